@@ -0,0 +1,605 @@
+/* -----------------------------------------------------------------------------
+
+  BrainBay  -  Version 2.0, GPL 2003-2017
+
+  MODULE:  ARCHIVE.CPP
+  Author:  Chris Veigl
+
+
+  This Module reads the archive file (the recording of the raw device data)
+  during playback:
+
+  The archive is mapped into memory when it is opened (map_captfile), the
+  packets are copied from the mapped view by read_captfile. When the file
+  cannot be mapped (e.g. no address space for a large file), a read window of
+  ARCHIVE_WINDOW bytes is refilled with ReadFile instead.
+
+  For integer-mode archives every packet has the same size, so a packet
+  position is found by a multiplication. Text-mode archives are scanned once
+  when they are opened (index_captfile): the byte offset of every
+  ARCHIVE_INDEX_STRIDE'th packet is stored in a packet index, and the session
+  length is set to the number of packets which were found. A seek
+  (seek_captfile) then only parses less than ARCHIVE_INDEX_STRIDE packets.
+
+  Compressed archives (v2) store the decoded packets instead of the device
+  bytes, so the playback does not run the protocol parser (play_captfile).
+  The packets are written in chunks of ARCHIVE_CHUNK_PACKETS. A chunk has a
+  header (ARCHIVECHUNKStruct) with the number of its first packet and the
+  arrival times of its first and last packet, followed by the coded values:
+  for every packet and value the difference to the value of the previous
+  packet, zigzag-mapped to an unsigned number and written as a varint
+  (7 bits per byte, the high bit marks a following byte). Only the values up
+  to the highest one which is used in the chunk are coded, the switches follow
+  as an additional value. Every chunk starts with zero as previous values and
+  can be decoded on its own. When the recording is closed, the file offset
+  and the first packet of every chunk are appended as an index, followed by
+  the number of chunks and ARCHIVE_INDEX_MAGIC. When the index is missing
+  (e.g. the recording was not closed), the chunk headers are scanned.
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; See the
+  GNU General Public License for more details.
+
+
+--------------------------------------------------------------------------------*/
+
+
+#include "brainBay.h"
+
+#define ARCHIVE_WINDOW        65536
+#define ARCHIVE_INDEX_STRIDE  64
+
+#define ARCHIVE_CODED_SIZE    (ARCHIVE_CHUNK_PACKETS*(MAX_EEG_CHANNELS*2+1)*5)
+
+typedef struct ARCHIVEWRITERStruct
+{
+	HANDLE                file;
+	ARCHIVEPACKETStruct   packet;      // packet assembled from the recorder buffers
+	int                   fill;
+	ARCHIVEPACKETStruct * chunk;       // packets of the actual chunk
+	int                   packets;
+	unsigned char *       coded;
+	DWORD *               index;       // file offset and first packet of the chunks
+	long                  chunks;
+	long                  allocated;
+	DWORD                 first;       // number of the next packet
+	DWORD                 filepos;
+	LONGLONG              start;
+	LONGLONG              freq;
+} ARCHIVEWRITERStruct;
+
+typedef struct ARCHIVEREADERStruct
+{
+	unsigned char *       data;        // coded data of the actual chunk
+	DWORD                 allocated;
+	unsigned char *       pos;
+	unsigned char *       end;
+	int                   left;        // packets left in the chunk
+	int                   values;
+	unsigned int          prev[MAX_EEG_CHANNELS*2+1];
+} ARCHIVEREADERStruct;
+
+ARCHIVEWRITERStruct  WRITER;
+ARCHIVEREADERStruct  READER;
+
+
+//  returns a pointer to the archive data at byte offset pos,
+//  avail receives the number of bytes which can be read from there
+unsigned char * archive_data(DWORD pos, int * avail)
+{
+	DWORD dwRead;
+
+	*avail=0;
+	if (pos>=CAPTFILE.size) return(NULL);
+	if (CAPTFILE.map)
+	{
+		*avail=CAPTFILE.size-pos;
+		return(CAPTFILE.map+pos);
+	}
+	if (!CAPTFILE.window) return(NULL);
+
+	if ((pos<CAPTFILE.windowpos) || (pos>=CAPTFILE.windowpos+CAPTFILE.windowlen))
+	{
+		CAPTFILE.windowlen=0;
+		SetFilePointer(CAPTFILE.filehandle,pos,NULL,FILE_BEGIN);
+		if (!ReadFile(CAPTFILE.filehandle,CAPTFILE.window,ARCHIVE_WINDOW,&dwRead,NULL) || (!dwRead))
+			return(NULL);
+		CAPTFILE.windowpos=pos;
+		CAPTFILE.windowlen=dwRead;
+	}
+	*avail=CAPTFILE.windowpos+CAPTFILE.windowlen-pos;
+	return(CAPTFILE.window+(pos-CAPTFILE.windowpos));
+}
+
+
+int map_captfile(void)
+{
+	CAPTFILE.size=GetFileSize(CAPTFILE.filehandle,NULL);
+	if (CAPTFILE.size==INVALID_FILE_SIZE) CAPTFILE.size=0;
+	CAPTFILE.readpos=0;
+	CAPTFILE.windowpos=0; CAPTFILE.windowlen=0;
+
+	if (CAPTFILE.size)
+	{
+		CAPTFILE.maphandle=CreateFileMapping(CAPTFILE.filehandle,NULL,PAGE_READONLY,0,0,NULL);
+		if (CAPTFILE.maphandle)
+		{
+			CAPTFILE.map=(unsigned char *)MapViewOfFile(CAPTFILE.maphandle,FILE_MAP_READ,0,0,0);
+			if (!CAPTFILE.map) { CloseHandle(CAPTFILE.maphandle); CAPTFILE.maphandle=NULL; }
+		}
+	}
+	if (!CAPTFILE.map)
+	{
+		write_logfile("archive could not be mapped, using read window");
+		CAPTFILE.window=(unsigned char *)malloc(ARCHIVE_WINDOW);
+		if (!CAPTFILE.window) { report_error("Could not allocate archive buffer"); return(FALSE); }
+	}
+	return(TRUE);
+}
+
+
+void unmap_captfile(void)
+{
+	if (CAPTFILE.map) UnmapViewOfFile(CAPTFILE.map);
+	if (CAPTFILE.maphandle) CloseHandle(CAPTFILE.maphandle);
+	if (CAPTFILE.window) free(CAPTFILE.window);
+	if (CAPTFILE.index) free(CAPTFILE.index);
+	if (READER.data) free(READER.data);
+	READER.data=NULL; READER.allocated=0; READER.left=0;
+	CAPTFILE.map=NULL; CAPTFILE.maphandle=NULL;
+	CAPTFILE.window=NULL; CAPTFILE.windowpos=0; CAPTFILE.windowlen=0;
+	CAPTFILE.index=NULL; CAPTFILE.indexcount=0;
+	CAPTFILE.size=0; CAPTFILE.readpos=0;
+}
+
+
+//  copies len bytes from the archive, returns the number of copied bytes
+int archive_copy(DWORD pos, void * dst, int len)
+{
+	unsigned char * p;
+	int avail,n,done=0;
+
+	while ((done<len) && ((p=archive_data(pos,&avail))!=NULL))
+	{
+		n=len-done; if (n>avail) n=avail;
+		memcpy((unsigned char *)dst+done,p,n);
+		done+=n; pos+=n;
+	}
+	return(done);
+}
+
+
+unsigned char * put_varint(unsigned char * p, unsigned int v)
+{
+	while (v>=0x80) { *p++=(unsigned char)(v|0x80); v>>=7; }
+	*p++=(unsigned char)v;
+	return(p);
+}
+
+unsigned char * get_varint(unsigned char * p, unsigned char * end, unsigned int * v)
+{
+	unsigned int r=0;
+	int shift=0;
+
+	while ((p<end) && (shift<35))
+	{
+		r|=(unsigned int)(*p&0x7f)<<shift;
+		shift+=7;
+		if (!(*p++&0x80)) break;
+	}
+	*v=r;
+	return(p);
+}
+
+unsigned int zigzag(int v) { return(((unsigned int)v<<1) ^ (unsigned int)(v>>31)); }
+int unzigzag(unsigned int v) { return((int)(v>>1) ^ -(int)(v&1)); }
+
+
+//  reads the chunk header at pos, returns FALSE when there is no valid chunk
+int read_archive_chunkheader(DWORD pos, ARCHIVECHUNKStruct * head)
+{
+	if (archive_copy(pos,head,sizeof(ARCHIVECHUNKStruct))!=sizeof(ARCHIVECHUNKStruct)) return(FALSE);
+	if ((head->magic!=ARCHIVE_CHUNK_MAGIC) || (head->values>MAX_EEG_CHANNELS*2)) return(FALSE);
+	if (head->length>CAPTFILE.size-pos-sizeof(ARCHIVECHUNKStruct)) return(FALSE);
+	return(TRUE);
+}
+
+
+//  compressed archive: loads the chunk index from the end of the file or
+//  scans the chunk headers, when the index is missing
+void index_archive_chunks(void)
+{
+	ARCHIVECHUNKStruct head;
+	DWORD trailer[2],pos,*entries;
+	long t,count=0;
+
+	CAPTFILE.length=0;
+	if (CAPTFILE.size>=CAPTFILE.data_begin+sizeof(trailer))
+	{
+		archive_copy(CAPTFILE.size-sizeof(trailer),trailer,sizeof(trailer));
+		if ((trailer[1]==ARCHIVE_INDEX_MAGIC) && (trailer[0]>0) &&
+			(trailer[0]<=(CAPTFILE.size-CAPTFILE.data_begin-sizeof(trailer))/(2*sizeof(DWORD))))
+			count=trailer[0];
+	}
+
+	if (count)
+	{
+		entries=(DWORD *)malloc(count*2*sizeof(DWORD));
+		CAPTFILE.index=(DWORD *)malloc(count*sizeof(DWORD));
+		if ((!entries) || (!CAPTFILE.index)) { free(entries); free(CAPTFILE.index); CAPTFILE.index=NULL; return; }
+		pos=CAPTFILE.size-sizeof(trailer)-count*2*sizeof(DWORD);
+		archive_copy(pos,entries,count*2*sizeof(DWORD));
+		for (t=0;t<count;t++) CAPTFILE.index[t]=entries[t*2];
+		free(entries);
+		CAPTFILE.indexcount=count;
+		if (read_archive_chunkheader(CAPTFILE.index[count-1],&head))
+			CAPTFILE.length=head.first+head.packets;
+		else count=0;
+	}
+
+	if (!count)
+	{   // no index: scan the chunks
+		long allocated=0;
+
+		if (CAPTFILE.index) free(CAPTFILE.index);
+		CAPTFILE.index=NULL; CAPTFILE.indexcount=0;
+		pos=CAPTFILE.data_begin;
+		while (read_archive_chunkheader(pos,&head))
+		{
+			if (CAPTFILE.indexcount>=allocated)
+			{
+				allocated+=1024;
+				CAPTFILE.index=(DWORD *)realloc(CAPTFILE.index,allocated*sizeof(DWORD));
+				if (!CAPTFILE.index) { CAPTFILE.indexcount=0; CAPTFILE.length=0; return; }
+			}
+			CAPTFILE.index[CAPTFILE.indexcount++]=pos;
+			CAPTFILE.length=head.first+head.packets;
+			pos+=sizeof(ARCHIVECHUNKStruct)+head.length;
+		}
+		write_logfile("archive without chunk index, %ld chunks found",CAPTFILE.indexcount);
+	}
+	write_logfile("compressed archive: %ld packets in %ld chunks",CAPTFILE.length,CAPTFILE.indexcount);
+}
+
+
+//  loads the chunk at pos for decoding, returns the number of its first packet or -1
+long load_archive_chunk(DWORD pos)
+{
+	ARCHIVECHUNKStruct head;
+
+	READER.left=0;
+	if (!read_archive_chunkheader(pos,&head)) return(-1);
+	if (head.length>READER.allocated)
+	{
+		if (READER.data) free(READER.data);
+		READER.data=(unsigned char *)malloc(head.length);
+		READER.allocated=READER.data ? head.length : 0;
+		if (!READER.data) return(-1);
+	}
+	pos+=sizeof(ARCHIVECHUNKStruct);
+	if (archive_copy(pos,READER.data,head.length)!=(int)head.length) return(-1);
+
+	READER.pos=READER.data;
+	READER.end=READER.data+head.length;
+	READER.left=head.packets;
+	READER.values=head.values;
+	memset(READER.prev,0,sizeof(READER.prev));
+	CAPTFILE.readpos=pos+head.length;
+	return(head.first);
+}
+
+
+//  decodes the next packet of the chunk to PACKET.buffer
+void decode_archive_packet(void)
+{
+	unsigned int v;
+	int x;
+
+	for (x=0;x<=READER.values;x++)
+	{
+		READER.pos=get_varint(READER.pos,READER.end,&v);
+		READER.prev[x]+=(unsigned int)unzigzag(v);
+	}
+	memcpy(PACKET.buffer,READER.prev,READER.values*sizeof(unsigned int));
+	memset(PACKET.buffer+READER.values,0,(MAX_EEG_CHANNELS*2-READER.values)*sizeof(unsigned int));
+	PACKET.switches=(unsigned char)READER.prev[READER.values];
+	READER.left--;
+}
+
+
+void seek_archive_packet(long packet)
+{
+	long entry,first;
+
+	READER.left=0;
+	CAPTFILE.readpos=CAPTFILE.data_begin;
+	if (!CAPTFILE.indexcount) return;
+
+	entry=packet/ARCHIVE_CHUNK_PACKETS;
+	if (entry>=CAPTFILE.indexcount) entry=CAPTFILE.indexcount-1;
+	first=load_archive_chunk(CAPTFILE.index[entry]);
+	if (first<0) return;
+	while ((first<packet) && (READER.left)) { decode_archive_packet(); first++; }
+}
+
+
+//  called when the archive was opened or the devicetype was changed
+void index_captfile(void)
+{
+	unsigned char * p;
+	int avail,i,bpp,found,allocated=0;
+	long values=0;
+	DWORD pos;
+
+	if ((!CAPTFILE.map) && (!CAPTFILE.window)) return;
+	CAPTFILE.readpos=CAPTFILE.data_begin;
+	if (CAPTFILE.index) free(CAPTFILE.index);
+	CAPTFILE.index=NULL; CAPTFILE.indexcount=0;
+	READER.left=0;
+	if (CAPTFILE.filetype==FILE_COMPRESSED) { index_archive_chunks(); return; }
+	if (CAPTFILE.filetype!=FILE_TEXTMODE) return;
+
+	bpp=TTY.bytes_per_packet; if (bpp<1) bpp=1;
+	pos=CAPTFILE.data_begin;
+	do
+	{
+		if (CAPTFILE.indexcount>=allocated)
+		{
+			allocated+=1024;
+			CAPTFILE.index=(DWORD *)realloc(CAPTFILE.index,allocated*sizeof(DWORD));
+			if (!CAPTFILE.index) { CAPTFILE.indexcount=0; return; }
+		}
+		CAPTFILE.index[CAPTFILE.indexcount++]=pos;
+
+		// find the beginning of the next indexed packet
+		found=0;
+		while ((!found) && ((p=archive_data(pos,&avail))!=NULL))
+		{
+			for (i=0;(i<avail)&&(!found);i++)
+				if ((p[i]==',') && (++values % (bpp*ARCHIVE_INDEX_STRIDE)==0)) found=1;
+			pos+=i;
+		}
+	} while (found && (pos<CAPTFILE.size));
+
+	CAPTFILE.length=values/bpp;
+	write_logfile("archive index: %ld packets, %ld index entries",CAPTFILE.length,CAPTFILE.indexcount);
+}
+
+
+void seek_captfile(long packet)
+{
+	unsigned char * p;
+	int avail,i,bpp;
+	long skip,entry;
+	DWORD pos;
+
+	bpp=TTY.bytes_per_packet; if (bpp<1) bpp=1;
+	if (packet<0) packet=0;
+
+	if (CAPTFILE.filetype==FILE_COMPRESSED)
+	{
+		seek_archive_packet(packet);
+		return;
+	}
+
+	if ((CAPTFILE.filetype!=FILE_TEXTMODE) || (!CAPTFILE.indexcount))
+	{
+		pos=CAPTFILE.data_begin+packet*bpp;
+		if (pos>CAPTFILE.size) pos=CAPTFILE.data_begin;
+		CAPTFILE.readpos=pos;
+		return;
+	}
+
+	entry=packet/ARCHIVE_INDEX_STRIDE;
+	if (entry>=CAPTFILE.indexcount) entry=CAPTFILE.indexcount-1;
+	pos=CAPTFILE.index[entry];
+	skip=(packet-entry*ARCHIVE_INDEX_STRIDE)*bpp;
+
+	while ((skip>0) && ((p=archive_data(pos,&avail))!=NULL))
+	{
+		for (i=0;(i<avail)&&(skip>0);i++)
+			if (p[i]==',') skip--;
+		pos+=i;
+	}
+	if (pos>=CAPTFILE.size) pos=CAPTFILE.data_begin;
+	CAPTFILE.readpos=pos;
+}
+
+
+void read_captfile(int amount)
+{
+	unsigned char * p;
+	char act[20];
+	int avail,i,n,actpos=0,actbufpos=0,wrapped=-1;
+
+	while (actbufpos<amount)
+	{
+		p=archive_data(CAPTFILE.readpos,&avail);
+		if (!p)
+		{   // end of the archive: continue from the first packet
+			if (wrapped==actbufpos) break;   // no data in the archive
+			wrapped=actbufpos;
+			CAPTFILE.readpos=CAPTFILE.data_begin;
+			continue;
+		}
+
+		if (CAPTFILE.filetype==FILE_TEXTMODE)
+		{
+			for (i=0;(i<avail)&&(actbufpos<amount);i++)
+			{
+				switch (p[i])
+				{
+					case ' ': case 10: case 13: break;
+					case ',':
+						act[actpos]=0;
+						TTY.readBuf[actbufpos++]=(unsigned char)atoi(act);
+						actpos=0;
+						break;
+					default: if (actpos<(int)sizeof(act)-1) act[actpos++]=p[i];
+				}
+			}
+			CAPTFILE.readpos+=i;
+		}
+		else
+		{
+			n=amount-actbufpos;
+			if (n>avail) n=avail;
+			memcpy(TTY.readBuf+actbufpos,p,n);
+			actbufpos+=n;
+			CAPTFILE.readpos+=n;
+		}
+	}
+}
+
+
+//  playback position in per mille, for the archive position bar
+int captfile_position(void)
+{
+	if (CAPTFILE.size<=(DWORD)CAPTFILE.data_begin) return(0);
+	return((int)((double)(CAPTFILE.readpos-CAPTFILE.data_begin)*1000.0/(CAPTFILE.size-CAPTFILE.data_begin)));
+}
+
+
+//  plays the next packet (compressed archives) or the next bytes of the archive
+void play_captfile(void)
+{
+	if (CAPTFILE.filetype!=FILE_COMPRESSED)
+	{
+		read_captfile(TTY.amount_to_read);
+		ParseLocalInput(TTY.amount_to_read);
+		return;
+	}
+
+	if (!READER.left)
+	{   // next chunk, at the end of the archive continue from the first chunk
+		if ((load_archive_chunk(CAPTFILE.readpos)<0) || (!READER.left))
+			if ((load_archive_chunk(CAPTFILE.data_begin)<0) || (!READER.left)) return;
+	}
+	decode_archive_packet();
+	PACKET.arrival=0;
+	process_packets();
+}
+
+
+//  compressed archive: writes the packets of the actual chunk
+int write_archive_chunk(void)
+{
+	ARCHIVECHUNKStruct head;
+	ARCHIVEPACKETStruct * pk;
+	unsigned int prev[MAX_EEG_CHANNELS*2+1];
+	unsigned char * p;
+	int i,x,values=0;
+	DWORD dwWritten;
+
+	if (!WRITER.packets) return(TRUE);
+
+	for (i=0;i<WRITER.packets;i++)
+		for (x=values;x<MAX_EEG_CHANNELS*2;x++)
+			if (WRITER.chunk[i].buffer[x]) values=x+1;
+
+	memset(prev,0,sizeof(prev));
+	p=WRITER.coded;
+	for (i=0;i<WRITER.packets;i++)
+	{
+		pk=&WRITER.chunk[i];
+		for (x=0;x<values;x++)
+		{
+			p=put_varint(p,zigzag((int)(pk->buffer[x]-prev[x])));
+			prev[x]=pk->buffer[x];
+		}
+		p=put_varint(p,zigzag((int)pk->switches-(int)prev[values]));
+		prev[values]=pk->switches;
+	}
+
+	head.magic=ARCHIVE_CHUNK_MAGIC;
+	head.first=WRITER.first;
+	head.packets=(WORD)WRITER.packets;
+	head.values=(BYTE)values;
+	head.reserved=0;
+	head.length=(DWORD)(p-WRITER.coded);
+	head.first_arrival=(WRITER.chunk[0].arrival-WRITER.start)*1000000/WRITER.freq;
+	head.last_arrival=(WRITER.chunk[WRITER.packets-1].arrival-WRITER.start)*1000000/WRITER.freq;
+
+	if (!WriteFile(WRITER.file,&head,sizeof(head),&dwWritten,NULL) || (dwWritten!=sizeof(head))) return(FALSE);
+	if (!WriteFile(WRITER.file,WRITER.coded,head.length,&dwWritten,NULL) || (dwWritten!=head.length)) return(FALSE);
+
+	if (WRITER.chunks>=WRITER.allocated)
+	{
+		WRITER.allocated+=1024;
+		WRITER.index=(DWORD *)realloc(WRITER.index,WRITER.allocated*2*sizeof(DWORD));
+		if (!WRITER.index) { WRITER.chunks=0; WRITER.allocated=0; return(FALSE); }
+	}
+	WRITER.index[WRITER.chunks*2]=WRITER.filepos;
+	WRITER.index[WRITER.chunks*2+1]=WRITER.first;
+	WRITER.chunks++;
+
+	WRITER.filepos+=sizeof(head)+head.length;
+	WRITER.first+=WRITER.packets;
+	WRITER.packets=0;
+	RECORDER.written+=sizeof(head)+head.length;
+	return(TRUE);
+}
+
+
+int start_archive_writer(HANDLE hFile)
+{
+	if (!WRITER.chunk) WRITER.chunk=(ARCHIVEPACKETStruct *)malloc(ARCHIVE_CHUNK_PACKETS*sizeof(ARCHIVEPACKETStruct));
+	if (!WRITER.coded) WRITER.coded=(unsigned char *)malloc(ARCHIVE_CODED_SIZE);
+	if ((!WRITER.chunk) || (!WRITER.coded)) { report_error("Could not allocate archive buffers"); return(FALSE); }
+
+	WRITER.file=hFile;
+	WRITER.fill=0; WRITER.packets=0;
+	WRITER.chunks=0; WRITER.first=0;
+	WRITER.filepos=SetFilePointer(hFile,0,NULL,FILE_CURRENT);
+	WRITER.start=0;
+	QueryPerformanceFrequency((_LARGE_INTEGER *)&WRITER.freq);
+	if (!WRITER.freq) WRITER.freq=1;
+	return(TRUE);
+}
+
+
+//  called by the recorder thread with the packets from record_packet
+int write_archive_packets(unsigned char * buf, int len)
+{
+	int n;
+
+	while (len>0)
+	{
+		n=sizeof(ARCHIVEPACKETStruct)-WRITER.fill;
+		if (n>len) n=len;
+		memcpy((unsigned char *)&WRITER.packet+WRITER.fill,buf,n);
+		WRITER.fill+=n; buf+=n; len-=n;
+
+		if (WRITER.fill==sizeof(ARCHIVEPACKETStruct))
+		{
+			WRITER.fill=0;
+			if ((!WRITER.first) && (!WRITER.packets)) WRITER.start=WRITER.packet.arrival;
+			WRITER.chunk[WRITER.packets++]=WRITER.packet;
+			if (WRITER.packets==ARCHIVE_CHUNK_PACKETS)
+				if (!write_archive_chunk()) return(FALSE);
+		}
+	}
+	return(TRUE);
+}
+
+
+//  writes the last chunk and the chunk index, called when the recording is closed
+int finish_archive_writer(void)
+{
+	DWORD trailer[2],dwWritten;
+	int res;
+
+	res=write_archive_chunk();
+	if (res && WRITER.chunks)
+	{
+		res=WriteFile(WRITER.file,WRITER.index,WRITER.chunks*2*sizeof(DWORD),&dwWritten,NULL);
+		trailer[0]=WRITER.chunks;
+		trailer[1]=ARCHIVE_INDEX_MAGIC;
+		if (res) res=WriteFile(WRITER.file,trailer,sizeof(trailer),&dwWritten,NULL);
+	}
+	write_logfile("compressed archive: %ld packets in %ld chunks",(long)WRITER.first,WRITER.chunks);
+	if (WRITER.index) free(WRITER.index);
+	WRITER.index=NULL; WRITER.allocated=0; WRITER.chunks=0;
+	return(res);
+}
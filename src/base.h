@@ -38,16 +38,36 @@
   the number of in- and outports and the pass_value() - function, which copies 
   a specified value to the in-ports of the linked objects
 
+  the links of each output port are compiled into the fanout-table (see 
+  schedule.cpp), so pass_values() only visits the consumers of the port.
+
+  when the profiler is active (see profile.cpp), pass_values() measures the
+  time of the pass and of each incoming_data() - call of the consumers.
+
+  the port descriptions (in_ports, out_ports) and the link-table (out) are
+  allocated outside the object, so the runtime data of the elements stays
+  compact. the link-table grows with the number of links (reserve_links),
+  it is terminated by an entry with to_port==-1. the port tables start with
+  DEF_PORTS entries and grow up to MAX_PORTS (reserve_ports), for elements
+  with many channels (EDF-files or network streams).
+
+  for block processing (see block.cpp), work_block() processes a number of 
+  queued packets at once. the default implementation replays the block sample
+  by sample via incoming_data() and work(), elements can override it and 
+  forward whole blocks with pass_block()
+
 
   
 -----------------------------------------------------------------------------*/
 
-// array bounds for objects and connections
-#define MAX_CONNECTS 50
-#define MAX_PORTS 32
-#define MAX_EEG_CHANNELS  32
-#define MAX_OBJECTS 150
+// array bounds for ports and channels
+#define MAX_PORTS 256           // upper bound of the port tables, see reserve_ports
+#define DEF_PORTS 32            // initial size of the port tables
+#define MAX_EEG_CHANNELS  32    // channels of a device packet
+#define MAX_CHANNELS 256        // channels of EDF-files and network streams
 #define MAX_VECTOR_SIZE 2000
+#define MAX_BLOCKSIZE 64
+#define MAX_WORKERS 16
 
 // Signal value definitions
 #define TRUE_VALUE         512 
@@ -62,12 +82,14 @@
 
 
 void report_error( char * Message );
-extern class BASE_CL * objects[MAX_OBJECTS];
+extern class BASE_CL ** objects;
 extern class BASE_CL * actobject;
 extern class BASE_CL * deviceobject;
 extern class BASE_CL * copy_object;
 extern int actport;
 extern struct LINKStruct * actconnect;
+extern volatile int profiling;
+extern volatile LONG profile_generation;
 
 typedef enum PORTTYPE{
 	SFLOAT = 0, MFLOAT = 1
@@ -102,6 +124,40 @@ typedef struct INPORTStruct
 	PORTTYPE in_type;
 } INPORTStruct ;
 
+typedef struct BLOCKPORTStruct
+{
+	float value[MAX_BLOCKSIZE];
+	unsigned char set[MAX_BLOCKSIZE];   // sample was passed to this port
+	int   written;
+} BLOCKPORTStruct ;
+
+typedef struct FANOUTStruct
+{
+	class BASE_CL * obj;
+	int port;
+} FANOUTStruct ;
+
+#define PROFILE_BINS 96      // histogram of durations, 4 bins per octave of timer ticks
+
+typedef struct PROFILECOUNTERStruct
+{
+	long     calls;
+	LONGLONG total;          // QueryPerformanceCounter - ticks
+	LONGLONG min;
+	LONGLONG max;
+	unsigned int bins[PROFILE_BINS];
+} PROFILECOUNTERStruct ;
+
+typedef struct PROFILEStruct
+{
+	PROFILECOUNTERStruct work;
+	PROFILECOUNTERStruct incoming;
+	PROFILECOUNTERStruct pass;
+	PROFILECOUNTERStruct latency;   // packet arrival to output action (output elements)
+	LONG     generation;            // counters are valid for this profile_generation
+	LONGLONG replay;                // incoming_data() - time within the actual work_block()
+} PROFILEStruct ;
+
 typedef struct LINKStruct
 {
 	int from_object;
@@ -130,18 +186,44 @@ class BASE_CL
 	char tag[30];
 	HWND displayWnd;
 
-	OUTPORTStruct out_ports[MAX_PORTS];
-	INPORTStruct  in_ports[MAX_PORTS];
+	OUTPORTStruct * out_ports;                // port_count entries
+	INPORTStruct  * in_ports;                 // port_count entries
+	int           port_count;
 
-	LINKStruct  out[MAX_CONNECTS];
+	LINKStruct  * out;                        // link-table, out_size entries
+	int           out_size;
     HWND hDlg;
 
+	FANOUTStruct * fanout;                    // consumers of port p: fanout[fanout_start[p]] .. fanout[fanout_start[p+1]-1]
+	int           fanout_size;
+	int         * fanout_start;               // port_count+1 entries
+
+	BLOCKPORTStruct ** in_block;              // port_count entries
+	int block_ports;
+	int block_pos;
+
+	PROFILEStruct * volatile prof;            // execution times, allocated by the profiler
+
 	BASE_CL (void)
 	{
-		int i;
 		width=0; height=0; displayWnd=NULL;
 		tag[0]=0;
-		for (i=0;i<MAX_PORTS;i++) 
+		block_ports=0; block_pos=-1;
+		port_count=DEF_PORTS;
+		in_ports=(INPORTStruct *)malloc(port_count*sizeof(INPORTStruct));
+		out_ports=(OUTPORTStruct *)malloc(port_count*sizeof(OUTPORTStruct));
+		fanout_start=(int *)calloc(port_count+1,sizeof(int));
+		in_block=(BLOCKPORTStruct **)calloc(port_count,sizeof(BLOCKPORTStruct *));
+		out=NULL; out_size=0;
+		fanout=NULL; fanout_size=0;
+		prof=NULL;
+		init_ports(0,port_count);
+		reserve_links(0);
+	}
+	void init_ports (int from, int to)
+	{
+		int i;
+		for (i=from;i<to;i++) 
 		{  
 		   in_ports[i].in_name[0]=0; 
 		   strcpy(in_ports[i].in_desc,"none");
@@ -159,16 +241,20 @@ class BASE_CL
 		   out_ports[i].get_range=0;
 		   out_ports[i].out_type = SFLOAT;
 		}
-
-		for (i=0;i<MAX_CONNECTS;i++) 
-		{  out[i].min=-1.0f;
-		   out[i].max=1.0f;
-		   strcpy(out[i].dimension,"none");
-		   strcpy(out[i].description,"none");
-		}
 	}
-	virtual ~BASE_CL (void) {}
+	virtual ~BASE_CL (void)
+	{
+		free_block_inputs();
+		free(in_ports);
+		free(out_ports);
+		free(fanout_start);
+		free(in_block);
+		free(out);
+		free(fanout);
+		delete prof;
+	}
 	virtual void work (void) {}
+	virtual void work_block (int count);
 	virtual void update_inports (void) {}
 	virtual void session_start (void) {}
 	virtual void session_stop (void) {}
@@ -184,18 +270,34 @@ class BASE_CL
 	
 	void pass_values (int port, float value)
 	{
-		LINKStruct * act_link;
-		for (act_link=&(out[0]);act_link->to_port!=-1;act_link++)
-			if (act_link->from_port==port)
-			   objects[act_link->to_object]->incoming_data(act_link->to_port, value );
+		FANOUTStruct * f, * end;
+		if (block_pos>=0) { pass_block_value(port, block_pos, value); return; }
+		if (profiling) { profile_pass_values(port, value); return; }
+		for (f=&fanout[fanout_start[port]],end=&fanout[fanout_start[port+1]];f<end;f++)
+			f->obj->incoming_data(f->port, value );
 	}
 	void pass_values (int port, float *value, int count)
 	{
-		LINKStruct * act_link;
-		for (act_link=&(out[0]);act_link->to_port!=-1;act_link++)
-			if (act_link->from_port==port)
-				if (objects[act_link->to_object])
-					objects[act_link->to_object]->incoming_data(act_link->to_port, value, count );
+		FANOUTStruct * f, * end;
+		if (profiling) { profile_pass_values(port, value, count); return; }
+		for (f=&fanout[fanout_start[port]],end=&fanout[fanout_start[port+1]];f<end;f++)
+			f->obj->incoming_data(f->port, value, count );
 	}
+	// profiler, implemented in profile.cpp
+	void profile_pass_values (int port, float value);
+	void profile_pass_values (int port, float *value, int count);
+	void build_fanout (void);
+	void clear_fanout (void);
+	LINKStruct * reserve_links (int count);
+	int reserve_ports (int count);
+	void remove_link (int num);
+
+	// block processing, implemented in block.cpp
+	void pass_block (int port, const float * values, int count, int pos=0);
+	void pass_block_value (int port, int pos, float value);
+	BLOCKPORTStruct * get_block_port (int port);
+	float * get_block_input (int port, int count, float * hold);
+	void clear_block_inputs (void);
+	void free_block_inputs (void);
 };
 
@@ -0,0 +1,255 @@
+/* -----------------------------------------------------------------------------
+
+  BrainBay  -  Version 2.0, GPL 2003-2017
+
+  MODULE:  BLOCK.CPP
+  Author:  Chris Veigl
+
+
+  This Module provides block processing of the signal-flow:
+
+  When a block size > 1 is selected in the application settings, process_packets()
+  does not call the work() - functions of all elements for each incoming packet,
+  but queues the packets (channel values, switches, arrival time and timing counters)
+  in the BLOCK - structure. When the block is full (or the session stops), all objects
+  process the queued packets in one work_block() - call.
+
+  The default work_block() of BASE_CL replays the block sample by sample: the
+  timing counters of each sample are restored, the values passed to the in-ports
+  at this sample are delivered via incoming_data() and work() is called, so all
+  elements work as before. Elements with a hot inner loop (EEG, FILTER, FFT,
+  AVERAGE, DEVIATION, MAGNITUDE, LIMITER, MIXER, EVALUATOR) override work_block()
+  and process the whole block with one call, passing their results via pass_block().
+
+  Block processing is only used if the design allows it (see update_blockmode):
+  designs with feedback-connections in the execution plan, vector ports, the session manager or
+  devices which deliver their data outside the PACKET - structure fall back to
+  per-packet processing. The block size adds up to (size-1) packets of latency.
+
+  Catch-up blocks: when the timer finds more than one packet due (sampling rates
+  above the 1 ms - timer resolution, or a late timer tick), pace_packets() sets
+  BLOCK.catchup and the due packets are processed as one block, also when the
+  block size is 1. This adds no latency, the block ends with the timer tick.
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; See the
+  GNU General Public License for more details.
+
+
+--------------------------------------------------------------------------------*/
+
+
+#include "brainBay.h"
+
+
+//
+//  BASE_CL block functions
+//
+
+BLOCKPORTStruct * BASE_CL::get_block_port(int port)
+{
+	if ((port<0) || (port>=port_count)) return(NULL);
+	if (!in_block[port])
+	{
+		in_block[port] = new BLOCKPORTStruct;
+		memset(in_block[port],0,sizeof(BLOCKPORTStruct));
+		if (port>=block_ports) block_ports=port+1;
+	}
+	return(in_block[port]);
+}
+
+void BASE_CL::pass_block_value(int port, int pos, float value)
+{
+	FANOUTStruct * f, * end;
+	BLOCKPORTStruct * bp;
+
+	for (f=&fanout[fanout_start[port]],end=&fanout[fanout_start[port+1]];f<end;f++)
+	{
+		bp=f->obj->get_block_port(f->port);
+		if (!bp) continue;
+		bp->value[pos]=value;
+		bp->set[pos]=1;
+		bp->written=1;
+	}
+}
+
+void BASE_CL::pass_block(int port, const float * values, int count, int pos)
+{
+	FANOUTStruct * f, * end;
+	BLOCKPORTStruct * bp;
+
+	if (block_pos<0)   // not processing a block: deliver the values one by one
+	{
+		for (int i=0;i<count;i++) pass_values(port,values[i]);
+		return;
+	}
+
+	for (f=&fanout[fanout_start[port]],end=&fanout[fanout_start[port+1]];f<end;f++)
+	{
+		bp=f->obj->get_block_port(f->port);
+		if (!bp) continue;
+		memcpy(&bp->value[pos],values,count*sizeof(float));
+		memset(&bp->set[pos],1,count);
+		bp->written=1;
+	}
+}
+
+//  returns the values of an in-port for the actual block. samples where
+//  no value was passed hold the previous value (like the per-sample members
+//  of the elements), hold is updated to the last value of the block
+float * BASE_CL::get_block_input(int port, int count, float * hold)
+{
+	BLOCKPORTStruct * bp;
+	int i;
+
+	bp=get_block_port(port);
+	if (!bp) return(NULL);
+	for (i=0;i<count;i++)
+	{
+		if (bp->set[i]) *hold=bp->value[i];
+		else bp->value[i]=*hold;
+	}
+	return(bp->value);
+}
+
+void BASE_CL::clear_block_inputs(void)
+{
+	for (int p=0;p<block_ports;p++)
+		if ((in_block[p]) && (in_block[p]->written))
+		{
+			memset(in_block[p]->set,0,sizeof(in_block[p]->set));
+			in_block[p]->written=0;
+		}
+}
+
+void BASE_CL::free_block_inputs(void)
+{
+	for (int p=0;p<block_ports;p++)
+		if (in_block[p]) { delete in_block[p]; in_block[p]=NULL; }
+	block_ports=0;
+}
+
+//  default: replay the block sample by sample
+void BASE_CL::work_block(int count)
+{
+	int i,p;
+
+	for (i=0;i<count;i++)
+	{
+		set_block_sample(i);
+		block_pos=i;
+		for (p=0;p<block_ports;p++)
+			if ((in_block[p]) && (in_block[p]->set[i]))
+			{
+				if (profiling) profile_incoming(this,p,in_block[p]->value[i]);
+				else incoming_data(p,in_block[p]->value[i]);
+			}
+		work();
+	}
+}
+
+
+
+//
+//  block queue
+//
+
+void set_block_sample(int i)
+{
+	TIMING.packetcounter=BLOCK.packetcounter[i];
+	TIMING.dialog_update=BLOCK.dialog_update[i];
+	TIMING.draw_update=BLOCK.draw_update[i];
+	PACKET.timestamp=BLOCK.timestamp[i];
+	PACKET.work_clocktime=BLOCK.clocktime[i];
+}
+
+//  returns TRUE if one of the samples of the block is a dialog- or
+//  draw- update sample (pass BLOCK.dialog_update or BLOCK.draw_update)
+int block_update_due(int * update, int count)
+{
+	for (int i=0;i<count;i++)
+		if (!update[i]) return(TRUE);
+	return(FALSE);
+}
+
+void update_blockmode(void)
+{
+	int t,i,active;
+
+	active = (!GLOBAL.neurobit_available) &&
+		     (!GLOBAL.emotiv_available) && (!GLOBAL.ganglion_available) &&
+			 (!EXECPLAN->feedback);
+
+	for (t=0;(t<GLOBAL.objects)&&(active);t++)
+	{
+		if (objects[t]->type==OB_SESSIONMANAGER) active=FALSE;
+		for (i=0;i<objects[t]->inports;i++)
+			if (objects[t]->in_ports[i].in_type==MFLOAT) active=FALSE;
+		for (i=0;i<objects[t]->outports;i++)
+			if (objects[t]->out_ports[i].out_type==MFLOAT) active=FALSE;
+	}
+	BLOCK.possible=active;
+	active = active && (BLOCK.size>1);
+
+	if (active!=BLOCK.active)
+	{
+		process_block();
+		if (active) write_logfile("block processing enabled, block size %d",BLOCK.size);
+		else if (BLOCK.size>1) write_logfile("block processing not possible for this design");
+	}
+	BLOCK.active=active;
+}
+
+void queue_block_packet(void)
+{
+	int i=BLOCK.count;
+	int size=BLOCK.size;
+
+	BLOCK.packetcounter[i]=TIMING.packetcounter;
+	BLOCK.dialog_update[i]=TIMING.dialog_update;
+	BLOCK.draw_update[i]=TIMING.draw_update;
+	memcpy(BLOCK.buffer[i],PACKET.work_buffer,sizeof(PACKET.work_buffer));
+	BLOCK.switches[i]=PACKET.work_switches;
+	BLOCK.timestamp[i]=PACKET.timestamp;
+	BLOCK.clocktime[i]=PACKET.work_clocktime;
+	BLOCK.count++;
+
+	if (BLOCK.catchup>size) size=BLOCK.catchup;
+	if ((BLOCK.count>=size)||(BLOCK.count>=MAX_BLOCKSIZE)) process_block();
+}
+
+void process_block(void)
+{
+	int count;
+	long sav_packetcounter;
+	int sav_dialog_update,sav_draw_update;
+	LONGLONG sav_timestamp,sav_clocktime;
+
+	count=BLOCK.count;
+	if (!count) return;
+	if (!enter_processing()) return;
+	BLOCK.count=0;
+
+	sav_packetcounter=TIMING.packetcounter;
+	sav_dialog_update=TIMING.dialog_update;
+	sav_draw_update=TIMING.draw_update;
+	sav_timestamp=PACKET.timestamp;
+	sav_clocktime=PACKET.work_clocktime;
+
+	execute_plan(count);
+
+	TIMING.packetcounter=sav_packetcounter;
+	TIMING.dialog_update=sav_dialog_update;
+	TIMING.draw_update=sav_draw_update;
+	PACKET.timestamp=sav_timestamp;
+	PACKET.work_clocktime=sav_clocktime;
+	leave_processing();
+}
+
+void discard_block(void)
+{
+	BLOCK.count=0;
+	for (int t=0;t<GLOBAL.objects;t++)
+		if (objects[t]) objects[t]->clear_block_inputs();
+}
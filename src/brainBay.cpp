@@ -111,6 +111,9 @@ int APIENTRY WinMain(HINSTANCE hInstance,
 	if ((strstr(lpCmdLine,"-d")) || (strstr(lpCmdLine,"--debug")))
 	{ AllocConsole();	freopen("CONOUT$", "w", stdout); } // open console window for debugging 
 
+	if (strstr(lpCmdLine,"--headless"))
+	{ GLOBAL.headless=1; AllocConsole();	freopen("CONOUT$", "w", stdout); } // batch mode, see headless.cpp
+
 	printf("commandline:%s\n",lpCmdLine);
 	init_path();
 	register_classes(hInstance);
@@ -123,6 +126,12 @@ int APIENTRY WinMain(HINSTANCE hInstance,
 	create_logfile();
 	write_logfile("BrainBay start.");
 	GlobalInitialize();
+	if (GLOBAL.headless) 
+	{
+		int result=run_headless(lpCmdLine);
+		DestroyWindow(ghWndMain);
+		return(result);
+	}
 
 	if(!(ghWndDesign=CreateWindow("Design_Class", "Design", WS_CLIPSIBLINGS | WS_CAPTION  | WS_THICKFRAME | WS_CHILD | WS_HSCROLL | WS_VSCROLL ,GLOBAL.design_left, GLOBAL.design_top, GLOBAL.design_right-GLOBAL.design_left, GLOBAL.design_bottom-GLOBAL.design_top, ghWndMain, NULL, hInst, NULL))) 
 	    report_error("can't create Design Window");
@@ -382,6 +391,9 @@ LRESULT CALLBACK MainWndHandler(HWND hWnd, UINT message, WPARAM wParam, LPARAM l
 					close_toolbox();
 					display_toolbox(CreateDialog(hInst, (LPCTSTR)IDD_EDITSCALEBOX, ghWndStatusbox, (DLGPROC)SCALEDlgHandler));
 					break;
+				case IDM_PROFILER:
+					open_profiler();
+					break;
 				case IDM_SETTINGS:
                      if (ghWndSettings==NULL) ghWndSettings=CreateDialog(hInst, (LPCTSTR)IDD_SETTINGSBOX, ghWndStatusbox, (DLGPROC)SETTINGSDlgHandler);
 					 else SetForegroundWindow(ghWndSettings);
@@ -530,6 +542,8 @@ LRESULT CALLBACK MainWndHandler(HWND hWnd, UINT message, WPARAM wParam, LPARAM l
 					break;
 				case IDM_INSERTBUTTON:create_object(OB_BUTTON);
 					break;
+				case IDM_INSERTAUXDEVICE:create_object(OB_AUXDEVICE);
+					break;
 
 				// here are the supported EED devices
 				case IDM_INSERT_EEG_GENERIC8: 
@@ -654,6 +668,7 @@ LRESULT CALLBACK MainWndHandler(HWND hWnd, UINT message, WPARAM wParam, LPARAM l
 										}
 								} while (occlude);
 							}
+							end_config_section();
 							CloseHandle(hFile);
 							//	DeleteFile(tmpfile);
 						}
@@ -137,8 +137,9 @@ extern "C" {
 #define OB_SESSIONMANAGER 62
 #define OB_KEYCAPTURE   63
 #define OB_BUTTON       64
+#define OB_AUXDEVICE    65
 
-#define OBJECT_COUNT 	65
+#define OBJECT_COUNT 	66
 
 
 
@@ -155,7 +156,8 @@ extern "C" {
 				 "ARRAY-3600", "COMREADER", "NEUROBIT", "MIN", "MAX", "ROUND", \
 				 "DIFFERENTIATE", "DELAY", "LIMITER", "EMOTIV", "FLOAT_VECTOR", \
 				 "VECTOR_FLOAT", "DISPLAY_VECTOR", "VECTORBUFFER", "GANGLION", \
-				 "SESSIONTIME", "SESSIONMANAGER", "KEYCAPTURE", "BUTTON"
+				 "SESSIONTIME", "SESSIONMANAGER", "KEYCAPTURE", "BUTTON", \
+				 "AUXDEVICE"
 //
 // use the main menu handler in brainbay.cpp 
 // to call the 'create_object'-function (located in in gloabals.cpp)
@@ -188,6 +190,7 @@ extern "C" {
 #define FT_NB_ARCHIVE   12
 #define FT_MCI          13
 #define FT_GANGLION_ARCHIVE 14
+#define FT_CSV          15
 
 
 #define MAX_COMPORT				150
@@ -207,6 +210,7 @@ extern "C" {
 
 #define FILE_TEXTMODE  0
 #define FILE_INTMODE   1
+#define FILE_COMPRESSED 2
 
 #define P_INT     1
 #define P_FLOAT   2
@@ -264,6 +268,9 @@ extern "C" {
 
 #define LEN_PIXELBUFFER  	500
 
+#define EDF_HEADERSIZE(channels)  (256+256*(channels))
+#define MAX_PROPERTYLEN   (EDF_HEADERSIZE(MAX_CHANNELS)+100)   // longest value of a property
+
 #define CON_HEIGHT   15
 #define CON_START    25
 #define CON_MAGNETIC 10
@@ -291,6 +298,7 @@ extern int PACKETSPERSECOND;
 extern char   midi_instnames[256][30];
 extern char   captfiletypes[10][40];
 extern char   devicetypes[20][40];
+extern char   recordflushnames[][20];
 extern char   objnames[OBJECT_COUNT][20];
 extern char   dimensions[10][10];
 extern int    BYTES_PER_PACKET[20];
@@ -309,6 +317,13 @@ extern struct FILTERTYPEStruct	   FILTERTYPE[FILTERTYPES];
 extern struct PASSTYPEStruct	   PASSTYPE[PASSTYPES];
 extern struct SCALEStruct          LOADSCALE;
 extern struct TIMINGStruct         TIMING;
+extern struct BLOCKStruct          BLOCK;
+extern struct EXECPLANStruct *     EXECPLAN;
+extern struct PACKETRINGStruct     PACKETRING;
+extern struct RENDERStruct         RENDER;
+extern struct RECORDERStruct       RECORDER;
+extern struct CLOCKStruct          CLOCK;
+extern struct CONFIGStruct         CONFIG;
 
 //
 //    DATA STRUCTURES
@@ -346,6 +361,10 @@ typedef struct GLOBALStruct
 	int statusWindowMarginWithPlayer;
 
 	int fly;
+	int headless;
+	int synthetic;          // channels of the synthetic test signal (headless benchmark), 0 = off
+	int worker_threads;
+	int record_flush;
 	int run_exception;
 
 	int showdesign;
@@ -369,7 +388,6 @@ typedef struct GLOBALStruct
 	LPARAM main_maximized;
 
 	WORD actcolumn;
-	char configbuffer[50000];
 	char nextconfigname[256];
 	char resourcepath[256];
 	char configfile[256];
@@ -443,17 +461,37 @@ char channels[4];
 char end;
 } EDFHEADER_PHYSICALStruct;
 
+#define EDF_FORMAT_EDF          0       // 16 bit samples
+#define EDF_FORMAT_BDF          1       // BioSemi, 24 bit samples
+#define EDF_SAMPLEBYTES(header) ((header)->format==EDF_FORMAT_BDF ? 3 : 2)
+
+#define EDF_PLUS_NONE           0
+#define EDF_PLUS_CONTINUOUS     1       // EDF+C / BDF+C
+#define EDF_PLUS_DISCONTINUOUS  2       // EDF+D / BDF+D: the records have gaps
+
+#define EDF_ANNOTATIONLEN       40      // characters of an annotation text
+
 typedef struct EDFHEADERStruct
 {
 	char  patient[81];
 	char  device[81];
 	int	  channels;
-	int   duration;
+	double duration;                // seconds of a record, may be fractional (EDF+)
 	int   samplespersegment;
 	int   segments;
 	int   samplingrate;
+	int   format;                   // EDF_FORMAT_EDF, EDF_FORMAT_BDF
+	int   plus;                     // EDF_PLUS_NONE, EDF_PLUS_CONTINUOUS, EDF_PLUS_DISCONTINUOUS
+	int   annotations;              // number of annotation channels
 } EDFHEADERStruct;
 
+typedef struct EDFANNOTATIONStruct
+{
+	double onset;                   // seconds from the start of the recording
+	double duration;
+	char   text[EDF_ANNOTATIONLEN];
+} EDFANNOTATIONStruct;
+
 
 #define samplebuflen 8192
  
@@ -463,19 +501,34 @@ typedef struct CHANNELStruct
     char transducer[81];
     char prefiltering[81];
     char physdim[9];
-	int  physmin;
-	int  physmax;
+	double physmin;
+	double physmax;
 	int  digmin;
 	int  digmax;
 	int  samples;
-	short  buffer[samplebuflen];
+	int  annotation;            // EDF+ annotation channel ("EDF Annotations")
+	short * buffer;             // points into the sample block of the element, see alloc_channel_buffers
 } CHANNELStruct ;
 
 
 
+#define SERIAL_QUEUESIZE 4096
+
+typedef struct SERIALPORTStruct
+{
+	HANDLE       handle;
+	OVERLAPPED   ovread;
+	OVERLAPPED   ovwait;       // WaitCommEvent
+	OVERLAPPED   ovwrite;
+	HANDLE       cancel;       // set by serial_cancel
+	DWORD        eventmask;
+	int          waiting;      // WaitCommEvent is pending
+} SERIALPORTStruct;
+
 typedef struct TTYStruct
 {
     HANDLE		 COMDEV;
+	SERIALPORTStruct SERIAL;
     int 		 PORT;
     DWORD		 BAUDRATE ;
 	COMMTIMEOUTS TIMEOUTSORIG;
@@ -492,6 +545,7 @@ typedef struct TTYStruct
 	int			 samplingrate;
     WORD		 read_pause;
 	int          amount_to_read;
+	int          readsize;      // maximum bytes of one read from the port
 	int          bytes_per_packet;
 	int			 amount_to_write;
     unsigned char readBuf[4096];
@@ -500,6 +554,10 @@ typedef struct TTYStruct
 } TTYStruct;
 
 
+#define PACING_DEGRADE      50      // ms of lag which reduce the dialog- and draw- updates
+#define PACING_DROP         1000    // ms of lag after which the backlog is dropped
+#define PACING_SLOWUPDATE   8       // update intervals are multiplied by this while behind
+
 typedef struct TIMINGStruct
 {
 	UINT     timerid;
@@ -514,6 +572,11 @@ typedef struct TIMINGStruct
 	LONGLONG packettime;
 	unsigned int ppscounter;
 	unsigned int actpps;
+	int      lag;            // ms the processing was behind at the last timer tick
+	int      maxlag;         // highest lag of the session
+	int      behind;         // lag >= PACING_DEGRADE: fewer dialog- and draw- updates
+	long     dropped;        // synthetic packets dropped because the lag reached PACING_DROP
+	long     resynced;       // packet times skipped by the pacing, no data lost
 } TIMINGStruct;
 
 
@@ -530,9 +593,231 @@ typedef struct PACKETStruct
 	unsigned char     aux;
 	unsigned int      buffer[MAX_EEG_CHANNELS*2];
 	unsigned int      tempbuf[MAX_EEG_CHANNELS*2];
+	unsigned int      work_buffer[MAX_EEG_CHANNELS*2];   // the packet which is processed by the elements
+	unsigned char     work_switches;
+	LONGLONG          timestamp;                         // arrival of the processed packet
+	LONGLONG          arrival;                           // arrival of the bytes in the parser, 0 = none
+	LONGLONG          clocktime;                         // corrected time of PACKET.buffer (clock.cpp), 0 = none
+	LONGLONG          work_clocktime;                    // corrected time of the processed packet
 } PACKETStruct;
 
 
+#define MAX_FRAMESIZE 57    // OpenBCI frame with 16 channels
+
+//  state of a frame decoder (ob_eeg.cpp)
+typedef struct FRAMEDECODERStruct
+{
+	int           channels;                      // OpenBCI: 8 or 16 channels
+	unsigned char frame[MAX_FRAMESIZE];          // frame which continues in the next buffer
+	int           framepos;                      // bytes in frame[], 0 = no frame started
+	int           framenumber;                   // next expected frame number, -1 = not known
+	int         * syncloss;                      // counter for lost frames
+	unsigned int  values[MAX_EEG_CHANNELS*2];    // the decoded frame
+	unsigned char number,switches;
+	void        (*deliver)(struct FRAMEDECODERStruct * dec);
+	void        * owner;
+} FRAMEDECODERStruct;
+
+
+#define PACKETRING_SIZE 1024    // must be a power of 2
+
+typedef struct RINGPACKETStruct
+{
+	unsigned int      buffer[MAX_EEG_CHANNELS*2];
+	unsigned char     switches;
+	LONGLONG          timestamp;
+	LONGLONG          clocktime;
+} RINGPACKETStruct;
+
+typedef struct PACKETRINGStruct
+{
+	volatile LONG     head;        // written by the reader thread only
+	volatile LONG     tail;        // written by the processing thread only
+	int               active;
+	volatile int      exit;
+	DWORD             reader_id;
+	HANDLE            thread;
+	HANDLE            event;
+	long              high_water;  // maximum number of queued packets
+	long              overruns;    // packets dropped because the ring was full
+	RINGPACKETStruct  packet[PACKETRING_SIZE];
+} PACKETRINGStruct;
+
+
+#define RECORDER_BUFFERS  8
+#define RECORDER_BUFSIZE  65536
+
+#define FLUSH_NONE   0
+#define FLUSH_SECOND 1
+#define FLUSH_BUFFER 2
+
+typedef struct RECORDERStruct
+{
+	HANDLE            file;
+	int               filetype;
+	int               flush;        // FLUSH_NONE, FLUSH_SECOND or FLUSH_BUFFER
+	int               active;
+	volatile int      exit;
+	CRITICAL_SECTION  cs;
+	int               cs_init;
+	HANDLE            thread;
+	HANDLE            event;
+	unsigned char *   buffer[RECORDER_BUFFERS];
+	int               fill[RECORDER_BUFFERS];
+	int               head;         // buffer which is filled by record_bytes
+	int               tail;         // next buffer for the writer thread
+	volatile int      count;        // full buffers waiting for the writer
+	int               column;       // text mode: value in the line
+	long              written;
+	volatile long     dropped;
+	DWORD             error;
+} RECORDERStruct;
+
+
+#define CLOCK_WINDOW   4096         // packets in the regression window, power of 2
+#define CLOCK_FIT      256          // packets between two estimations
+#define CLOCK_MINFIT   512          // packets needed for the first estimation
+#define CLOCK_MAXPPM   50000        // larger deviations: the nominal rate does not fit
+
+typedef struct CLOCKStruct
+{
+	int           resample;         // setting: interpolate the packets to PACKETSPERSECOND
+	int           valid;            // an estimation is available
+	double        rate;             // estimated packets per second of the device
+	double        ppm;              // deviation from PACKETSPERSECOND
+	double        period;           // fitted QPC ticks per packet
+	double        offset;           // fitted arrival of packet 0, ticks after base
+	LONGLONG      base;             // arrival of the first packet
+	LONGLONG      last;             // arrival of the last packet
+	long          count;            // packets since the start of the model
+	double        arrival[CLOCK_WINDOW];
+	double        next;             // resampling: position of the next packet
+	int           haveprev;
+	unsigned int  prev[MAX_EEG_CHANNELS*2];
+	unsigned char prevswitches;
+} CLOCKStruct;
+
+
+//  design- and settings-files: the actual section (see load_next_config_buffer)
+typedef struct CONFIGPROPERTYStruct
+{
+	char * key;
+	char * value;
+	int    used;                    // requested by load_property
+} CONFIGPROPERTYStruct;
+
+typedef struct CONFIGStruct
+{
+	HANDLE        file;             // the file which was read into text
+	DWORD         fileend;
+	char        * text;             // the file, the lines of the parsed sections are split
+	long          size,pos,allocated;
+	int           type;             // next object of the section, -1 for the settings
+	int           section;          // the properties of a section are not checked yet
+	CONFIGPROPERTYStruct * prop;
+	int           props,propsallocated;
+	int         * hash;             // hash table of the keys: index of prop, -1 = empty
+	int           hashmask,hashallocated;
+	char       ** link;             // "linkport" lines
+	int           links,linksallocated;
+	int           failed;           // out of memory: the rest of the file is not loaded
+} CONFIGStruct;
+
+
+//  compressed archive (v2): header, chunks of coded packets, chunk index
+#define ARCHIVE_CHUNK_PACKETS  256
+#define ARCHIVE_CHUNK_MAGIC    0x4b434242      // "BBCK"
+#define ARCHIVE_INDEX_MAGIC    0x58494242      // "BBIX"
+
+typedef struct ARCHIVECHUNKStruct
+{
+	DWORD     magic;
+	DWORD     first;           // number of the first packet of the chunk
+	WORD      packets;
+	BYTE      values;          // coded values per packet (without the switches)
+	BYTE      reserved;
+	DWORD     length;          // bytes of coded data following the chunk header
+	LONGLONG  first_arrival;   // microseconds since the start of the recording
+	LONGLONG  last_arrival;
+} ARCHIVECHUNKStruct;
+
+typedef struct ARCHIVEPACKETStruct
+{
+	unsigned int      buffer[MAX_EEG_CHANNELS*2];
+	unsigned char     switches;
+	LONGLONG          arrival;
+} ARCHIVEPACKETStruct;
+
+
+#define MAX_RENDERITEMS 256
+#define RENDER_FPS      60
+#define RENDER_LISTSIZE 2048    // bytes of listbox lines waiting for one frame
+
+typedef struct RENDERITEMStruct
+{
+	HWND   hWnd;
+	int    id;          // dialog control, 0 for InvalidateRect
+	int    kind;
+	int    erase;
+	int    value;       // scroll position, enable state or command
+	int    dirty;       // changed since the last frame
+	char * text;        // published text or listbox lines (processing thread)
+	int    textsize;
+	int    textlen;     // bytes of the waiting listbox lines
+	char * frame;       // text of the actual frame (render thread)
+	int    framesize;
+	int    framelen;
+} RENDERITEMStruct;
+
+typedef struct RENDERStruct
+{
+	int               active;
+	HANDLE            thread;
+	HANDLE            exit_event;
+	CRITICAL_SECTION  cs;
+	long              frames;
+	long              overflows;   // updates lost because all items or the list were full
+	long              logged;      // overflows written to the logfile
+	int               count;
+	RENDERITEMStruct  item[MAX_RENDERITEMS];
+} RENDERStruct;
+
+
+typedef struct BLOCKStruct
+{
+	int   size;       // packets per processing block, 1 = process every packet
+	int   active;     // block processing with size>1 for the current design
+	int   possible;   // the design allows block processing (used for catch-up blocks)
+	int   catchup;    // packets due in the actual timer tick, processed as one block
+	int   count;      // packets queued for the actual block
+	long  packetcounter[MAX_BLOCKSIZE];
+	int   dialog_update[MAX_BLOCKSIZE];
+	int   draw_update[MAX_BLOCKSIZE];
+	unsigned int  buffer[MAX_BLOCKSIZE][MAX_EEG_CHANNELS*2];
+	unsigned char switches[MAX_BLOCKSIZE];
+	LONGLONG      timestamp[MAX_BLOCKSIZE];
+	LONGLONG      clocktime[MAX_BLOCKSIZE];
+} BLOCKStruct;
+
+
+typedef struct EXECPLANStruct
+{
+	int       count;                      // objects in execution order
+	int       size;                       // allocated entries of the per-object arrays
+	int       succ_size;                  // allocated entries of succ[]
+	BASE_CL ** order;
+	int     * index;                      // position of the object in objects[]
+	int     * level;                      // longest path from a source element
+	int     * succ_start;                 // successors of order[t]: succ[succ_start[t]] .. succ[succ_start[t+1]-1]
+	int     * succ;
+	int       feedback;                   // connections against the execution order
+	int     * stage;                      // 0: serial, 1: parallel task, 2: serial after the parallel tasks
+	int       tasks;                      // number of parallel task lists, 0 = serial execution
+	int       task_start[MAX_WORKERS+1];  // task list w: order[task[task_start[w]]] .. order[task[task_start[w+1]-1]]
+	int     * task;
+} EXECPLANStruct;
+
+
 typedef struct MIDIPORTStruct
 {
 	HMIDIOUT midiout;
@@ -560,6 +845,15 @@ typedef struct CAPTFILEStruct
 	long    start;
 	long	length;
 	long    offset;
+	HANDLE  maphandle;          // file mapping of the archive (reading)
+	unsigned char * map;        // mapped view, NULL when the read window is used
+	unsigned char * window;     // read window, when the file could not be mapped
+	DWORD   windowpos;
+	DWORD   windowlen;
+	DWORD   size;               // file size in bytes
+	DWORD   readpos;            // byte offset of the next read
+	DWORD * index;              // text mode: byte offset of every 64th packet
+	long    indexcount;
 } CAPTFILEStruct;
 
 
@@ -628,10 +922,21 @@ void   create_logfile(void);
 void   write_logfile(char *,...);
 
 BOOL killProcess(char * name );
+int  run_headless(char * cmdline);
 
 
 
 
+//    Block processing functions
+
+void	update_blockmode(void);
+void	queue_block_packet(void);
+void	process_block(void);
+void	discard_block(void);
+void	set_block_sample(int);
+int		block_update_due(int *, int);
+
+
 //    Timer-functions for playing the archive file 
 
 void	CALLBACK TimerProc(UINT uID,UINT uMsg,DWORD dwUser,DWORD dw1,DWORD dw2);
@@ -641,17 +946,37 @@ LONG    get_sliderpos(LONG samplepos);
 void	set_session_pos(long pos);
 void	get_session_length(void);
 void	update_status_window(void);
+void	pace_packets(LONGLONG pc);
+void	synthetic_packet(void);
 
 
 //  Com-Port functions
 
 void   ParseLocalInput(int);
+void   ParseLocalInput(int, LONGLONG arrival);
+void   openbci_samples(unsigned char * p, unsigned int * dst, int count);
+void   init_decoder(FRAMEDECODERStruct * dec, int channels, void (*deliver)(FRAMEDECODERStruct *), void * owner, int * syncloss);
+void   decode_P2(FRAMEDECODERStruct * dec, unsigned char * buf, int len);
+void   decode_OPENBCI(FRAMEDECODERStruct * dec, unsigned char * buf, int len);
 void   process_packets(void);
+void   emit_packet(void);
+void   reset_clock(void);
+int    clock_packet(void);
+void   work_packet(void);
+void   push_packet(void);
+void   start_packetring(DWORD reader_id);
+void   stop_packetring(void);
 void   init_comsettingsDlg( HWND hDlg );
 BOOL   SetupCommPort( int );
 BOOL   BreakDownCommPort( void );
 DWORD  WINAPI ReaderProc( LPVOID );
 DWORD  WINAPI WriterProc( LPVOID );
+BOOL   serial_open(SERIALPORTStruct * sp, int port, DWORD baudrate, int flowcontrol);
+int    serial_read(SERIALPORTStruct * sp, unsigned char * buf, int size, DWORD timeout, LONGLONG * arrival);
+BOOL   serial_write(SERIALPORTStruct * sp, unsigned char * buf, int len);
+void   serial_cancel(SERIALPORTStruct * sp);
+void   serial_stop(SERIALPORTStruct * sp, HANDLE * thread);
+void   serial_close(SERIALPORTStruct * sp);
  
 //	NIA functions
 
@@ -664,6 +989,28 @@ int     ReadNIA(UINT, LONG );
 void   create_object(int);
 void   free_object(int);
 int    sort_objects(void);
+int    reserve_objects(int count);
+void   build_plan(void);
+void   clear_plan(void);
+void   execute_plan(int count);
+void   init_workers(int threads);
+int    enter_processing(void);
+void   leave_processing(void);
+int    pause_processing(void);
+void   resume_processing(int sav_timerpause);
+void   call_object(BASE_CL * ob, int count);
+void   run_object(BASE_CL * ob, int count);
+
+//  Execution profiler - functions
+
+void   profile_work(BASE_CL * ob, int count);
+void   profile_incoming(BASE_CL * ob, int port, float value);
+void   reset_profile(void);
+int    export_profile(char * filename);
+void   save_profile(void);
+void   open_profiler(void);
+void   record_latency(BASE_CL * ob);
+void   log_latency(void);
 
 void	update_dimensions(void);
 void    link_object(BASE_CL *);
@@ -679,15 +1026,29 @@ BOOL	save_to_file(LPCTSTR pszFileName, void * buffer, int size);
 HANDLE	create_captfile(LPCTSTR);
 int	open_captfile(LPCTSTR);
 void	close_captfile(void );
-void	write_captfile(unsigned char );
+void	record_bytes(unsigned char * buf, int len);
+void	record_packet(void);
+int		start_recorder(HANDLE hFile, int filetype);
+void	stop_recorder(void);
 void	read_captfile(int);
+int	map_captfile(void);
+void	unmap_captfile(void);
+void	index_captfile(void);
+void	seek_captfile(long packet);
+int	captfile_position(void);
+void	play_captfile(void);
+int	start_archive_writer(HANDLE hFile);
+int	write_archive_packets(unsigned char * buf, int len);
+int	finish_archive_writer(void);
 BOOL	save_configfile(LPCTSTR);
 BOOL	load_configfile(LPCTSTR);
 BOOL	save_settings(void);
 BOOL	load_settings(void);
 void	save_property(HANDLE , char * ,int , void * );
 int		load_next_config_buffer(HANDLE);
-int		load_property(char * ,int , void * ); 
+void	end_config_section(void);
+int		load_property(char * ,int , void * );
+char *	load_property_string(char * ); 
 void	store_links(HANDLE,BASE_CL *);
 void	load_object_basics(BASE_CL *);
 void	save_object_basics(HANDLE , BASE_CL * );
@@ -707,6 +1068,20 @@ void  color_button(HWND, COLORREF );
 COLORREF  select_color(HWND, COLORREF);
 int check_keys(void);
 
+//     Render thread - functions (display updates from work() )
+
+void  publish_invalidate(HWND hWnd, BOOL erase=FALSE);
+void  publish_dlg_text(HWND hDlg, int id, const char * text);
+void  publish_dlg_int(HWND hDlg, int id, int value, BOOL bSigned);
+void  publish_window_text(HWND hWnd, const char * text);
+void  publish_scroll_pos(HWND hDlg, int id, int pos);
+void  publish_enable(HWND hDlg, int id, BOOL enable);
+void  publish_list_item(HWND hDlg, int id, const char * text);
+void  publish_command(HWND hWnd, int command);
+void  clear_render_items(void);
+void  start_render(void);
+void  stop_render(void);
+
 
 
 //     Math - functions
@@ -721,24 +1096,34 @@ void reduce_filepath(char * , char *);
 void copy_string(char * , int , int , char * );
 int  get_int(char * str, int pos, int * target);
 int  get_float(char * , const char *, float *);
+double str_to_double(const char * str, const char ** end);
 int  get_string(char * , const char *, char *);
 void print_time(char * ,float, int);
 float get_time(char *);
 
 //     (edf) - functions
 
-HANDLE open_edf_file(EDFHEADERStruct * , CHANNELStruct * ,  char * );
+HANDLE open_edf_file(EDFHEADERStruct * , CHANNELStruct ** , int * , char * );
 HANDLE create_edf_file(EDFHEADERStruct * , CHANNELStruct * , char * );
 void edfheader_to_physical(EDFHEADERStruct * from, EDFHEADER_PHYSICALStruct * to);
-void edfchannels_to_physical(CHANNELStruct * fromchn,char * to,int channels);
+int  edf_samples(CHANNELStruct * chn);
+void edf_number(char * to, double value);
+void edfchannels_to_physical(CHANNELStruct * fromchn,char * to,int channels,int design);
 void generate_edf_header(char * to, EDFHEADERStruct * header,CHANNELStruct * channels);
-void parse_edf_header(EDFHEADERStruct *, CHANNELStruct *,char *);
+void parse_edf_header(EDFHEADERStruct *, CHANNELStruct **, int *, char *);
+void save_edf_header(HANDLE hFile, char * desc, EDFHEADERStruct * header, CHANNELStruct * channel);
+int  load_edf_header(char * desc, EDFHEADERStruct * header, CHANNELStruct ** channel, int * allocated);
 void update_header(HWND hDlg, EDFHEADERStruct * header);
 void get_header(HWND hDlg, EDFHEADERStruct * header);
 void update_channelcombo(HWND hDlg, CHANNELStruct * channel, int channels);
 void update_channel(HWND hDlg, CHANNELStruct * channel, int actchn);
 void get_channel(HWND hDlg, CHANNELStruct * channel, int actchn);
-void reset_channel(CHANNELStruct * channel);
+void reset_channel(CHANNELStruct * channel, int channels);
+int  reserve_channels(CHANNELStruct ** channel, int * allocated, int count);
+short * alloc_channel_buffers(short * buffers, CHANNELStruct * channel, int channels, int buflen);
+void edf_to_float(const unsigned char * raw, int bytes, int count, float gain, float ofs, float * out);
+void float_to_edf(float value, float gain, float ofs, int digmin, int digmax, int bytes, unsigned char * raw);
+int  parse_edf_annotations(const unsigned char * tal, int len, double * rectime, EDFANNOTATIONStruct * ann, int max);
 void reset_header (EDFHEADERStruct * header);
 
 
@@ -0,0 +1,199 @@
+/* -----------------------------------------------------------------------------
+
+  BrainBay  -  Version 2.0, GPL 2003-2017
+
+  MODULE:  CLOCK.CPP
+  Author:  Chris Veigl
+
+
+  This Module estimates the sampling clock of the connected device:
+
+  The crystal of an amplifier deviates from the nominal sampling rate, so the
+  packet count of a long session drifts away from the real time (e.g. a video
+  or the markers of another system). clock_packet() is called by
+  process_packets for every packet which was received from a device. The
+  arrival times of the last CLOCK_WINDOW packets are fitted to a line
+  (arrival = offset + period * packetnumber) every CLOCK_FIT packets.
+  As the arrival of a packet can only be delayed (buffering of the serial
+  driver, USB latency), the fit is repeated with the points below the median
+  residual, which moves the line to the lower edge of the arrival times and
+  removes late outliers.
+
+  The estimate gives the sampling rate of the device (CLOCK.rate, shown in the
+  status bar) and the corrected time of every packet (PACKET.clocktime, which
+  is passed to the elements as PACKET.work_clocktime). When the resampling
+  option is enabled (application settings), the packets are interpolated
+  to the nominal rate PACKETSPERSECOND, so that the packet count follows the
+  real time.
+
+  The model is restarted when a session starts or stops, when the playback
+  of an archive starts and when no packet was received for a second.
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; See the
+  GNU General Public License for more details.
+
+
+--------------------------------------------------------------------------------*/
+
+
+#include "brainBay.h"
+
+CLOCKStruct CLOCK;
+
+static double fit_x[CLOCK_WINDOW],fit_y[CLOCK_WINDOW],fit_r[CLOCK_WINDOW];
+
+
+void reset_clock(void)
+{
+	CLOCK.valid=FALSE;
+	CLOCK.count=0;
+	CLOCK.haveprev=FALSE;
+	CLOCK.rate=0;
+	CLOCK.ppm=0;
+}
+
+
+int compare_double(const void * a, const void * b)
+{
+	if (*(double *)a < *(double *)b) return(-1);
+	if (*(double *)a > *(double *)b) return(1);
+	return(0);
+}
+
+
+//  least squares line through the n points of fit_x, fit_y
+int fit_line(int n, double * a, double * b)
+{
+	double sx=0,sy=0,sxx=0,sxy=0,d;
+	int i;
+
+	for (i=0;i<n;i++)
+	{
+		sx+=fit_x[i]; sy+=fit_y[i];
+		sxx+=fit_x[i]*fit_x[i]; sxy+=fit_x[i]*fit_y[i];
+	}
+	d=n*sxx-sx*sx;
+	if ((n<2) || (d==0)) return(FALSE);
+	*b=(n*sxy-sx*sy)/d;
+	*a=(sy-*b*sx)/n;
+	return(TRUE);
+}
+
+
+void clock_fit(void)
+{
+	double a,b,y0,median;
+	long first,k;
+	int n,i,m,pass;
+
+	n=(CLOCK.count<CLOCK_WINDOW) ? CLOCK.count : CLOCK_WINDOW;
+	first=CLOCK.count-n;
+	y0=CLOCK.arrival[first&(CLOCK_WINDOW-1)];
+	for (i=0;i<n;i++)
+	{
+		k=first+i;
+		fit_x[i]=(double)i;
+		fit_y[i]=CLOCK.arrival[k&(CLOCK_WINDOW-1)]-y0;
+	}
+
+	for (pass=0;pass<3;pass++)
+	{
+		if (!fit_line(n,&a,&b)) return;
+		if (pass==2) break;
+
+		// keep the points below the median residual
+		for (i=0;i<n;i++) fit_r[i]=fit_y[i]-(a+b*fit_x[i]);
+		qsort(fit_r,n,sizeof(double),compare_double);
+		median=fit_r[n/2];
+		for (i=0,m=0;i<n;i++)
+			if (fit_y[i]-(a+b*fit_x[i])<=median)
+			{
+				fit_x[m]=fit_x[i]; fit_y[m]=fit_y[i]; m++;
+			}
+		n=m;
+	}
+	if (b<=0) return;
+
+	CLOCK.period=b;
+	CLOCK.offset=y0+a-b*first;
+	CLOCK.rate=(double)TIMING.pcfreq/b;
+	CLOCK.ppm=(CLOCK.rate-PACKETSPERSECOND)*1000000.0/PACKETSPERSECOND;
+	if (!CLOCK.valid)
+		write_logfile("device clock: %.4f packets/sec (%.0f ppm)",CLOCK.rate,CLOCK.ppm);
+	CLOCK.valid=TRUE;
+}
+
+
+//  interpolates the packets at the nominal rate between the previous and
+//  the actual packet k, the packets are passed to emit_packet()
+void clock_resample(long k)
+{
+	unsigned int cur[MAX_EEG_CHANNELS*2];
+	unsigned char curswitches;
+	LONGLONG curclock;
+	double frac,step,d;
+	int x;
+
+	step=(double)TIMING.pcfreq/PACKETSPERSECOND/CLOCK.period;
+	if ((!CLOCK.haveprev) || (CLOCK.next<k-1) || (CLOCK.next>k+step)) CLOCK.next=k;
+
+	memcpy(cur,PACKET.buffer,sizeof(cur));
+	curswitches=PACKET.switches;
+	curclock=PACKET.clocktime;
+
+	while (CLOCK.next<=k)
+	{
+		frac=CLOCK.next-(k-1);
+		if ((!CLOCK.haveprev) || (frac>=1.0))
+		{
+			memcpy(PACKET.buffer,cur,sizeof(cur));
+			PACKET.switches=curswitches;
+		}
+		else
+		{
+			for (x=0;x<MAX_EEG_CHANNELS*2;x++)
+			{
+				d=((double)((int)cur[x]-(int)CLOCK.prev[x]))*frac;
+				PACKET.buffer[x]=(unsigned int)((int)CLOCK.prev[x]+(int)(d<0 ? d-0.5 : d+0.5));
+			}
+			PACKET.switches=(frac<0.5) ? CLOCK.prevswitches : curswitches;
+		}
+		PACKET.clocktime=CLOCK.base+(LONGLONG)(CLOCK.offset+CLOCK.period*CLOCK.next);
+		emit_packet();
+		CLOCK.next+=step;
+	}
+
+	memcpy(PACKET.buffer,cur,sizeof(cur));
+	PACKET.switches=curswitches;
+	PACKET.clocktime=curclock;
+	memcpy(CLOCK.prev,cur,sizeof(cur));
+	CLOCK.prevswitches=curswitches;
+	CLOCK.haveprev=TRUE;
+}
+
+
+//  called by process_packets for a packet from a device (PACKET.arrival),
+//  returns TRUE when the packet was passed on by the resampling
+int clock_packet(void)
+{
+	LONGLONG now=PACKET.arrival;
+	long k;
+
+	if ((CLOCK.count) && (now-CLOCK.last>TIMING.pcfreq)) reset_clock();
+	if (!CLOCK.count) CLOCK.base=now;
+	CLOCK.last=now;
+
+	k=CLOCK.count++;
+	CLOCK.arrival[k&(CLOCK_WINDOW-1)]=(double)(now-CLOCK.base);
+	if ((CLOCK.count>=CLOCK_MINFIT) && (!(CLOCK.count%CLOCK_FIT))) clock_fit();
+
+	if (!CLOCK.valid) { PACKET.clocktime=now; return(FALSE); }
+	PACKET.clocktime=CLOCK.base+(LONGLONG)(CLOCK.offset+CLOCK.period*k);
+
+	// no resampling when the nominal rate does not match the device
+	if ((!CLOCK.resample) || (CLOCK.ppm>CLOCK_MAXPPM) || (CLOCK.ppm<-CLOCK_MAXPPM)) return(FALSE);
+	clock_resample(k);
+	return(TRUE);
+}
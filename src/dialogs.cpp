@@ -667,12 +667,18 @@ LRESULT CALLBACK SETTINGSDlgHandler( HWND hDlg, UINT message, WPARAM wParam, LPA
 
 				SetDlgItemInt(hDlg, IDC_DIALOGINTERVAL,GLOBAL.dialog_interval,0);
 				SetDlgItemInt(hDlg, IDC_DRAWINTERVAL,GLOBAL.draw_interval,0);
+				SetDlgItemInt(hDlg, IDC_BLOCKSIZE,BLOCK.size,0);
+				SetDlgItemInt(hDlg, IDC_WORKERTHREADS,GLOBAL.worker_threads,0);
+				for (t=0; recordflushnames[t][0]!=0;t++)
+					SendDlgItemMessage( hDlg, IDC_RECORDFLUSH, CB_ADDSTRING, 0,(LPARAM) (LPSTR) recordflushnames[t]) ;
+				SendDlgItemMessage( hDlg, IDC_RECORDFLUSH, CB_SETCURSEL, GLOBAL.record_flush, 0L ) ;
 
 				CheckDlgButton(hDlg, IDC_CONNECTED, TTY.CONNECTED);
 				CheckDlgButton(hDlg, IDC_STARTUP, GLOBAL.startup);
 				CheckDlgButton(hDlg, IDC_STARTDESIGN, GLOBAL.startdesign);
 				CheckDlgButton(hDlg, IDC_AUTORUN, GLOBAL.autorun);
 				CheckDlgButton(hDlg, IDC_MINIMIZED, GLOBAL.minimized);
+				CheckDlgButton(hDlg, IDC_CLOCKRESAMPLE, CLOCK.resample);
 				CheckDlgButton(hDlg, IDC_LOCKSESSION, GLOBAL.locksession);
 				CheckDlgButton(hDlg, IDC_USE_CVCAPTURE, GLOBAL.use_cv_capture);
 				CheckDlgButton(hDlg, IDC_USE_VIDEOINPUT, !GLOBAL.use_cv_capture);
@@ -749,6 +755,9 @@ LRESULT CALLBACK SETTINGSDlgHandler( HWND hDlg, UINT message, WPARAM wParam, LPA
 			case IDC_MINIMIZED:
 				 GLOBAL.minimized= IsDlgButtonChecked(hDlg, IDC_MINIMIZED);
 				break;
+			case IDC_CLOCKRESAMPLE:
+				 CLOCK.resample= IsDlgButtonChecked(hDlg, IDC_CLOCKRESAMPLE);
+				break;
 			case IDC_LOCKSESSION:
 				 GLOBAL.locksession= IsDlgButtonChecked(hDlg, IDC_LOCKSESSION);
 				 for (int i=0;i<GLOBAL.objects;i++)
@@ -781,6 +790,40 @@ LRESULT CALLBACK SETTINGSDlgHandler( HWND hDlg, UINT message, WPARAM wParam, LPA
 			case IDC_DRAWINTERVAL:
 				GLOBAL.draw_interval=GetDlgItemInt(hDlg,IDC_DRAWINTERVAL, NULL, 0);
 				break;
+			case IDC_BLOCKSIZE:
+				if (HIWORD(wParam)==EN_KILLFOCUS)
+				{
+					BLOCK.size=GetDlgItemInt(hDlg,IDC_BLOCKSIZE, NULL, 0);
+					if (BLOCK.size<1) BLOCK.size=1;
+					if (BLOCK.size>MAX_BLOCKSIZE) BLOCK.size=MAX_BLOCKSIZE;
+					SetDlgItemInt(hDlg, IDC_BLOCKSIZE,BLOCK.size,0);
+					if (!GLOBAL.running) update_blockmode();
+				}
+				break;
+			case IDC_WORKERTHREADS:
+				if (HIWORD(wParam)==EN_KILLFOCUS)
+				{
+					int threads=GetDlgItemInt(hDlg,IDC_WORKERTHREADS, NULL, 0);
+					if (threads<1) threads=1;
+					if (threads>MAX_WORKERS) threads=MAX_WORKERS;
+					SetDlgItemInt(hDlg, IDC_WORKERTHREADS,threads,0);
+					if ((threads!=GLOBAL.worker_threads) && (!GLOBAL.running))
+					{
+						GLOBAL.worker_threads=threads;
+						init_workers(threads);
+						sort_objects();
+					}
+					else SetDlgItemInt(hDlg, IDC_WORKERTHREADS,GLOBAL.worker_threads,0);
+				}
+				break;
+			case IDC_RECORDFLUSH:
+				if (HIWORD(wParam)==CBN_SELCHANGE)
+				{
+					GLOBAL.record_flush=SendDlgItemMessage(hDlg, IDC_RECORDFLUSH, CB_GETCURSEL, 0, 0);
+					if ((GLOBAL.record_flush<FLUSH_NONE)||(GLOBAL.record_flush>FLUSH_BUFFER)) GLOBAL.record_flush=FLUSH_NONE;
+					RECORDER.flush=GLOBAL.record_flush;
+				}
+				break;
 			case IDC_EMOTIV_PATH:
 				GetDlgItemText(hDlg,IDC_EMOTIV_PATH, GLOBAL.emotivpath, 255);
 				break;
@@ -1182,11 +1225,22 @@ LRESULT CALLBACK TAGDlgHandler( HWND hDlg, UINT message, WPARAM wParam, LPARAM l
 
 void update_statusinfo(void)
 {
-	char szdata[100];
+	char szdata[200];
 
 	if (GLOBAL.running) 
 	{
-		wsprintf(szdata, "Session running,  %d Packets/sec (%d lost)",TIMING.actpps, GLOBAL.syncloss); 
+		if (PACKETRING.active)
+			wsprintf(szdata, "Session running,  %d Packets/sec (%d lost), queue max %d, %d overruns",
+				TIMING.actpps, GLOBAL.syncloss, PACKETRING.high_water, PACKETRING.overruns);
+		else wsprintf(szdata, "Session running,  %d Packets/sec (%d lost)",TIMING.actpps, GLOBAL.syncloss); 
+		if ((RECORDER.thread) && (RECORDER.dropped))
+			wsprintf(szdata+strlen(szdata), ", archive: %d bytes dropped", RECORDER.dropped);
+		if (CLOCK.valid)
+			sprintf(szdata+strlen(szdata), ", device clock %.3f Hz", CLOCK.rate);
+		if ((TIMING.behind) || (TIMING.dropped))
+			wsprintf(szdata+strlen(szdata), ", %d ms behind (%d dropped)", TIMING.lag, TIMING.dropped);
+		if (TIMING.resynced)
+			wsprintf(szdata+strlen(szdata), ", pacing resynced by %d packets", TIMING.resynced);
 		SetDlgItemText(ghWndStatusbox,IDC_STATUS,szdata);
 	}
 	else SetDlgItemText(ghWndStatusbox,IDC_STATUS,"Session paused");
@@ -1217,14 +1271,19 @@ void stop_session() {
 	TTY.read_pause=1;
 	GLOBAL.session_sliding=-1;
 	stop_timer(); 							
+	process_block();
 	for (int t=0;t<GLOBAL.objects;t++) objects[t]->session_stop();
+	reset_clock();      // the stream is interrupted
+	save_profile();
 	SetDlgItemText(ghWndStatusbox,IDC_STATUS,"Session paused");
 }
 
 void run_session() {
 	stop_timer();
 	update_dimensions();
+	update_blockmode();
 	GLOBAL.session_sliding=-1;
+	reset_clock();      // no arrival times of the last session in the fit
 	for (int t=0;t<GLOBAL.objects;t++)  objects[t]->session_start();
 	start_timer();
 	SetDlgItemText(ghWndStatusbox,IDC_STATUS,"Session running");
@@ -1593,6 +1652,7 @@ LRESULT CALLBACK DesignWndHandler(HWND hWnd, UINT message, WPARAM wParam, LPARAM
 							  GLOBAL.fx=actobject->xPos+actobject->width;
 							  GLOBAL.fy=actobject->yPos+CON_START+i*CON_HEIGHT;
 							  for (k=0;actobject->out[k].from_port!=-1;k++);
+							  if (!actobject->reserve_links(k)) break;
 							  actobject->out[k+1].from_port=-1;
 							  actobject->out[k].from_port=i;
 							  for (t=0;(t<GLOBAL.objects)&&(objects[t]!=actobject);t++) ; 
@@ -1718,10 +1778,10 @@ LRESULT CALLBACK DesignWndHandler(HWND hWnd, UINT message, WPARAM wParam, LPARAM
 		case WM_KEYDOWN:
 			    if (wParam==KEY_DELETE )
 				{
-					int i,t,object_index;
+					int i,t,object_index,sav_pause;
 
-
-					TIMING.pause_timer=1;
+					// no packet may be processed while objects and links are removed
+					sav_pause=pause_processing();
 					if (actobject) //&&(actobject!=objects[0]))        // delete a whole object
 					{
   		 		   	    write_logfile("deleting object: %s",objnames[actobject->type]);
@@ -1730,19 +1790,14 @@ LRESULT CALLBACK DesignWndHandler(HWND hWnd, UINT message, WPARAM wParam, LPARAM
 
 						//deleting all connections at this object's output ports
 						//for array_data_ports
-						for (i=MAX_CONNECTS-1;i>=0;i--){
+						for (i=objects[object_index]->out_size-1;i>=0;i--){
 							delete_connection(&objects[object_index]->out[i]);							
 						}
 						for(t=0;t<GLOBAL.objects;t++)						 
-						  for (i=0;i<MAX_CONNECTS;i++)
+						  for (i=0;i<objects[t]->out_size;i++)
 						  {
-							while (objects[t]->out[i].to_object==object_index)
-							{
-								memcpy(&objects[t]->out[i],&objects[t]->out[i+1],sizeof(LINKStruct)*(MAX_CONNECTS-i));
-							    objects[t]->out[MAX_CONNECTS-1].to_object=-1;
-								objects[t]->out[MAX_CONNECTS-1].from_port=-1;
-								objects[t]->out[MAX_CONNECTS-1].to_port=-1;
-							}
+							while ((objects[t]->out[i].to_object==object_index) && (objects[t]->out[i].to_port!=-1))
+								objects[t]->remove_link(i);
 							if (objects[t]->out[i].to_object>object_index) 
 								objects[t]->out[i].to_object--;
 							if (objects[t]->out[i].from_object>object_index) 
@@ -1765,9 +1820,10 @@ LRESULT CALLBACK DesignWndHandler(HWND hWnd, UINT message, WPARAM wParam, LPARAM
 					    InvalidateRect(hWnd,NULL,TRUE);
 
 					}
+					sort_objects();
 					for(t=0;t<GLOBAL.objects;t++) objects[t]->update_inports();
 					update_dimensions();
-					TIMING.pause_timer=0;
+					resume_processing(sav_pause);
 				}
  			    SetFocus(ghWndMain);
 				break;
@@ -1999,6 +2055,7 @@ void update_status_window(void)
 void report(char * Message)
 {
 	write_logfile("INFO: %s",Message);
+	if (GLOBAL.headless) { printf("INFO: %s\n",Message); return; }
     if (!GLOBAL.loading) close_toolbox();
 	ShowWindow(ghWndMain,FALSE);
 	UpdateWindow(ghWndMain);
@@ -2012,6 +2069,7 @@ void report(char * Message)
 void report_error(char * Message)
 {
 	write_logfile("ERROR: %s",Message);
+	if (GLOBAL.headless) { printf("ERROR: %s\n",Message); return; }
     if (!GLOBAL.loading) close_toolbox();
 	ShowWindow(ghWndMain,FALSE);
 	UpdateWindow(ghWndMain);
@@ -2026,6 +2084,7 @@ void report_error(char * Message)
 void critical_error(char * Message)
 {	
 	write_logfile("CRITICAL ERROR: %s",Message);
+	if (GLOBAL.headless) { printf("CRITICAL ERROR: %s\n",Message); ExitProcess(1); }
     if (!GLOBAL.loading) close_toolbox();
 	ShowWindow(ghWndMain,FALSE);
 	UpdateWindow(ghWndMain);
@@ -10,10 +10,8 @@
   open captfile: tries to open the specified file, when a BrainBay header is found, 
          the devicetype / filetype - settings are updated. 
 		 the number of Packets in the Archive is determined via the filesize.
-
-  read_captfile: a byte is read from the archive (text or a integer-mode)
-			and written to the TTY-read-buffer.
-  write_captfile: a byte is written to the archive (text or a integer-mode)
+		 the archive is mapped and read by the functions in archive.cpp
+  the received bytes are written to the archive by the recorder (see recorder.cpp)
   close_captfile: closes the archive file		
 
   open_file_dlg: opens a select-file-window, for load or save purposes. 
@@ -25,6 +23,12 @@
  			 new objects are created and overloaded with data from the configuration-file.
  			 the file contains 1:1 - copies of all objects -> pointers cannot be used
   save_configfile: saves the current settings (all the objects, counters etc.)
+  load_next_config_buffer: the design file is read into memory once, every call
+             parses the next section (up to "end object"). The "key=value" lines
+			 are entered into a hash table which serves load_property(), the
+			 "linkport" lines are collected for link_object(). Properties which
+			 were not requested by the loader are reported in the logfile.
+			 When the tables can't grow, the load stops (CONFIG.failed).
 
   This program is free software; you can redistribute it and/or
   modify it under the terms of the GNU General Public License
@@ -37,6 +41,7 @@
 #include "ob_midi.h"
 
 HANDLE logfile=INVALID_HANDLE_VALUE;
+CONFIGStruct CONFIG;
 
 void append_newline(char * str,int si)
 {
@@ -110,6 +115,11 @@ HANDLE create_captfile(LPCTSTR lpFName)
 
 	
     if (!WriteFile(hTemp,&header,sizeof(header), &dwWritten, NULL))  report_error("Could not write to Archive");
+	if (!start_recorder(hTemp,CAPTFILE.filetype))
+	{
+		CloseHandle(hTemp);
+		return (INVALID_HANDLE_VALUE);
+	}
 	
 	CAPTFILE.start=TIMING.packetcounter;
 	CAPTFILE.file_action=FILE_WRITING;
@@ -151,10 +161,12 @@ void update_devicetype(void)
 			CAPTFILE.data_begin=0;
 			break;
 	}
+	if (CAPTFILE.filetype==FILE_COMPRESSED) CAPTFILE.data_begin=sizeof(CAPTFILEHEADERStruct);
 	TTY.bytes_per_packet=BYTES_PER_PACKET[TTY.devicetype];
 	TTY.amount_to_read=AMOUNT_TO_READ[TTY.devicetype];
 	if (CAPTFILE.filehandle!=INVALID_HANDLE_VALUE)
 		SetFilePointer(CAPTFILE.filehandle,CAPTFILE.data_begin,NULL,FILE_BEGIN);
+	index_captfile();
 	PACKET.readstate=0;
 	get_session_length();
 }
@@ -181,6 +193,7 @@ int open_captfile(LPCTSTR lpFName)
 		{
 			if (!strcmp(header.filetype, captfiletypes[FILE_TEXTMODE])) CAPTFILE.filetype=FILE_TEXTMODE; 
 			if (!strcmp(header.filetype, captfiletypes[FILE_INTMODE])) CAPTFILE.filetype=FILE_INTMODE;
+			if (!strcmp(header.filetype, captfiletypes[FILE_COMPRESSED])) CAPTFILE.filetype=FILE_COMPRESSED;
 		}
 		else 
 		{
@@ -188,6 +201,12 @@ int open_captfile(LPCTSTR lpFName)
 			CAPTFILE.filetype=FILE_INTMODE;
 		}
 		strcpy(CAPTFILE.devicetype,header.devicetype);
+		if (!map_captfile())
+		{
+			CloseHandle(CAPTFILE.filehandle);
+			CAPTFILE.filehandle=INVALID_HANDLE_VALUE;
+			return (0);
+		}
 		update_devicetype();
 		CAPTFILE.file_action=FILE_READING;
 
@@ -223,6 +242,8 @@ void close_captfile(void)
 	CAPTFILE.do_read=0;
 	CAPTFILE.do_write=0;
 	CAPTFILE.file_action=0;
+	stop_recorder();
+	unmap_captfile();
 
 	if (CAPTFILE.filehandle!=INVALID_HANDLE_VALUE)
 	{
@@ -241,88 +262,6 @@ void close_captfile(void)
 }
 
 
-void read_captfile(int amount)
-{
-	DWORD dwRead;  
-	char temp[500];
-	char act[500];
-	int actpos,actbufpos,tempint=0;
-	int res;
-
-
-	actpos=0;
-	for(actbufpos=0;actbufpos<amount;)
-	{
-
-	  res=ReadFile(CAPTFILE.filehandle,temp, 1, &dwRead, NULL);
-	  if (res &&  (dwRead )) 
-	  { 
-	  switch (CAPTFILE.filetype)
-	  {
-	    case FILE_INTMODE:
-		     TTY.readBuf[actbufpos++]=(unsigned char)temp[0];
-			 break;
-
-		case FILE_TEXTMODE:
-			switch (temp[0]) 
-			{
-				case ' ': case 10: case 13: break;
-				case ',':
-					    act[actpos]=0; sscanf(act,"%d",&tempint);
-						TTY.readBuf[actbufpos++]=(unsigned char)tempint;
-						actpos=0;
-						break;
-				 default: act[actpos++]=temp[0];
-				 
-			}
-			break;
-				  
-		}
- 	  } 
-	  else //{ TTY.readBuf[0]=0; return; }
-	  { 
-	       SetFilePointer(CAPTFILE.filehandle,CAPTFILE.data_begin,NULL,FILE_BEGIN);
-		   //res=ReadFile(CAPTFILE.filehandle,temp, 1, &dwRead, NULL);
-		   //TTY.readBuf[0]=0;
- 	  } 
-
-	  
-
-	}
-}
-
-
-void write_captfile(unsigned char actbyte)
-{
-	DWORD dwWritten;
-	 char buf[10];
-
-	switch (CAPTFILE.filetype)
-	{
-	  case FILE_TEXTMODE:
-	      wsprintf(buf, "%d, ", (int) actbyte);
-		  while (strlen(buf)<5) strcat(buf," ");
-		  if (++GLOBAL.actcolumn==TTY.bytes_per_packet)
-		  { 
-			strcat (buf,"\r\n ");
-			GLOBAL.actcolumn=0;
-		  }
-		  if (!WriteFile(CAPTFILE.filehandle,buf,strlen(buf), &dwWritten, NULL))  
-		  {    report_error("Could not write to Archive"); 
-		       close_captfile();
-		  }
-		  break;
-	  case FILE_INTMODE:
-		  buf[0]=actbyte;
-		  if (!WriteFile(CAPTFILE.filehandle,buf,1, &dwWritten, NULL))  
-		  {   report_error("Could not write to Archive"); 
-		      close_captfile(); 
-		  }
-		  break;
-	}
-}
-
-
 int open_file_dlg(HWND hDlg, char * szFileName, int type, int flag_save)
 {
     OPENFILENAME ofn;
@@ -367,7 +306,7 @@ int open_file_dlg(HWND hDlg, char * szFileName, int type, int flag_save)
 		    ofn.lpstrDefExt = "wav";
 			break;
 	   case FT_EDF:
-			ofn.lpstrFilter = "EDF-Files (*.edf)\0*.edf\0All Files (*.*)\0*.*\0";
+			ofn.lpstrFilter = "EDF/BDF-Files (*.edf,*.bdf)\0*.edf;*.bdf\0All Files (*.*)\0*.*\0";
 		    ofn.lpstrDefExt = "edf";
 			break;
 	   case FT_AVI:
@@ -383,7 +322,7 @@ int open_file_dlg(HWND hDlg, char * szFileName, int type, int flag_save)
 		    ofn.lpstrDefExt = "erp";
 			break;
 	   case FT_TXT:
-			ofn.lpstrFilter = "Text Files (*.txt)\0*.txt\0All Files (*.*)\0*.*\0";
+			ofn.lpstrFilter = "Text Files (*.txt,*.csv)\0*.txt;*.csv\0All Files (*.*)\0*.*\0";
 		    ofn.lpstrDefExt = "txt";
 			break;
 	   case FT_BMP:
@@ -402,6 +341,10 @@ int open_file_dlg(HWND hDlg, char * szFileName, int type, int flag_save)
 			ofn.lpstrFilter = "Neurobit Archive File (*.nba)\0*.nba\0All Files (*.*)\0*.*\0";
 		    ofn.lpstrDefExt = "nba";
 			break;
+	   case FT_CSV:
+			ofn.lpstrFilter = "CSV Files (*.csv)\0*.csv\0All Files (*.*)\0*.*\0";
+		    ofn.lpstrDefExt = "csv";
+			break;
 	}
     ofn.lpstrFile = szFileName;
     ofn.nMaxFile = MAX_PATH;
@@ -509,7 +452,7 @@ BOOL load_configfile(LPCTSTR pszFileName)
 		deviceobject=NULL;
 		GLOBAL.run_exception=0;
 		GLOBAL.minimized=FALSE;
-		if (GLOBAL.main_maximized)
+		if ((GLOBAL.main_maximized) && (!GLOBAL.headless))
 		{  SendMessage(ghWndMain,WM_SIZE,SIZE_RESTORED,0);		 
 		   ShowWindow( ghWndMain, TRUE ); UpdateWindow( ghWndMain );
 		}
@@ -562,7 +505,7 @@ BOOL load_configfile(LPCTSTR pszFileName)
 
 		 if (save_connected) { update_p21state(); save_connected=TTY.CONNECTED; }
 		 BreakDownCommPort();  
-		 if (try_connect) { TTY.CONNECTED=SetupCommPort(TTY.PORT); update_p21state(); }
+		 if ((try_connect) && (!GLOBAL.headless)) { TTY.CONNECTED=SetupCommPort(TTY.PORT); update_p21state(); }
 		
 		 load_property("captfilename",P_STRING,CAPTFILE.filename);
 		 load_property("captfiletype",P_INT,&CAPTFILE.filetype);
@@ -584,6 +527,7 @@ BOOL load_configfile(LPCTSTR pszFileName)
    		 for (t=0;t<num_objects;t++)
 		 {
 			act_type=load_next_config_buffer(hFile);
+			if (CONFIG.failed) { num_objects=GLOBAL.objects; break; }
 			if (act_type>=0)
 			{	
 				create_object(act_type);
@@ -596,8 +540,10 @@ BOOL load_configfile(LPCTSTR pszFileName)
 
 			}
 		 }
+		 end_config_section();
 		 CloseHandle(hFile);
 		 for (t=0;t<num_objects;t++) objects[t]->update_inports();
+		 sort_objects();
 		 update_dimensions();
 
 		 CAPTFILE.filehandle=INVALID_HANDLE_VALUE;
@@ -666,17 +612,20 @@ BOOL load_configfile(LPCTSTR pszFileName)
 
 
 		 MoveWindow(ghWndMain,GLOBAL.left,GLOBAL.top,GLOBAL.right-GLOBAL.left,GLOBAL.bottom-GLOBAL.top,TRUE);
-		 ShowWindow( ghWndMain, TRUE ); 
-		 UpdateWindow( ghWndMain ); 
-		 // SetWindowPos(ghWndMain,0,0,0,0,0,SWP_NOMOVE|SWP_NOSIZE);
-		 InvalidateRect(ghWndMain,NULL,TRUE);
- 		 InvalidateRect(ghWndDesign,NULL,TRUE);
-		 if (GLOBAL.minimized) ShowWindow(ghWndMain, SW_MINIMIZE);
+		 if (!GLOBAL.headless)   // batch mode: main window stays hidden
+		 {
+			 ShowWindow( ghWndMain, TRUE ); 
+			 UpdateWindow( ghWndMain ); 
+			 // SetWindowPos(ghWndMain,0,0,0,0,0,SWP_NOMOVE|SWP_NOSIZE);
+			 InvalidateRect(ghWndMain,NULL,TRUE);
+ 			 InvalidateRect(ghWndDesign,NULL,TRUE);
+			 if (GLOBAL.minimized) ShowWindow(ghWndMain, SW_MINIMIZE);
+		 }
 
 		 GLOBAL.loading=0;
-		 if ((GLOBAL.autorun) && (!GLOBAL.run_exception)) SendMessage(ghWndStatusbox,WM_COMMAND, IDC_RUNSESSION,0);
+		 if ((GLOBAL.autorun) && (!GLOBAL.run_exception) && (!GLOBAL.headless)) SendMessage(ghWndStatusbox,WM_COMMAND, IDC_RUNSESSION,0);
   	    
-		 if (save_toolbox!=-1)
+		 if ((save_toolbox!=-1) && (!GLOBAL.headless))
 		 {
 			GLOBAL.showtoolbox=save_toolbox;
 			actobject=objects[GLOBAL.showtoolbox];
@@ -783,6 +732,11 @@ BOOL save_settings(void)
 	save_property(hFile,"samplingrate",P_INT,&PACKETSPERSECOND);
 	save_property(hFile,"dialoginterval",P_INT,&GLOBAL.dialog_interval);
 	save_property(hFile,"drawinterval",P_INT,&GLOBAL.draw_interval);
+	save_property(hFile,"blocksize",P_INT,&BLOCK.size);
+	save_property(hFile,"workerthreads",P_INT,&GLOBAL.worker_threads);
+	save_property(hFile,"recordflush",P_INT,&GLOBAL.record_flush);
+	save_property(hFile,"serialreadsize",P_INT,&TTY.readsize);
+	save_property(hFile,"clockresample",P_INT,&CLOCK.resample);
 	save_property(hFile,"startup",P_INT,&GLOBAL.startup);
 	save_property(hFile,"autorun",P_INT,&GLOBAL.autorun);
 	save_property(hFile,"configfile",P_STRING,GLOBAL.configfile);
@@ -832,6 +786,17 @@ BOOL load_settings(void)
 	load_property("samplingrate",P_INT,&PACKETSPERSECOND);
 	load_property("dialoginterval",P_INT,&GLOBAL.dialog_interval);
 	load_property("drawinterval",P_INT,&GLOBAL.draw_interval);
+	load_property("blocksize",P_INT,&BLOCK.size);
+	if (BLOCK.size<1) BLOCK.size=1;
+	if (BLOCK.size>MAX_BLOCKSIZE) BLOCK.size=MAX_BLOCKSIZE;
+	load_property("workerthreads",P_INT,&GLOBAL.worker_threads);
+	if (GLOBAL.worker_threads<1) GLOBAL.worker_threads=1;
+	if (GLOBAL.worker_threads>MAX_WORKERS) GLOBAL.worker_threads=MAX_WORKERS;
+	load_property("recordflush",P_INT,&GLOBAL.record_flush);
+	if ((GLOBAL.record_flush<FLUSH_NONE)||(GLOBAL.record_flush>FLUSH_BUFFER)) GLOBAL.record_flush=FLUSH_NONE;
+	load_property("serialreadsize",P_INT,&TTY.readsize);
+	if ((TTY.readsize<1)||(TTY.readsize>(int)sizeof(TTY.readBuf))) TTY.readsize=sizeof(TTY.readBuf);
+	load_property("clockresample",P_INT,&CLOCK.resample);
 	load_property("startup",P_INT,&GLOBAL.startup);
 	load_property("autorun",P_INT,&GLOBAL.autorun);
 	load_property("configfile",P_STRING,GLOBAL.configfile);
@@ -868,50 +833,81 @@ BOOL load_settings(void)
 		if (!f) {strcat (tempname," not found"); report_error (tempname); }
 	}
 
+	end_config_section();
 	CloseHandle(hFile);	
 	return(TRUE);
 	
 }
 
-int load_property(char * desc,int type, void * ad)
+unsigned int config_hash(const char * key)
 {
-	char newdesc[60];
-	char param[20000];
-	char * propstart;
- 	int pos;
+	unsigned int h=2166136261u;
 
+	while (*key) { h^=(unsigned char)*key++; h*=16777619u; }
+	return(h);
+}
 
-	low_chars(newdesc, desc);
-  //  report(newdesc);
-	strcat(newdesc,"=");
-
-	propstart=strstr(GLOBAL.configbuffer,newdesc);
-	if (propstart) 
+//  finds the value of a property of the actual section
+char * find_property(char * desc)
+{
+	char key[60];
+	unsigned int h;
+	int i;
+
+	if (!CONFIG.props) return(NULL);
+	low_chars(key, desc);
+	h=config_hash(key)&CONFIG.hashmask;
+	while ((i=CONFIG.hash[h])>=0)
 	{
-		while ((*propstart)&&(*propstart!='=')&&(*propstart!=10)&&(*propstart!=13)) propstart++;
-		if (*propstart=='=')
+		if (!strcmp(CONFIG.prop[i].key,key))
 		{
-		  propstart++;
-		  while (*propstart==' ') propstart++;
-		  pos=0;
-		  while ((*propstart!=10)&&(*propstart!=13)&&(*propstart)&&pos<20000) param[pos++]=*propstart++;
-		  param[pos]=0;
-		  switch (type)
-		  {
-			case P_INT: sscanf(param,"%d",(int *)ad); return(1);
-			case P_FLOAT: sscanf(param,"%f",(float *)ad); return(1);
-		    case P_STRING: strcpy ((char *)ad,param); return(1);
-		  }
+			CONFIG.prop[i].used=TRUE;
+			return(CONFIG.prop[i].value);
 		}
+		h=(h+1)&CONFIG.hashmask;
+	}
+	return(NULL);
+}
+
+int load_property(char * desc,int type, void * ad)
+{
+	char * propstart;
+	char * to;
+ 	int pos;
+
+	if (!(propstart=find_property(desc))) return(0);
+	switch (type)
+	{
+		case P_INT: sscanf(propstart,"%d",(int *)ad); return(1);
+		case P_FLOAT: sscanf(propstart,"%f",(float *)ad); return(1);
+		case P_STRING: 
+			to=(char *)ad; pos=0;
+			while ((*propstart!=10)&&(*propstart!=13)&&(*propstart)&&pos<MAX_PROPERTYLEN) to[pos++]=*propstart++;
+			to[pos]=0;
+			return(1);
 	}
 	return(0);
 }
 
+//  returns an allocated copy of a (long) string property, NULL if not found
+char * load_property_string(char * desc)
+{
+	char * propstart, * str;
+	int len;
+
+	if (!(propstart=find_property(desc))) return(NULL);
+	for (len=0;(propstart[len]!=10)&&(propstart[len]!=13)&&(propstart[len]);len++);
+	if (!(str=(char *)malloc(len+1))) return(NULL);
+	memcpy(str,propstart,len);
+	str[len]=0;
+	return(str);
+}
+
 
 
 void save_property(HANDLE hFile, char * desc,int type, void * ad)
 {
-	char str[20000];
+	char str[100];
     DWORD dwWritten;
 	char nl[3]="\r\n";
 
@@ -924,7 +920,7 @@ void save_property(HANDLE hFile, char * desc,int type, void * ad)
 		{
 		  case P_INT: sprintf(str,"%d",*((int *)ad)); break;
 		  case P_FLOAT: sprintf(str,"%.6f",*((float *)ad)); break;
-          case P_STRING: strcpy (str,(char *)ad); break;
+          case P_STRING: WriteFile(hFile, (char *)ad, strlen((char *)ad), &dwWritten, NULL); str[0]=0; break;
 		}
 		strcat(str,nl);
 		WriteFile(hFile, str, strlen(str), &dwWritten, NULL);
@@ -988,6 +984,9 @@ void load_object_basics(BASE_CL * actobj)
 	load_property("outputports",P_INT,&(actobj->outports));
 	load_property("tag",P_STRING,actobj->tag);
 
+	actobj->inports=actobj->reserve_ports(actobj->inports);
+	actobj->outports=actobj->reserve_ports(actobj->outports);
+
 	for (t=1;t<=actobj->inports;t++)
 	{
 		sprintf(temp,"inport%ddesc",t);
@@ -1019,25 +1018,158 @@ void load_object_basics(BASE_CL * actobj)
 
 }
 
+//  reads the rest of the file, unless it was read by the last call
+int read_config_file(HANDLE hFile)
+{
+	DWORD pos,size,sizehigh=0,dwRead=0;
+
+	pos=SetFilePointer(hFile,0,NULL,FILE_CURRENT);
+	if ((hFile==CONFIG.file) && (pos==CONFIG.fileend) && (CONFIG.text)) return(TRUE);
+
+	size=GetFileSize(hFile,&sizehigh);
+	if ((size==INVALID_FILE_SIZE) || (sizehigh)) return(FALSE);
+	size= (size>pos) ? size-pos : 0;
+	if ((long)size+1>CONFIG.allocated)
+	{
+		free(CONFIG.text);
+		CONFIG.allocated=size+1;
+		if (!(CONFIG.text=(char *)malloc(CONFIG.allocated))) { CONFIG.allocated=0; return(FALSE); }
+	}
+	if (!ReadFile(hFile,CONFIG.text,size,&dwRead,NULL)) dwRead=0;
+	CONFIG.text[dwRead]=0;
+	CONFIG.size=dwRead; CONFIG.pos=0;
+	CONFIG.file=hFile; CONFIG.fileend=pos+dwRead;
+	CONFIG.failed=FALSE;
+	return(TRUE);
+}
+
+//  the add_config - and build_config - functions return FALSE when the table can't grow,
+//  the old table is kept
+int add_config_property(char * key, char * value)
+{
+	CONFIGPROPERTYStruct * p;
+	int size;
+
+	if (CONFIG.props>=CONFIG.propsallocated)
+	{
+		size= CONFIG.propsallocated ? CONFIG.propsallocated*2 : 256;
+		if (!(p=(CONFIGPROPERTYStruct *)realloc(CONFIG.prop,size*sizeof(CONFIGPROPERTYStruct)))) return(FALSE);
+		CONFIG.prop=p; CONFIG.propsallocated=size;
+	}
+	CONFIG.prop[CONFIG.props].key=key;
+	CONFIG.prop[CONFIG.props].value=value;
+	CONFIG.prop[CONFIG.props].used=FALSE;
+	CONFIG.props++;
+	return(TRUE);
+}
+
+int add_config_link(char * line)
+{
+	char ** l;
+	int size;
+
+	if (CONFIG.links>=CONFIG.linksallocated)
+	{
+		size= CONFIG.linksallocated ? CONFIG.linksallocated*2 : 64;
+		if (!(l=(char **)realloc(CONFIG.link,size*sizeof(char *)))) return(FALSE);
+		CONFIG.link=l; CONFIG.linksallocated=size;
+	}
+	CONFIG.link[CONFIG.links++]=line;
+	return(TRUE);
+}
+
+//  enters the keys of the section into the hash table (at most half filled),
+//  the first of duplicate keys is used
+int build_config_hash(void)
+{
+	unsigned int h;
+	int i,size=64;
+	int * hash;
+
+	while (size<CONFIG.props*2) size*=2;
+	if (size>CONFIG.hashallocated)
+	{
+		if (!(hash=(int *)realloc(CONFIG.hash,size*sizeof(int)))) return(FALSE);
+		CONFIG.hash=hash; CONFIG.hashallocated=size;
+	}
+	CONFIG.hashmask=size-1;
+	for (i=0;i<size;i++) CONFIG.hash[i]=-1;
+
+	for (i=0;i<CONFIG.props;i++)
+	{
+		h=config_hash(CONFIG.prop[i].key)&CONFIG.hashmask;
+		while ((CONFIG.hash[h]>=0) && (strcmp(CONFIG.prop[CONFIG.hash[h]].key,CONFIG.prop[i].key)))
+			h=(h+1)&CONFIG.hashmask;
+		if (CONFIG.hash[h]<0) CONFIG.hash[h]=i;
+		else CONFIG.prop[i].used=TRUE;
+	}
+	return(TRUE);
+}
+
+//  reports the properties of the last section which were not requested
+void end_config_section(void)
+{
+	int i;
+
+	if (!CONFIG.section) return;
+	CONFIG.section=FALSE;
+	for (i=0;i<CONFIG.props;i++)
+		if (!CONFIG.prop[i].used)
+		{
+			if (CONFIG.type<0) write_logfile("unknown setting ignored: %s",CONFIG.prop[i].key);
+			else write_logfile("unknown property of %s ignored: %s",
+				(CONFIG.type<OBJECT_COUNT) ? objnames[CONFIG.type] : "element",CONFIG.prop[i].key);
+		}
+}
+
+//  parses the next section of the file, returns the type of the next object or -1
 int load_next_config_buffer(HANDLE hFile)
 {
-    DWORD dwRead;
-	char buf[2];
-	int pos,l;
+	char * line, * end, * value;
+	int ok=TRUE;
+
+	end_config_section();
+	CONFIG.props=0; CONFIG.links=0;
+	if (!read_config_file(hFile)) return(-1);
+	if (CONFIG.failed) return(-1);
 
- 	pos=0;
-	dwRead=1;l=1;
-	while (l&&dwRead)
+	while (CONFIG.pos<CONFIG.size)
 	{
-		ReadFile(hFile, &buf,1,&dwRead,NULL);
-		GLOBAL.configbuffer[pos++]=buf[0];	GLOBAL.configbuffer[pos]=0;
+		line=CONFIG.text+CONFIG.pos;
+		if ((end=(char *)memchr(line,10,CONFIG.size-CONFIG.pos)))
+		{
+			*end=0;
+			CONFIG.pos=end-CONFIG.text+1;
+		}
+		else
+		{
+			end=CONFIG.text+CONFIG.size;
+			CONFIG.pos=CONFIG.size;
+		}
+		while ((end>line)&&(end[-1]==13)) *--end=0;
 
-		if (strstr(GLOBAL.configbuffer,"end object")!=NULL) l=0;
+		if (!strcmp(line,"end object")) break;
+		if (!strncmp(line,"linkport",8)) ok=add_config_link(line);
+		else if ((value=strchr(line,'=')))
+		{
+			*value++=0;
+			while (*value==' ') value++;
+			ok=add_config_property(line,value);
+		}
+		if (!ok) break;
 	}
-    //report_error(GLOBAL.configbuffer);
-	pos=-1;
-	load_property("next object",P_INT,&pos);
-	return (pos);
+	if ((!ok) || (!build_config_hash()))
+	{   // out of memory: no property of this section is served
+		CONFIG.props=0; CONFIG.links=0;
+		CONFIG.failed=TRUE;
+		report_error("Not enough memory to load the design, the rest of the file is not loaded");
+		return(-1);
+	}
+	CONFIG.section=TRUE;
+
+	CONFIG.type=-1;
+	load_property("next object",P_INT,&CONFIG.type);
+	return (CONFIG.type);
 }
 
 
@@ -1050,24 +1182,19 @@ void link_object(BASE_CL * act)
 
 	if (!act) return;
 	
-	linkinfo=strstr(GLOBAL.configbuffer,"linkport");
-	con=0;
-	while (linkinfo) 
+	for (con=0;con<CONFIG.links;con++)
 	{
-//		if (act->type==OB_EEG) report("link-it");
-
+		if (!act->reserve_links(con+1)) return;
 		act->out[con].from_object=GLOBAL.objects-1;
 
+		linkinfo=CONFIG.link[con];
 		getfrom=get_int(linkinfo,0,&from_port);
 		getfrom=get_int(linkinfo,getfrom,&to_obj); if (to_obj<0) to_obj=-to_obj;
 		getfrom=get_int(linkinfo,getfrom,&to_port);
-//		getfrom=get_string(linkinfo+getfrom,":",act->out[con].description);
 		
 		act->out[con].from_port=from_port;
 		act->out[con].to_object=to_obj;
 		act->out[con].to_port=to_port;
-		con++;
-		linkinfo=strstr(linkinfo+1,"linkport");
 	}
 
 }
@@ -1100,52 +1227,72 @@ void reduce_filepath(char * to, char * from)
 }
 
 
-void parse_edf_header(EDFHEADERStruct * to, CHANNELStruct * tochn, char * from)
+//  parses the header of an edf-file, the channel table (allocated entries)
+//  is grown to the number of channels. BDF-files (BioSemi, 24 bit samples)
+//  start with 0xFF,"BIOSEMI", EDF+ and BDF+ are marked in the reserved field.
+//  the samples per segment are the highest of the signal channels
+void parse_edf_header(EDFHEADERStruct * to, CHANNELStruct ** channel, int * allocated, char * from)
 {
-	int start,x,temp;
+	int start,x,n,temp;
 	char szdata[100];
+	CHANNELStruct * tochn;
 
 	temp=0;
 
 	copy_string(from,8,88,to->patient);
 	copy_string(from,88,168,to->device);
 
+	to->format = ((unsigned char)from[0]==0xFF) ? EDF_FORMAT_BDF : EDF_FORMAT_EDF;
+	copy_string(from,192,197,szdata);
+	if ((!strcmp(szdata,"EDF+C"))||(!strcmp(szdata,"BDF+C"))) to->plus=EDF_PLUS_CONTINUOUS;
+	else if ((!strcmp(szdata,"EDF+D"))||(!strcmp(szdata,"BDF+D"))) to->plus=EDF_PLUS_DISCONTINUOUS;
+	else to->plus=EDF_PLUS_NONE;
+	to->annotations=0;
+
 	copy_string(from,236,244,szdata);
 	sscanf(szdata,"%d",&to->segments);
 
 	copy_string(from,244,252,szdata);
-	sscanf(szdata,"%d",&to->duration);
+	to->duration=0;
+	sscanf(szdata,"%lf",&to->duration);
 	if (to->duration<=0) to->duration=1;
 
 	copy_string(from,252,256,szdata);
-	sscanf(szdata,"%d",&to->channels);
+	n=0;
+	sscanf(szdata,"%d",&n);
+	if (n<0) n=0;
+	to->channels=reserve_channels(channel,allocated,n);
 
+	tochn=*channel;
 	to->samplespersegment=1;
 	for (x=0;x<to->channels;x++) 
 	{
 		copy_string(from,256+x*16,256+(x+1)*16,tochn->label);
-		start=256+to->channels*16;
+		start=256+n*16;
 		copy_string(from,start+x*80,start+(x+1)*80,tochn->transducer);
-		start+=to->channels*80;
+		start+=n*80;
 		copy_string(from,start+x*8,start+(x+1)*8,tochn->physdim);
-		start+=to->channels*8;
+		start+=n*8;
 		copy_string(from,start+x*8,start+(x+1)*8,szdata);
-		sscanf(szdata,"%d",&tochn->physmin);
-		start+=to->channels*8;
+		sscanf(szdata,"%lf",&tochn->physmin);
+		start+=n*8;
 		copy_string(from,start+x*8,start+(x+1)*8,szdata);
-		sscanf(szdata,"%d",&tochn->physmax);
-		start+=to->channels*8;
+		sscanf(szdata,"%lf",&tochn->physmax);
+		start+=n*8;
 		copy_string(from,start+x*8,start+(x+1)*8,szdata);
 		sscanf(szdata,"%d",&tochn->digmin);
-		start+=to->channels*8;
+		start+=n*8;
 		copy_string(from,start+x*8,start+(x+1)*8,szdata);
 		sscanf(szdata,"%d",&tochn->digmax);
-		start+=to->channels*8;
+		start+=n*8;
 		copy_string(from,start+x*80,start+(x+1)*80,tochn->prefiltering);
-		start+=to->channels*80;
+		start+=n*80;
 		copy_string(from,start+x*8,start+(x+1)*8,szdata);
 		sscanf(szdata,"%d",&tochn->samples);
-		if (tochn->samples>to->samplespersegment) to->samplespersegment=tochn->samples;
+		if (tochn->samples<0) tochn->samples=0;
+		tochn->annotation = (!strncmp(tochn->label,"EDF Annotations",15)) || (!strncmp(tochn->label,"BDF Annotations",15));
+		if (tochn->annotation) to->annotations++;
+		else if (tochn->samples>to->samplespersegment) to->samplespersegment=tochn->samples;
 		tochn++;
 	}
 }
@@ -1171,77 +1318,115 @@ void edfheader_to_physical(EDFHEADERStruct * from, EDFHEADER_PHYSICALStruct * to
 	strcpy(to->starttime,acttime); 
 
 
-	strcpy(to->version,"0"); 
+	if (from->format==EDF_FORMAT_BDF) { to->version[0]=(char)0xFF; strcpy(to->version+1,"BIOSEMI"); }
+	else strcpy(to->version,"0"); 
 	strcpy(to->patient,from->patient); 
 	strcpy(to->recording,from->device);
     sprintf(to->records,"%d",from->segments);
-	sprintf(to->duration,"%d",1);
+	edf_number(to->duration,from->duration);
 	sprintf(to->channels,"%d",from->channels);
 	sprintf(to->headerlength,"%d",len);
 
 	ch=(char *)to;
 	for(t=0;t<256;t++,ch++) if (*ch==0) *ch=' ';
+	if (from->plus) 
+	{
+		memcpy(to->reserved,(from->plus==EDF_PLUS_DISCONTINUOUS) ? "EDF+D" : "EDF+C",5);
+		if (from->format==EDF_FORMAT_BDF) to->reserved[0]='B';
+	}
+	else if (from->format==EDF_FORMAT_BDF) memcpy(to->reserved,"24BIT",5);
 	to->end=0;
 }
 
 
-void edfchannels_to_physical(CHANNELStruct * fromchn,char * to,int channels)
+//  formats a number for an 8 character field of the header, the decimals are
+//  cut until it fits (writes at most 8 characters and the terminating 0)
+void edf_number(char * to, double value)
+{
+	char num[400];
+	int prec,len;
+
+	for (prec=6;prec>=0;prec--)
+	{
+		sprintf(num,"%.*f",prec,value);
+		len=(int)strlen(num);
+		if (prec)
+		{
+			while (num[len-1]=='0') num[--len]=0;
+			if (num[len-1]=='.') num[--len]=0;
+		}
+		if (len<=8) break;
+	}
+	num[8]=0;
+	memcpy(to,num,strlen(num)+1);
+}
+
+//  a channel with 0 samples per record follows the packet rate
+int edf_samples(CHANNELStruct * chn)
+{
+	return((chn->samples>0) ? chn->samples : PACKETSPERSECOND);
+}
+
+//  design: the samples are kept as they are (0 = follow the packet rate),
+//  otherwise the header of a file or stream gets the real number of samples
+void edfchannels_to_physical(CHANNELStruct * fromchn,char * to,int channels,int design)
 {
 	char szdata[100];
 	int i,t;
 	CHANNELStruct * actchn;
+	char * end;
 
-	to[0]=0;
+	to[0]=0; end=to;
 
 	actchn=fromchn;	
 	for (t=0;t<channels ;t++,actchn++)   // channel label
 	{   strcpy(szdata,actchn->label);  
 		for (i=strlen(szdata);i<16;i++) szdata[i]=' '; 
-		szdata[16]=0; strcat(to,szdata);	}
+		szdata[16]=0; strcpy(end,szdata); end+=strlen(end);	}
 	actchn=fromchn;	
 	for (t=0;t<channels ;t++,actchn++)    // transducer
 	{   strcpy(szdata,actchn->transducer); 
 		for (i=strlen(szdata);i<80;i++) szdata[i]=' ';
-		szdata[80]=0; strcat(to,szdata);	}
+		szdata[80]=0; strcpy(end,szdata); end+=strlen(end);	}
 	actchn=fromchn;	
 	for (t=0;t<channels ;t++,actchn++)    // physical dimension
 	{   strcpy(szdata,actchn->physdim); 
 		for (i=strlen(szdata);i<8;i++) szdata[i]=' ';
-		szdata[8]=0; strcat(to,szdata);	}
+		szdata[8]=0; strcpy(end,szdata); end+=strlen(end);	}
 	actchn=fromchn;	
 	for (t=0;t<channels ;t++,actchn++)   // physical minimum
-	{   sprintf(szdata,"%d",actchn->physmin); 
+	{   edf_number(szdata,actchn->physmin); 
 		for (i=strlen(szdata);i<8;i++) szdata[i]=' ';
-		szdata[8]=0; strcat(to,szdata);	}
+		szdata[8]=0; strcpy(end,szdata); end+=strlen(end);	}
 	actchn=fromchn;	
 	for (t=0;t<channels ;t++,actchn++)  // physical maximum
-	{   sprintf(szdata,"%d",actchn->physmax); 
+	{   edf_number(szdata,actchn->physmax); 
 		for (i=strlen(szdata);i<8;i++) szdata[i]=' ';
-		szdata[8]=0; strcat(to,szdata);	}
+		szdata[8]=0; strcpy(end,szdata); end+=strlen(end);	}
 	actchn=fromchn;	
 	for (t=0;t<channels ;t++,actchn++)  // digital minimum
 	{   sprintf(szdata,"%d",actchn->digmin); 
 		for (i=strlen(szdata);i<8;i++) szdata[i]=' ';
-		szdata[8]=0; strcat(to,szdata);	}
+		szdata[8]=0; strcpy(end,szdata); end+=strlen(end);	}
 	actchn=fromchn;	
 	for (t=0;t<channels ;t++,actchn++)   // digital maximum
 	{   sprintf(szdata,"%d",actchn->digmax); 
 		for (i=strlen(szdata);i<8;i++) szdata[i]=' ';
-		szdata[8]=0; strcat(to,szdata);	}
+		szdata[8]=0; strcpy(end,szdata); end+=strlen(end);	}
 	actchn=fromchn;	
 	for (t=0;t<channels ;t++,actchn++)    // prefiltering
-	{   strcpy(szdata,actchn->transducer); 
+	{   strcpy(szdata,actchn->prefiltering); 
 		for (i=strlen(szdata);i<80;i++) szdata[i]=' ';
-		szdata[80]=0; strcat(to,szdata);	}
+		szdata[80]=0; strcpy(end,szdata); end+=strlen(end);	}
 	actchn=fromchn;	
 	for (t=0;t<channels ;t++,actchn++)   //  samples per data record
-	{   sprintf(szdata,"%d",PACKETSPERSECOND); 
+	{   sprintf(szdata,"%d",design ? actchn->samples : edf_samples(actchn)); 
 		for (i=strlen(szdata);i<8;i++) szdata[i]=' ';
-		szdata[8]=0; strcat(to,szdata);	}
+		szdata[8]=0; strcpy(end,szdata); end+=strlen(end);	}
 	for (t=0;t<channels;t++)   // reseverd
 	{   strcpy(szdata," ");   
 		for (i=strlen(szdata);i<32;i++) szdata[i]=' ';
-		szdata[32]=0; strcat(to,szdata);	}
+		szdata[32]=0; strcpy(end,szdata); end+=strlen(end);	}
 
 }
 
@@ -1252,18 +1437,18 @@ void generate_edf_header(char * to, EDFHEADERStruct * header,CHANNELStruct * cha
     char nl[3];
 
 	edfheader_to_physical(header, (EDFHEADER_PHYSICALStruct *)to);
-	edfchannels_to_physical(channels, to+256, header->channels);
+	edfchannels_to_physical(channels, to+256, header->channels, FALSE);
 	nl[0]=13;nl[1]=10;nl[2]=0;
 	strcat(to,nl);
 
 }
 
-HANDLE open_edf_file(EDFHEADERStruct * to, CHANNELStruct * tochn,  char * filename)
+HANDLE open_edf_file(EDFHEADERStruct * to, CHANNELStruct ** channel, int * allocated, char * filename)
 {
-	char readbuf[8192];
-	int t,channels;
+	char * readbuf;
+	int channels;
 	HANDLE temp;
-	char fname[256],szdata[300];
+	char fname[256],head[256],szdata[20];
 	DWORD dwRead;
 
 
@@ -1278,20 +1463,27 @@ HANDLE open_edf_file(EDFHEADERStruct * to, CHANNELStruct * tochn,  char * filena
 	write_logfile("open edf file: %s",fname);
 	temp= CreateFile(fname, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
 	if (temp==INVALID_HANDLE_VALUE) return (temp);
-	ReadFile(temp,readbuf,256, &dwRead,NULL);
+	ReadFile(temp,head,256, &dwRead,NULL);
 	if (dwRead!=256) { CloseHandle(temp); return(INVALID_HANDLE_VALUE); }
 
-	copy_string(readbuf,252,256,szdata);
+	copy_string(head,252,256,szdata);
+	channels=0;
 	sscanf(szdata,"%d",&channels);
-
-	for (t=0;t<channels;t++)
+	if ((channels<0)||(channels>MAX_CHANNELS))
 	{
-
-		ReadFile(temp,readbuf+256+256*t,256, &dwRead,NULL);
-		if (dwRead!=256) { CloseHandle(temp); return(INVALID_HANDLE_VALUE); }
+		write_logfile("edf file has %d channels, the maximum is %d",channels,MAX_CHANNELS);
+		CloseHandle(temp); return(INVALID_HANDLE_VALUE);
 	}
 
-	parse_edf_header(to, tochn, readbuf);
+	// the header holds 256 bytes per channel
+	if (!(readbuf=(char *)malloc(EDF_HEADERSIZE(channels)+1))) { CloseHandle(temp); return(INVALID_HANDLE_VALUE); }
+	memcpy(readbuf,head,256);
+	ReadFile(temp,readbuf+256,256*channels, &dwRead,NULL);
+	if (dwRead!=(DWORD)256*channels) { free(readbuf); CloseHandle(temp); return(INVALID_HANDLE_VALUE); }
+	readbuf[EDF_HEADERSIZE(channels)]=0;
+
+	parse_edf_header(to, channel, allocated, readbuf);
+	free(readbuf);
 	//if (filename) 
 	strcpy(filename,fname);
 	return(temp);
@@ -1304,11 +1496,11 @@ HANDLE create_edf_file(EDFHEADERStruct * from, CHANNELStruct * fromchn, char * f
 	char fname[256];
 	DWORD dwWritten;
 	EDFHEADER_PHYSICALStruct file_header;
-	char chnbuf[18000];
+	char * chnbuf;
 	
 	*filename=0;
 	strcpy(fname,GLOBAL.resourcepath); 
-	strcat(fname,"ARCHIVES\\*.edf");
+	strcat(fname,(from->format==EDF_FORMAT_BDF) ? "ARCHIVES\\*.bdf" : "ARCHIVES\\*.edf");
 	if (!open_file_dlg(ghWndMain,fname, FT_EDF, OPEN_SAVE)) return (INVALID_HANDLE_VALUE);
 
 	write_logfile("create edf file: %s",fname);
@@ -1316,13 +1508,13 @@ HANDLE create_edf_file(EDFHEADERStruct * from, CHANNELStruct * fromchn, char * f
 	temp= CreateFile(fname, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
 	if (temp==INVALID_HANDLE_VALUE) return (temp);
 
+	if (!(chnbuf=(char *)malloc(EDF_HEADERSIZE(from->channels)))) { CloseHandle(temp); return(INVALID_HANDLE_VALUE); }
 	edfheader_to_physical(from, &file_header);
-	edfchannels_to_physical(fromchn, chnbuf, from->channels);
+	edfchannels_to_physical(fromchn, chnbuf, from->channels, FALSE);
 
 	WriteFile(temp,&file_header,256, &dwWritten,NULL);
-	if (dwWritten!=256) { CloseHandle(temp); return(INVALID_HANDLE_VALUE); }
-
-	WriteFile(temp,chnbuf,256*from->channels, &dwWritten,NULL);
+	if (dwWritten==256) WriteFile(temp,chnbuf,256*from->channels, &dwWritten,NULL);
+	free(chnbuf);
 	if (dwWritten!=(DWORD)256*from->channels) { CloseHandle(temp); return(INVALID_HANDLE_VALUE); }
 
 	strcpy(filename,fname);
@@ -1336,28 +1528,37 @@ void reset_header(EDFHEADERStruct * header)
 		header->samplingrate=PACKETSPERSECOND;
 		header->duration=1;
 		header->channels=0;
+		header->format=EDF_FORMAT_EDF;
+		header->plus=EDF_PLUS_NONE;
+		header->annotations=0;
 		strcpy(header->patient,"none");
 		strcpy(header->device ,"none");
 
 }
  
 void update_header(HWND hDlg, EDFHEADERStruct * header)
-{  
+{
+	char szdata[20];
 
 	SetDlgItemInt(hDlg,IDC_CHANNELS,header->channels,0);
 	SetDlgItemText(hDlg,IDC_PATIENT,header->patient);
 	SetDlgItemText(hDlg,IDC_DEVICE,header->device);
-	SetDlgItemInt(hDlg,IDC_DURATION,header->duration,0);
+	edf_number(szdata,header->duration);
+	SetDlgItemText(hDlg,IDC_DURATION,szdata);
 	SetDlgItemInt(hDlg,IDC_SEGMENTS,header->segments,1);
 	SetDlgItemInt(hDlg,IDC_SAMPLES,header->samplespersegment,0);
-	SetDlgItemInt(hDlg,IDC_SAMPLINGRATE,header->samplespersegment/header->duration,0);
+	SetDlgItemInt(hDlg,IDC_SAMPLINGRATE,(int)(header->samplespersegment/header->duration+0.5),0);
 }
 
 void get_header(HWND hDlg, EDFHEADERStruct * header)
-{  
+{
+	char szdata[20];
+
 	GetDlgItemText(hDlg,IDC_PATIENT,header->patient,80);
 	GetDlgItemText(hDlg,IDC_DEVICE,header->device,80);
-	header->duration=GetDlgItemInt(hDlg,IDC_DURATION,NULL,0);
+	GetDlgItemText(hDlg,IDC_DURATION,szdata,sizeof(szdata));
+	header->duration=atof(szdata);
+	if (header->duration<=0) header->duration=1;
 	header->segments=GetDlgItemInt(hDlg,IDC_SEGMENTS,NULL,0);
 	header->samplespersegment=GetDlgItemInt(hDlg,IDC_SAMPLES,NULL,0);
 	header->samplingrate=GetDlgItemInt(hDlg,IDC_SAMPLINGRATE,NULL,0);
@@ -1380,10 +1581,10 @@ void update_channelcombo(HWND hDlg, CHANNELStruct * channel, int channels)
 }
 
 
-void reset_channel(CHANNELStruct * channel)
+void reset_channel(CHANNELStruct * channel, int channels)
 {
 	int x;
-	for (x=0; x<MAX_EEG_CHANNELS; x++)
+	for (x=0; x<channels; x++)
 	{
 		strcpy(channel[x].label,"none");
 		strcpy(channel[x].transducer,"none");
@@ -1393,17 +1594,177 @@ void reset_channel(CHANNELStruct * channel)
 		channel[x].physmax=1;
 		channel[x].digmin=0;
 		channel[x].digmax=1024;
+		channel[x].samples=1;
+		channel[x].annotation=0;
+		channel[x].buffer=NULL;
+	}
+}
+
+//  makes sure that the channel table holds count channels (up to MAX_CHANNELS),
+//  the new entries are reset. returns count or the number of available channels.
+//  the table starts with channel=NULL, allocated=0. the sample buffers of new
+//  entries have to be assigned (alloc_channel_buffers)
+int reserve_channels(CHANNELStruct ** channel, int * allocated, int count)
+{
+	CHANNELStruct * c;
+	int size,sav_pause;
+
+	if (count>MAX_CHANNELS) count=MAX_CHANNELS;
+	if ((*channel) && (count<=*allocated)) return(count);
+	size=(*allocated>0) ? *allocated : 8;
+	while (size<count) size*=2;
+	if (size>MAX_CHANNELS) size=MAX_CHANNELS;
+
+	// the processing threads may access the channels of the element
+	sav_pause=pause_processing();
+	c=(CHANNELStruct *)realloc(*channel,size*sizeof(CHANNELStruct));
+	if (c)
+	{
+		reset_channel(c+*allocated,size-*allocated);
+		*channel=c; *allocated=size;
 	}
+	resume_processing(sav_pause);
+	if (!c) { report_error("Could not allocate memory for the channels"); return(*allocated); }
+	return(count);
+}
+
+//  allocates the sample buffers of the channels in one block: buflen samples
+//  per channel, or the samples of a data record (channel.samples) when buflen is 0.
+//  buffers is the previous block of the element, the new block is returned
+short * alloc_channel_buffers(short * buffers, CHANNELStruct * channel, int channels, int buflen)
+{
+	short * b;
+	int x,total,sav_pause;
+
+	for (x=0,total=0;x<channels;x++) total+= buflen ? buflen : channel[x].samples;
+	if (total<1) total=1;
+
+	sav_pause=pause_processing();
+	b=(short *)realloc(buffers,total*sizeof(short));
+	if (!b) free(buffers);
+	for (x=0,total=0;x<channels;x++)
+	{
+		channel[x].buffer= b ? b+total : NULL;
+		total+= buflen ? buflen : channel[x].samples;
+	}
+	if (b) memset(b,0,total*sizeof(short));
+	resume_processing(sav_pause);
+	if (!b) report_error("Could not allocate memory for the channel buffers");
+	return(b);
+}
+
+//  converts count samples of a data record to physical values (sample*gain+ofs),
+//  the samples are signed little endian numbers of 2 (EDF) or 3 (BDF) bytes
+void edf_to_float(const unsigned char * raw, int bytes, int count, float gain, float ofs, float * out)
+{
+	const short * s;
+	int i;
+
+	if (bytes==2)
+	{
+		s=(const short *)raw;
+		for (i=0;i<count;i++) out[i]=(float)s[i]*gain+ofs;
+	}
+	else
+	{
+		for (i=0;i<count;i++,raw+=3)
+			out[i]=(float)((int)raw[0] | ((int)raw[1]<<8) | ((int)(signed char)raw[2]<<16))*gain+ofs;
+	}
+}
+
+//  converts a physical value to a sample of 2 or 3 bytes (gain and ofs
+//  map the physical to the digital range), the sample is clipped to digmin..digmax
+void float_to_edf(float value, float gain, float ofs, int digmin, int digmax, int bytes, unsigned char * raw)
+{
+	float f;
+	int d;
+
+	f=value*gain+ofs;
+	d=(int)((f<0) ? f-0.5f : f+0.5f);
+	if (d<digmin) d=digmin;
+	if (d>digmax) d=digmax;
+	raw[0]=(unsigned char)d;
+	raw[1]=(unsigned char)(d>>8);
+	if (bytes==3) raw[2]=(unsigned char)(d>>16);
+}
+
+//  decodes the time-stamped annotation lists (TALs) of an EDF+ annotation channel:
+//  "+onset[0x15 duration]0x14 text 0x14 [text 0x14 ..] 0x00". The first TAL of a record
+//  has no text, its onset is the start time of the record (rectime).
+//  up to max annotations are stored to ann, returns the number of annotations
+int parse_edf_annotations(const unsigned char * tal, int len, double * rectime, EDFANNOTATIONStruct * ann, int max)
+{
+	char num[30],text[EDF_ANNOTATIONLEN];
+	double onset,duration;
+	int pos=0,i,n=0,t,first=TRUE;
+
+	while ((pos<len) && ((tal[pos]=='+')||(tal[pos]=='-')))
+	{
+		for (i=0;(pos<len)&&(tal[pos]!=0x14)&&(tal[pos]!=0x15)&&(i<29);pos++) num[i++]=tal[pos];
+		num[i]=0; onset=atof(num);
+		duration=0;
+		if ((pos<len) && (tal[pos]==0x15))
+		{
+			for (pos++,i=0;(pos<len)&&(tal[pos]!=0x14)&&(i<29);pos++) num[i++]=tal[pos];
+			num[i]=0; duration=atof(num);
+		}
+		pos++;
+
+		for (t=0;(pos<len)&&(tal[pos]);t++)       // the texts of the TAL
+		{
+			for (i=0;(pos<len)&&(tal[pos]!=0x14)&&(tal[pos]);pos++)
+				if (i<EDF_ANNOTATIONLEN-1) text[i++]=tal[pos];
+			text[i]=0;
+			if ((first) && (!t) && (!i)) *rectime=onset;
+			else if ((i) && (n<max))
+			{
+				strcpy(ann[n].text,text);
+				ann[n].onset=onset;
+				ann[n].duration=duration;
+				n++;
+			}
+			if ((pos<len) && (tal[pos]==0x14)) pos++;
+		}
+		first=FALSE;
+		pos++;
+	}
+	return(n);
+}
+
+//  saves the edf-header and the channel descriptions as one property
+void save_edf_header(HANDLE hFile, char * desc, EDFHEADERStruct * header, CHANNELStruct * channel)
+{
+	char * edfinfos;
+
+	if (!(edfinfos=(char *)malloc(EDF_HEADERSIZE(header->channels)+1))) return;
+	edfheader_to_physical(header, (EDFHEADER_PHYSICALStruct *) edfinfos);
+	edfchannels_to_physical(channel,edfinfos+256,header->channels,TRUE);
+	save_property(hFile,desc,P_STRING,edfinfos);
+	free(edfinfos);
+}
+
+int load_edf_header(char * desc, EDFHEADERStruct * header, CHANNELStruct ** channel, int * allocated)
+{
+	char * edfinfos;
+
+	if (!(edfinfos=load_property_string(desc))) return(0);
+	if (strlen(edfinfos)>=256) parse_edf_header(header, channel, allocated, edfinfos);
+	free(edfinfos);
+	return(1);
 }
 
 void update_channel(HWND hDlg, CHANNELStruct * channel, int actchn)
 {
+	char szdata[20];
+
 	SetDlgItemText(hDlg,IDC_LABEL,channel[actchn].label);
 	SetDlgItemText(hDlg,IDC_ELECTRODE,channel[actchn].transducer);
 	SetDlgItemText(hDlg,IDC_PREFILTERING,channel[actchn].prefiltering);
 	SetDlgItemText(hDlg,IDC_PHYSDIM,channel[actchn].physdim);
-	SetDlgItemInt(hDlg,IDC_PHYSMIN,channel[actchn].physmin,1);
-	SetDlgItemInt(hDlg,IDC_PHYSMAX,channel[actchn].physmax,1);
+	edf_number(szdata,channel[actchn].physmin);
+	SetDlgItemText(hDlg,IDC_PHYSMIN,szdata);
+	edf_number(szdata,channel[actchn].physmax);
+	SetDlgItemText(hDlg,IDC_PHYSMAX,szdata);
 	SetDlgItemInt(hDlg,IDC_DIGMIN,channel[actchn].digmin,1);
 	SetDlgItemInt(hDlg,IDC_DIGMAX,channel[actchn].digmax,1);
 	SetDlgItemInt(hDlg,IDC_SPP,channel[actchn].samples,0);
@@ -1411,12 +1772,16 @@ void update_channel(HWND hDlg, CHANNELStruct * channel, int actchn)
 
 void get_channel(HWND hDlg, CHANNELStruct * channel, int actchn)
 {
+	char szdata[20];
+
 	GetDlgItemText(hDlg,IDC_LABEL,channel[actchn].label,16);
 	GetDlgItemText(hDlg,IDC_PREFILTERING,channel[actchn].prefiltering,80);
 	GetDlgItemText(hDlg, IDC_ELECTRODE, channel[actchn].transducer,80); 
 	GetDlgItemText(hDlg,IDC_PHYSDIM,channel[actchn].physdim,8);
-	channel[actchn].physmin=GetDlgItemInt(hDlg,IDC_PHYSMIN,NULL,1);
-	channel[actchn].physmax=GetDlgItemInt(hDlg,IDC_PHYSMAX,NULL,1);
+	GetDlgItemText(hDlg,IDC_PHYSMIN,szdata,sizeof(szdata));
+	channel[actchn].physmin=atof(szdata);
+	GetDlgItemText(hDlg,IDC_PHYSMAX,szdata,sizeof(szdata));
+	channel[actchn].physmax=atof(szdata);
 	channel[actchn].digmin=GetDlgItemInt(hDlg,IDC_DIGMIN,NULL,1);
 	channel[actchn].digmax=GetDlgItemInt(hDlg,IDC_DIGMAX,NULL,1);
 }
@@ -89,6 +89,7 @@
 #include "ob_sessionmanager.h"
 #include "ob_keycapture.h"
 #include "ob_button.h"
+#include "ob_auxdevice.h"
 
 //
 // GLOBAL VARIABLES
@@ -106,7 +107,8 @@ HGLRC      GLRC_Animation;	 // Handle to GL-context of Animation Window
 
 int PACKETSPERSECOND=DEF_PACKETSPERSECOND;
 
-BASE_CL * objects[MAX_OBJECTS];
+BASE_CL ** objects=NULL;
+int        objects_size=0;
 BASE_CL * actobject;
 BASE_CL * deviceobject;
 BASE_CL * copy_object;
@@ -121,6 +123,7 @@ struct CAPTFILEStruct	    CAPTFILE;
 struct MIDIPORTStruct       MIDIPORTS[MAX_MIDIPORTS];
 struct SCALEStruct          LOADSCALE;
 struct TIMINGStruct         TIMING;
+struct BLOCKStruct          BLOCK;
 
 char objnames[OBJECT_COUNT][20]      = { OBJNAMES };
 char dimensions[10][10]      = {"uV","mV","V","Hz","%","DegC","DegF","uS","kOhm","BPM" };
@@ -286,6 +289,8 @@ void create_object(int type)
 							 actobject->object_size=sizeof(KEYCAPTUREOBJ);break;
 		case OB_BUTTON:		 actobject=new BUTTONOBJ(GLOBAL.objects); 
 							 actobject->object_size=sizeof(BUTTONOBJ);break;
+		case OB_AUXDEVICE:	 actobject=new AUXDEVICEOBJ(GLOBAL.objects); 
+							 actobject->object_size=sizeof(AUXDEVICEOBJ);break;
 
 
 	}
@@ -299,15 +304,17 @@ void create_object(int type)
 		if (!actobject->height) actobject->height=CON_START+i*CON_HEIGHT+5;
 		if (!actobject->tag[0]) strcpy(actobject->tag,objnames[type]);
 
-		for (i=0;i<MAX_CONNECTS;i++)
+		for (i=0;i<actobject->out_size;i++)
 		{ 
 		   actobject->out[i].from_object=GLOBAL.objects; actobject->out[i].from_port=-1;
 		   actobject->out[i].to_object=-1; actobject->out[i].to_port=-1; 
 		   strcpy(actobject->out[i].dimension,"uV");
 		   actobject->out[i].min=-250;actobject->out[i].max=250;
 		}
+		if (!reserve_objects(GLOBAL.objects+1)) { delete actobject; actobject=NULL; return; }
 		objects[GLOBAL.objects]=actobject;
 		GLOBAL.objects++;
+		if (!GLOBAL.loading) sort_objects();
         if (!GLOBAL.loading)
 		{
 			actobject->make_dialog();
@@ -433,6 +440,7 @@ void set_session_pos(long pos)
 
 	if (GLOBAL.running) {runflag=1; stop_timer();}
 
+	discard_block();
 	TIMING.packetcounter= pos; 
 	barpos= (int) ((float)pos/(float)GLOBAL.session_length*1000.0f);
 
@@ -746,6 +754,10 @@ void GlobalInitialize()
 
 	init_devicetype();
 	TTY.COMDEV=INVALID_HANDLE_VALUE;
+	TTY.SERIAL.handle=INVALID_HANDLE_VALUE;
+	TTY.readsize=sizeof(TTY.readBuf);
+	CLOCK.resample=FALSE;
+	reset_clock();
 	TTY.CONNECTED=FALSE;
 	TTY.read_pause=TRUE;
 	TTY.amount_to_write=0;
@@ -808,6 +820,14 @@ void GlobalInitialize()
 
 	TIMING.timerid=0;
 
+	BLOCK.size=1;
+	BLOCK.active=0;
+	BLOCK.possible=0;
+	BLOCK.catchup=0;
+	BLOCK.count=0;
+	GLOBAL.worker_threads=1;
+	GLOBAL.record_flush=FLUSH_NONE;
+
 	CAPTFILE.filetype=FILE_INTMODE;
 	CAPTFILE.filehandle=INVALID_HANDLE_VALUE;
 	CAPTFILE.file_action=0;
@@ -827,6 +847,8 @@ void GlobalInitialize()
 	init_midi();
 
 	load_settings();
+	init_workers(GLOBAL.worker_threads);
+	if (!GLOBAL.headless) start_render();
 	
 	TIMING.timerid=0;
 	TIMING.pause_timer=0;
@@ -843,9 +865,11 @@ void GlobalCleanup()
 	int t;
 
 	stop_timer();
+	stop_render();
 	for (t=0;t<GLOBAL.objects;t++) objects[t]->session_stop();
 	
 	while (GLOBAL.objects>0)   free_object(0);
+	init_workers(0);
 	
 	BreakDownCommPort();
 	// for (t=0;t<GLOBAL.objects;t++) free_object(0);
@@ -927,6 +951,43 @@ int get_int(char * str, int pos, int * target)
 		return pos;
 }
 	
+//  locale independent conversion of a number ([+-]digits[.digits][e[+-]digits]),
+//  end receives the position after the number (str when there is no number)
+double str_to_double(const char * str, const char ** end)
+{
+	static const double pow10[]={1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+		1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22};
+	const char * p=str, * e;
+	double v=0;
+	int neg=0,digits=0,exponent=0,x=0,eneg=0;
+
+	if ((*p=='+')||(*p=='-')) neg=(*p++=='-');
+	while ((*p>='0')&&(*p<='9')) { v=v*10+(*p++-'0'); digits++; }
+	if (*p=='.')
+	{
+		p++;
+		while ((*p>='0')&&(*p<='9')) { v=v*10+(*p++-'0'); digits++; exponent--; }
+	}
+	if (!digits) { if (end) *end=str; return(0); }
+
+	if ((*p=='e')||(*p=='E'))
+	{
+		e=p+1;
+		if ((*e=='+')||(*e=='-')) eneg=(*e++=='-');
+		if ((*e>='0')&&(*e<='9'))
+		{
+			while ((*e>='0')&&(*e<='9')) { if (x<10000) x=x*10+(*e-'0'); e++; }
+			exponent+= eneg ? -x : x;
+			p=e;
+		}
+	}
+
+	if (exponent<0) v= (exponent>=-22) ? v/pow10[-exponent] : v*pow(10.0,exponent);
+	else if (exponent>0) v= (exponent<=22) ? v*pow10[exponent] : v*pow(10.0,exponent);
+	if (end) *end=p;
+	return(neg ? -v : v);
+}
+
 int get_float(char * source, const char * param, float * result)
 {
 	char actline[100];
@@ -975,64 +1036,121 @@ int get_string(char * source, const char * param, char * result)
 
 void free_object(int actobj)
 {
-	delete objects[actobj];
-	memcpy(&objects[actobj],&objects[actobj+1],sizeof(objects[0])*(GLOBAL.objects-actobj));
+	BASE_CL * sav=objects[actobj];
+	int sav_pause=pause_processing();
+
+	memmove(&objects[actobj],&objects[actobj+1],sizeof(objects[0])*(GLOBAL.objects-actobj-1));
 	GLOBAL.objects--;
+	clear_plan();     // the caller rebuilds the plan when the links are updated
+	for (int t=0;t<GLOBAL.objects;t++) objects[t]->clear_fanout();
+	delete sav;
+	clear_render_items();
+	resume_processing(sav_pause);
 }
 
 
 
-void swap_objects(int a, int b)
+//  makes sure that the objects[] - array can hold count objects
+int reserve_objects(int count)
 {
-	int x,i;
-	BASE_CL * sav;
-
-    for (x=0;x<GLOBAL.objects;x++)
-		for (i=0;objects[x]->out[i].to_object!=-1;i++)
-		{
-			if (objects[x]->out[i].to_object==a) objects[x]->out[i].to_object=b;
-			else if (objects[x]->out[i].to_object==b) objects[x]->out[i].to_object=a;
-			if (objects[x]->out[i].from_object==a) objects[x]->out[i].from_object=b;
-			else if (objects[x]->out[i].from_object==b) objects[x]->out[i].from_object=a;
-		}
-
-	if (GLOBAL.drawfromobj==a) GLOBAL.drawfromobj=b;
-	else if (GLOBAL.drawfromobj==b) GLOBAL.drawfromobj=a;
+	BASE_CL ** o;
+	int size, sav_pause;
+
+	if (count<=objects_size) return(TRUE);
+	size = objects_size ? objects_size*2 : 64;
+	while (size<count) size*=2;
+
+	sav_pause=pause_processing();
+	o=(BASE_CL **)realloc(objects,size*sizeof(BASE_CL *));
+	if (o) { objects=o; objects_size=size; }
+	resume_processing(sav_pause);
+	if (!o) { report_error("Could not allocate memory for the objects"); return(FALSE); }
+	return(TRUE);
+}
 
-	sav=objects[a];
-    objects[a]=objects[b];
-    objects[b]=sav;
 
+//  makes sure that the link-table can hold count links, the link which is
+//  actually drawn and the terminating entry (to_port==-1)
+LINKStruct * BASE_CL::reserve_links(int count)
+{
+	LINKStruct * l;
+	int i,size;
+
+	if (count+2<=out_size) return(out);
+	size=count+10;
+	l=(LINKStruct *)realloc(out,size*sizeof(LINKStruct));
+	if (!l) { report_error("Could not allocate memory for the links"); return(NULL); }
+	for (i=out_size;i<size;i++)
+	{
+		l[i].from_object=-1; l[i].from_port=-1;
+		l[i].to_object=-1;   l[i].to_port=-1;
+		l[i].min=-250.0f;    l[i].max=250.0f;
+		strcpy(l[i].dimension,"uV");
+		strcpy(l[i].description,"none");
+		l[i].visited=0;
+	}
+	out=l; out_size=size;
+	return(out);
 }
 
-int sort_objects(void)
+//  makes sure that the port tables hold count in- and outports, returns
+//  count or the number of available ports when the tables can't be grown
+int BASE_CL::reserve_ports(int count)
 {
-	int t,u,i,it,sav_timerpause;
+	INPORTStruct * ip;
+	OUTPORTStruct * op;
+	BLOCKPORTStruct ** bp;
+	int * fs;
+	int size,sav_pause;
+
+	if (count>MAX_PORTS) count=MAX_PORTS;
+	if (count<=port_count) return(count);
+	size=port_count;
+	while (size<count) size*=2;
+	if (size>MAX_PORTS) size=MAX_PORTS;
+
+	ip=(INPORTStruct *)malloc(size*sizeof(INPORTStruct));
+	op=(OUTPORTStruct *)malloc(size*sizeof(OUTPORTStruct));
+	fs=(int *)calloc(size+1,sizeof(int));
+	bp=(BLOCKPORTStruct **)calloc(size,sizeof(BLOCKPORTStruct *));
+	if ((!ip) || (!op) || (!fs) || (!bp))
+	{
+		free(ip); free(op); free(fs); free(bp);
+		report_error("Could not allocate memory for the ports");
+		return(port_count);
+	}
+	memcpy(ip,in_ports,port_count*sizeof(INPORTStruct));
+	memcpy(op,out_ports,port_count*sizeof(OUTPORTStruct));
+	memcpy(fs,fanout_start,(port_count+1)*sizeof(int));
+	memcpy(bp,in_block,port_count*sizeof(BLOCKPORTStruct *));
+	for (int p=port_count+1;p<=size;p++) fs[p]=fs[port_count];
+
+	// the processing threads may pass values to this object
+	sav_pause=pause_processing();
+	free(in_ports); free(out_ports); free(fanout_start); free(in_block);
+	in_ports=ip; out_ports=op; fanout_start=fs; in_block=bp;
+	init_ports(port_count,size);
+	port_count=size;
+	resume_processing(sav_pause);
+	return(count);
+}
 
-	sav_timerpause=TIMING.pause_timer;
-	TIMING.pause_timer=1;
-	for (u=0;u<GLOBAL.objects;u++)
-	  for (i=0;(i<MAX_CONNECTS)&&(objects[u]->out[i].to_object!=-1);i++)
-		  objects[u]->out[i].visited=0;
+//  removes link num from the link-table
+void BASE_CL::remove_link(int num)
+{
+	memmove(&out[num],&out[num+1],sizeof(LINKStruct)*(out_size-num-1));
+	out[out_size-1].to_object=-1;
+	out[out_size-1].from_port=-1;
+	out[out_size-1].to_port=-1;
+}
 
-	it=0;
-	for (t=0;t<GLOBAL.objects;t++)
-	 for (u=0;u<GLOBAL.objects;u++)
-	  for (i=0;(i<MAX_CONNECTS)&&(objects[u]->out[i].to_object!=-1);i++)
-		if ((objects[u]->out[i].to_object==t)&&(u>t)&&(objects[u]->out[i].visited==0))
-		{
-		   objects[u]->out[i].visited=1;
-		   swap_objects(u,t);
-		   t=0;u=GLOBAL.objects; i=MAX_CONNECTS;
-/*
-		   it++; if (it>10000) 
-		   {  // report("loop"); 
-			   return(FALSE);
-		   }
-		   */
 
-		}
-	TIMING.pause_timer=sav_timerpause;
+//  called when objects or connections were changed: 
+//  compiles the execution plan of the design (see schedule.cpp)
+int sort_objects(void)
+{
+	build_plan();
+	update_blockmode();
 	return(TRUE);
 }
 
@@ -1049,6 +1167,8 @@ struct LINKStruct * get_link (BASE_CL * obj,int port)
     return(NULL);
 }
 
+//  returns the number of inports for elements with a free input port,
+//  the port tables of the element are grown to this size
 int count_inports(BASE_CL * obj)
 {
     int i,z,m;
@@ -1057,7 +1177,7 @@ int count_inports(BASE_CL * obj)
 	for (i=0;i<GLOBAL.objects;i++)
 		for (z=0;objects[i]->out[z].to_port!=-1;z++)
 			if ((objects[objects[i]->out[z].to_object]==obj)&&(objects[i]->out[z].to_port>m)) m=objects[i]->out[z].to_port;
-    return(m+2);
+    return(obj->reserve_ports(m+2));
 }
 
 void set_dimensions(struct LINKStruct * act,float max, float min, char * dim, char * desc)
@@ -1320,6 +1440,7 @@ int check_OS(void)
 
 //for array_data_ports
 void set_inports(BASE_CL *st, int num){
+	num=st->reserve_ports(num);
 	if (st->inports<=num){
 		st->inports = num;
 		return;
@@ -1328,15 +1449,10 @@ void set_inports(BASE_CL *st, int num){
 	int i,t,object_index;
 	for (object_index=0;actobject!=objects[object_index];object_index++);
 	for(t=0;t<GLOBAL.objects;t++)						 
-		for (i=0;i<MAX_CONNECTS;i++)
+		for (i=0;i<objects[t]->out_size;i++)
 		{
-		while (objects[t]->out[i].to_object==object_index)
-		{
-			memcpy(&objects[t]->out[i],&objects[t]->out[i+1],sizeof(LINKStruct)*(MAX_CONNECTS-i));
-			objects[t]->out[MAX_CONNECTS-1].to_object=-1;
-			objects[t]->out[MAX_CONNECTS-1].from_port=-1;
-			objects[t]->out[MAX_CONNECTS-1].to_port=-1;
-		}
+		while ((objects[t]->out[i].to_object==object_index) && (objects[t]->out[i].to_port!=-1))
+			objects[t]->remove_link(i);
 		if (objects[t]->out[i].to_object>object_index) 
 			objects[t]->out[i].to_object--;
 		if (objects[t]->out[i].from_object>object_index) 
@@ -1344,18 +1460,20 @@ void set_inports(BASE_CL *st, int num){
 		}
 	st->inports = num;
 	get_session_length();
+	sort_objects();
 
 }
 
 //for array_data_ports
 void set_outports(BASE_CL *st, int num){
+	num=st->reserve_ports(num);
 	if (st->outports<=num){
 		st->outports = num;
 		return;
 	} 
 	
 	for (int i=num;i<st->outports;i++){
-		for (int j=0;j<MAX_CONNECTS;j++){
+		for (int j=0;j<st->out_size;j++){
 			if (st->out[j].from_port==i){
 				delete_connection(&st->out[j]);
 			}
@@ -1363,6 +1481,7 @@ void set_outports(BASE_CL *st, int num){
 	}
 	st->outports = num;
 	get_session_length();
+	sort_objects();
 }
 
 //for array_data_ports
@@ -0,0 +1,235 @@
+/* -----------------------------------------------------------------------------
+
+  BrainBay  -  Version 2.0, GPL 2003-2017
+
+  MODULE:  HEADLESS.CPP
+  Author:  Chris Veigl
+
+
+  This Module provides a windowless batch mode for offline re-analysis:
+
+    brainbay.exe --headless <design.con> [--archive <file.arc>] [--packets <n>]
+                 [--profile <profile.csv>] [--synthetic <rate> <channels>]
+
+  The design is loaded via load_configfile(), the archive (or the EDF-files
+  referenced by EDF-READER elements) is replayed and process_packets() is driven
+  as fast as possible, like the GLOBAL.fly - mode but without the timer, message
+  pump, dialog- or display updates. The main window is created but never shown,
+  so display elements can be constructed as usual and stay invisible.
+  The batch mode is part of the Win32 executable: the elements create their
+  windows and dialogs via the Win32 API, a windowless build for other
+  platforms is not available.
+  The achieved packets/second - rate is reported to the console and the logfile.
+  With --profile, the execution profile of the elements is saved to a CSV-file.
+
+  With --synthetic, the design is not processed as fast as possible but paced in
+  real time by pace_packets() (like the timer of a running session), at the given
+  sampling rate. The packets carry a synthetic test signal (one sine wave per
+  channel), e.g. --synthetic 16000 8 tests if a design sustains 16 kHz x 8 channels.
+  The highest lag and the dropped packets are reported.
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; See the
+  GNU General Public License for more details.
+
+
+--------------------------------------------------------------------------------*/
+
+
+#include "brainBay.h"
+
+#include <math.h>
+
+
+//  copies the next (optionally quoted) argument of the commandline to arg,
+//  returns the position after the argument or NULL if no argument is left
+
+char * get_cmdline_arg(char * pos, char * arg, int maxlen)
+{
+	int i=0;
+
+	while ((*pos==' ')||(*pos=='\t')) pos++;
+	if (!*pos) return(NULL);
+
+	if (*pos=='\"')
+	{
+		pos++;
+		while ((*pos)&&(*pos!='\"')&&(i<maxlen-1)) arg[i++]=*pos++;
+		if (*pos=='\"') pos++;
+	}
+	else while ((*pos)&&(*pos!=' ')&&(*pos!='\t')&&(i<maxlen-1)) arg[i++]=*pos++;
+
+	arg[i]=0;
+	return(pos);
+}
+
+
+//  synthetic test signal for GLOBAL.synthetic channels: sine waves of
+//  1 Hz, 4 Hz, 7 Hz, .. around the center of the 10 bit range
+void synthetic_packet(void)
+{
+	double t;
+	int x;
+
+	t=2.0*3.14159265358979*(double)TIMING.packetcounter/(double)PACKETSPERSECOND;
+	for (x=0;(x<GLOBAL.synthetic)&&(x<MAX_EEG_CHANNELS);x++)
+		PACKET.buffer[x]=(unsigned int)(512.0+400.0*sin(t*(1+3*x)));
+	PACKET.switches=0;
+	PACKET.arrival=0;
+}
+
+
+int run_headless(char * cmdline)
+{
+	char arg[MAX_PATH],designfile[MAX_PATH],archivefile[MAX_PATH],profilefile[MAX_PATH];
+	char * pos;
+	long maxpackets=0, packets;
+	int rate=0, channels=0;
+	LONGLONG pc;
+	int t;
+	LONGLONG starttime,endtime;
+	double seconds;
+
+	designfile[0]=0; archivefile[0]=0; profilefile[0]=0;
+	pos=cmdline;
+	while ((pos=get_cmdline_arg(pos,arg,sizeof(arg))))
+	{
+		if (!strcmp(arg,"--headless"))
+		{
+			if (!(pos=get_cmdline_arg(pos,designfile,sizeof(designfile)))) break;
+		}
+		else if (!strcmp(arg,"--archive"))
+		{
+			if (!(pos=get_cmdline_arg(pos,archivefile,sizeof(archivefile)))) break;
+		}
+		else if (!strcmp(arg,"--packets"))
+		{
+			if (!(pos=get_cmdline_arg(pos,arg,sizeof(arg)))) break;
+			maxpackets=atol(arg);
+		}
+		else if (!strcmp(arg,"--profile"))
+		{
+			if (!(pos=get_cmdline_arg(pos,profilefile,sizeof(profilefile)))) break;
+		}
+		else if (!strcmp(arg,"--synthetic"))
+		{
+			if (!(pos=get_cmdline_arg(pos,arg,sizeof(arg)))) break;
+			rate=atoi(arg);
+			if (!(pos=get_cmdline_arg(pos,arg,sizeof(arg)))) break;
+			channels=atoi(arg);
+		}
+	}
+
+	if (!designfile[0])
+	{
+		printf("usage: brainbay --headless <design.con> [--archive <file.arc>] [--packets <n>] [--profile <file.csv>] [--synthetic <rate> <channels>]\n");
+		return(1);
+	}
+
+	write_logfile("headless run: design %s",designfile);
+	if (!load_configfile(designfile))
+	{
+		printf("could not load design %s\n",designfile);
+		return(1);
+	}
+	sort_objects();
+
+	if (archivefile[0])
+	{
+		close_captfile();
+		strcpy(CAPTFILE.filename,archivefile);
+		if (!open_captfile(CAPTFILE.filename))
+		{
+			printf("could not open archive %s\n",archivefile);
+			return(1);
+		}
+	}
+
+	if (rate>0)
+	{
+		if ((channels<1) || (channels>MAX_EEG_CHANNELS))
+		{
+			printf("--synthetic: 1 to %d channels\n",MAX_EEG_CHANNELS);
+			return(1);
+		}
+		update_samplingrate(rate);
+		if (PACKETSPERSECOND!=rate) return(1);
+		GLOBAL.synthetic=channels;
+		TTY.read_pause=1;
+		CAPTFILE.do_read=0;
+		GLOBAL.session_end=rate*10;
+	}
+
+	if (maxpackets>0) GLOBAL.session_end=maxpackets;
+	if (GLOBAL.session_end<=0)
+	{
+		printf("nothing to process: no archive or EDF-file in the design, use --packets <n>\n");
+		return(1);
+	}
+
+	update_dimensions();
+	update_blockmode();
+	init_system_time();
+	TIMING.packetcounter=0;
+	GLOBAL.session_start=0;
+	GLOBAL.syncloss=0;
+	GLOBAL.fly=GLOBAL.synthetic ? 0 : 1;
+	if (profilefile[0]) profiling=1;
+	for (t=0;t<GLOBAL.objects;t++) objects[t]->session_start();
+	GLOBAL.running=TRUE;
+
+	printf("processing %ld packets of %s ...\n",GLOBAL.session_end,designfile);
+	QueryPerformanceCounter((_LARGE_INTEGER *)&starttime);
+
+	if (GLOBAL.synthetic)
+	{   // real time, paced like the timer of a running session
+		timeBeginPeriod(1);
+		TIMING.readtimestamp=starttime;
+		while ((GLOBAL.running) && (TIMING.packetcounter<GLOBAL.session_end))
+		{
+			QueryPerformanceCounter((_LARGE_INTEGER *)&pc);
+			pace_packets(pc);
+			Sleep(1);
+		}
+		timeEndPeriod(1);
+	}
+
+	while ((GLOBAL.running) && (TIMING.packetcounter<GLOBAL.session_end))
+	{
+		if (CAPTFILE.do_read&&(CAPTFILE.offset<=TIMING.packetcounter)&&(CAPTFILE.offset+CAPTFILE.length>TIMING.packetcounter))
+		{
+			play_captfile();
+		}
+		else process_packets();
+	}
+
+	process_block();
+	QueryPerformanceCounter((_LARGE_INTEGER *)&endtime);
+	GLOBAL.running=FALSE;
+	for (t=0;t<GLOBAL.objects;t++) objects[t]->session_stop();
+	for (t=0;t<GLOBAL.objects;t++) objects[t]->session_end();
+	log_latency();
+
+	packets=TIMING.packetcounter;
+	seconds=(double)(endtime-starttime)/(double)TIMING.pcfreq;
+	if (seconds<=0) seconds=1e-9;
+
+	printf("%ld packets in %.3f seconds: %.0f packets/sec (%.1f x realtime at %d Hz), %d lost\n",
+		packets, seconds, (double)packets/seconds, (double)packets/seconds/(double)PACKETSPERSECOND,
+		PACKETSPERSECOND, GLOBAL.syncloss);
+	write_logfile("headless run: %ld packets in %d ms, %d packets/sec",
+		packets, (int)(seconds*1000.0), (int)((double)packets/seconds));
+	if (GLOBAL.synthetic)
+	{
+		printf("synthetic %d Hz x %d channels: highest lag %d ms, %ld packets dropped: %s\n",
+			rate, channels, TIMING.maxlag, TIMING.dropped, TIMING.dropped ? "not sustained" : "sustained");
+		write_logfile("synthetic %d Hz x %d channels: highest lag %d ms, %ld packets dropped",
+			rate, channels, TIMING.maxlag, TIMING.dropped);
+	}
+	if ((profilefile[0]) && (!export_profile(profilefile)))
+		printf("could not write profile %s\n",profilefile);
+
+	GlobalCleanup();
+	return(0);
+}
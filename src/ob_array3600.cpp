@@ -370,7 +370,7 @@ void ARRAY3600OBJ::work(void)
 			setParameters(address, maxcurrent, maxvoltage, maxpower, voltage);
 			
 			if (hDlg==ghWndToolbox)
- 				SetDlgItemInt(hDlg,IDC_VOLTAGE,voltage,0);
+ 				publish_dlg_int(hDlg,IDC_VOLTAGE,voltage,0);
 			
 		}
 	}
@@ -0,0 +1,471 @@
+/* -----------------------------------------------------------------------------
+
+  BrainBay  Version 2.0, GPL 2003-2017, contact: chris@shifz.org
+
+  MODULE: OB_AUXDEVICE.CPP:  implementation of the Auxiliary Device Element
+  Authors: Chris Veigl
+
+  The Auxiliary Device reads an additional amplifier (e.g. an ECG or GSR box)
+  at its own serial port, so that a design can combine several devices.
+  Every element has its own reader thread (see serial.cpp) and an instance of
+  the frame decoders of the EEG element (decode_P2, decode_OPENBCI in ob_eeg.cpp).
+  The decoded samples are stored with their arrival time in a sample queue.
+  An OpenBCI board streams while a session is running ('b' / 's').
+
+  work() merges the stream into the processing clock of the session: the
+  output for the actual packet (PACKET.work_clocktime, see clock.cpp) is
+  interpolated between the two samples around this time, or the last sample
+  is held. As the samples of the device arrive later than their sampling
+  time, the stream is read with a delay ('latency').
+  Without an EEG device, the timer of the session creates the packets, so
+  several auxiliary devices can be merged without a main device.
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; See the
+  GNU General Public License for more details.
+
+-----------------------------------------------------------------------------*/
+
+
+#include "brainBay.h"
+#include "ob_auxdevice.h"
+
+extern char * szBaud[];
+extern DWORD  BaudTable[];
+
+char * auxdevicenames[] = { "ModularEEG (P2, 6 Channels)", "OpenBCI (8 Channels)",
+							"generic (1 Channel raw data 8 bit)", "" };
+
+
+LRESULT CALLBACK AuxDeviceDlgHandler(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam)
+{
+	char szBuffer[50];
+    int wPosition,t;
+	AUXDEVICEOBJ * st;
+
+	st = (AUXDEVICEOBJ *) actobject;
+	if ((st==NULL)||(st->type!=OB_AUXDEVICE)) return(FALSE);
+
+	switch( message )
+	{
+		case WM_INITDIALOG:
+			for (t=0; auxdevicenames[t][0]!=0;t++)
+				SendDlgItemMessage( hDlg, IDC_DEVICECOMBO, CB_ADDSTRING, 0,(LPARAM) (LPSTR) auxdevicenames[t]) ;
+			SendDlgItemMessage( hDlg, IDC_DEVICECOMBO, CB_SETCURSEL, st->devicetype, 0L ) ;
+
+			for (t = 0; t < MAX_COMPORT; t++)
+			{
+				wsprintf( szBuffer, "COM%d", t + 1 ) ;
+				SendDlgItemMessage( hDlg, IDC_PORTCOMBO, CB_ADDSTRING, 0,(LPARAM) (LPSTR) szBuffer ) ;
+			}
+			if (st->comport) SendDlgItemMessage( hDlg, IDC_PORTCOMBO, CB_SETCURSEL, (WPARAM) (st->comport - 1), 0L ) ;
+			else SetDlgItemText( hDlg, IDC_PORTCOMBO, "none") ;
+			for (t = 0; BaudTable[t]!=0 ; t++)
+			{
+				wPosition = LOWORD( SendDlgItemMessage( hDlg, IDC_BAUDCOMBO, CB_ADDSTRING, 0, (LPARAM) (LPSTR) szBaud[t] ) ) ;
+				SendDlgItemMessage( hDlg, IDC_BAUDCOMBO, CB_SETITEMDATA, (WPARAM) wPosition, (LPARAM) BaudTable[t]) ;
+				if (BaudTable[t] == (DWORD)st->baudrate) SendDlgItemMessage( hDlg, IDC_BAUDCOMBO, CB_SETCURSEL, (WPARAM) wPosition, 0L ) ;
+			}
+			CheckDlgButton(hDlg, IDC_CONNECTED, st->connected);
+
+			SetDlgItemInt(hDlg,IDC_AUXRATE,st->rate,0);
+			SetDlgItemInt(hDlg,IDC_AUXLATENCY,st->latency,0);
+			CheckDlgButton(hDlg, IDC_AUXHOLD, st->hold);
+			SetDlgItemInt(hDlg,IDC_RECEIVED,st->received,0);
+			SetDlgItemInt(hDlg,IDC_AUXQUEUED,0,0);
+			SetDlgItemInt(hDlg,IDC_AUXOVERRUNS,st->overruns,0);
+	        break;
+
+		case WM_CLOSE:
+			    EndDialog(hDlg, LOWORD(wParam));
+				return TRUE;
+			break;
+		case WM_COMMAND:
+			switch (LOWORD(wParam))
+			{
+				case IDC_DEVICECOMBO:
+					if (HIWORD(wParam)==CBN_SELCHANGE)
+					{
+						st->BreakDownComPort();
+						CheckDlgButton(hDlg,IDC_CONNECTED,FALSE);
+						st->devicetype=SendDlgItemMessage(hDlg, IDC_DEVICECOMBO, CB_GETCURSEL, 0, 0 );
+						switch (st->devicetype)
+						{
+							case AUX_P2:       st->rate=256; st->baudrate=57600; break;
+							case AUX_OPENBCI8: st->rate=250; st->baudrate=115200; break;
+						}
+						st->update_outports();
+						SetDlgItemInt(hDlg,IDC_AUXRATE,st->rate,0);
+						for (t = 0; BaudTable[t]!=0 ; t++)
+							if (BaudTable[t] == (DWORD)st->baudrate) SendDlgItemMessage( hDlg, IDC_BAUDCOMBO, CB_SETCURSEL, (WPARAM) t, 0L ) ;
+						InvalidateRect(ghWndDesign,NULL,TRUE);
+					}
+					break;
+				case IDC_PORTCOMBO:
+					if (HIWORD(wParam)==CBN_SELCHANGE)
+					{
+						st->comport=SendDlgItemMessage(hDlg, IDC_PORTCOMBO, CB_GETCURSEL, 0, 0 )+1 ;
+						st->BreakDownComPort();
+						CheckDlgButton(hDlg,IDC_CONNECTED,FALSE);
+					}
+					break;
+				case IDC_BAUDCOMBO:
+					if (HIWORD(wParam)==CBN_SELCHANGE)
+					{   int sel;
+
+						sel=SendDlgItemMessage(hDlg, IDC_BAUDCOMBO, CB_GETCURSEL, 0, 0 ) ;
+						st->baudrate=BaudTable[sel];
+						if (st->connected)
+						{
+							st->connected=st->SetupComPort(st->comport);
+							CheckDlgButton(hDlg, IDC_CONNECTED, st->connected);
+						}
+					}
+					break;
+				case IDC_CONNECT:
+						if (st->connected) st->BreakDownComPort();
+						else
+						{
+							st->received=st->overruns=0;
+							st->connected=st->SetupComPort(st->comport);
+						}
+						CheckDlgButton(hDlg, IDC_CONNECTED, st->connected);
+					break;
+
+				case IDC_CONNECTED:
+						CheckDlgButton(hDlg,IDC_CONNECTED, st->connected);
+					break;
+
+				case IDC_AUXRATE:
+					if (HIWORD(wParam)==EN_KILLFOCUS)
+					{
+						st->rate=GetDlgItemInt(hDlg, IDC_AUXRATE, 0,0);
+						if (st->rate<0) st->rate=0;
+					}
+					break;
+				case IDC_AUXLATENCY:
+					if (HIWORD(wParam)==EN_KILLFOCUS)
+						st->latency=GetDlgItemInt(hDlg, IDC_AUXLATENCY, 0,0);
+					break;
+				case IDC_AUXHOLD:
+					st->hold=IsDlgButtonChecked(hDlg, IDC_AUXHOLD);
+					break;
+            }
+			return TRUE;
+			break;
+		case WM_SIZE:
+		case WM_MOVE:  update_toolbox_position(hDlg);
+		break;
+	}
+	return FALSE;
+}
+
+
+
+//  receives the frames of the decoder
+void aux_frame(FRAMEDECODERStruct * dec)
+{
+	((AUXDEVICEOBJ *)dec->owner)->store_frame(dec->values);
+}
+
+DWORD WINAPI AuxDeviceProc(LPVOID lpv)
+{
+	((AUXDEVICEOBJ *)lpv)->ReadComPort();
+	return(0);
+}
+
+
+BOOL AUXDEVICEOBJ::SetupComPort(int port)
+{
+	DWORD dwThreadId;
+
+    BreakDownComPort();
+	comport=port;
+	if (!serial_open(&serial, port, baudrate, FALSE))
+	{
+		char sztemp[100];
+		sprintf(sztemp, "The Port COM%d is not available. Please select another Com-Port.",port);
+        write_logfile("AUXDEVICE: COMPORT %d open failed.",port );
+		report_error(sztemp);
+		return FALSE;
+	}
+
+	init_decoder(&decoder,8,aux_frame,this,&overruns);
+	lasttime=0;
+	inpos=0; outpos=0;
+	readdone=FALSE;
+	readthread=CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE) AuxDeviceProc, this, 0, &dwThreadId);
+	if (!readthread)
+	{
+		report_error("CreateThread failed");
+		serial_close(&serial);
+		return FALSE;
+	}
+	return(TRUE);
+}
+
+
+//  reader thread: decodes the received frames into the sample queue.
+//  The frames of one read arrived together, they get the arrival time of
+//  the read minus the sampling period for every following frame
+void AUXDEVICEOBJ::ReadComPort(void)
+{
+	unsigned char buf[AUX_READSIZE];
+	LONGLONG arrival,period,t;
+	unsigned int pos;
+	int len,n,i;
+
+	while (!readdone)
+	{
+		len=serial_read(&serial, buf, AUX_READSIZE, 100, &arrival);
+		if (len<0) { Sleep(10); continue; }
+		if (!len) continue;
+
+		pos=inpos;
+		if (!(n=decode(buf,len,pos))) continue;
+
+		period=(rate>0) ? TIMING.pcfreq/rate : 0;
+		for (i=0;i<n;i++)
+		{
+			t=arrival-(LONGLONG)(n-1-i)*period;
+			if (t<=lasttime) t=lasttime+1;
+			times[(pos+i)&(AUX_QUEUESIZE-1)]=t;
+			lasttime=t;
+		}
+		received+=n;
+		inpos=(pos+n)&(AUX_QUEUESIZE-1);
+	}
+}
+
+
+BOOL AUXDEVICEOBJ::BreakDownComPort()
+{
+	connected=FALSE;
+	readdone=TRUE;
+	serial_stop(&serial,&readthread);
+	serial_close(&serial);
+	return TRUE;
+}
+
+
+int AUXDEVICEOBJ::frame_length(void)
+{
+	switch (devicetype)
+	{
+		case AUX_P2:       return(17);
+		case AUX_OPENBCI8: return(33);
+	}
+	return(1);
+}
+
+int AUXDEVICEOBJ::channel_count(void)
+{
+	switch (devicetype)
+	{
+		case AUX_P2:       return(6);
+		case AUX_OPENBCI8: return(8+3);
+	}
+	return(1);
+}
+
+
+//  decodes the bytes into samples at the queue position pos,
+//  returns the number of complete samples
+int AUXDEVICEOBJ::decode(unsigned char * buf, int len, unsigned int pos)
+{
+	decodepos=pos;
+	decoded=0;
+	switch (devicetype)
+	{
+		case AUX_P2:       decode_P2(&decoder,buf,len); break;
+		case AUX_OPENBCI8: decode_OPENBCI(&decoder,buf,len); break;
+		default:
+			for (;len>0;len--,buf++)
+			{
+				decoder.values[0]=*buf;
+				store_frame(decoder.values);
+			}
+	}
+	return(decoded);
+}
+
+void AUXDEVICEOBJ::store_frame(unsigned int * values)
+{
+	unsigned int pos=(decodepos+decoded)&(AUX_QUEUESIZE-1);
+
+	if (((pos+1)&(AUX_QUEUESIZE-1))==outpos) { overruns++; return; }
+	memcpy(samples[pos],values,channel_count()*sizeof(unsigned int));
+	decoded++;
+}
+
+
+float AUXDEVICEOBJ::channel_value(int x, unsigned int value)
+{
+	switch (devicetype)
+	{
+		case AUX_P2:
+			return((float)value * (out_ports[x].out_max-out_ports[x].out_min) / 1024.0f + out_ports[x].out_min);
+		case AUX_OPENBCI8:
+			if (x>=8) return((float)((int)value));   // accelerometer
+			return((float)((int)value) * out_ports[x].out_max / (float)((1<<23) - 1));
+	}
+	return((float)value * (out_ports[x].out_max-out_ports[x].out_min) / 256.0f + out_ports[x].out_min);
+}
+
+
+void AUXDEVICEOBJ::update_outports(void)
+{
+	int x;
+
+	outports=channel_count();
+	for (x=0;x<outports;x++)
+	{
+	  	sprintf(out_ports[x].out_name,"Chn%d",x+1);
+		sprintf(out_ports[x].out_desc,"Aux Channel%d",x+1);
+		strcpy(out_ports[x].out_dim,"uV");
+		out_ports[x].get_range=-1;
+     	out_ports[x].out_min=-500.0f;
+		out_ports[x].out_max=500.0f;
+	}
+	if (devicetype==AUX_OPENBCI8)
+	{
+		for (x=8;x<11;x++)
+		{
+			sprintf(out_ports[x].out_name,"Acc%c",'X'+x-8);
+			sprintf(out_ports[x].out_desc,"Acceleration %c",'X'+x-8);
+			strcpy(out_ports[x].out_dim,"none");
+			out_ports[x].out_min=-32768.0f;
+			out_ports[x].out_max=32767.0f;
+		}
+	}
+	if (devicetype==AUX_RAW8BIT)
+	{
+		strcpy(out_ports[0].out_dim,"none");
+		out_ports[0].out_min=0.0f;
+		out_ports[0].out_max=255.0f;
+	}
+	for (x=0;x<AUX_CHANNELS;x++) actvalues[x]=0.0f;
+	height=CON_START+outports*CON_HEIGHT+5;
+}
+
+
+AUXDEVICEOBJ::AUXDEVICEOBJ(int num) : BASE_CL()
+{
+	inports = 0;
+	width=75;
+
+	devicetype=AUX_P2;
+	comport=0;
+	baudrate=57600;
+	rate=256;
+	latency=50;
+	hold=FALSE;
+	connected=FALSE;
+	memset(&serial,0,sizeof(serial));
+	serial.handle=INVALID_HANDLE_VALUE;
+	readthread=NULL;
+	readdone=FALSE;
+	init_decoder(&decoder,8,aux_frame,this,&overruns);
+	lasttime=0;
+	inpos=0; outpos=0;
+	received=0; overruns=0;
+	update_outports();
+}
+
+void AUXDEVICEOBJ::make_dialog(void)
+{    display_toolbox(hDlg=CreateDialog(hInst, (LPCTSTR)IDD_AUXDEVICEBOX, ghWndStatusbox, (DLGPROC)AuxDeviceDlgHandler)); }
+
+void AUXDEVICEOBJ::load(HANDLE hFile)
+{
+	load_object_basics(this);
+	load_property("devicetype",P_INT,&devicetype);
+	load_property("comport",P_INT,&comport);
+	load_property("baudrate",P_INT,&baudrate);
+	load_property("rate",P_INT,&rate);
+	load_property("latency",P_INT,&latency);
+	load_property("hold",P_INT,&hold);
+	load_property("connected",P_INT,&connected);
+	if ((devicetype<AUX_P2)||(devicetype>AUX_RAW8BIT)) devicetype=AUX_P2;
+	outports=channel_count();
+	if (connected) connected=SetupComPort(comport);
+}
+
+void AUXDEVICEOBJ::save(HANDLE hFile)
+{
+	save_object_basics(hFile, this);
+	save_property(hFile,"devicetype",P_INT,&devicetype);
+    save_property(hFile,"comport",P_INT,&comport);
+	save_property(hFile,"baudrate",P_INT,&baudrate);
+	save_property(hFile,"rate",P_INT,&rate);
+	save_property(hFile,"latency",P_INT,&latency);
+	save_property(hFile,"hold",P_INT,&hold);
+	save_property(hFile,"connected",P_INT,&connected);
+}
+
+//  the samples received before the session are discarded, the newest is kept
+void AUXDEVICEOBJ::session_start(void)
+{
+	unsigned int pos=inpos;
+
+	if (pos!=outpos) outpos=(pos-1)&(AUX_QUEUESIZE-1);
+	if ((connected) && (devicetype==AUX_OPENBCI8))
+	{   // start the stream, the first frame gives the frame number
+		decoder.framenumber=-1;
+		serial_write(&serial,(unsigned char *)"b",1);
+	}
+}
+
+void AUXDEVICEOBJ::session_stop(void)
+{
+	if ((connected) && (devicetype==AUX_OPENBCI8))
+		serial_write(&serial,(unsigned char *)"s",1);
+}
+
+void AUXDEVICEOBJ::work(void)
+{
+	unsigned int a,b,pos,mask=AUX_QUEUESIZE-1;
+	LONGLONG t;
+	float frac,v;
+	int x;
+
+	if (!connected) return;
+
+	// processing time of the packet, minus the delay of the device stream
+	t=PACKET.work_clocktime;
+	if (!t) QueryPerformanceCounter((_LARGE_INTEGER *)&t);
+	t-=(LONGLONG)latency*TIMING.pcfreq/1000;
+
+	pos=inpos;
+	a=outpos;
+	if (a!=pos)
+	{
+		// a: the last sample at or before t, the older samples are released
+		while (((b=(a+1)&mask)!=pos) && (times[b]<=t)) a=b;
+		outpos=a;
+
+		if ((b!=pos) && (!hold) && (times[a]<=t))
+		{
+			frac=(float)(t-times[a])/(float)(times[b]-times[a]);
+			for (x=0;x<outports;x++)
+			{
+				v=channel_value(x,samples[a][x]);
+				actvalues[x]=v+(channel_value(x,samples[b][x])-v)*frac;
+			}
+		}
+		else for (x=0;x<outports;x++) actvalues[x]=channel_value(x,samples[a][x]);
+	}
+	for (x=0;x<outports;x++) pass_values(x,actvalues[x]);
+
+	if ((hDlg==ghWndToolbox) && (!TIMING.dialog_update))
+	{
+		publish_dlg_int(hDlg,IDC_RECEIVED,received,0);
+		publish_dlg_int(hDlg,IDC_AUXQUEUED,(pos-outpos)&mask,0);
+		publish_dlg_int(hDlg,IDC_AUXOVERRUNS,overruns,0);
+	}
+}
+
+AUXDEVICEOBJ::~AUXDEVICEOBJ()
+{
+	  BreakDownComPort();
+}
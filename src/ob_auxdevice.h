@@ -0,0 +1,80 @@
+/* -----------------------------------------------------------------------------
+
+  BrainBay  Version 2.0, GPL 2003-2017, contact: chris@shifz.org
+
+  MODULE: OB_AUXDEVICE.H:  declarations for the Auxiliary Device Element
+  Authors: Chris Veigl
+
+  The Auxiliary Device reads a second (third, ..) amplifier at its own
+  serial port, in addition to the device of the EEG-element. Every instance
+  has its own reader thread, frame decoder and timestamped sample queue.
+  The samples are aligned to the processing clock of the session.
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; See the
+  GNU General Public License for more details.
+
+-----------------------------------------------------------------------------*/
+
+
+#include "brainBay.h"
+
+#define AUX_QUEUESIZE   1024        // samples, power of 2
+#define AUX_CHANNELS    11          // OpenBCI: 8 channels + 3 accelerometer
+#define AUX_READSIZE    512
+
+#define AUX_P2          0
+#define AUX_OPENBCI8    1
+#define AUX_RAW8BIT     2
+
+class AUXDEVICEOBJ : public BASE_CL
+{
+
+  public:
+	int devicetype,comport,baudrate,connected;
+	int rate,latency,hold;
+	SERIALPORTStruct serial;
+	HANDLE readthread;
+	volatile int readdone;
+
+	// frame decoder (ob_eeg.cpp), used by the reader thread
+	FRAMEDECODERStruct decoder;
+	unsigned int decodepos;
+	int decoded;
+	LONGLONG lasttime;
+
+	// sample queue: written by the reader thread, read by work()
+	unsigned int samples[AUX_QUEUESIZE][AUX_CHANNELS];
+	LONGLONG times[AUX_QUEUESIZE];
+	volatile unsigned int inpos,outpos;
+	unsigned int received;
+	int overruns;
+	float actvalues[AUX_CHANNELS];
+
+	BOOL SetupComPort(int port);
+	void ReadComPort(void);
+	BOOL BreakDownComPort(void);
+	int  decode(unsigned char * buf, int len, unsigned int pos);
+	void store_frame(unsigned int * values);
+	int  frame_length(void);
+	int  channel_count(void);
+	void update_outports(void);
+	float channel_value(int x, unsigned int value);
+
+	AUXDEVICEOBJ(int num);
+
+	void make_dialog(void);
+
+	void load(HANDLE hFile);
+
+	void save(HANDLE hFile);
+
+	void session_start(void);
+
+	void session_stop(void);
+
+	void work(void);
+
+	~AUXDEVICEOBJ();
+};
@@ -108,6 +108,25 @@ void AVERAGEOBJ::work(void)
 	}
 }
 
+void AVERAGEOBJ::work_block(int count)
+{
+	float out[MAX_BLOCKSIZE];
+	BLOCKPORTStruct * bp;
+	int i,first=count;
+
+	bp=(block_ports>0) ? in_block[0] : NULL;
+	for (i=0;i<count;i++)
+	{
+		if ((bp) && (bp->set[i])) AVERAGEOBJ::incoming_data(0, bp->value[i]);
+		if (added)
+		{
+			if (first==count) first=i;
+			out[i] = accumulator / added;
+		}
+	}
+	if (first<count) pass_block(0, &out[first], count-first, first);
+}
+
 void AVERAGEOBJ::change_interval(int newinterval)
 {
 	interval = newinterval;
@@ -367,7 +367,7 @@ void AVIOBJ::work(void)
 	if (frame!=old_frame )
 	{
 		old_frame=frame;
-		InvalidateRect(displayWnd,NULL,FALSE);	
+		publish_invalidate(displayWnd);	
 	}
 	
 }
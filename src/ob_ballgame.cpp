@@ -305,7 +305,7 @@ BALLGAMEOBJ::BALLGAMEOBJ(int num) : BASE_CL()
 
 		if ((displayWnd)&&(!TIMING.draw_update)) 
 		{
-		  InvalidateRect(displayWnd,NULL,FALSE);
+		  publish_invalidate(displayWnd);
 		}
 	  }
 
@@ -34,11 +34,33 @@ void BUFFEROBJ::UpdateGraphic(){
 	}
 }
 
-void BUFFEROBJ::InitBuffer(int index){
-	if (buffer[index]!= NULL) return;
-	buffer[index] = new float[MAX_VECTOR_SIZE];
-	for (int i=0;i<MAX_VECTOR_SIZE;i++)
-		buffer[index][i]=0.0;
+//grows the channel table to count channels
+int BUFFEROBJ::InitBuffers(int count){
+	BUFFERCHANNELStruct * b;
+	int sav_pause;
+
+	if (count<=allocated) return(TRUE);
+	sav_pause=pause_processing();
+	b=(BUFFERCHANNELStruct *)realloc(buffer,count*sizeof(BUFFERCHANNELStruct));
+	if (b) {
+		memset(&b[allocated],0,(count-allocated)*sizeof(BUFFERCHANNELStruct));
+		buffer=b; allocated=count;
+	}
+	resume_processing(sav_pause);
+	if (!b) report_error("Could not allocate memory for the buffer channels");
+	return(b!=NULL);
+}
+
+//the values of a channel are allocated with the size of the first input
+int BUFFEROBJ::ReserveValues(int port, int count){
+	float * v;
+
+	if (count<=buffer[port].allocated) return(TRUE);
+	if (count>MAX_VECTOR_SIZE) return(FALSE);
+	if (!(v=(float *)realloc(buffer[port].values,count*sizeof(float)))) return(FALSE);
+	buffer[port].values=v;
+	buffer[port].allocated=count;
+	return(TRUE);
 }
 
 BUFFEROBJ::BUFFEROBJ(int num) : BASE_CL()
@@ -47,10 +69,8 @@ BUFFEROBJ::BUFFEROBJ(int num) : BASE_CL()
 	set_outports(this,1);
 	width=95;
 	nchannels = 1;
-	for (int i=0;i<MAX_EEG_CHANNELS;i++){
-		buffer[i] = NULL;
-	}
-    InitBuffer(0);
+	buffer = NULL; allocated = 0;
+    InitBuffers(1);
 
 	UpdateGraphic();
 }
@@ -64,8 +84,8 @@ void BUFFEROBJ::load(HANDLE hFile)
 {
    load_object_basics(this);
    load_property("nchannels",P_INT,&nchannels);
-   for (int i=0;i<nchannels;i++)
-	   InitBuffer(i);
+   if (nchannels>MAX_CHANNELS) nchannels=MAX_CHANNELS;
+   if (!InitBuffers(nchannels)) nchannels=allocated;
    set_inports(this,nchannels);
    set_outports(this,nchannels);
    UpdateGraphic();
@@ -79,35 +99,37 @@ void BUFFEROBJ::save(HANDLE hFile)
 	
 void BUFFEROBJ::incoming_data(int port, float value)
 {
-	if (value!=INVALID_VALUE)
+	if ((value!=INVALID_VALUE) && (ReserveValues(port,1)))
 	{
 		//add new value to the buffer
-		buffer[port][0] = value;
-		bufferSize[port] = 1;
+		buffer[port].values[0] = value;
+		buffer[port].size = 1;
 	}
 	else
-		bufferSize[port] = 0;
+		buffer[port].size = 0;
 }
 
 void BUFFEROBJ::incoming_data(int port, float *value, int count)
 {
+	if (count>MAX_VECTOR_SIZE) count=MAX_VECTOR_SIZE;
+	if ((count>0) && (!ReserveValues(port,count))) count=0;
 	if (count>0)
 	{
 		//write_logfile("getting values port %d:  %4.2f,%4.2f,%4.2f,%4.2f",port,value[0],value[1],value[2],value[3]);
    		//add new values to the buffer
 		for (int i=0;i<count;i++)
-			buffer[port][i] = value[i];
+			buffer[port].values[i] = value[i];
 	}
-	bufferSize[port] = count;
+	buffer[port].size = count;
 }
 
 void BUFFEROBJ::work(void)
 {
 	for (int n=0;n<nchannels;n++)
-		for (int i=0;i<bufferSize[n];i++)
+		for (int i=0;i<buffer[n].size;i++)
 		{
-		    //write_logfile("passing to port %d value: %4.2f",n,buffer[n][i]);
-			pass_values(n,buffer[n][i]);
+		    //write_logfile("passing to port %d value: %4.2f",n,buffer[n].values[i]);
+			pass_values(n,buffer[n].values[i]);
 		}
 }
 
@@ -115,13 +137,15 @@ void BUFFEROBJ::update_inports(void)
 {
 	int newinports=count_inports(this);
 
-	if (newinports>MAX_EEG_CHANNELS || newinports==nchannels) return;
+	if (newinports>MAX_CHANNELS || newinports==nchannels) return;
 
-	if (newinports>nchannels) InitBuffer(nchannels);
+	if (newinports>nchannels) {
+		if (!InitBuffers(newinports)) return;
+	}
 	else{		
 		for (int i=newinports;i<nchannels;i++){	
-			delete[] buffer[i];
-			buffer[i] = NULL;
+			free(buffer[i].values);
+			memset(&buffer[i],0,sizeof(BUFFERCHANNELStruct));
 		}
 	}
 	nchannels = newinports;
@@ -133,10 +157,9 @@ void BUFFEROBJ::update_inports(void)
 }
 
 BUFFEROBJ::~BUFFEROBJ() {
-	for (int i=0;i<nchannels;i++){
-		delete[] buffer[i];
-		buffer[i] = NULL;
-	}
+	for (int i=0;i<allocated;i++)
+		free(buffer[i].values);
+	free(buffer);
 }
 
 LRESULT CALLBACK BufferDlgHandler(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam)
@@ -17,11 +17,18 @@
   
 -------------------------------------------------------------------------------------*/
 
+typedef struct BUFFERCHANNELStruct
+{
+	float * values;
+	int size;          // values of the last input
+	int allocated;
+} BUFFERCHANNELStruct;
+
 class BUFFEROBJ : public BASE_CL
 {
 	protected:
-		float *buffer[MAX_EEG_CHANNELS];
-		int bufferSize[MAX_EEG_CHANNELS]; //size of each buffer
+		BUFFERCHANNELStruct * buffer;   // allocated entries, the values grow with the input
+		int allocated;
 		int nchannels;
 	public:
 
@@ -42,7 +49,8 @@ class BUFFEROBJ : public BASE_CL
 	void update_inports(void);
 
 	void UpdateGraphic(void);
-	void InitBuffer(int index);
+	int  InitBuffers(int count);
+	int  ReserveValues(int port, int count);
 
 	
 	~BUFFEROBJ();
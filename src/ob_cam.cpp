@@ -860,11 +860,11 @@ void CAMOBJ::work(void)
 
 	if ((hDlg==ghWndToolbox) && (!TIMING.dialog_update))
 	{ 
-		if (mode==MODE_VIDEOFILE_READING)  SetDlgItemText(hDlg,IDC_CAMSTATUS,"Reading from Videofile");
-		else if (mode==MODE_VIDEOFILE_WRITING)  SetDlgItemText(hDlg,IDC_CAMSTATUS,"Writing to Videofile");
-		else if (capture)  SetDlgItemText(hDlg,IDC_CAMSTATUS,"Displaying live images from Camera");
-		else SetDlgItemText(hDlg,IDC_CAMSTATUS,"Waiting for Video Source");
-	    SetDlgItemInt(hDlg,IDC_CUR_RATE,framerate,0);
+		if (mode==MODE_VIDEOFILE_READING)  publish_dlg_text(hDlg,IDC_CAMSTATUS,"Reading from Videofile");
+		else if (mode==MODE_VIDEOFILE_WRITING)  publish_dlg_text(hDlg,IDC_CAMSTATUS,"Writing to Videofile");
+		else if (capture)  publish_dlg_text(hDlg,IDC_CAMSTATUS,"Displaying live images from Camera");
+		else publish_dlg_text(hDlg,IDC_CAMSTATUS,"Waiting for Video Source");
+	    publish_dlg_int(hDlg,IDC_CUR_RATE,framerate,0);
 	}
 
 	if (trackface)
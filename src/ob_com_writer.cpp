@@ -137,12 +137,13 @@ void COM_WRITEROBJ::work(void)
 		write_to_comport (command );
 		write_to_comport (data1 );
 		write_to_comport (data2 );
+		record_latency(this);
 		cnt++;
 		if (hDlg==ghWndToolbox)
 		{
 			char szdata[50];
 			sprintf(szdata,"%d frames written",cnt);
- 			SetDlgItemText(hDlg,IDC_STATUS,szdata);
+ 			publish_dlg_text(hDlg,IDC_STATUS,szdata);
 		}
 	}
 	trigger=input;
@@ -153,12 +154,13 @@ void COM_WRITEROBJ::work(void)
 		write_to_comport (command );
 		write_to_comport (data1 );
 		write_to_comport ((unsigned char) input2);
+		record_latency(this);
 		cnt++;
 		if (hDlg==ghWndToolbox)
 		{
 			char szdata[50];
 			sprintf(szdata,"%d frames written",cnt);
- 			SetDlgItemText(hDlg,IDC_STATUS,szdata);
+ 			publish_dlg_text(hDlg,IDC_STATUS,szdata);
 		}
 	}
 	trigger2=input2;
@@ -8,6 +8,8 @@
   The ComPort Reader can be used to open a serial port and read data from it
   Thus, external devices or Software like Mitsar Psytask can be connected and
   transfer information to a running BrainBay Session
+  The port is read by a reader thread (see serial.cpp), work() takes the
+  received bytes from the ring buffer.
   
   This program is free software; you can redistribute it and/or
   modify it under the terms of the GNU General Public License
@@ -52,7 +54,7 @@ LRESULT CALLBACK ComReaderDlgHandler(HWND hDlg, UINT message, WPARAM wParam, LPA
 				if (BaudTable[t] == st->baudrate) SendDlgItemMessage( hDlg, IDC_BAUDCOMBO, CB_SETCURSEL, (WPARAM) wPosition, 0L ) ;
 			}
 
-			if (st->comdev==INVALID_HANDLE_VALUE)
+			if (st->serial.handle==INVALID_HANDLE_VALUE)
 				CheckDlgButton(hDlg, IDC_CONNECTED, FALSE);
 			else CheckDlgButton(hDlg, IDC_CONNECTED, TRUE);
 		
@@ -86,7 +88,7 @@ LRESULT CALLBACK ComReaderDlgHandler(HWND hDlg, UINT message, WPARAM wParam, LPA
 					    
 						sel=SendDlgItemMessage(hDlg, IDC_BAUDCOMBO, CB_GETCURSEL, 0, 0 ) ;
 						st->baudrate=BaudTable[sel];
-						if (st->comdev!=INVALID_HANDLE_VALUE)
+						if (st->serial.handle!=INVALID_HANDLE_VALUE)
 						{
 						    st->BreakDownComPort(); 
 							st->connected=st->SetupComPort(st->comport);
@@ -103,11 +105,10 @@ LRESULT CALLBACK ComReaderDlgHandler(HWND hDlg, UINT message, WPARAM wParam, LPA
 						}
 						else
 						{
+							st->received=st->processed=0;
 							st->connected=st->SetupComPort(st->comport);
 							CheckDlgButton(hDlg, IDC_CONNECTED, st->connected);
 						}
-						st->received=st->processed=0;
-						st->inpos=st->outpos=0;
 
 					break;
 
@@ -130,56 +131,34 @@ LRESULT CALLBACK ComReaderDlgHandler(HWND hDlg, UINT message, WPARAM wParam, LPA
 
 
 
+DWORD WINAPI ComReaderProc(LPVOID lpv)
+{
+	((COMREADEROBJ *)lpv)->ReadComPort();
+	return(0);
+}
+
+
 BOOL COMREADEROBJ::SetupComPort(int port)
 {	
-	connected=FALSE;
+	DWORD dwThreadId;
 	int sav_port;
-    DCB dcb = {0};
-	char PORTNAME[10];
 
+	connected=FALSE;
 	sav_port=comport;
     BreakDownComPort();
 	comport= port ;
 
-	// set tty structure for the specified port	
-	if (!port) goto failed;
-	sprintf(PORTNAME,"\\\\.\\COM%d",port);
-    comdev = CreateFile( PORTNAME,GENERIC_READ | GENERIC_WRITE, 
-                  0,0,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,0);
-
-    if (comdev == INVALID_HANDLE_VALUE) goto failed;  
-    if (!GetCommState(comdev, &dcb))      // get current DCB settings
-	{ report_error("GetCommState");goto failed; }
-
-    // update DCB rate, byte size, parity, and stop bits size
-	dcb.DCBlength = sizeof(dcb);
-	dcb.BaudRate = baudrate;
-    dcb.ByteSize = 8;
-	dcb.Parity   = NOPARITY;
-    dcb.StopBits = ONESTOPBIT;
-	dcb.EvtChar = '\0';
-    // update flow control settings
-    dcb.fDtrControl     =  DTR_CONTROL_ENABLE;
-    dcb.fRtsControl     =  RTS_CONTROL_ENABLE;
-    dcb.fOutxCtsFlow    = FALSE;
-    dcb.fOutxDsrFlow    = FALSE;
-    dcb.fDsrSensitivity = FALSE;;
-    dcb.fOutX           = FALSE;
-    dcb.fInX            = FALSE;
-    dcb.fTXContinueOnXoff = FALSE;
-    dcb.XonChar         = 0;
-    dcb.XoffChar        = 0;
-    dcb.XonLim          = 0;
-    dcb.XoffLim         = 0;
-    dcb.fParity = FALSE; //TRUE;
-    if (!SetCommState(comdev, &dcb))     // set new state
-	{ report_error("SetCommState failed"); goto failed;}
-    if (!SetupComm(comdev, 1024, 1024))  // set comm buffer sizes
-	{  report_error("SetupComm failed");goto failed;}
-    if (!EscapeCommFunction(comdev, SETDTR))        // raise DTR
-	{  report_error("EscapeCommFunction failed");goto failed;}
-	SetCommMask (comdev, EV_RXCHAR | EV_CTS | EV_DSR | EV_RLSD | EV_RING);
+	if (!serial_open(&serial, port, baudrate, FALSE)) goto failed;
 
+	inpos=0; outpos=0;
+	readdone=FALSE;
+	readthread=CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE) ComReaderProc, this, 0, &dwThreadId);
+	if (!readthread)
+	{
+		report_error("CreateThread failed");
+		serial_close(&serial);
+		goto failed;
+	}
 	return(TRUE);
 
 failed:
@@ -189,60 +168,49 @@ failed:
  	        write_logfile("COMPORT %d open failed.",port );		
 			report_error(sztemp);		
 			comport=sav_port;
-			comdev=INVALID_HANDLE_VALUE;
 			connected=FALSE;
 			return FALSE;
 		}
 
 }
 
-int COMREADEROBJ::ReadComPort(HANDLE device, unsigned char * buffer, unsigned int pos, unsigned int maxlen)
+//  reader thread: waits for received bytes and appends them to the ring buffer,
+//  work() takes the bytes from the buffer
+void COMREADEROBJ::ReadComPort(void)
 {
-	DWORD dwRead;
-    DWORD dwBytesTransferred,i;
-    struct _COMSTAT status;
-    unsigned long   etat;
-	//
-	if (device==INVALID_HANDLE_VALUE) return(FALSE);
-	
-	dwBytesTransferred = 0;
-    if (ClearCommError(device, &etat, &status))
-      dwBytesTransferred = status.cbInQue;
-   
-	if (dwBytesTransferred) 
+	unsigned int pos,len;
+	int n;
+
+	while (!readdone)
 	{
-		i=0;
-   		if (dwBytesTransferred+pos >= maxlen)
+		// free space up to the end of the buffer, one byte stays free
+		pos=inpos;
+		if (pos>=outpos) len=COMREADERBUFLEN-pos-(outpos==0 ? 1 : 0);
+		else len=outpos-pos-1;
+		if (!len) { Sleep(1); continue; }     // buffer full: wait for work()
+
+		n=serial_read(&serial, buffer+pos, len, 100, NULL);
+		if (n>0) 
 		{
- 		    if (dwBytesTransferred > maxlen) dwBytesTransferred=maxlen;
-
-			i=maxlen-pos;
-   		    ReadFile (device, buffer+pos, i, &dwRead, 0);
-			pos=0;
+			received+=n;
+			inpos=(pos+n) % COMREADERBUFLEN;
 		}
-
-		ReadFile (device, buffer+pos, dwBytesTransferred-i, &dwRead, 0);
+		else if (n<0) Sleep(10);
 	}
-	return((int)dwBytesTransferred);
 }
 
-BOOL COMREADEROBJ::WriteComPort(HANDLE device, unsigned char * data, unsigned int len)
+BOOL COMREADEROBJ::WriteComPort(unsigned char * data, unsigned int len)
 {
-	DWORD dwWritten;
-	if (device==INVALID_HANDLE_VALUE) return(FALSE);
-	if (!WriteFile(device, data, len, &dwWritten, 0) || ((int)dwWritten!=len)) return(FALSE);
-	return(TRUE);
+	return(serial_write(&serial, data, len));
 }
 
 
 BOOL COMREADEROBJ::BreakDownComPort()
 {	
 	connected=FALSE;
-	if (comdev==INVALID_HANDLE_VALUE) return TRUE;
-	if (!PurgeComm(comdev, PURGE_FLAGS))  report_error("PurgeComm failed..");
-    if (!EscapeCommFunction(comdev, CLRDTR)) report_error("EscapeCommFunction failed");
-    CloseHandle(comdev);
-	comdev=INVALID_HANDLE_VALUE;
+	readdone=TRUE;
+	serial_stop(&serial,&readthread);
+	serial_close(&serial);
 	return TRUE;
 }
 
@@ -265,7 +233,10 @@ COMREADEROBJ::COMREADEROBJ(int num) : BASE_CL()
 	cnt=0;
 	mintime=100;
 	baudrate=57600;
-	comdev=INVALID_HANDLE_VALUE;
+	memset(&serial,0,sizeof(serial));
+	serial.handle=INVALID_HANDLE_VALUE;
+	readthread=NULL;
+	readdone=FALSE;
 	
 }
 	
@@ -302,8 +273,6 @@ void COMREADEROBJ::incoming_data(int port, float value)
 	
 void COMREADEROBJ::work(void)
 {
-	int i;
-
 	if (connected) 
 	{
 		cnt+= 1000.0f/(float) PACKETSPERSECOND;
@@ -312,29 +281,26 @@ void COMREADEROBJ::work(void)
 			cnt-= (float) mintime;
 
 			act_value=(unsigned char)((input1-(float)in_ports[0].in_min)/((float)in_ports[0].in_max-(float)in_ports[0].in_min)*256);
-	        WriteComPort(comdev, &act_value, 1);			
+	        WriteComPort(&act_value, 1);			
 			sent++;
 		}
 
-		// attention: data lost in case of buffer overrun ..
-		i=ReadComPort(comdev,buffer, inpos,COMREADERBUFLEN);
-		received+=i;
-		inpos=(inpos+i) % COMREADERBUFLEN;
+		// the bytes are received by the reader thread (ReadComPort)
 		if (inpos!=outpos)
 		{
 			float act_outvalue = (float)buffer[outpos] / 256 * ((float)out_ports[0].out_max -(float)out_ports[0].out_min) + (float)out_ports[0].out_min;
 			pass_values(0,act_outvalue);
-			outpos= (++outpos) % COMREADERBUFLEN;
+			outpos= (outpos+1) % COMREADERBUFLEN;
 			processed++;
 		}
 		//else pass_values(0,0);
 
 		if ((hDlg==ghWndToolbox) && (!TIMING.dialog_update))
 		{ 
-			SetDlgItemInt(hDlg,IDC_RECEIVED,inpos,0);
-			SetDlgItemInt(hDlg,IDC_PROCESSED,outpos,0);
-			SetDlgItemInt(hDlg,IDC_SENT,sent,0);
-			SetDlgItemInt(hDlg,IDC_ACTVALUE,act_value,0);
+			publish_dlg_int(hDlg,IDC_RECEIVED,inpos,0);
+			publish_dlg_int(hDlg,IDC_PROCESSED,outpos,0);
+			publish_dlg_int(hDlg,IDC_SENT,sent,0);
+			publish_dlg_int(hDlg,IDC_ACTVALUE,act_value,0);
 		}
 	}
 }
@@ -28,16 +28,17 @@ class COMREADEROBJ : public BASE_CL
 	int mintime;
 	int cnt;
 	unsigned char act_value;
-	HANDLE comdev;
+	SERIALPORTStruct serial;
+	HANDLE readthread;
+	volatile int readdone;
 	unsigned int baudrate,comport,connected;
-	unsigned int inpos,outpos, received,processed, sent;
+	volatile unsigned int inpos,outpos;
+	unsigned int received,processed, sent;
 	unsigned char buffer[COMREADERBUFLEN];
-
-	DWORD dwRead;
 	
 	BOOL COMREADEROBJ::SetupComPort(int port);
-	BOOL COMREADEROBJ::ReadComPort(HANDLE device, unsigned char * buffer, unsigned int pos, unsigned int maxlen);
-	BOOL COMREADEROBJ::WriteComPort(HANDLE device, unsigned char * data, unsigned int len);
+	void COMREADEROBJ::ReadComPort(void);
+	BOOL COMREADEROBJ::WriteComPort(unsigned char * data, unsigned int len);
 	BOOL COMREADEROBJ::BreakDownComPort(void);
 
 	COMREADEROBJ(int num);
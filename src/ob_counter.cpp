@@ -436,7 +436,7 @@ COUNTEROBJ::COUNTEROBJ(int num) : BASE_CL()
 		
 		  if ((displayWnd)&&(!TIMING.draw_update)) 
 		  {
-		    InvalidateRect(displayWnd,NULL,FALSE);
+		    publish_invalidate(displayWnd);
 		  }
 	  }
 
@@ -146,6 +146,23 @@ void DEVIATIONOBJ::work(void)
 	
 }
 
+void DEVIATIONOBJ::work_block(int count)
+{
+	float outdev[MAX_BLOCKSIZE], outmean[MAX_BLOCKSIZE];
+	BLOCKPORTStruct * bp;
+	int i;
+
+	bp=(block_ports>0) ? in_block[0] : NULL;
+	for (i=0;i<count;i++)
+	{
+		if ((bp) && (bp->set[i])) DEVIATIONOBJ::incoming_data(0, bp->value[i]);
+		outdev[i]=deviation;
+		outmean[i]=mean;
+	}
+	pass_block(0, outdev, count);
+	pass_block(1, outmean, count);
+}
+
 void DEVIATIONOBJ::change_interval(int newinterval)
 {
 	interval = newinterval;
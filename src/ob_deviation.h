@@ -42,6 +42,7 @@ class DEVIATIONOBJ : public BASE_CL
 	void save(HANDLE hFile);
 	
 	void work(void);
+	void work_block(int count);
 
 	void change_interval(int newinterval);
 
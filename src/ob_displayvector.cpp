@@ -64,7 +64,7 @@ void DISPLAYVECTOROBJ::incoming_data(int port, float *value, int count)
 
 void DISPLAYVECTOROBJ::work(void)
 {
-	SetDlgItemText(hDlg,IDC_VALUES,value_str);
+	publish_dlg_text(hDlg,IDC_VALUES,value_str);
 }
 
 DISPLAYVECTOROBJ::~DISPLAYVECTOROBJ() {
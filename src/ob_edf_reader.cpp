@@ -11,6 +11,12 @@
   and the Signals are presented at the output-ports.
 
   Adjust the sampling rate to correctly display the signals.
+  The data records are read ahead by a reader thread into two record
+  buffers and converted to physical values with a precomputed gain and
+  offset per channel, work() hands out the samples of the actual record.
+  BDF-files (24 bit) and EDF+/BDF+ are supported: the annotations of the
+  annotation channels are presented at an additional event-port, the
+  outputs pause in the gaps between the records of discontinuous files.
   more Info about the EDF-File Format: http://www.edfplus.info/
 
   This program is free software; you can redistribute it and/or
@@ -55,7 +61,7 @@ LRESULT CALLBACK EdfReaderDlgHandler( HWND hDlg, UINT message, WPARAM wParam, LP
 	EDF_READEROBJ * st;
 	int x;
 	static int actchn;
-	char strfloat[21];
+	char strfloat[21],szdata[100];
 
 	
 	st = (EDF_READEROBJ *) actobject;
@@ -93,7 +99,7 @@ LRESULT CALLBACK EdfReaderDlgHandler( HWND hDlg, UINT message, WPARAM wParam, LP
 			case IDC_SELECT:
 			 
 				 st->filename[0]=0;
-				 if ((st->edffile=open_edf_file(&st->header,st->channel,st->filename))==INVALID_HANDLE_VALUE) st->state=0;
+				 if ((st->edffile=open_edf_file(&st->header,&st->channel,&st->channels_allocated,st->filename))==INVALID_HANDLE_VALUE) st->state=0;
 				 else if (st->header.channels==0) 
 				 {
 					SendMessage(hDlg,WM_COMMAND,IDC_CLOSE,0);
@@ -104,6 +110,10 @@ LRESULT CALLBACK EdfReaderDlgHandler( HWND hDlg, UINT message, WPARAM wParam, LP
 
 				 update_state(hDlg,st->state);
 				 if (!st->state) break;
+				 st->prepare_records();
+				 sprintf(szdata,"%s%s, %d annotation channels",(st->header.format==EDF_FORMAT_BDF) ? "BDF (24 bit)" : "EDF",
+					 (st->header.plus==EDF_PLUS_DISCONTINUOUS) ? "+D" : (st->header.plus ? "+C" : ""), st->header.annotations);
+				 add_to_listbox(hDlg,IDC_LIST,szdata);
 				 st->calc_session_length();
 				 get_session_length();
 				 //set_session_pos(0);
@@ -111,18 +121,18 @@ LRESULT CALLBACK EdfReaderDlgHandler( HWND hDlg, UINT message, WPARAM wParam, LP
 				 st->packetcount=0;
 				 st->sampos=0;
 
-				 if (st->outports!=st->header.channels)
+				 if (st->outports!=st->edf_ports())
 				 {
-				   for (x=0;x<MAX_CONNECTS;x++)
+				   for (x=0;x<st->out_size;x++)
 				   {	
 					st->out[x].from_port=-1;
 					st->out[x].to_port=-1;
 					st->out[x].to_object=-1;
 				   }
-				   for (x=0;x<MAX_PORTS;x++)
+				   for (x=0;x<st->port_count;x++)
 					st->out_ports[x].out_name[0]=0;
 				 }
-				 st->outports=st->header.channels;
+				 st->outports=st->reserve_ports(st->edf_ports());
 				 st->height=CON_START+st->outports*CON_HEIGHT+5;
 
 				 update_header(hDlg,&st->header);
@@ -144,6 +154,7 @@ LRESULT CALLBACK EdfReaderDlgHandler( HWND hDlg, UINT message, WPARAM wParam, LP
 					add_to_listbox(hDlg,IDC_LIST, "file closed.");
 					strcpy(st->filename,"none");
 					if (st->edffile==INVALID_HANDLE_VALUE) break;
+					st->stop_reader();
 					CloseHandle(st->edffile);
 					st->edffile=INVALID_HANDLE_VALUE;
 				    get_session_length();
@@ -192,11 +203,19 @@ EDF_READEROBJ::EDF_READEROBJ(int num) : BASE_CL()
 		width=80;
 		height=50;
 
-		for (i=0;i<MAX_PORTS;i++)
+		for (i=0;i<port_count;i++)
 		  out_ports[i].get_range=-1;
 
 		reset_header(&header);
-		reset_channel(channel);
+		channel=NULL; channels_allocated=0; rawbuf=NULL;
+		scalemem=NULL; gain=ofs=NULL; recpos=outchan=NULL; signals=0;
+		eventcount[0]=eventcount[1]=0; eventnamecount=0;
+		eventvalue=0; eventhold=0; gap=0; nexttime=0;
+		record[0]=record[1]=NULL; recnum[0]=recnum[1]=-1;
+		recordsize=0; actslot=0; actrec=0;
+		readthread=NULL; readevent=NULL; readdone=TRUE;
+		InitializeCriticalSection(&cs);
+		reserve_channels(&channel,&channels_allocated,0);
 		state=0;
 		packetcount=0;
 		sampos=0;
@@ -210,27 +229,260 @@ EDF_READEROBJ::EDF_READEROBJ(int num) : BASE_CL()
 
 	  void EDF_READEROBJ::get_captions(void)
 	  {
-		int x,i;
+		int x,i,c;
 		char tmp[256];
 
+		if (!outchan) return;
 		for (x=0;x<outports;x++) 
 		{
-				strcpy(out_ports[x].out_desc,channel[x].label);
-				strcpy(tmp,channel[x].label);
+				if (x>=signals)
+				{
+					strcpy(out_ports[x].out_desc,"Annotations");
+					strcpy(out_ports[x].out_name,"events");
+					if (!loading)
+					{
+						out_ports[x].out_dim[0]=0;
+						out_ports[x].out_min=0;
+						out_ports[x].out_max=EDF_MAXEVENTNAMES+1;
+					}
+					continue;
+				}
+				c=outchan[x];
+				strcpy(out_ports[x].out_desc,channel[c].label);
+				strcpy(tmp,channel[c].label);
 				if (strlen(tmp)>8) tmp[8]='\0';
 				strcpy(out_ports[x].out_name,tmp);
 
 				if (!loading)
 				{
-					for (i=0;(i<4)&&(channel[x].physdim[i]);i++) out_ports[x].out_dim[i]=channel[x].physdim[i];
+					for (i=0;(i<4)&&(channel[c].physdim[i]);i++) out_ports[x].out_dim[i]=channel[c].physdim[i];
 					out_ports[x].out_dim[i]=0;
 
-					out_ports[x].out_min=(float)channel[x].physmin;
-					out_ports[x].out_max=(float)channel[x].physmax;
+					out_ports[x].out_min=(float)channel[c].physmin;
+					out_ports[x].out_max=(float)channel[c].physmax;
 				}
 		}
 //		update_dimensions();
 	  }
+
+
+DWORD WINAPI EdfReaderProc(LPVOID lpv)
+{
+	EDF_READEROBJ * st = (EDF_READEROBJ *) lpv;
+
+	while (!st->readdone)
+	{
+		WaitForSingleObject(st->readevent,INFINITE);
+		if (!st->readdone) st->prefetch();
+	}
+	return(0);
+}
+
+
+	  //  allocates the record buffers and precomputes the scaling of the channels
+	  int EDF_READEROBJ::prepare_records(void)
+	  {
+		int x,s,bytes;
+		double g;
+
+		stop_reader();
+		bytes=EDF_SAMPLEBYTES(&header);
+		for (x=0,s=0;x<header.channels;x++) s+=channel[x].samples;
+		recordsize=s;
+
+		free(rawbuf); free(scalemem); free(record[0]);
+		rawbuf=(unsigned char *)malloc(recordsize*bytes+1);
+		scalemem=(float *)malloc(header.channels*(2*sizeof(float)+2*sizeof(int))+1);
+		record[0]=(float *)malloc(2*recordsize*sizeof(float)+1);
+		recnum[0]=recnum[1]=-1;
+		actslot=0; actrec=0; signals=0;
+		eventcount[0]=eventcount[1]=0; eventnamecount=0;
+		eventhold=0; gap=0;
+		if ((!rawbuf)||(!scalemem)||(!record[0]))
+		{
+			free(rawbuf); free(scalemem); free(record[0]);
+			rawbuf=NULL; scalemem=NULL; record[0]=record[1]=NULL; outchan=NULL;
+			report_error("EDF-Reader: not enough memory for the data records");
+			return(FALSE);
+		}
+		gain=scalemem;
+		ofs=scalemem+header.channels;
+		recpos=(int *)(scalemem+2*header.channels);
+		outchan=recpos+header.channels;
+		record[1]=record[0]+recordsize;
+
+		for (x=0,s=0;x<header.channels;x++)  // physical value = digital value * gain + ofs
+		{
+			if (channel[x].digmax!=channel[x].digmin)
+				g=(double)(channel[x].physmax-channel[x].physmin)/(double)(channel[x].digmax-channel[x].digmin);
+			else g=1.0;
+			gain[x]=(float)g;
+			ofs[x]=(float)(channel[x].physmin-channel[x].digmin*g);
+			recpos[x]=s;
+			s+=channel[x].samples;
+			if (!channel[x].annotation) outchan[signals++]=x;
+		}
+		return(TRUE);
+	  }
+
+	  //  output ports: the signal channels and one port for the annotations
+	  int EDF_READEROBJ::edf_ports(void)
+	  {
+		if (!outchan) return(0);
+		return(signals + (header.annotations ? 1 : 0));
+	  }
+
+	  //  event number of an annotation: annotations which start with a number
+	  //  give this number, the others are numbered in order of appearance
+	  float EDF_READEROBJ::event_value(char * text)
+	  {
+		int i;
+
+		if (((text[0]>='0')&&(text[0]<='9')) || ((text[0]=='-')&&(text[1]>='0')&&(text[1]<='9')))
+			return((float)atof(text));
+		for (i=0;i<eventnamecount;i++)
+			if (!strcmp(eventnames[i],text)) return((float)(i+1));
+		if (eventnamecount<EDF_MAXEVENTNAMES)
+		{
+			strcpy(eventnames[eventnamecount++],text);
+			return((float)eventnamecount);
+		}
+		return((float)(EDF_MAXEVENTNAMES+1));
+	  }
+
+	  void EDF_READEROBJ::read_annotations(int slot, const unsigned char * tal, int len)
+	  {
+		EDFANNOTATIONStruct ann[EDF_MAXEVENTS];
+		EDFEVENTStruct * e;
+		double rate;
+		int i,n;
+
+		n=parse_edf_annotations(tal,len,&rectime[slot],ann,EDF_MAXEVENTS-eventcount[slot]);
+		rate=(double)header.samplespersegment/(double)header.duration;
+		for (i=0;i<n;i++)
+		{
+			e=&events[slot][eventcount[slot]++];
+			e->sample=(int)((ann[i].onset-rectime[slot])*rate+0.5);
+			if (e->sample<0) e->sample=0;
+			if (e->sample>=header.samplespersegment) e->sample=header.samplespersegment-1;
+			e->length=(int)(ann[i].duration*rate+0.5);
+			if (e->length<1) e->length=1;
+			e->value=event_value(ann[i].text);
+			strcpy(e->text,ann[i].text);
+		}
+	  }
+
+	  //  reads data record rec into the record buffer slot, returns FALSE at the end of the file.
+	  //  called with the critical section held
+	  int EDF_READEROBJ::read_record(int slot, long rec)
+	  {
+		OVERLAPPED ov;
+		LONGLONG pos;
+		DWORD dwRead;
+		int x,bytes;
+
+		if ((rec<0)||(!record[0])||(edffile==INVALID_HANDLE_VALUE)) return(FALSE);
+
+		bytes=EDF_SAMPLEBYTES(&header);
+		pos=(LONGLONG)EDF_HEADERSIZE(header.channels)+(LONGLONG)rec*recordsize*bytes;
+		memset(&ov,0,sizeof(ov));
+		ov.Offset=(DWORD)pos;
+		ov.OffsetHigh=(DWORD)(pos>>32);
+		if ((!ReadFile(edffile,rawbuf,(DWORD)recordsize*bytes,&dwRead,&ov)) || (dwRead<(DWORD)recordsize*bytes))
+			return(FALSE);
+
+		rectime[slot]=(double)rec*header.duration;
+		eventcount[slot]=0;
+		for (x=0;x<header.channels;x++)
+		{
+			if (channel[x].annotation) 
+				read_annotations(slot,rawbuf+recpos[x]*bytes,channel[x].samples*bytes);
+			else edf_to_float(rawbuf+recpos[x]*bytes,bytes,channel[x].samples,gain[x],ofs[x],record[slot]+recpos[x]);
+		}
+		return(TRUE);
+	  }
+
+	  //  reader thread: reads the record after the actual one into the other buffer
+	  void EDF_READEROBJ::prefetch(void)
+	  {
+		int slot;
+		long rec;
+
+		EnterCriticalSection(&cs);
+		slot=actslot^1;
+		rec=actrec+1;
+		if (recnum[slot]!=rec)
+		{
+			recnum[slot]=-1;
+			if (read_record(slot,rec)) recnum[slot]=rec;
+		}
+		LeaveCriticalSection(&cs);
+	  }
+
+	  //  switches to the next record, waits if the reader thread is still reading it
+	  void EDF_READEROBJ::next_record(void)
+	  {
+		EnterCriticalSection(&cs);
+		actslot^=1;
+		actrec++;
+		if (recnum[actslot]!=actrec)
+		{
+			recnum[actslot]=-1;
+			if (read_record(actslot,actrec)) recnum[actslot]=actrec;
+		}
+		sampos=0;
+		if (recnum[actslot]==actrec)
+		{   // discontinuous file: the outputs pause until the record starts
+			if ((header.plus==EDF_PLUS_DISCONTINUOUS) && (rectime[actslot]>nexttime))
+				gap=(long)((rectime[actslot]-nexttime)*header.samplespersegment/header.duration+0.5);
+			nexttime=rectime[actslot]+header.duration;
+		}
+		LeaveCriticalSection(&cs);
+		if (readthread) SetEvent(readevent);
+	  }
+
+	  void EDF_READEROBJ::seek_record(long rec, int pos)
+	  {
+		EnterCriticalSection(&cs);
+		recnum[0]=recnum[1]=-1;
+		actslot=0;
+		actrec=rec;
+		if (read_record(0,rec)) recnum[0]=rec;
+		sampos=pos;
+		nexttime=rectime[0]+header.duration;
+		gap=0; eventhold=0;
+		LeaveCriticalSection(&cs);
+		if (readthread) SetEvent(readevent);
+	  }
+
+	  void EDF_READEROBJ::start_reader(void)
+	  {
+		DWORD dwThreadId;
+
+		if ((readthread)||(!record[0])) return;
+		readdone=FALSE;
+		readevent=CreateEvent(NULL,FALSE,TRUE,NULL);
+		readthread=CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE) EdfReaderProc, this, 0, &dwThreadId);
+		if (!readthread)
+		{
+			report_error("CreateThread failed");
+			CloseHandle(readevent);
+			readevent=NULL;
+			readdone=TRUE;
+		}
+	  }
+
+	  void EDF_READEROBJ::stop_reader(void)
+	  {
+		if (!readthread) return;
+		readdone=TRUE;
+		SetEvent(readevent);
+		WaitForSingleObject(readthread,INFINITE);
+		CloseHandle(readthread);
+		CloseHandle(readevent);
+		readthread=NULL;
+		readevent=NULL;
+	  }
 	
 
   	  void EDF_READEROBJ::session_start(void) 
@@ -238,6 +490,7 @@ EDF_READEROBJ::EDF_READEROBJ(int num) : BASE_CL()
 		if ((edffile!=INVALID_HANDLE_VALUE)&&(outports>0))
 		{
 			state=2;
+			start_reader();
 			if (hDlg==ghWndToolbox)
 			{
 				update_state(hDlg,state);
@@ -248,6 +501,7 @@ EDF_READEROBJ::EDF_READEROBJ(int num) : BASE_CL()
 	  }
   	  void EDF_READEROBJ::session_stop(void) 
 	  {	
+		stop_reader();
 		if (edffile!=INVALID_HANDLE_VALUE) state=1; else state=0;
 		if (hDlg==ghWndToolbox)
 		{
@@ -261,7 +515,8 @@ EDF_READEROBJ::EDF_READEROBJ(int num) : BASE_CL()
 		  if (edffile!=INVALID_HANDLE_VALUE)
 		  { 
 			  state=1;
-			  SetFilePointer(edffile,256+header.channels*256,NULL,FILE_BEGIN);
+			  stop_reader();
+			  seek_record(0,0);
 			  if (hDlg==ghWndToolbox)
 			  {  
 				update_state(hDlg,state);
@@ -273,41 +528,15 @@ EDF_READEROBJ::EDF_READEROBJ(int num) : BASE_CL()
 	  }
   	  void EDF_READEROBJ::session_pos(long pos) 
 	  {	
-		  int x,i;
-		  long p,s;
+		  long p;
 	  
-		  if(edffile!=INVALID_HANDLE_VALUE)
+		  if((edffile!=INVALID_HANDLE_VALUE)&&(record[0])&&(header.samplespersegment>0))
 		  {
-
-//			  char sztemp[20];
-			  long ui=0;
-
 			  state=1;
-			  if (pos>sessionlength) 
-				{	SetFilePointer(edffile,0,NULL,FILE_END);
-					return;
-				}
-				pos -= offset; 
-				if (pos<0) 
- 				{	SetFilePointer(edffile,256+header.channels*256,NULL,FILE_BEGIN);    // set pos to segment start
-					return;
-				}
-
- 		  	    for (x=0,i=0;x<header.channels;x++) i+=channel[x].samples;
-
-				p=(long)((float)pos/(float)header.samplespersegment);    // which segment ?
-				s=p*i;              // segment start
-
-				ui=SetFilePointer(edffile,256+header.channels*256+
-						s*2,NULL,FILE_BEGIN);    // set pos to segment start
-
-				for (x=0;x<outports;x++)   // read whole segment
-					ReadFile(edffile,channel[x].buffer,2*channel[x].samples,&dwRead,NULL);
-
-				sampos=pos-p*header.samplespersegment;       // pos in segment
-//				sprintf(sztemp,"s:%d,ui:%d,sampos:%d",s,ui,sampos);
-//			    SetDlgItemText(ghWndStatusbox,IDC_STATUS,sztemp);
-
+			  pos -= offset; 
+			  if (pos<0) pos=0;
+			  p=pos/header.samplespersegment;                   // which segment ?
+			  seek_record(p,pos-p*header.samplespersegment);     // pos in segment
 		  } else state=0;
 		  if (hDlg==ghWndToolbox)	update_state(hDlg,state);
 	
@@ -319,8 +548,8 @@ EDF_READEROBJ::EDF_READEROBJ(int num) : BASE_CL()
 		  if (edffile!=INVALID_HANDLE_VALUE)
 		  {
 			for (x=0,i=0;x<header.channels;x++) i+=channel[x].samples;
-			sessionlength= SetFilePointer(edffile,0,NULL,FILE_END) - (256+header.channels*256);
-			sessionlength=sessionlength/i/2*header.duration*header.samplingrate+offset; 
+			sessionlength= GetFileSize(edffile,NULL) - EDF_HEADERSIZE(header.channels);
+			sessionlength=(long)(sessionlength/i/EDF_SAMPLEBYTES(&header)*header.duration*header.samplingrate+0.5)+offset; 
 		  } else sessionlength=0;
 	  }
 
@@ -345,20 +574,21 @@ EDF_READEROBJ::EDF_READEROBJ(int num) : BASE_CL()
 	  	  load_object_basics(this);
 		  load_property("filename",P_STRING,&filename);
 		  load_property("offset",P_INT,&offset);
-		  if ((edffile=open_edf_file(&header,channel,filename))==INVALID_HANDLE_VALUE)
+		  if ((edffile=open_edf_file(&header,&channel,&channels_allocated,filename))==INVALID_HANDLE_VALUE)
 		  {	 char st[150];
 			 reduce_filepath(st,filename);
 			 strcpy(filename,GLOBAL.resourcepath);
 			 strcat(filename,"ARCHIVES\\");
 			 strcat(filename,st);			 
-			 edffile=open_edf_file(&header,channel,filename); 
+			 edffile=open_edf_file(&header,&channel,&channels_allocated,filename); 
 		  }
 		  if (edffile!=INVALID_HANDLE_VALUE)
 		  {
+			  prepare_records();
 			  header.samplingrate=PACKETSPERSECOND;
 			  calc_session_length();
 			  session_pos(0);
-			  outports=header.channels;
+			  outports=reserve_ports(edf_ports());
 			  state=1;
 		  } else  { report_error("EDF archive file not found, please open file in EDF-Reader"); sessionlength=0; }
 
@@ -379,61 +609,64 @@ EDF_READEROBJ::EDF_READEROBJ(int num) : BASE_CL()
 	  
 	  void EDF_READEROBJ::work(void) 
 	  {
-		int x;
-//		short actval;
-		double actval;
+		int x,c;
+		float * rec;
+		EDFEVENTStruct * e;
 		char szdata[100];
-		double fact;
-		DWORD dwRead;
-	
 	
-		if ((outports==0)||(state!=2)||(edffile==INVALID_HANDLE_VALUE)) return;
+		if ((outports==0)||(state!=2)||(edffile==INVALID_HANDLE_VALUE)||(!record[0])||(header.samplespersegment<=0)) return;
 		if ((TIMING.packetcounter<offset)||(TIMING.packetcounter>sessionlength)) return;
 	
-		if (sampos<header.samplespersegment-1)
-		{
-			for (x=0;x<outports;x++)
-			{
-				actval=channel[x].buffer[sampos];
-				if (channel[x].samples==1) actval=channel[x].buffer[0];
-
-				fact=(channel[x].physmax-channel[x].physmin)/(double)(channel[x].digmax-channel[x].digmin);
-				actval-=channel[x].digmin;
-//				actval=(int)(actval*fact);
-				actval=actval*fact;
-				pass_values(x,(float)actval+channel[x].physmin);
-			}
-			sampos++; 
-			packetcount++;
-			if (((int)(packetcount/1000))*1000==packetcount)
-			{
-				sprintf(szdata,"%d Packets read\n",packetcount);
-				if (hDlg==ghWndToolbox) 
-					add_to_listbox(hDlg,IDC_LIST, szdata); 
-			}
+		if (sampos>=header.samplespersegment) next_record();
+		if (recnum[actslot]!=actrec) return;        // end of file
+		if (gap>0) { gap--; return; }
 
+		rec=record[actslot];
+		for (x=0;(x<signals)&&(x<outports);x++)
+		{
+			c=outchan[x];
+			if (channel[c].samples==header.samplespersegment) pass_values(x,rec[recpos[c]+sampos]);
+			else pass_values(x,rec[recpos[c]+sampos*channel[c].samples/header.samplespersegment]);
 		}
-		else
+
+		if (outports>signals)
 		{
-		    sampos=0;
-		    for (x=0;x<outports;x++)
-			{
-				ReadFile(edffile,channel[x].buffer,(DWORD)(2*channel[x].samples),&dwRead,NULL);
-				if (dwRead<(DWORD)2*channel[x].samples)
+			for (x=0,e=events[actslot];x<eventcount[actslot];x++,e++)
+				if (e->sample==sampos)
 				{
-//					session_pos(0);
-					packetcount=0;sampos=header.samplespersegment;x=outports;
+					eventvalue=e->value;
+					eventhold=e->length;
+					if (hDlg==ghWndToolbox) 
+					{
+						sprintf(szdata,"%.2f s: %s (%g)",rectime[actslot]+(double)sampos*header.duration/header.samplespersegment,e->text,e->value);
+						publish_list_item(hDlg,IDC_LIST, szdata); 
+					}
 				}
-			}
+			if (eventhold>0) { pass_values(signals,eventvalue); eventhold--; }
+			else pass_values(signals,0);
 		}
 
+		sampos++; 
+		packetcount++;
+		if (((int)(packetcount/1000))*1000==packetcount)
+		{
+			sprintf(szdata,"%d Packets read\n",packetcount);
+			if (hDlg==ghWndToolbox) 
+				publish_list_item(hDlg,IDC_LIST, szdata); 
+		}
 	  }
 
 
 EDF_READEROBJ::~EDF_READEROBJ()
 	  {	
-		if (edffile)
+		stop_reader();
+		if (edffile!=INVALID_HANDLE_VALUE)
 		{
 			CloseHandle(edffile);
 		}
-	  }  
+		free(record[0]);
+		free(scalemem);
+		free(rawbuf);
+		free(channel);
+		DeleteCriticalSection(&cs);
+	  }
@@ -11,6 +11,12 @@
   and the Signals are presented at the output-ports.
 
   Adjust the sampling rate to correctly display the signals.
+  The data records are read ahead by a reader thread into two record
+  buffers and converted to physical values with a precomputed gain and
+  offset per channel, work() hands out the samples of the actual record.
+  BDF-files (24 bit) and EDF+/BDF+ are supported: the annotations of the
+  annotation channels are presented at an additional event-port, the
+  outputs pause in the gaps between the records of discontinuous files.
   more Info about the EDF-File Format: http://www.edfplus.info/
 
   This program is free software; you can redistribute it and/or
@@ -24,6 +30,17 @@
 
 #include "brainBay.h"
 
+#define EDF_MAXEVENTS      32           // annotations per data record
+#define EDF_MAXEVENTNAMES  64           // texts which get an event number
+
+typedef struct EDFEVENTStruct
+{
+	int    sample;                      // position in the data record
+	int    length;                      // samples
+	float  value;                       // value at the event port
+	char   text[EDF_ANNOTATIONLEN];
+} EDFEVENTStruct;
+
 
 class EDF_READEROBJ : public BASE_CL
 {
@@ -33,7 +50,29 @@ protected:
   
 public: 
 	struct EDFHEADERStruct header;
-	struct CHANNELStruct channel[MAX_EEG_CHANNELS];
+	struct CHANNELStruct * channel;
+	int    channels_allocated;
+	unsigned char * rawbuf;       // one data record as stored in the file
+	float  * scalemem;            // gain, offset, record position per channel, channel per port
+	float  * gain, * ofs;
+	int    * recpos, * outchan;
+	int    signals;               // ports of the signal channels, the event port follows
+	float  * record[2];           // converted records, double buffered
+	volatile long recnum[2];      // record number in the buffer, -1 = empty
+	double rectime[2];            // start time of the record in seconds
+	EDFEVENTStruct events[2][EDF_MAXEVENTS];
+	int    eventcount[2];
+	char   eventnames[EDF_MAXEVENTNAMES][EDF_ANNOTATIONLEN];
+	int    eventnamecount;
+	float  eventvalue;
+	long   eventhold,gap;
+	double nexttime;
+	int    recordsize;            // samples of one record, all channels
+	int    actslot;
+	long   actrec;
+	HANDLE readthread,readevent;
+	volatile int readdone;
+	CRITICAL_SECTION cs;          // file access and record buffers
 	int    packetcount;
 	int    sampos;
 	HANDLE edffile;
@@ -53,6 +92,16 @@ public:
 	void session_pos(long pos);
 	long session_length(void);
     void calc_session_length(void);
+	int  prepare_records(void);
+	int  edf_ports(void);
+	int  read_record(int slot, long rec);
+	void read_annotations(int slot, const unsigned char * tal, int len);
+	float event_value(char * text);
+	void seek_record(long rec, int pos);
+	void next_record(void);
+	void prefetch(void);
+	void start_reader(void);
+	void stop_reader(void);
 
 	void make_dialog(void);
 	void load(HANDLE hFile);
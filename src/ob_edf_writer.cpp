@@ -8,6 +8,17 @@
 
   Using this Object, an EDF-File can be written,
   the Signals are connected to the input-ports.
+  With the BDF-option, the samples are written with 24 bit (BioSemi BDF-file),
+  so the resolution of 24 bit amplifiers (e.g. OpenBCI) is kept.
+
+  Every channel has its own samples per record (1 second), the values of a
+  channel with less samples than PACKETSPERSECOND are averaged. A channel
+  with 0 samples follows the packet rate, also when it changes later.
+  The samples of the channels are fixed when the writing starts. work() only
+  collects the values, the complete records are passed to a writer thread
+  via a queue of EDFW_QUEUESIZE records, which encodes and writes them.
+  Every EDFW_HEADERUPDATE records the number of records in the header is
+  updated, so the file stays readable when the session ends unexpectedly.
 
   more Info about the EDF-File Format: http://www.edfplus.info/
 
@@ -47,6 +58,8 @@ void set_gui_fileready(HWND hDlg)
 	EnableWindow(GetDlgItem(hDlg, IDC_DIGMAX), FALSE); 
 	EnableWindow(GetDlgItem(hDlg, IDC_PREFILTERING), FALSE); 
 	EnableWindow(GetDlgItem(hDlg, IDC_CHNFROMPORT), FALSE); 
+	EnableWindow(GetDlgItem(hDlg, IDC_BDFFORMAT), FALSE); 
+	EnableWindow(GetDlgItem(hDlg, IDC_CHNSAMPLES), FALSE); 
 }
 
 void set_gui_fileidle(HWND hDlg) 
@@ -70,6 +83,8 @@ void set_gui_fileidle(HWND hDlg)
 	EnableWindow(GetDlgItem(hDlg, IDC_DIGMAX), TRUE); 
 	EnableWindow(GetDlgItem(hDlg, IDC_PREFILTERING), TRUE);
 	EnableWindow(GetDlgItem(hDlg, IDC_CHNFROMPORT), TRUE); 
+	EnableWindow(GetDlgItem(hDlg, IDC_BDFFORMAT), TRUE); 
+	EnableWindow(GetDlgItem(hDlg, IDC_CHNSAMPLES), TRUE); 
 }
 
 void set_gui_filewriting(HWND hDlg) 
@@ -93,6 +108,8 @@ void set_gui_filewriting(HWND hDlg)
 	EnableWindow(GetDlgItem(hDlg, IDC_DIGMAX), FALSE); 
 	EnableWindow(GetDlgItem(hDlg, IDC_PREFILTERING), FALSE);
 	EnableWindow(GetDlgItem(hDlg, IDC_CHNFROMPORT), FALSE); 
+	EnableWindow(GetDlgItem(hDlg, IDC_BDFFORMAT), FALSE); 
+	EnableWindow(GetDlgItem(hDlg, IDC_CHNSAMPLES), FALSE); 
 }
 
 
@@ -124,6 +141,8 @@ LRESULT CALLBACK EdfWriterDlgHandler( HWND hDlg, UINT message, WPARAM wParam, LP
 				update_header(hDlg,&st->header);
 				update_channelcombo(hDlg, st->channel, st->header.channels);
 				update_channel(hDlg,st->channel,actchn);
+				SetDlgItemInt(hDlg,IDC_CHNSAMPLES,st->channel[actchn].samples,0);
+				CheckDlgButton(hDlg,IDC_BDFFORMAT,st->header.format==EDF_FORMAT_BDF);
 				return TRUE;
 	
 		case WM_CLOSE: 
@@ -131,11 +150,17 @@ LRESULT CALLBACK EdfWriterDlgHandler( HWND hDlg, UINT message, WPARAM wParam, LP
 				return TRUE;
 			
 		case WM_COMMAND:
-			if (HIWORD(wParam)==EN_KILLFOCUS) {get_header(hDlg,&st->header); get_channel(hDlg, st->channel, actchn);}
+			if (HIWORD(wParam)==EN_KILLFOCUS) 
+			{
+				get_header(hDlg,&st->header); get_channel(hDlg, st->channel, actchn);
+				st->channel[actchn].samples=GetDlgItemInt(hDlg,IDC_CHNSAMPLES,NULL,0);
+			}
 			switch (LOWORD(wParam)) 
 			{ 
 			case IDC_SELECT:
 			 
+				 st->set_format(st->header.format);
+				 st->limit_samples();
 				 st->edffile=create_edf_file(&st->header, st->channel, st->filename);
 				 if (st->edffile==INVALID_HANDLE_VALUE) 
 				 { 
@@ -146,8 +171,11 @@ LRESULT CALLBACK EdfWriterDlgHandler( HWND hDlg, UINT message, WPARAM wParam, LP
 				 else 
 				 { 
 					 st->state=STATE_READY;
+					 st->written=0;
 					 set_gui_fileready(hDlg);
 				 }
+				 update_header(hDlg,&st->header);
+				 SetDlgItemInt(hDlg,IDC_CHNSAMPLES,st->channel[actchn].samples,0);
 
 				 SetDlgItemText(hDlg,IDC_EDFFILE,st->filename);
 			     InvalidateRect(ghWndDesign,NULL,TRUE);
@@ -157,6 +185,7 @@ LRESULT CALLBACK EdfWriterDlgHandler( HWND hDlg, UINT message, WPARAM wParam, LP
 				if ((st->inports>0) &&(st->edffile!=INVALID_HANDLE_VALUE))
 				{
 					add_to_listbox(hDlg,IDC_LIST, "starting File-Write");
+					if ((!st->prepare_record()) || (!st->start_writer())) break;
 					// START FILE WRITING
 					st->state=STATE_WRITING;st->samplecount=0;st->recordcount=0;
 					set_gui_filewriting(hDlg);
@@ -169,6 +198,7 @@ LRESULT CALLBACK EdfWriterDlgHandler( HWND hDlg, UINT message, WPARAM wParam, LP
 					 update_channelcombo(hDlg, st->channel, st->header.channels);
 					 actchn=0;
 					 update_channel(hDlg,st->channel,actchn);
+					 SetDlgItemInt(hDlg,IDC_CHNSAMPLES,st->channel[actchn].samples,0);
 			  		 InvalidateRect(ghWndDesign,NULL,TRUE);
 			  		 InvalidateRect(ghWndMain,NULL,TRUE);
 				 }
@@ -177,34 +207,41 @@ LRESULT CALLBACK EdfWriterDlgHandler( HWND hDlg, UINT message, WPARAM wParam, LP
 			case IDC_STOP:
 					add_to_listbox(hDlg,IDC_LIST, "stopped");
 					st->state=STATE_READY;
+					st->stop_writer();
 					set_gui_fileready(hDlg);
 					break; 
 
 			case IDC_CLOSE: 
 					add_to_listbox(hDlg,IDC_LIST, "file closed.");
 					st->state=STATE_IDLE;
-					if (st->edffile!=INVALID_HANDLE_VALUE)
-					{
-						char str[8];
-						DWORD dwWritten;
-						sprintf(str,"%d",st->recordcount);
-						SetFilePointer(st->edffile,236,NULL,FILE_BEGIN);
-						WriteFile(st->edffile,str,strlen(str),&dwWritten, NULL);
-						SetFilePointer(st->edffile,0,NULL,FILE_END);
-						CloseHandle(st->edffile);
-						st->edffile=INVALID_HANDLE_VALUE;
-					}
+					st->close_edffile();
 					set_gui_fileidle(hDlg);
  
  				    InvalidateRect(ghWndDesign,NULL,TRUE);
 					break;
 
+			case IDC_BDFFORMAT:
+					get_channel(hDlg, st->channel, actchn);
+					if (IsDlgButtonChecked(hDlg,IDC_BDFFORMAT))
+					{   // use the 24 bit range
+						for (int x=0;x<st->channels_allocated;x++)
+						{
+							st->channel[x].digmin=-8388608;
+							st->channel[x].digmax=8388607;
+						}
+						st->set_format(EDF_FORMAT_BDF);
+					}
+					else st->set_format(EDF_FORMAT_EDF);
+					update_channel(hDlg,st->channel,actchn);
+					break;
+
 			case IDC_CHANNELCOMBO:
 					if (HIWORD(wParam)==CBN_SELCHANGE)
 					{
 						get_channel(hDlg, st->channel, actchn);
 						actchn=SendMessage(GetDlgItem(hDlg, IDC_CHANNELCOMBO), CB_GETCURSEL , 0, 0);
 						update_channel(hDlg, st->channel,actchn);
+						SetDlgItemInt(hDlg,IDC_CHNSAMPLES,st->channel[actchn].samples,0);
 					}
 				 break;
 
@@ -229,16 +266,18 @@ LRESULT CALLBACK EdfWriterDlgHandler( HWND hDlg, UINT message, WPARAM wParam, LP
 
 EDF_WRITEROBJ::EDF_WRITEROBJ(int num) : BASE_CL()	
 	  {
-  	    int x;
 	    outports = 0;
 		inports = 1;
 		width=80;
 		height=50;
 
 		reset_header(&header);
-		reset_channel(channel);
+		channel=NULL; channels_allocated=0; recordbuf=NULL; scalemem=NULL; queue=NULL;
+		gain=ofs=sum=NULL; recpos=sumcount=recsamples=NULL; recordsize=0;
+		qhead=qtail=qcount=0; dropped=0; written=0; writeerror=0;
+		writethread=NULL; writeevent=NULL; writeexit=0;
+		InitializeCriticalSection(&cs);
 
-		for (x=0;x<8192;x++) edfinfos[x]=' ';
 		header.samplespersegment=PACKETSPERSECOND;
 		header.segments=-1;
 		header.samplingrate=PACKETSPERSECOND;
@@ -246,19 +285,7 @@ EDF_WRITEROBJ::EDF_WRITEROBJ(int num) : BASE_CL()
 		strcpy (header.patient,"standard EEG");
 		strcpy (header.device,"Modular EEG  Unit");
 		header.channels=0;
-
-		for (x=0;x<MAX_EEG_CHANNELS;x++) 
-		{
-			sprintf(szdata,"%d : ",x+1);
-			strcpy (channel[x].transducer, "Ag/AgCl Electrode");
-			strcpy (channel[x].physdim, "uV");
-			strcpy (channel[x].label, "none");
-			strcpy (channel[x].prefiltering, "HP:0.16Hz, LP:59Hz");
-			channel[x].physmin=500;
-			channel[x].physmax=500;
-			channel[x].digmin=0;
-			channel[x].digmax=1024;
-		}
+		reserve_inputs();
 
 		state=STATE_IDLE;
 		samplecount=0;recordcount=0;
@@ -278,25 +305,214 @@ EDF_WRITEROBJ::EDF_WRITEROBJ(int num) : BASE_CL()
 				//in_ports[x].in_name[i]=0;
 				strcpy(channel[x].physdim,in_ports[x].in_dim);
 
-				channel[x].physmin=(int)in_ports[x].in_min;
-				channel[x].physmax=(int)in_ports[x].in_max;
+				channel[x].physmin=in_ports[x].in_min;
+				channel[x].physmax=in_ports[x].in_max;
 		}
 		header.channels=inports-1;
 	  }
+
+	  //  the channel table grows with the connected inputs
+	  void EDF_WRITEROBJ::reserve_inputs(void)
+	  {
+		int x,n;
+
+		n=channels_allocated;
+		if (inports>reserve_channels(&channel,&channels_allocated,inports)) inports=channels_allocated;
+		for (x=n;x<channels_allocated;x++) 
+		{
+			strcpy (channel[x].transducer, "Ag/AgCl Electrode");
+			strcpy (channel[x].physdim, "uV");
+			strcpy (channel[x].label, "none");
+			strcpy (channel[x].prefiltering, "HP:0.16Hz, LP:59Hz");
+			channel[x].physmin=500;
+			channel[x].physmax=500;
+			channel[x].digmin=0;
+			channel[x].digmax=1024;
+			channel[x].samples=0;
+		}
+	  }
+	
+  	  //  the digital range of the channels is limited to 16 bit (EDF) or 24 bit (BDF)
+	  void EDF_WRITEROBJ::set_format(int format)
+	  {
+		int x,lo,hi;
+
+		header.format=format;
+		lo = (format==EDF_FORMAT_BDF) ? -8388608 : -32768;
+		hi = (format==EDF_FORMAT_BDF) ? 8388607 : 32767;
+		for (x=0;x<channels_allocated;x++)
+		{
+			if (channel[x].digmin<lo) channel[x].digmin=lo;
+			if (channel[x].digmin>hi) channel[x].digmin=hi;
+			if (channel[x].digmax<lo) channel[x].digmax=lo;
+			if (channel[x].digmax>hi) channel[x].digmax=hi;
+		}
+	  }
+
+	  //  a channel has 1 to PACKETSPERSECOND samples per record, 0 follows the packet rate
+	  void EDF_WRITEROBJ::limit_samples(void)
+	  {
+		int x;
+
+		header.samplespersegment=1;
+		for (x=0;x<inports-1;x++)
+		{
+			if (channel[x].samples<0) channel[x].samples=0;
+			if (channel[x].samples>PACKETSPERSECOND) channel[x].samples=PACKETSPERSECOND;
+			if (edf_samples(&channel[x])>header.samplespersegment) header.samplespersegment=edf_samples(&channel[x]);
+		}
+	  }
+
+	  //  allocates the record queue and precomputes the scaling to the digital range
+	  int EDF_WRITEROBJ::prepare_record(void)
+	  {
+		int x,n;
+
+		n=inports-1;
+		limit_samples();
+		for (x=0,recordsize=0;x<n;x++) recordsize+=edf_samples(&channel[x]);
+
+		free(recordbuf); free(scalemem); free(queue);
+		recordbuf=(unsigned char *)malloc(recordsize*EDF_SAMPLEBYTES(&header)+1);
+		scalemem=(float *)malloc(n*(3*sizeof(float)+3*sizeof(int))+1);
+		queue=(float *)malloc(EDFW_QUEUESIZE*recordsize*sizeof(float)+1);
+		if ((!recordbuf)||(!scalemem)||(!queue))
+		{
+			free(recordbuf); free(scalemem); free(queue);
+			recordbuf=NULL; scalemem=NULL; queue=NULL;
+			report_error("EDF-Writer: not enough memory for the data records");
+			return(FALSE);
+		}
+		gain=scalemem; ofs=gain+n; sum=ofs+n;
+		recpos=(int *)(sum+n); sumcount=recpos+n; recsamples=sumcount+n;
+
+		for (x=0,recordsize=0;x<n;x++)   // digital value = physical value * gain + offset
+		{
+			if (channel[x].physmax-channel[x].physmin==0) gain[x]=0.0f;
+			else gain[x]=(float)(channel[x].digmax-channel[x].digmin)/(float)(channel[x].physmax-channel[x].physmin);
+			ofs[x]=(float)channel[x].digmin-(float)channel[x].physmin*gain[x];
+			sum[x]=0; sumcount[x]=0;
+			recpos[x]=recordsize;
+			recsamples[x]=edf_samples(&channel[x]);
+			recordsize+=recsamples[x];
+		}
+		return(TRUE);
+	  }
+
+
+DWORD WINAPI EdfWriterProc(LPVOID lpv)
+{
+	((EDF_WRITEROBJ *)lpv)->write_records();
+	return(0);
+}
+
+	  int EDF_WRITEROBJ::start_writer(void)
+	  {
+		DWORD dwThreadId;
+
+		stop_writer();
+		qhead=0; qtail=0; qcount=0;
+		dropped=0; writeerror=0; writeexit=0;
+		writeevent=CreateEvent(NULL,FALSE,FALSE,NULL);
+		writethread=CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE) EdfWriterProc, this, 0, &dwThreadId);
+		if (!writethread)
+		{
+			CloseHandle(writeevent);
+			report_error("Could not create EDF writer thread");
+			return(FALSE);
+		}
+		return(TRUE);
+	  }
+
+	  //  writes the queued records and ends the writer thread
+	  void EDF_WRITEROBJ::stop_writer(void)
+	  {
+		if (!writethread) return;
+		writeexit=1;
+		SetEvent(writeevent);
+		WaitForSingleObject(writethread,INFINITE);
+		CloseHandle(writethread);
+		CloseHandle(writeevent);
+		writethread=NULL;
+		write_recordcount();
+		write_logfile("EDF writer: %ld records written, %ld records dropped",written,dropped);
+		if (writeerror) report_error("Could not write to EDF-File");
+	  }
+
+	  //  writer thread
+	  void EDF_WRITEROBJ::write_records(void)
+	  {
+		int exit;
+
+		do
+		{
+			WaitForSingleObject(writeevent,INFINITE);
+			exit=writeexit;
+			while (qcount)
+			{
+				if ((!writeerror) && (!write_record(queue+qtail*recordsize)))
+					writeerror=GetLastError();
+				EnterCriticalSection(&cs);
+				qtail=(qtail+1)%EDFW_QUEUESIZE;
+				qcount--;
+				LeaveCriticalSection(&cs);
+			}
+		} while (!exit);
+	  }
+
+	  //  encodes one record and writes it after the last record of the file
+	  int EDF_WRITEROBJ::write_record(float * values)
+	  {
+		OVERLAPPED ov;
+		LONGLONG pos;
+		DWORD dwWritten;
+		int x,i,n,bytes;
+
+		n=inports-1;
+		bytes=EDF_SAMPLEBYTES(&header);
+		for (x=0;x<n;x++)
+			for (i=recpos[x];i<recpos[x]+recsamples[x];i++)
+				float_to_edf(values[i],gain[x],ofs[x],channel[x].digmin,channel[x].digmax,bytes,recordbuf+i*bytes);
+
+		pos=(LONGLONG)EDF_HEADERSIZE(n)+(LONGLONG)written*recordsize*bytes;
+		memset(&ov,0,sizeof(ov));
+		ov.Offset=(DWORD)pos;
+		ov.OffsetHigh=(DWORD)(pos>>32);
+		if ((!WriteFile(edffile,recordbuf,recordsize*bytes,&dwWritten,&ov)) || (dwWritten!=(DWORD)recordsize*bytes))
+			return(FALSE);
+		written++;
+		if (!(written%EDFW_HEADERUPDATE)) write_recordcount();
+		return(TRUE);
+	  }
+
+	  //  updates the number of records in the header
+	  void EDF_WRITEROBJ::write_recordcount(void)
+	  {
+		OVERLAPPED ov;
+		DWORD dwWritten;
+		char str[20];
+
+		if (edffile==INVALID_HANDLE_VALUE) return;
+		sprintf(str,"%-8ld",written);
+		memset(&ov,0,sizeof(ov));
+		ov.Offset=236;
+		WriteFile(edffile,str,8,&dwWritten,&ov);
+		if (GLOBAL.record_flush!=FLUSH_NONE) FlushFileBuffers(edffile);
+	  }
 	
   	  void EDF_WRITEROBJ::update_inports(void)
 	  {
 		if ((edffile!=INVALID_HANDLE_VALUE)&& (inports!=count_inports(this)))
 		{
 			close_toolbox();
-			CloseHandle(edffile);
-			edffile=INVALID_HANDLE_VALUE;
+			close_edffile();
 			close_toolbox();
 			report("EDF-Writer Input Ports changed, File has been closed");
 			state=STATE_IDLE;
 			if (ghWndToolbox==hDlg) set_gui_fileidle(hDlg);
 		}
 		inports=count_inports(this);
+		reserve_inputs();
 		header.channels=inports-1;
 		height=CON_START+inports*CON_HEIGHT+5;
 		InvalidateRect(ghWndMain,NULL,TRUE);
@@ -313,10 +529,10 @@ EDF_WRITEROBJ::EDF_WRITEROBJ(int num) : BASE_CL()
 
 	 	  load_object_basics(this);
 		  load_property("filename",P_STRING,&filename);
-		  if (load_property("edfinfos",P_STRING,&edfinfos))
-			  parse_edf_header(&header, channel, edfinfos);
+		  load_edf_header("edfinfos", &header, &channel, &channels_allocated);
 	//	  else get_captions();
-		  inports=header.channels;
+		  inports=reserve_ports(header.channels);
+		  reserve_inputs();
 		  height=CON_START+inports*CON_HEIGHT+5;
 	  }
 		
@@ -324,9 +540,7 @@ EDF_WRITEROBJ::EDF_WRITEROBJ(int num) : BASE_CL()
 	  {
 		  save_object_basics(hFile, this);
 		  save_property(hFile,"filename",P_STRING,&filename);
-		  edfheader_to_physical(&header, (EDFHEADER_PHYSICALStruct *) edfinfos);
-		  edfchannels_to_physical(channel,edfinfos+256,header.channels);
-		  save_property(hFile,"edfinfos",P_STRING,&edfinfos);	  
+		  save_edf_header(hFile,"edfinfos",&header,channel);
 	  }
 
 
@@ -338,45 +552,79 @@ EDF_WRITEROBJ::EDF_WRITEROBJ(int num) : BASE_CL()
 	  
 	  void EDF_WRITEROBJ::work(void) 
 	  {
-		int x;
-		float fact;
-	
+		int x,n,k;
+		float * rec;
 	
-		if ((inports==0)||(state!=STATE_WRITING)||(edffile==INVALID_HANDLE_VALUE)) return;
+		if ((inports==0)||(state!=STATE_WRITING)||(edffile==INVALID_HANDLE_VALUE)||(!queue)) return;
 
-	
-		for (x=0;x<inports-1;x++)
+		n=inports-1;
+		rec=queue+qhead*recordsize;
+		for (x=0;x<n;x++)
 		{
-			// WRITE FILE
-			if (channel[x].physmax-channel[x].physmin==0) fact=0.0f;
-			else fact=(float)(channel[x].digmax-channel[x].digmin)/(float)(channel[x].physmax-channel[x].physmin);
-			channel[x].buffer[samplecount]=(short)((in_ports[x].value-channel[x].physmin)*fact+channel[x].digmin);
-		}		
+			sum[x]+=in_ports[x].value;
+			sumcount[x]++;
+			k=samplecount*recsamples[x]/PACKETSPERSECOND;
+			if ((samplecount+1)*recsamples[x]/PACKETSPERSECOND!=k)  // last packet of the sample
+			{
+				if (k<recsamples[x]) rec[recpos[x]+k]=sum[x]/sumcount[x];
+				sum[x]=0; sumcount[x]=0;
+			}
+		}
 		samplecount++;
 
-		if (samplecount==PACKETSPERSECOND)
+		if (samplecount>=PACKETSPERSECOND)   // also when the packet rate was lowered
 		{
 			samplecount=0; recordcount++;
-			for (x=0;x<inports-1;x++)
-				WriteFile(edffile,channel[x].buffer,PACKETSPERSECOND*2,&dwWritten,NULL);
+			EnterCriticalSection(&cs);
+			if (qcount+1<EDFW_QUEUESIZE)
+			{
+				qhead=(qhead+1)%EDFW_QUEUESIZE;
+				qcount++;
+			}
+			else dropped++;      // the writer thread is behind: the record is overwritten
+			LeaveCriticalSection(&cs);
+			SetEvent(writeevent);
 
 			sprintf(szdata,"%d Seconds written",recordcount);
 			if (hDlg==ghWndToolbox) 
-				add_to_listbox(hDlg,IDC_LIST, szdata);
+				publish_list_item(hDlg,IDC_LIST, szdata);
 		}
 
 	  }
 
 
-EDF_WRITEROBJ::~EDF_WRITEROBJ()
-	  {	
-		if (edffile)
+//  writes the number of records and closes the file. When the clock of the
+//  device was estimated (clock.cpp) and the packets were not resampled,
+//  the record duration is corrected to the real sampling rate.
+void EDF_WRITEROBJ::close_edffile(void)
+	  {
+		char str[20];
+
+		if (edffile==INVALID_HANDLE_VALUE) return;
+
+		stop_writer();
+		sprintf(str,"%-8ld",written);
+		SetFilePointer(edffile,236,NULL,FILE_BEGIN);
+		WriteFile(edffile,str,8,&dwWritten, NULL);
+		if ((CLOCK.valid) && (!CLOCK.resample) && (CLOCK.rate>0))
 		{
-			char str[8];
-			sprintf(str,"%d",recordcount);
-			SetFilePointer(edffile,236,NULL,FILE_BEGIN);
-			WriteFile(edffile,str,strlen(str),&dwWritten, NULL);
-			SetFilePointer(edffile,0,NULL,FILE_END);
-			CloseHandle(edffile);
+			sprintf(str,"%-8.6f",(double)PACKETSPERSECOND/CLOCK.rate);
+			str[8]=0;
+			SetFilePointer(edffile,244,NULL,FILE_BEGIN);
+			WriteFile(edffile,str,8,&dwWritten, NULL);
 		}
+		SetFilePointer(edffile,0,NULL,FILE_END);
+		CloseHandle(edffile);
+		edffile=INVALID_HANDLE_VALUE;
+	  }
+
+
+EDF_WRITEROBJ::~EDF_WRITEROBJ()
+	  {	
+		close_edffile();
+		free(recordbuf);
+		free(scalemem);
+		free(queue);
+		DeleteCriticalSection(&cs);
+		free(channel);
 	  }  
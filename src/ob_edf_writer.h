@@ -8,6 +8,7 @@
 
   Using this Object, an EDF-File can be written,
   the Signals are connected to the input-ports.
+  The records are encoded and written by a writer thread.
 
   more Info about the EDF-File Format: http://www.edfplus.info/
 
@@ -21,6 +22,9 @@
 
 #include "brainBay.h"
 
+#define EDFW_QUEUESIZE      8       // records waiting for the writer thread
+#define EDFW_HEADERUPDATE   10      // records between two updates of the record count
+
 class EDF_WRITEROBJ : public BASE_CL
 {
 protected:
@@ -30,22 +34,47 @@ protected:
   
 public: 
 	struct EDFHEADERStruct header;
-	struct CHANNELStruct channel[MAX_EEG_CHANNELS];
+	struct CHANNELStruct * channel;
+	int    channels_allocated;
+	unsigned char * recordbuf;    // one record of all channels, as written to the file
+	float  * scalemem;            // gain, offset and decimation sum per channel
+	float  * gain, * ofs, * sum;
+	int    * recpos, * sumcount;  // position in the record, values in the sum
+	int    * recsamples;          // samples per record of the channels in the queue
+	float  * queue;               // EDFW_QUEUESIZE records of physical values
+	int    recordsize;            // samples of one record, all channels
+	int    qhead,qtail;
+	volatile int qcount;          // records waiting for the writer thread
+	long   dropped;
+	long   written;               // records in the file
+	DWORD  writeerror;
+	HANDLE writethread,writeevent;
+	volatile int writeexit;
+	CRITICAL_SECTION cs;
 	int    samplecount,recordcount;
 	HANDLE edffile;
 	char   filename[255];
-	char   edfinfos[8192];
 	int  state;
 
 
     EDF_WRITEROBJ(int num);
 	void get_captions(void);
+	void reserve_inputs(void);
+	void set_format(int format);
+	void limit_samples(void);
+	int  prepare_record(void);
+	int  start_writer(void);
+	void stop_writer(void);
+	void write_records(void);
+	int  write_record(float * values);
+	void write_recordcount(void);
 	void update_inports(void);
 	void work(void);
 	void incoming_data(int port, float value);
 	void make_dialog(void);
 	void load(HANDLE hFile);
 	void save(HANDLE hFile);
+	void close_edffile(void);
     ~EDF_WRITEROBJ();
 
 };
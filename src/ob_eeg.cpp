@@ -48,8 +48,6 @@
             the packets-per second - value
 
   process_packets:  calls the worker-functions of all existing objects.
-  parse_byte_P2: parses a ModEEG-P2 datastream and 
-			stores channel values into the packetstructure
   parse_byte_P21: parses a P21 datastream (by Jarek Foltynski, modified by Reiner Mnch)
 			     P21 is a bidirectional protocol
   parse_byte_P3: parses a ModEEG-P3 datastream and stores channel values 
@@ -57,7 +55,15 @@
   parse_byte_QDS: parses OpenEXG datastream with QDS NFB 256 protocol and
 			stores channel values into the packetstructure
  
-  ParseLocalInput: Chooses parsing-algorithm, according to TTY.devicetype
+  decode_*: frame decoders, which receive a whole buffer of read bytes. Complete
+			frames are located via memchr and decoded in one step, the parse_byte_* -
+			state machines are only used for frames which cross the buffer boundary.
+  decode_P2, decode_OPENBCI: frame decoders with their own state (FRAMEDECODERStruct),
+			they are also used by the Auxiliary Device elements.
+  openbci_samples, openbci_scale: convert the 24 bit samples of an OpenBCI frame
+			and scale them to uV with SSSE3 - instructions (if the cpu has them),
+			the scalar versions give the same results.
+  ParseLocalInput: Chooses the frame decoder, according to TTY.devicetype
 
 
   This program is free software; you can redistribute it and/or
@@ -72,6 +78,19 @@
 #include "brainBay.h"
 #include "ob_eeg.h"
 
+// SIMD decoding of OpenBCI frames (SSSE3, checked at runtime via cpuid)
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+  #define OPENBCI_SIMD
+  #include <tmmintrin.h>
+  #ifdef _MSC_VER
+	#include <intrin.h>
+	#define SSSE3_FUNCTION
+  #else
+	#include <cpuid.h>
+	#define SSSE3_FUNCTION __attribute__((target("ssse3")))
+  #endif
+#endif
+
 
 #define MAXLEN_TEMPSTR  20
 
@@ -103,7 +122,7 @@
 
 
 
-char captfiletypes[][40] = {"Text (Debug Mode)","Integer Values","\0"};
+char captfiletypes[][40] = {"Text (Debug Mode)","Integer Values","Compressed (v2)","\0"};
 
 char * szBaud[] = {"9600", "19200", "38400", "57600", "115200", "230400", "460800", "921600", "\0"};  // Combobox - Items for Baudrate
 DWORD   BaudTable[] =  {9600, 19200, 38400, 57600, 115200, 230400, 460800, 921600, 0 } ;  // Constants for Baudrate Setting
@@ -142,40 +161,6 @@ void check_sync(unsigned int num)
 
 
 
-void parse_byte_P2(unsigned char actbyte)
-{
-    switch (PACKET.readstate) 
-	{
-		  case 0: if (actbyte==165) PACKET.readstate++; 
-				  break;
-		  case 1: if (actbyte==90)  PACKET.readstate++; 
-				  else PACKET.readstate=0;
-				  break;
-		  case 2: PACKET.readstate++; 
-				  break;
-	      case 3: PACKET.number = actbyte;
-			      // if (++PACKET.old_number != actbyte) GLOBAL.temp++;
-				  // PACKET.old_number=actbyte;
-			      PACKET.extract_pos=0;PACKET.readstate++;
-				  break;
-		  case 4: if (PACKET.extract_pos < 12)
-				  {   if ((PACKET.extract_pos & 1) == 0)
-					     PACKET.buffer[PACKET.extract_pos>>1]=actbyte*256;
-			          else PACKET.buffer[PACKET.extract_pos>>1]+=actbyte;
-					  PACKET.extract_pos++;
-				  }
-				  else
-				  {  PACKET.switches= actbyte;
-					 PACKET.readstate=0;
-		  	  	     process_packets();
-				  }
-		  		  break;
-		  default: PACKET.readstate=0;
-		}		
-}
-
-
-
 
 
 /********************************************************************
@@ -745,103 +730,6 @@ void parse_byte_NIA(unsigned char actbyte)
   End Indcator:    0xC0
  **********************************************************************/
 
-void parse_byte_OPENBCI(unsigned char actbyte, int channelsInPacket)
-{
-	static int bytecounter=0;
-	static int channelcounter=0;
-	static int tempval=0;
-	static unsigned char framenumber=0;
-
-	switch (PACKET.readstate) {
-
-		// To better sync up when lost, look for two byte sequence.  It has happened
-		// previously, that when data contains lots of A0's, sync could not reestablish.
-		//
-		case 0: if (actbyte == 0xC0)			// look for end indicator
-					PACKET.readstate++;
-				break;
-
-		case 1:	if (actbyte == 0xA0)		    // look for start indicator next
-					PACKET.readstate++;
-				else
-					PACKET.readstate = 0;
-				break;
-
-		case 2:	if (actbyte != framenumber) {
-					GLOBAL.syncloss++;
-					// but go ahead and parse it anyway, 
-				}
-				framenumber = actbyte + 1;		// next expected frame number
-				bytecounter=0;
-				channelcounter=0;
-				tempval=0;
-				PACKET.readstate++;
-				break;
-
-		case 3: // get channel values 
-				tempval |= (((unsigned int)actbyte) << (16 - (bytecounter*8)));		// big endian
-//				tempval |= (((unsigned int)actbyte) << (bytecounter*8));	// little endian
-				bytecounter++;
-				if (bytecounter==3) {
-					if ((tempval & 0x00800000) > 0) {
-						tempval |= 0xFF000000;
-					} else {
-						tempval &= 0x00FFFFFF;
-					}
-					PACKET.buffer[channelcounter] = tempval;
-					channelcounter++;
-					if (channelcounter==channelsInPacket) {  // all channels arrived !
-						PACKET.readstate++;
-						bytecounter=0;
-						tempval=0;
-					}
-					else { bytecounter=0; tempval=0; }
-				}
-				break;
-
-		case 4: // get accelerometer XYZ
-				tempval |= (((unsigned int)actbyte) << (8 - (bytecounter*8)));		// big endian
-//				tempval |= (((unsigned int)actbyte) << (bytecounter*8));	// little endian
-				bytecounter++;
-				if (bytecounter==2) {
-					if ((tempval & 0x00008000) > 0) {
-						tempval |= 0xFFFF0000;
-					} else {
-						tempval &= 0x0000FFFF;
-					}  
-					PACKET.buffer[channelcounter]=tempval;
-					channelcounter++;
-					if (channelcounter==(channelsInPacket+3)) {  // all channels arrived !
-						PACKET.readstate++;
-						bytecounter=0;
-						channelcounter=0;
-						tempval=0;
-					}
-					else { bytecounter=0; tempval=0; }
-				}
-				break;
-
-		case 5: if (actbyte == 0xC0)     // if correct end delimiter found:
-				{
-					process_packets();   // call message pump
-					PACKET.readstate = 1;
-				}
-				else
-				{
-					GLOBAL.syncloss++;
-					PACKET.readstate = 0;	// resync
-				}
-				break;
-
-		default: PACKET.readstate=0;  // resync
-	}
-}
-
-
-
-
-
-
 /********************************************************************
 
   OPI Exploraton kit parser
@@ -976,39 +864,40 @@ Byte:Example // [CODE] Explanation
 [35]:0x34 // [CHKSUM] (1's comp inverse of 8-bit Payload sum of 0x) 
  **********************************************************************/
 
+int neurosky_pos=0;	// parser state, shared with decode_Neurosky
+
 void parse_byte_Neurosky(unsigned char actbyte)
 {
-	static int pos=0;
     static short tmpval=0;
 
-	switch (pos) 
+	switch (neurosky_pos) 
 	{
-		  case 0: if (actbyte==0xAA) pos++;
+		  case 0: if (actbyte==0xAA) neurosky_pos++;
 				  break;
-		  case 1: if (actbyte==0xAA) pos++;
+		  case 1: if (actbyte==0xAA) neurosky_pos++;
 				  break;
-  		  case 2: if (actbyte==0x04) pos++;        // raw packet
-				  else if (actbyte==0x20) pos=10;  // analysed packet
+  		  case 2: if (actbyte==0x04) neurosky_pos++;        // raw packet
+				  else if (actbyte==0x20) neurosky_pos=10;  // analysed packet
 				  break;
-  		  case 3: if (actbyte==0x80) pos++;
+  		  case 3: if (actbyte==0x80) neurosky_pos++;
 				  break;
-  		  case 4: if (actbyte==0x02) pos++;
+  		  case 4: if (actbyte==0x02) neurosky_pos++;
 				  break;
 
 		  case 5: tmpval=actbyte<<8;
-			      pos++;
+			      neurosky_pos++;
 				  break;
 
 		  case 6: tmpval |= actbyte;
 			      PACKET.buffer[0]=32767+tmpval; 
-			      pos++;
+			      neurosky_pos++;
 				  break;
 
 		  case 7: process_packets();
-				  pos=0;  // next packet 
+				  neurosky_pos=0;  // next packet 
 				  break;
 
-		  case 10: pos=0; 
+		  case 10: neurosky_pos=0; 
 			      // TBD: parse analysed packet
 			      // process_packets();
 				  break;
@@ -1022,34 +911,408 @@ void parse_byte_Neurosky(unsigned char actbyte)
 
 
 
-void ParseLocalInput(int BufLen)
+/********************************************************************
+
+  OpenBCI sample conversion
+
+  The 24 bit big endian samples of a frame are converted to signed 32 bit
+  values 4 at a time: a byte shuffle moves the 3 bytes of a sample to the upper
+  3 bytes of a dword, the arithmetic shift right does the sign extension.
+  The EEG-object scales the values with the precomputed uV per count of
+  each channel, 4 channels at a time. The SSSE3 - versions are selected at
+  runtime, the scalar versions are used on other cpus and give bit-identical
+  results.
+
+ **********************************************************************/
+
+int cpu_ssse3=-1;	// -1: not checked yet
+
+int has_ssse3(void)
 {
-	unsigned char actbyte;
-	unsigned int pbufcnt;
-	
-	for (pbufcnt=0;pbufcnt<(unsigned int)BufLen;pbufcnt++)
+#ifdef OPENBCI_SIMD
+	if (cpu_ssse3<0)
 	{
-		actbyte=TTY.readBuf[pbufcnt];
-		if (CAPTFILE.do_write) write_captfile(actbyte);
-        switch (TTY.devicetype)
+  #ifdef _MSC_VER
+		int info[4];
+		__cpuid(info,1);
+		cpu_ssse3=(info[2]>>9)&1;
+  #else
+		unsigned int a,b,c,d;
+		cpu_ssse3 = __get_cpuid(1,&a,&b,&c,&d) ? (c>>9)&1 : 0;
+  #endif
+		write_logfile("OpenBCI sample conversion: %s",cpu_ssse3 ? "SSSE3" : "scalar");
+	}
+	return(cpu_ssse3);
+#else
+	return(0);
+#endif
+}
+
+void openbci_samples_scalar(unsigned char * p, unsigned int * dst, int count)
+{
+	int i,val;
+
+	for (i=0;i<count;i++,p+=3)
+	{
+		val=(p[0]<<16)|(p[1]<<8)|p[2];
+		if (val & 0x00800000) val|=0xFF000000;
+		dst[i]=val;
+	}
+}
+
+void openbci_scale_scalar(unsigned int * buf, float * scale, float * values, int count)
+{
+	for (int x=0;x<count;x++)
+		values[x]=(float)((int)buf[x])*scale[x];
+}
+
+#ifdef OPENBCI_SIMD
+
+//  reads 4 bytes behind the last sample: the accelerometer values
+//  and the end indicator of the frame follow the samples
+SSSE3_FUNCTION void openbci_samples_ssse3(unsigned char * p, unsigned int * dst, int count)
+{
+	const __m128i shuffle = _mm_setr_epi8(-1,2,1,0, -1,5,4,3, -1,8,7,6, -1,11,10,9);
+	__m128i v;
+	int i;
+
+	for (i=0;i+4<=count;i+=4,p+=12)
+	{
+		v=_mm_shuffle_epi8(_mm_loadu_si128((__m128i *)p),shuffle);
+		_mm_storeu_si128((__m128i *)(dst+i),_mm_srai_epi32(v,8));
+	}
+	if (i<count) openbci_samples_scalar(p,dst+i,count-i);
+}
+
+SSSE3_FUNCTION void openbci_scale_ssse3(unsigned int * buf, float * scale, float * values, int count)
+{
+	__m128 v;
+	int x;
+
+	for (x=0;x+4<=count;x+=4)
+	{
+		v=_mm_cvtepi32_ps(_mm_loadu_si128((__m128i *)(buf+x)));
+		_mm_storeu_ps(values+x,_mm_mul_ps(v,_mm_loadu_ps(scale+x)));
+	}
+	if (x<count) openbci_scale_scalar(buf+x,scale+x,values+x,count-x);
+}
+
+#endif
+
+void openbci_samples(unsigned char * p, unsigned int * dst, int count)
+{
+#ifdef OPENBCI_SIMD
+	if (has_ssse3()) { openbci_samples_ssse3(p,dst,count); return; }
+#endif
+	openbci_samples_scalar(p,dst,count);
+}
+
+void openbci_scale(unsigned int * buf, float * scale, float * values, int count)
+{
+#ifdef OPENBCI_SIMD
+	if (has_ssse3()) { openbci_scale_ssse3(buf,scale,values,count); return; }
+#endif
+	openbci_scale_scalar(buf,scale,values,count);
+}
+
+
+/********************************************************************
+
+  Frame decoders
+
+  ParseLocalInput passes the whole buffer of read bytes to the decoder of
+  the actual devicetype. When the parser is in its idle state, the decoders
+  search the next sync byte with memchr and decode complete frames directly
+  from the buffer. Bytes of a frame which is not complete in this buffer
+  are passed to the parse_byte_* - state machine, which continues with
+  the next buffer. Devices without fixed frames use the byte parser for
+  the whole buffer.
+
+  The ModularEEG P2 and OpenBCI decoders keep their state in a
+  FRAMEDECODERStruct: the bytes of a frame which continues in the next
+  buffer, the next expected frame number and the function which receives
+  the decoded frames. So the same decoders serve the EEG device and the
+  Auxiliary Device elements, each with its own instance.
+
+ **********************************************************************/
+
+FRAMEDECODERStruct EEGDECODER;
+
+void init_decoder(FRAMEDECODERStruct * dec, int channels, void (*deliver)(FRAMEDECODERStruct *), void * owner, int * syncloss)
+{
+	dec->channels=channels;
+	dec->framepos=0;
+	dec->framenumber=-1;
+	dec->number=0; dec->switches=0;
+	dec->deliver=deliver;
+	dec->owner=owner;
+	dec->syncloss=syncloss;
+}
+
+//  appends the bytes to the frame which started in the last buffer, returns the bytes used
+int carry_frame(FRAMEDECODERStruct * dec, unsigned char * buf, int len, int framelen)
+{
+	int n=framelen-dec->framepos;
+
+	if (n>len) n=len;
+	memcpy(dec->frame+dec->framepos,buf,n);
+	dec->framepos+=n;
+	return(n);
+}
+
+//  the carried bytes are no valid frame: search the next one behind its first byte
+void resync_frame(FRAMEDECODERStruct * dec, void (*decode)(FRAMEDECODERStruct *, unsigned char *, int))
+{
+	unsigned char tmp[MAX_FRAMESIZE];
+	int len=dec->framepos-1;
+
+	memcpy(tmp,dec->frame+1,len);
+	dec->framepos=0;
+	decode(dec,tmp,len);
+}
+
+void p2_frame(FRAMEDECODERStruct * dec, unsigned char * p)
+{
+	dec->number=p[3];
+	for (int i=0;i<6;i++)
+		dec->values[i]=p[4+i*2]*256+p[5+i*2];
+	dec->switches=p[16];
+	dec->deliver(dec);
+}
+
+void openbci_frame(FRAMEDECODERStruct * dec, unsigned char * p)
+{
+	unsigned char * a;
+	int i,val;
+
+	// the first frame gives the frame number
+	if ((dec->framenumber!=-1) && (p[1]!=dec->framenumber)) (*dec->syncloss)++;
+	dec->framenumber=(p[1]+1)&255;
+	dec->number=p[1];
+	openbci_samples(p+2,dec->values,dec->channels);
+	a=p+2+dec->channels*3;
+	for (i=0;i<3;i++,a+=2)
+	{
+		val=(a[0]<<8)|a[1];
+		if (val & 0x00008000) val|=0xFFFF0000;
+		dec->values[dec->channels+i]=val;
+	}
+	dec->deliver(dec);
+}
+
+//  receives the frames of the EEG device
+void eeg_frame(FRAMEDECODERStruct * dec)
+{
+	if (TTY.devicetype==DEV_MODEEG_P2)
+	{
+		memcpy(PACKET.buffer,dec->values,6*sizeof(unsigned int));
+		PACKET.number=dec->number;
+		PACKET.switches=dec->switches;
+	}
+	else memcpy(PACKET.buffer,dec->values,(dec->channels+3)*sizeof(unsigned int));
+	process_packets();
+}
+
+//  the decoder of the EEG device is reset together with the byte parsers
+//  (PACKET.readstate=0, when a port or archive is opened), see ParseLocalInput
+FRAMEDECODERStruct * eeg_decoder(int channels)
+{
+	if ((!EEGDECODER.deliver) || (!PACKET.readstate))
+		init_decoder(&EEGDECODER,channels,eeg_frame,NULL,&GLOBAL.syncloss);
+	EEGDECODER.channels=channels;
+	return(&EEGDECODER);
+}
+
+void decode_P2(FRAMEDECODERStruct * dec, unsigned char * buf, int len)
+{
+	unsigned char * p, * end=buf+len;
+
+	while (buf<end)
+	{
+		if (dec->framepos)
+		{   // the frame started in the last buffer
+			buf+=carry_frame(dec,buf,end-buf,17);
+			if (dec->framepos<17) break;
+			if (dec->frame[1]==90) { dec->framepos=0; p2_frame(dec,dec->frame); }
+			else resync_frame(dec,decode_P2);
+			continue;
+		}
+
+		if (!(p=(unsigned char *)memchr(buf,165,end-buf))) break;
+		if (end-p<17)    // frame continues in the next buffer
 		{
-			case DEV_MODEEG_P2:	parse_byte_P2 (actbyte); break;
-			case DEV_MODEEG_P3:	parse_byte_P3 (actbyte); break;
-			case DEV_RAW:       parse_byte_raw(actbyte); break;
-			case DEV_MONOLITHEEG_P21: parse_byte_P21(actbyte); break;
-			case DEV_SBT2:      parse_byte_SBT2(actbyte); break;
-			case DEV_SBT4:      parse_byte_SBT4(actbyte); break;
-			case DEV_RAW8BIT:   parse_byte_raw_8bit(actbyte); break;
-			case DEV_PENDANT3:  parse_byte_PendantV3(actbyte); break;
-			case DEV_QDS:       parse_byte_QDS(actbyte); break;
-			case DEV_NIA:		parse_byte_NIA(actbyte); break;
-			case DEV_IBVA:		parse_byte_IBVA(actbyte); break;
-			case DEV_OPENBCI8:	parse_byte_OPENBCI(actbyte, 8); break;
-			case DEV_OPENBCI16:	parse_byte_OPENBCI(actbyte, 16); break;
-			case DEV_OPI_EXPLORATION: parse_byte_OPI(actbyte); break;
-			case DEV_NEUROSKY:  parse_byte_Neurosky(actbyte); break;
+			carry_frame(dec,p,end-p,17);
+			break;
 		}
+		if (p[1]!=90) { buf=p+1; continue; }
+		p2_frame(dec,p);
+		buf=p+17;
+	}
+}
+
+void decode_raw(unsigned char * buf, int len)
+{
+	unsigned char * end=buf+len;
+
+	while ((PACKET.readstate) && (buf<end)) parse_byte_raw(*buf++);
+	for (;end-buf>=2;buf+=2)
+	{
+		PACKET.buffer[0]=buf[0]+((unsigned char)(buf[1]+2))*256;
+		process_packets();
+	}
+	while (buf<end) parse_byte_raw(*buf++);
+}
+
+void decode_raw_8bit(unsigned char * buf, int len)
+{
+	for (int i=0;i<len;i++)
+	{
+		PACKET.buffer[0]=buf[i];
+		process_packets();
 	}
+}
+
+void decode_QDS(unsigned char * buf, int len)
+{
+	unsigned char * p, * end=buf+len;
+	int i;
+
+	while (buf<end)
+	{
+		if (PACKET.readstate)
+		{   parse_byte_QDS(*buf++); continue; }
+
+		if (!(p=(unsigned char *)memchr(buf,204,end-buf))) break;
+		if (end-p<20)
+		{
+			while (p<end) parse_byte_QDS(*p++);
+			break;
+		}
+		if ((p[1]!=51) || (p[2]!=204))
+		{   // let the state machine resync
+			buf=p;
+			while ((buf<end) && ((buf==p) || (PACKET.readstate))) parse_byte_QDS(*buf++);
+			continue;
+		}
+
+		for (i=0;i<8;i++)   // LSB first, 2's complement
+			PACKET.buffer[i]=(unsigned int)((short)(p[4+i*2] | (p[5+i*2]<<8))+32768);
+		process_packets();
+		buf=p+20;
+	}
+}
+
+void decode_NIA(unsigned char * buf, int len)
+{
+	unsigned char * end=buf+len;
+
+	while ((PACKET.readstate) && (buf<end)) parse_byte_NIA(*buf++);
+	for (;end-buf>=6;buf+=6)
+	{
+		PACKET.buffer[0]=buf[0]+buf[1]*256+buf[2]*65536;
+		PACKET.buffer[1]=buf[3]+buf[4]*256+buf[5]*65536;
+		process_packets();
+	}
+	while (buf<end) parse_byte_NIA(*buf++);
+}
+
+void decode_OPENBCI(FRAMEDECODERStruct * dec, unsigned char * buf, int len)
+{
+	unsigned char * p, * end=buf+len;
+	int framelen=dec->channels*3+9;   // start, frame number, channels, accelerometer, end indicator
+
+	while (buf<end)
+	{
+		if (dec->framepos)
+		{   // the frame started in the last buffer
+			buf+=carry_frame(dec,buf,end-buf,framelen);
+			if (dec->framepos<framelen) break;
+			if (dec->frame[framelen-1]==0xC0) { dec->framepos=0; openbci_frame(dec,dec->frame); }
+			else resync_frame(dec,decode_OPENBCI);
+			continue;
+		}
+
+		if (!(p=(unsigned char *)memchr(buf,0xA0,end-buf))) break;
+		if (end-p<framelen)    // frame continues in the next buffer
+		{
+			carry_frame(dec,p,end-p,framelen);
+			break;
+		}
+		if (p[framelen-1]!=0xC0) { buf=p+1; continue; }   // 0xA0 within the data
+		openbci_frame(dec,p);
+		buf=p+framelen;
+	}
+}
+
+void decode_Neurosky(unsigned char * buf, int len)
+{
+	unsigned char * p, * end=buf+len;
+
+	while (buf<end)
+	{
+		if (neurosky_pos)
+		{   parse_byte_Neurosky(*buf++); continue; }
+
+		if (!(p=(unsigned char *)memchr(buf,0xAA,end-buf))) break;
+		if ((end-p>=8) && (p[1]==0xAA) && (p[2]==0x04) && (p[3]==0x80) && (p[4]==0x02))
+		{   // raw packet
+			PACKET.buffer[0]=32767+(short)((p[5]<<8)|p[6]);
+			process_packets();
+			buf=p+8;
+		}
+		else
+		{
+			buf=p;
+			parse_byte_Neurosky(*buf++);
+		}
+	}
+}
+
+//  devices without fixed frames: the byte parser processes the buffer
+void decode_bytes(unsigned char * buf, int len, void (*parse_byte)(unsigned char))
+{
+	for (int i=0;i<len;i++) parse_byte(buf[i]);
+}
+
+
+void ParseLocalInput(int BufLen)
+{
+	LONGLONG arrival;
+
+	QueryPerformanceCounter((_LARGE_INTEGER *)&arrival);
+	ParseLocalInput(BufLen,arrival);
+}
+
+//  arrival: time when the bytes were received
+void ParseLocalInput(int BufLen, LONGLONG arrival)
+{
+	unsigned char * buf=(unsigned char *)TTY.readBuf;
+	
+	if (BufLen<=0) return;
+
+	// arrival time of the bytes, for the packets completed by the decoder
+	PACKET.arrival=arrival;
+	if (CAPTFILE.do_write) record_bytes(buf,BufLen);
+
+	switch (TTY.devicetype)
+	{
+		case DEV_MODEEG_P2:	decode_P2(eeg_decoder(6),buf,BufLen); PACKET.readstate=1; break;
+		case DEV_MODEEG_P3:	decode_bytes(buf,BufLen,parse_byte_P3); break;
+		case DEV_RAW:       decode_raw(buf,BufLen); break;
+		case DEV_MONOLITHEEG_P21: decode_bytes(buf,BufLen,parse_byte_P21); break;
+		case DEV_SBT2:      decode_bytes(buf,BufLen,parse_byte_SBT2); break;
+		case DEV_SBT4:      decode_bytes(buf,BufLen,parse_byte_SBT4); break;
+		case DEV_RAW8BIT:   decode_raw_8bit(buf,BufLen); break;
+		case DEV_PENDANT3:  decode_bytes(buf,BufLen,parse_byte_PendantV3); break;
+		case DEV_QDS:       decode_QDS(buf,BufLen); break;
+		case DEV_NIA:		decode_NIA(buf,BufLen); break;
+		case DEV_IBVA:		decode_bytes(buf,BufLen,parse_byte_IBVA); break;
+		case DEV_OPENBCI8:	decode_OPENBCI(eeg_decoder(8),buf,BufLen); PACKET.readstate=1; break;
+		case DEV_OPENBCI16:	decode_OPENBCI(eeg_decoder(16),buf,BufLen); PACKET.readstate=1; break;
+		case DEV_OPI_EXPLORATION: decode_bytes(buf,BufLen,parse_byte_OPI); break;
+		case DEV_NEUROSKY:  decode_Neurosky(buf,BufLen); break;
+	}
+	PACKET.arrival=0;
 	return;
 }
 
@@ -1531,6 +1794,7 @@ LRESULT CALLBACK EEGDlgHandler( HWND hDlg, UINT message, WPARAM wParam, LPARAM l
 				case IDC_PLAY_ARCHIVE:
 					if(CAPTFILE.filehandle==INVALID_HANDLE_VALUE) break;
 					QueryPerformanceCounter((_LARGE_INTEGER *)&TIMING.readtimestamp);
+					reset_clock();
 					CAPTFILE.do_read=1;
 					update_captfile_guibuttons(hDlg);
 					start_timer();
@@ -1597,6 +1861,7 @@ EEGOBJ::EEGOBJ(int num) : BASE_CL()
  		outports = 7;
 		scrolling=0;
 		width=60;
+		for (int x=0;x<MAX_PORTS;x++) { uvscale[x]=0; uvscale_max[x]=0; }
 		update_devicetype();
 		setEEGDeviceDefaults(this);
 	}
@@ -1640,7 +1905,7 @@ EEGOBJ::EEGOBJ(int num) : BASE_CL()
 		    if (TTY.devicetype==DEV_MONOLITHEEG_P21) sendP21Command(CMD_SET_VINFO, VINFO_RUNEEG ,0);
 			CAPTFILE.do_read=0;CAPTFILE.do_write=0;TTY.read_pause=1;
 			if (hDlg==ghWndToolbox) update_captfile_guibuttons(hDlg);
-			if(CAPTFILE.filehandle!=INVALID_HANDLE_VALUE) SetFilePointer(CAPTFILE.filehandle,CAPTFILE.data_begin,NULL,FILE_BEGIN);
+			if(CAPTFILE.filehandle!=INVALID_HANDLE_VALUE) seek_captfile(0);
 
 	  }
   	  void EEGOBJ::session_pos(long pos) 
@@ -1649,7 +1914,7 @@ EEGOBJ::EEGOBJ(int num) : BASE_CL()
 			pos-=CAPTFILE.offset;
 			if (pos<0) pos=0;
 			if (pos>CAPTFILE.length) pos=CAPTFILE.length;
-			SetFilePointer(CAPTFILE.filehandle,CAPTFILE.data_begin+pos*TTY.bytes_per_packet,NULL,FILE_BEGIN);
+			seek_captfile(pos);
 	  } 
 
 	  long EEGOBJ::session_length(void) 
@@ -1738,59 +2003,119 @@ EEGOBJ::EEGOBJ(int num) : BASE_CL()
 			save_property(hFile, "resolution", P_FLOAT, &dummy);
 	  }
 
-	  void EEGOBJ::work(void) 
+	  //  number of values passed per packet for the actual device
+	  int EEGOBJ::packet_values(void)
 	  {
-		int i,x;
+        switch (TTY.devicetype)
+		{
+			case DEV_PENDANT3: return(4);
+			case DEV_MODEEG_P2:
+			case DEV_MODEEG_P3:
+			case DEV_MONOLITHEEG_P21: return(7);
+			case DEV_OPENBCI8: return(8+3);
+			case DEV_OPENBCI16: return(16+3);
+		}
+		return(outports);
+	  }
+
+	  //  scaled value of output port x for the packet buffer buf
+	  float EEGOBJ::channel_value(int x, unsigned int * buf, unsigned char sw)
+	  {
+		int chans;
 
         switch (TTY.devicetype)
 		{
 			case DEV_PENDANT3:
-			    for (x=0;x<2;x++)
-				   pass_values(x,(float) PACKET.buffer[x] * (out_ports[x].out_max-out_ports[x].out_min) / (float)(1<<resolution) + out_ports[x].out_min);
-		    	pass_values(2,(float) (PACKET.buffer[2]));  // valid indicator
-		    	pass_values(3,(float) (PACKET.switches));  
+				if (x==2) return((float) (buf[2]));  // valid indicator
+				if (x==3) return((float) sw);
 				break;
 
 			case DEV_MODEEG_P2:
 			case DEV_MODEEG_P3:
 			case DEV_MONOLITHEEG_P21: 
-				  for (x=0;x<6;x++)
-						pass_values(x,(float) PACKET.buffer[x] * (out_ports[x].out_max-out_ports[x].out_min) / (float)(1<<resolution) + out_ports[x].out_min);
-				  pass_values(x,(float)PACKET.switches);
-				  break;
+				if (x==6) return((float) sw);
+				break;
 
 			case DEV_OPENBCI8:
-				i = 8;
-				goto openbci;
-
 			case DEV_OPENBCI16:
-				i = 16;
-openbci:	{
-				float uvpercount, maxcount, pbufferuv;
-				int pbuffer;
-				maxcount = (float)((1<<23) - 1);
-				for (x=0;x<i;x++)
-				{
-					uvpercount = (float)(out_ports[x].out_max) / maxcount;
-					// PACKET.buffer is unsigned int, but our values are signed.
-					pbuffer = (int)PACKET.buffer[x];
-					pbufferuv = (float)pbuffer * uvpercount;
-					pass_values(x, pbufferuv);
-					// if (x == 1)	write_logfile("uvpc %f, pbuf %d, pbufuv %f\n", uvpercount, pbuffer, pbufferuv);
-				}
-				pass_values(x,(float) ((int)PACKET.buffer[x]));  x++;
-				pass_values(x,(float) ((int)PACKET.buffer[x]));  x++;
-				pass_values(x,(float) ((int)PACKET.buffer[x]));  x++;
-				break;
+				chans = (TTY.devicetype==DEV_OPENBCI8) ? 8 : 16;
+				// PACKET.buffer is unsigned int, but our values are signed.
+				if (x>=chans) return((float) ((int)buf[x]));   // accelerometer
+				update_uvscale(chans);
+				return((float)((int)buf[x]) * uvscale[x]);
+		}
+		return(((float) buf[x]) * (out_ports[x].out_max-out_ports[x].out_min) / (float)(1<<resolution) + out_ports[x].out_min);
+	  }
+
+	  //  uV per count of the OpenBCI channels, recalculated when the range changes
+	  void EEGOBJ::update_uvscale(int chans)
+	  {
+		for (int x=0;x<chans;x++)
+			if (out_ports[x].out_max!=uvscale_max[x])
+			{
+				uvscale_max[x]=out_ports[x].out_max;
+				uvscale[x]=(float)(out_ports[x].out_max) / (float)((1<<23) - 1);
 			}
+	  }
+
+	  //  channel and accelerometer values of an OpenBCI packet
+	  void EEGOBJ::openbci_values(unsigned int * buf, float * values, int chans)
+	  {
+		openbci_scale(buf,uvscale,values,chans);
+		for (int x=chans;x<chans+3;x++) values[x]=(float)((int)buf[x]);
+	  }
+
+	  void EEGOBJ::work_block(int count)
+	  {
+		float values[MAX_BLOCKSIZE];
+		float packet[16+3], chanvalues[16+3][MAX_BLOCKSIZE];
+		int i,x,n,chans;
 
-			default:  // all other devices
-			  for (x=0;x<outports;x++)
-					pass_values(x, ((float) PACKET.buffer[x])  * (out_ports[x].out_max-out_ports[x].out_min) / (float)(1<<resolution) + out_ports[x].out_min);
-			  break;
+		n=packet_values();
+		if ((TTY.devicetype==DEV_OPENBCI8)||(TTY.devicetype==DEV_OPENBCI16))
+		{
+			chans=n-3;
+			update_uvscale(chans);
+			for (i=0;i<count;i++)
+			{
+				openbci_values(BLOCK.buffer[i],packet,chans);
+				for (x=0;x<n;x++) chanvalues[x][i]=packet[x];
+			}
+			for (x=0;x<n;x++) pass_block(x,chanvalues[x],count);
+			n=0;
+		}
+		for (x=0;x<n;x++)
+		{
+			for (i=0;i<count;i++)
+				values[i]=channel_value(x,BLOCK.buffer[i],BLOCK.switches[i]);
+			pass_block(x,values,count);
+		}
+		if (block_update_due(BLOCK.dialog_update,count))
+		{
+			TIMING.dialog_update=0;
+			update_toolbox();
 		}
+	  }
 
+	  void EEGOBJ::work(void) 
+	  {
+		float values[16+3];
+		int x,n;
 
+		n=packet_values();
+		if ((TTY.devicetype==DEV_OPENBCI8)||(TTY.devicetype==DEV_OPENBCI16))
+		{
+			update_uvscale(n-3);
+			openbci_values(PACKET.work_buffer,values,n-3);
+			for (x=0;x<n;x++) pass_values(x,values[x]);
+		}
+		else for (x=0;x<n;x++)
+			pass_values(x,channel_value(x,PACKET.work_buffer,PACKET.work_switches));
+		update_toolbox();
+	  }
+
+	  void EEGOBJ::update_toolbox(void) 
+	  {
 		if ((!TIMING.dialog_update) && (hDlg==ghWndToolbox))
 		{
 			if (TTY.COMDEV!=INVALID_HANDLE_VALUE)
@@ -1798,21 +2123,19 @@ openbci:	{
 				char str[15];
 				if (TTY.devicetype==DEV_IBVA)
 				{
-					sprintf(str,"%.2f V",(float)PACKET.buffer[5]*16/1024);
-					SetDlgItemText(hDlg, IDC_BATTERY, str);
+					sprintf(str,"%.2f V",(float)PACKET.work_buffer[5]*16/1024);
+					publish_dlg_text(hDlg, IDC_BATTERY, str);
 				}
 				if (TTY.devicetype==DEV_SBT2)
 				{
-					sprintf(str,"%d",PACKET.buffer[6]);
-					SetDlgItemText(hDlg, IDC_SBT2STATUS, str);
+					sprintf(str,"%d",PACKET.work_buffer[6]);
+					publish_dlg_text(hDlg, IDC_SBT2STATUS, str);
 				}
 			}
 
 			if((!scrolling) && (CAPTFILE.do_read)) 
 			{
-				DWORD x= SetFilePointer(CAPTFILE.filehandle,0,NULL,FILE_CURRENT);
-				x=x*1000/CAPTFILE.length/TTY.bytes_per_packet;
-				SetScrollPos(GetDlgItem(hDlg, IDC_ARCHIVE_POSBAR), SB_CTL, x, 1);
+				SetScrollPos(GetDlgItem(hDlg, IDC_ARCHIVE_POSBAR), SB_CTL, captfile_position(), 1);
 			}
 		}
 	  }
@@ -39,6 +39,8 @@ class EEGOBJ : public BASE_CL
 	unsigned int      buffer[MAX_EEG_CHANNELS*2];
 	unsigned int      chnmatrix;
 	int				  resolution;
+	float             uvscale[MAX_PORTS];       // uV per count of the OpenBCI channels
+	float             uvscale_max[MAX_PORTS];   // out_max used for uvscale
 
 
 	EEGOBJ(int num);
@@ -51,6 +53,12 @@ class EEGOBJ : public BASE_CL
 	void load(HANDLE hFile);
 	void save(HANDLE hFile);
 	void work(void);
+	void work_block(int count);
+	int  packet_values(void);
+	float channel_value(int x, unsigned int * buf, unsigned char sw);
+	void update_uvscale(int chans);
+	void openbci_values(unsigned int * buf, float * values, int chans);
+	void update_toolbox(void);
 	~EEGOBJ();
 	
 	
@@ -406,17 +406,16 @@ ERPDETECTOBJ::ERPDETECTOBJ(int num) : BASE_CL()
 					 {
 						if (current==epochs)
 						{ 
-    						EnableWindow(GetDlgItem(hDlg, IDC_STARTCAPTURE), TRUE);
-    						EnableWindow(GetDlgItem(hDlg, IDC_STOPCAPTURE), FALSE);
-    						EnableWindow(GetDlgItem(hDlg, IDC_LOADERP), TRUE);
-    						EnableWindow(GetDlgItem(hDlg, IDC_SAVEERP), TRUE);
-						 	SetDlgItemText(hDlg,IDC_STATUS,"Detection Mode.");
-							UpdateWindow(hDlg);
+    						publish_enable(hDlg, IDC_STARTCAPTURE, TRUE);
+    						publish_enable(hDlg, IDC_STOPCAPTURE, FALSE);
+    						publish_enable(hDlg, IDC_LOADERP, TRUE);
+    						publish_enable(hDlg, IDC_SAVEERP, TRUE);
+						 	publish_dlg_text(hDlg,IDC_STATUS,"Detection Mode.");
 						}
 						
 					 }
 	
-					 InvalidateRect(hDlg,NULL,TRUE);
+					 publish_invalidate(hDlg,TRUE);
 				 }
 			  }
 			  if ((!TIMING.dialog_update)&&(hDlg==ghWndToolbox))
@@ -424,11 +423,11 @@ ERPDETECTOBJ::ERPDETECTOBJ(int num) : BASE_CL()
 				  char sztemp[50];
 				  if (trigger!=1)
 				  {   sprintf(sztemp,   "waiting for trail %d",current+1);
-				      SetDlgItemText(hDlg,IDC_STATUS,sztemp);
+				      publish_dlg_text(hDlg,IDC_STATUS,sztemp);
 				  }
 				  else 
 				  {     sprintf(sztemp, "  recording trial %d",current+1); 
-				        SetDlgItemText(hDlg,IDC_STATUS,sztemp);
+				        publish_dlg_text(hDlg,IDC_STATUS,sztemp);
 				  }
 			  }
   			  pass_values(0,INVALID_VALUE);
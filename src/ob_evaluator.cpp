@@ -162,7 +162,7 @@ void EVALOBJ::setExpression(char *expr)
 void EVALOBJ::work(void)
 {
 	static char *names[] = {"A", "B", "C", "D", "E", "F"};
-    static double values[NUMINPUTS];
+    double values[NUMINPUTS];
     double result=INVALID_VALUE;
 
     if ((evaluator != NULL)&&(!setexp))
@@ -178,6 +178,33 @@ void EVALOBJ::work(void)
     pass_values(0, (float)result);
 }
 
+void EVALOBJ::work_block(int count)
+{
+	static char *names[] = {"A", "B", "C", "D", "E", "F"};
+    double values[NUMINPUTS];
+	float * inputs[NUMINPUTS] = { &inputA, &inputB, &inputC, &inputD, &inputE, &inputF };
+	float out[MAX_BLOCKSIZE];
+	BLOCKPORTStruct * bp;
+	int i,p;
+
+	for (i=0;i<count;i++)
+	{
+		for (p=0;(p<NUMINPUTS)&&(p<block_ports);p++)
+		{
+			bp=in_block[p];
+			if ((bp) && (bp->set[i]) && (bp->value[i]!=INVALID_VALUE))
+				*inputs[p]=bp->value[i];
+		}
+		out[i]=(float)INVALID_VALUE;
+		if ((evaluator != NULL)&&(!setexp))
+		{
+			for (p=0;p<NUMINPUTS;p++) values[p] = *inputs[p];
+			out[i] = (float)evaluator_evaluate(evaluator, NUMINPUTS, names, values);
+		}
+	}
+	pass_block(0, out, count);
+}
+
 EVALOBJ::~EVALOBJ()
 {
 	if (evaluator != NULL) evaluator_destroy(evaluator);
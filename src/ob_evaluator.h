@@ -83,6 +83,7 @@ class EVALOBJ : public BASE_CL
 		void incoming_data(int port, float value);
 	
 		void work(void);
+		void work_block(int count);
 
 		~EVALOBJ();
 		
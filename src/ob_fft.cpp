@@ -622,7 +622,7 @@ LRESULT CALLBACK FFTDlgHandler(HWND hDlg, UINT message, WPARAM wParam, LPARAM lP
 			  update_dimensions();
 			}
 			//memset(st->tex_buf,0,sizeof(float)*128*128);
-			if (st->displayWnd) InvalidateRect(st->displayWnd,NULL,TRUE);
+			publish_invalidate(st->displayWnd,TRUE);
 			InvalidateRect(hDlg,NULL,FALSE);
 			}
 			break;
@@ -642,13 +642,13 @@ LRESULT CALLBACK FFTDlgHandler(HWND hDlg, UINT message, WPARAM wParam, LPARAM lP
 				update_dimensions();
 			}
 			//memset(st->tex_buf,0,sizeof(float)*128*128);
-			if (st->displayWnd) InvalidateRect(st->displayWnd,NULL,TRUE);
+			publish_invalidate(st->displayWnd,TRUE);
 			InvalidateRect(hDlg,NULL,FALSE);
 			}
 			break;
 		case IDC_FFTALIGNCOMBO:
 			st->align=SendDlgItemMessage(hDlg, IDC_FFTALIGNCOMBO, CB_GETCURSEL, 0, 0 ) ;
-			if (st->displayWnd) InvalidateRect(st->displayWnd,NULL,TRUE);
+			publish_invalidate(st->displayWnd,TRUE);
 			InvalidateRect(hDlg,NULL,FALSE);
 			break;
 		case IDC_BINCOMBO:
@@ -657,7 +657,7 @@ LRESULT CALLBACK FFTDlgHandler(HWND hDlg, UINT message, WPARAM wParam, LPARAM lP
 			break;
 		case IDC_WINDOWCOMBO:
 			st->window=SendDlgItemMessage(hDlg, IDC_WINDOWCOMBO, CB_GETCURSEL, 0, 0 ) ;
-			if (st->displayWnd) InvalidateRect(st->displayWnd,NULL,TRUE);
+			publish_invalidate(st->displayWnd,TRUE);
 			InvalidateRect(hDlg,NULL,FALSE);
 			break;
 		case IDC_FFTKINDCOMBO:
@@ -679,7 +679,7 @@ LRESULT CALLBACK FFTDlgHandler(HWND hDlg, UINT message, WPARAM wParam, LPARAM lP
 				}
 			*/
 			st->h_pos = -1;
-			if (st->displayWnd) InvalidateRect(st->displayWnd,NULL,TRUE);
+			publish_invalidate(st->displayWnd,TRUE);
 			InvalidateRect(hDlg,NULL,FALSE);
 			break;
 		case IDC_LOADPAL:
@@ -694,7 +694,7 @@ LRESULT CALLBACK FFTDlgHandler(HWND hDlg, UINT message, WPARAM wParam, LPARAM lP
 				reduce_filepath(szFileName,szFileName);
 				strcpy(st->palettefile,szFileName);
 				SetDlgItemText(hDlg, IDC_PALETTEFILE, st->palettefile); 
-				if (st->displayWnd) InvalidateRect(st->displayWnd,NULL,TRUE);
+				publish_invalidate(st->displayWnd,TRUE);
 			  }
 			}
 			InvalidateRect(hDlg,NULL,FALSE);
@@ -702,7 +702,7 @@ LRESULT CALLBACK FFTDlgHandler(HWND hDlg, UINT message, WPARAM wParam, LPARAM lP
 
 		case IDC_FFTBKCOLOR:
 			st->bkcol=select_color(hDlg,st->bkcol);
-			if (st->displayWnd) InvalidateRect(st->displayWnd,NULL,TRUE);
+			publish_invalidate(st->displayWnd,TRUE);
 			InvalidateRect(hDlg,NULL,FALSE);
 			break;
 		case IDC_FFTCAPTIONS:
@@ -1052,15 +1052,51 @@ FFTOBJ::FFTOBJ(int num) : BASE_CL()
 
 	  void FFTOBJ::work(void) 
 	  {
-		int i,bins,startbin,endbin,maxindex; 
-		float powaccu,avgaccu,avgstep;
-		float max;
-
 	    chnBufPos++;  if (chnBufPos>=FFT_BUFFERLEN) chnBufPos=0;
 	    buffer[chnBufPos]=input/100.0f*scale;
 	    fft_interval++;
 	    if (fft_interval>=fft_drawinterval)
 		{
+		  calc_bands();
+          pass_values(0,avgfreq); 
+          pass_values(1,bandpower); 
+          pass_values(2,peakfreq); 
+		  fft_interval=0;
+		}
+		if ((!TIMING.draw_update)&&(!GLOBAL.fly)) publish_invalidate(displayWnd);	
+	  }
+
+	  void FFTOBJ::work_block(int count) 
+	  {
+		float * in;
+		int i;
+
+		in=get_block_input(0,count,&input);
+		for (i=0;i<count;i++)
+		{
+			chnBufPos++;  if (chnBufPos>=FFT_BUFFERLEN) chnBufPos=0;
+			buffer[chnBufPos]=in[i]/100.0f*scale;
+			fft_interval++;
+			if (fft_interval>=fft_drawinterval)
+			{
+			  calc_bands();
+			  pass_block_value(0,i,avgfreq); 
+			  pass_block_value(1,i,bandpower); 
+			  pass_block_value(2,i,peakfreq); 
+			  fft_interval=0;
+			}
+		}
+		if ((block_update_due(BLOCK.draw_update,count))&&(!GLOBAL.fly)) publish_invalidate(displayWnd);	
+	  }
+
+	  //  calculates the spectrum of the channel buffer and the
+	  //  average frequency, power and peak frequency of the selected band
+	  void FFTOBJ::calc_bands(void) 
+	  {
+		int i,bins,startbin,endbin,maxindex; 
+		float powaccu,avgaccu,avgstep;
+		float max;
+
   	      fft_float(chnBufPos, (float *) buffer, window, (float *) fftbands, fft_bin_values[binselect]);
 
 		  powaccu=0;
@@ -1084,14 +1120,9 @@ FFTOBJ::FFTOBJ(int num) : BASE_CL()
 		  }
 		  if (powaccu==0) avgaccu=0.0f; else avgaccu/=powaccu;
 		  // powaccu=powaccu/i;
-          pass_values(0,avgaccu); 
-          pass_values(1,powaccu); 
-          pass_values(2,startband+(float)maxindex*avgstep); 
-
-		  fft_interval=0;
-		}
-		if ((!TIMING.draw_update)&&(!GLOBAL.fly)) InvalidateRect(displayWnd,NULL,FALSE);	
-
+		  avgfreq=avgaccu;
+		  bandpower=powaccu;
+		  peakfreq=startband+(float)maxindex*avgstep;
 	  }
 
 HWND FFTOBJ::create_FFT_Window(int left,int right, int top, int bottom)
@@ -59,6 +59,7 @@ protected:
 	int      scale;
 	int		 fft_drawinterval;
 	float	 fftbands[FFT_BUFFERLEN>>1];
+	float    avgfreq,bandpower,peakfreq;
 	float    tex_buf[128][128];
 	
 	int		 xrot,yrot;
@@ -91,6 +92,8 @@ protected:
 	void save(HANDLE hFile);
 	void incoming_data(int port, float value);
 	void work(void);
+	void work_block(int count);
+	void calc_bands(void);
 	HWND create_FFT_Window(int left,int right, int top, int bottom);
 	~FFTOBJ();
    
@@ -10,6 +10,15 @@
   of signals can be read. Delimiters for the Columns can be selected
   the Signals are fed to the output-ports.
 
+  The ASCII-formats are read line by line from a window of the file
+  (fill_buffer, next_line), the numbers are converted independent of the
+  locale setting (str_to_double). When the file is opened, the header lines
+  and the delimiter are detected from the first line which contains only
+  numbers, the line before gives the names of the columns. The following
+  pass over the file counts the data lines and stores the offset of every
+  FILEREAD_INDEXSTEP'th line, so session_pos() does not have to read the
+  file from the beginning.
+
 
   This program is free software; you can redistribute it and/or
   modify it under the terms of the GNU General Public License
@@ -26,54 +35,41 @@
 
 int open_textarchive(FILE_READEROBJ * st)
 {
-	char tmp1[256],tmp[2];
-	int i,op=0;
 	unsigned int max=0;
-	DWORD dwRead;
+	DWORD sizehigh=0;
+	int i;
 
-	st->file=CreateFile(st->filename, GENERIC_READ,  FILE_SHARE_READ, NULL, OPEN_EXISTING, 0, NULL);
+	if (st->file!=INVALID_HANDLE_VALUE) CloseHandle(st->file);
+	st->file=CreateFile(st->filename, GENERIC_READ,  FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
 
 	 if (st->file==INVALID_HANDLE_VALUE) 
 	 {
 		 strcpy(st->filename,"none");
 		 st->state=0;
+		 st->samplecount=0;
 		 return(0);
 	 }
 
-	 i=0;
-	 if (st->format<5)
-	 {
-	 do 
-	 {
-		 tmp[0]=0;
- 	     ReadFile(st->file,tmp,1,&dwRead,NULL);
-	 }  while ((dwRead!=0) && (tmp[0]!=10));
+	 st->filesize=GetFileSize(st->file,&sizehigh);
+	 st->filesize|=((LONGLONG)sizehigh)<<32;
+	 if (!st->buffer) st->buffer=(char *)malloc(FILEREAD_BUFSIZE+1);
 
-	 i=0;tmp[1]=0;tmp1[0]=0;
-	 do 
+	 if (st->format<5)
 	 {
-		 tmp[0]=0;
- 	     ReadFile(st->file,tmp,1,&dwRead,NULL);
-		 if ((tmp[0]!=13)&&(tmp[0]!=10)&&(tmp[0]!=9)&&(tmp[0]!=','))
-			 strcat(tmp1,tmp);
-		 else if ((tmp[0]==9)||(tmp[0]==',')||(tmp[0]==13))
-		 { 
-			 if (strlen(tmp1)>19) tmp1[19]=0;
-			 if (max<strlen(tmp1)) max=strlen(tmp1);
-
-			 strcpy(st->out_ports[op].out_name,tmp1);
-			 strcpy(st->out_ports[op++].out_desc,tmp1);
-			 tmp1[0]=0;
-		 }
-	 }  while ((dwRead!=0) && (tmp[0]!=10));
-	 if (op>0) st->outports=op;
+		 st->read_header();
+		 st->build_index();
 	 }
 	 else
 	 {
 		 st->outports=1;
 		 strcpy(st->out_ports[0].out_name,"chn1");
+		 st->datastart=0;
+		 st->samplecount=(long)(st->filesize/2);
 	 }
+	 st->session_pos(0);
 
+	 for (i=0;i<st->outports;i++)
+		 if (max<strlen(st->out_ports[i].out_name)) max=strlen(st->out_ports[i].out_name);
 	 st->height=CON_START+st->outports*CON_HEIGHT+5;
 	 if (max<10) max=0; else max-=10;
 	 st->width=70+max*5;
@@ -201,6 +197,12 @@ LRESULT CALLBACK FileReaderDlgHandler( HWND hDlg, UINT message, WPARAM wParam, L
 					if (HIWORD(wParam)==CBN_SELCHANGE)
 					{
 					    st->format=SendMessage(GetDlgItem(hDlg, IDC_FORMATCOMBO), CB_GETCURSEL , 0, 0);		
+						if ((st->file!=INVALID_HANDLE_VALUE)&&(!st->state))
+						{   // the line index depends on the format
+							open_textarchive(st);
+							get_session_length();
+							InvalidateRect(ghWndDesign,NULL,TRUE);
+						}
 					}
 				 break;
 
@@ -234,6 +236,182 @@ FILE_READEROBJ::FILE_READEROBJ(int num) : BASE_CL()
 		state=0; format=0;
 		file=INVALID_HANDLE_VALUE;
 		strcpy(filename,"none");
+
+		buffer=NULL; bufpos=0; buflen=0;
+		bufoffset=0; filesize=0; datastart=0;
+		lineindex=NULL; indexsize=0; indexallocated=0;
+		delimiter='\t';
+		for (int i=0;i<MAX_PORTS;i++) values[i]=0;
+	  }
+
+
+	  //  reads the window at the given file offset
+	  int FILE_READEROBJ::fill_buffer(LONGLONG offset)
+	  {
+		OVERLAPPED ov;
+		DWORD dwRead=0;
+
+		memset(&ov,0,sizeof(ov));
+		ov.Offset=(DWORD)offset;
+		ov.OffsetHigh=(DWORD)(offset>>32);
+		if (!ReadFile(file,buffer,FILEREAD_BUFSIZE,&dwRead,&ov)) dwRead=0;
+		bufoffset=offset; bufpos=0; buflen=dwRead;
+		buffer[buflen]=0;
+		return(buflen);
+	  }
+
+
+	  //  returns the next line (terminated in the window), NULL at the end of the file
+	  char * FILE_READEROBJ::next_line(void)
+	  {
+		char * line, * end;
+
+		if ((bufpos>=buflen) && (!fill_buffer(bufoffset+buflen))) return(NULL);
+
+		end=(char *)memchr(buffer+bufpos,10,buflen-bufpos);
+		if ((!end) && (bufpos>0))
+		{   // the line continues after the window
+			fill_buffer(bufoffset+bufpos);
+			end=(char *)memchr(buffer,10,buflen);
+		}
+
+		line=buffer+bufpos;
+		if (end) { *end=0; bufpos=end-buffer+1; }
+		else bufpos=buflen;
+		return(line);
+	  }
+
+
+	  //  reads the fields of a line into values (up to max), empty fields keep their value.
+	  //  numbers and texts count the fields which are / are not numbers
+	  int FILE_READEROBJ::parse_line(char * line, int max, int * numbers, int * texts)
+	  {
+		const char * p=line, * e;
+		double v;
+		int n=0,text;
+
+		*numbers=0; *texts=0;
+		while (1)
+		{
+			while ((*p==' ')||(*p=='"')) p++;
+			if ((delimiter==' ')&&(n>0)&&((!*p)||(*p=='\r'))) break;
+
+			v=str_to_double(p,&e);
+			if (e!=p)
+			{
+				if (n<max) values[n]=(float)v;
+				(*numbers)++;
+				p=e;
+			}
+			text=0;
+			for (;(*p)&&(*p!=delimiter)&&(*p!='\r');p++)
+				if ((*p!=' ')&&(*p!='"')) text=1;
+			*texts+=text;
+
+			n++;
+			if (*p!=delimiter) break;
+			p++;
+		}
+		return(n);
+	  }
+
+
+	  //  finds the first line which contains only numbers and its delimiter,
+	  //  the line before gives the names of the output ports
+	  void FILE_READEROBJ::read_header(void)
+	  {
+		char header[1024],name[20];
+		char * line, * p, * next;
+		LONGLONG offset;
+		int i,x,columns=0,numbers,texts;
+
+		header[0]=0;
+		datastart=0;
+		fill_buffer(0);
+		if ((buflen>=3)&&(!memcmp(buffer,"\xEF\xBB\xBF",3))) bufpos=3;   // UTF-8 byte order mark
+
+		for (i=0;i<FILEREAD_MAXHEADER;i++)
+		{
+			offset=bufoffset+bufpos;
+			if (!(line=next_line())) break;
+			if (strchr(line,';')) delimiter=';';
+			else if (strchr(line,'\t')) delimiter='\t';
+			else if (strchr(line,',')) delimiter=',';
+			else delimiter=' ';
+
+			columns=parse_line(line,MAX_PORTS,&numbers,&texts);
+			if ((numbers)&&(!texts)) { datastart=offset; break; }
+			strncpy(header,line,sizeof(header)-1);
+			header[sizeof(header)-1]=0;
+			columns=0;
+		}
+
+		if (!columns)
+		{
+			write_logfile("file reader: no data lines found in %s",filename);
+			return;
+		}
+		if (columns>MAX_PORTS) columns=MAX_PORTS;
+		outports=reserve_ports(columns);
+
+		for (x=0,p=header;x<outports;x++)
+		{
+			while ((*p==' ')||(*p=='"')) p++;
+			for (i=0;(p[i])&&(p[i]!=delimiter)&&(p[i]!='\r');i++);
+			next= (p[i]==delimiter) ? p+i+1 : p+i;
+			while ((i>0)&&((p[i-1]==' ')||(p[i-1]=='"'))) i--;
+			if (i>19) i=19;
+			if (i) { memcpy(name,p,i); name[i]=0; }
+			else sprintf(name,"chn%d",x+1);
+			strcpy(out_ports[x].out_name,name);
+			strcpy(out_ports[x].out_desc,name);
+			p=next;
+		}
+	  }
+
+
+	  //  counts the data lines and stores the offset of every FILEREAD_INDEXSTEP'th line
+	  void FILE_READEROBJ::build_index(void)
+	  {
+		LONGLONG offset=datastart;
+		LONGLONG * newindex;
+		char * p, * end;
+		int linestart=TRUE;
+		long lines=0;
+		int size;
+
+		indexsize=0;
+		while (fill_buffer(offset))
+		{
+			p=buffer; end=buffer+buflen;
+			while (p<end)
+			{
+				if (linestart)
+				{
+					if (!(lines%FILEREAD_INDEXSTEP))
+					{
+						if (indexsize>=indexallocated)
+						{
+							size= indexallocated ? indexallocated*2 : 1024;
+							if (!(newindex=(LONGLONG *)realloc(lineindex,size*sizeof(LONGLONG))))
+							{   // keep the index so far, the file is read up to this line
+								samplecount=lines;
+								report_error("File-Reader: not enough memory for the line index, the file is read partly");
+								return;
+							}
+							lineindex=newindex; indexallocated=size;
+						}
+						lineindex[indexsize++]=bufoffset+(p-buffer);
+					}
+					lines++;
+					linestart=FALSE;
+				}
+				if (!(p=(char *)memchr(p,10,end-p))) break;
+				p++; linestart=TRUE;
+			}
+			offset+=buflen;
+		}
+		samplecount=lines;
 	  }
 
 
@@ -269,9 +447,7 @@ FILE_READEROBJ::FILE_READEROBJ(int num) : BASE_CL()
 		  state=0;
 		  if (file!=INVALID_HANDLE_VALUE)
 		  { 
-			  if (format<5)
-			  SetFilePointer(file,0,NULL,FILE_BEGIN);
-			  else SetFilePointer(file,0,NULL,FILE_BEGIN+1);
+			  session_pos(0);
 			  if (hDlg==ghWndToolbox)
 			  {  
 					SetDlgItemText(hDlg,IDC_FILESTATUS, "stopped");
@@ -284,58 +460,24 @@ FILE_READEROBJ::FILE_READEROBJ(int num) : BASE_CL()
 	  }
   	  void FILE_READEROBJ::session_pos(long pos) 
 	  {	
-		  char tmp[2];
-		  DWORD dwRead=1;
-		  long p=0,i=0;
+		  long i;
 
-		  if((pos<0) || (file==INVALID_HANDLE_VALUE)) return;
+		  if((pos<0) || (file==INVALID_HANDLE_VALUE) || (!buffer)) return;
 
-		  if (pos>samplecount) 
+		  if (format>=5) { fill_buffer((LONGLONG)pos*2); return; }
+
+		  if ((pos>=samplecount) || (!indexsize))
 		  {	
-			  SetFilePointer(file,0,NULL,FILE_END);
+			  bufoffset=filesize; bufpos=0; buflen=0;
 			  return;
 		  }
-	  
-		  SetFilePointer(file,0,NULL,FILE_BEGIN);
-
-  		  p=0;tmp[0]=0;
-		  while ((p<pos) && (dwRead))
-		  {
- 			     ReadFile(file,tmp,1,&dwRead,NULL);
-				 if (format<5) { if (tmp[0]==13) p++; }
-				 else {i++; if (i%2) p++; }
-		  }
+		  fill_buffer(lineindex[pos/FILEREAD_INDEXSTEP]);
+		  for (i=pos%FILEREAD_INDEXSTEP;i>0;i--) next_line();
 	  } 
 
 	  long FILE_READEROBJ::session_length(void) 
 	  {
-		  char tmp[2];
-		  DWORD dwRead=1;
-		  long p=0;
-		  int i=0;
-
 		  if (file==INVALID_HANDLE_VALUE) return(0);
-
-		  SetFilePointer(file,0,NULL,FILE_BEGIN);
-
-  		  p=0;tmp[0]=0;
-		  while (dwRead)
-		  {
- 			     ReadFile(file,tmp,1,&dwRead,NULL);
-				 if (format<5) { if (tmp[0]==13) p++; }
-				 else p++;
-		  }
-
-		  SetFilePointer(file,0,NULL,FILE_BEGIN);
-
-		  if (format==4)
-			while ((dwRead)&&(i<2));
-			{
- 			     ReadFile(file,tmp,1,&dwRead,NULL);
-				 if (tmp[0]==13) i++; 
-			}
-
-		  if (format<5) samplecount=p; else samplecount=p/2;
 		  return(samplecount);
 	  }
 
@@ -369,68 +511,40 @@ FILE_READEROBJ::FILE_READEROBJ(int num) : BASE_CL()
 	  
 	  void FILE_READEROBJ::work(void) 
 	  {
-		int x,d;
+		unsigned char * raw;
+		char * line;
+		int x,numbers,texts;
 		float f;
-		char tmp[2],tmp1[256];
-		DWORD dwRead;
-		int s_int;
-		unsigned int u_int;
-	
 	
 		if ((outports==0)||(state==0)||(file==INVALID_HANDLE_VALUE)) return;
 
-	
 		if (format<5)
 		{
- 		  for (x=0;x<outports;x++)
-		  {
-			tmp1[0]=0;tmp[1]=0;
-			do 
+			if (!(line=next_line())) return;
+			parse_line(line,outports,&numbers,&texts);
+			for (x=0;x<outports;x++)
 			{
-				 tmp[0]=0;
- 			     ReadFile(file,tmp,1,&dwRead,NULL);
-				 if (((tmp[0]>='0')&&(tmp[0]<='9'))||(tmp[0]=='.')||(tmp[0]=='-')) 
-					 strcat(tmp1,tmp);
-			}  while ((tmp[0]!=0) && (tmp[0]!=13)&&(tmp[0]!=9)&&(tmp[0]!=','));
-
-			tmp1[strlen(tmp1)]=0;
-
-            if ((format==2)||(format==3)||(format==4))
-			{
-//				SetDlgItemText(ghWndStatusbox,IDC_STATUS,tmp1);
-				sscanf(tmp1,"%f",&f);
-				if (format==4) pass_values(x,f*1000000); else pass_values(x,f);
+				f=values[x];
+				if (format==4) f*=1000000.0f;
+				else if (format<2) f=(float)(int)f;
+				pass_values(x,f);
 			}
-			else 
-			{
-				  sscanf(tmp1,"%d",&d);
-				  pass_values(x,(float)d);
-			}
-		  }
 		}
 		else
 		{
-             ReadFile(file,tmp1,2,&dwRead,NULL);
-			 if (format==5)
-			 {
-				   s_int= (tmp1[1]<<8) + tmp1[0];
-				   f=(float)(s_int);
-			 }
-			 else
-			 {
-				  u_int= (tmp1[1]<<8) + tmp1[0];
-		 	      f=(float)(u_int);
-			 }
-		     pass_values(0,f);
+			if ((bufpos+2>buflen) && (fill_buffer(bufoffset+bufpos)<2)) return;
+			raw=(unsigned char *)buffer+bufpos;
+			bufpos+=2;
+			if (format==5) f=(float)(short)(raw[0]|(raw[1]<<8));
+			else f=(float)(raw[0]|(raw[1]<<8));
+			pass_values(0,f);
 		}
-			
 	  }
 
 
 FILE_READEROBJ::~FILE_READEROBJ()
 	  {	
-		if (file)
-		{
-			CloseHandle(file);
-		}
-	  }  
+		if (file!=INVALID_HANDLE_VALUE) CloseHandle(file);
+		free(buffer);
+		free(lineindex);
+	  }
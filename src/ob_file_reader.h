@@ -10,6 +10,11 @@
   of signals can be read. Delimiters for the Columns can be selected
   the Signals are fed to the output-ports.
 
+  ASCII-files are read through a window of FILEREAD_BUFSIZE bytes. The header
+  lines and the delimiter (TAB, comma, semicolon or blanks) are detected when
+  the file is opened, a line index of every FILEREAD_INDEXSTEP'th data line
+  is built at the same time for positioning the session.
+
 
   This program is free software; you can redistribute it and/or
   modify it under the terms of the GNU General Public License
@@ -21,6 +26,10 @@
 
 #include "brainBay.h"
 
+#define FILEREAD_BUFSIZE    262144      // read window (bytes)
+#define FILEREAD_INDEXSTEP  256         // data lines between two entries of the line index
+#define FILEREAD_MAXHEADER  10          // lines checked for column names
+
 class FILE_READEROBJ : public BASE_CL
 {
 protected:
@@ -33,6 +42,20 @@ public:
 	int  format;
 	long samplecount;
 
+	char * buffer;
+	int  bufpos,buflen;
+	LONGLONG bufoffset,filesize,datastart;
+	LONGLONG * lineindex;
+	long indexsize,indexallocated;
+	char delimiter;
+	float values[MAX_PORTS];
+
+	int  fill_buffer(LONGLONG offset);
+	char * next_line(void);
+	int  parse_line(char * line, int max, int * numbers, int * texts);
+	void read_header(void);
+	void build_index(void);
+
 
     FILE_READEROBJ(int num);
 	void work(void);
@@ -10,6 +10,23 @@
   of the connected signale can be written. Delimiters for the Columns can be selected
   the Signals are connected to the input-ports.
 
+  work() only stores the (averaged) values of a row. The rows are collected in
+  blocks of FILEW_BLOCKROWS rows, a block is queued when it is full or after a
+  second. The writer thread encodes the queued blocks in the format of the file
+  (fileformat, copied when the file is opened, the format combo is disabled
+  while a file is open) and writes them at the end of the file. When the writer
+  thread falls behind by FILEW_QUEUESIZE blocks, the latest block is overwritten
+  and counted as dropped.
+
+  binary formats (float32, little endian):
+  raw float32:  the rows of all values, interleaved
+  NumPy (.npy): version 1.0 header of FILEW_NPYHEADER bytes, shape (rows, columns),
+                the shape is updated every FILEW_HEADERUPDATE blocks
+  columnar:     "BBCOLUMN", int32 version (1), int32 columns, float32 rows/second,
+                columns * char[20] names, followed by chunks of
+                int32 rows, columns * (float32 min, float32 max),
+                columns * rows values (column after column)
+
 
   This program is free software; you can redistribute it and/or
   modify it under the terms of the GNU General Public License
@@ -55,6 +72,8 @@ void updateDialog(HWND hDlg, FILE_WRITEROBJ * st)
 			EnableWindow(GetDlgItem(hDlg, IDC_CLOSE), FALSE);
 		break;
 	}
+	// the format of an open file can't be changed
+	EnableWindow(GetDlgItem(hDlg, IDC_FORMATCOMBO), st->file==INVALID_HANDLE_VALUE);
 	CheckDlgButton(hDlg,IDC_APPEND,st->append);
 	CheckDlgButton(hDlg,IDC_AUTOCREATE,st->autocreate);
 	CheckDlgButton(hDlg,IDC_ADD_DATE,st->add_date);
@@ -93,7 +112,9 @@ int openFile(FILE_WRITEROBJ * st)
 		//printf("new filename is: %s\n",filename);
 	}
 
-	if (!st->append) 
+	st->close_file();
+	st->fileformat=st->format;    // the writer thread keeps this format until the file is closed
+	if ((!st->append) || (st->fileformat>=FILEW_NPY))
 	{
 		st->file=CreateFile(filename, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, 0, NULL);
 	}
@@ -108,14 +129,14 @@ int openFile(FILE_WRITEROBJ * st)
 		return(0);
 	}
 
-	if ((strlen(st->headerline)) && (st->format != 4) && (!st->append))  // write headerline
+	if ((strlen(st->headerline)) && (st->fileformat != 4) && (st->fileformat<FILEW_RAWFLOAT) && (!st->append))  // write headerline
 	{
 		WriteFile(st->file,st->headerline,strlen(st->headerline),&dwWritten,NULL);
 	    wsprintf(tmp,"\r\n");
 		WriteFile(st->file,tmp,strlen(tmp),&dwWritten,NULL);
 	}
 
-	if (st->format==4) // bioexplorer format: write bioexplorer header!
+	if (st->fileformat==4) // bioexplorer format: write bioexplorer header!
 	{ 
 		int i,a;
 
@@ -139,6 +160,39 @@ int openFile(FILE_WRITEROBJ * st)
 		if ((!st->append)||(filesize<10))
 		WriteFile(st->file,tmp,strlen(tmp),&dwWritten,NULL);
 	}
+
+	st->columns=st->inports-1;
+	if (st->columns<1) st->columns=1;
+	st->written=0;
+	if (st->fileformat==FILEW_NPY) st->write_npyheader();
+	if (st->fileformat==FILEW_COLUMNAR)
+	{
+		int version=1,i;
+		float rate=(float)PACKETSPERSECOND/(st->averaging>0 ? st->averaging : 1);
+		char name[20];
+
+		WriteFile(st->file,"BBCOLUMN",8,&dwWritten,NULL);
+		WriteFile(st->file,&version,4,&dwWritten,NULL);
+		WriteFile(st->file,&st->columns,4,&dwWritten,NULL);
+		WriteFile(st->file,&rate,4,&dwWritten,NULL);
+		for (i=0;i<st->columns;i++)
+		{
+			memset(name,0,sizeof(name));
+			strncpy(name,st->in_ports[i].in_desc,sizeof(name)-1);
+			WriteFile(st->file,name,sizeof(name),&dwWritten,NULL);
+		}
+	}
+
+	LONG high=0;
+	DWORD low=SetFilePointer(st->file,0,&high,FILE_END);
+	st->fileend=((LONGLONG)high<<32)|low;
+	if (!st->start_writer())
+	{
+		CloseHandle(st->file);
+		st->file=INVALID_HANDLE_VALUE;
+		st->state=STATE_FILE_IDLE;
+		return(0);
+	}
 	st->state=STATE_FILE_OPEN;	
 	return(1);
 }
@@ -163,6 +217,9 @@ LRESULT CALLBACK FileWriterDlgHandler( HWND hDlg, UINT message, WPARAM wParam, L
 				SendDlgItemMessage(hDlg,IDC_FORMATCOMBO,CB_ADDSTRING,0,(LPARAM) (LPSTR) "ASCII-BioExplorer with header");
 				SendDlgItemMessage(hDlg,IDC_FORMATCOMBO,CB_ADDSTRING,0,(LPARAM) (LPSTR) "1-Channel raw integer 16bit signed");
 				SendDlgItemMessage(hDlg,IDC_FORMATCOMBO,CB_ADDSTRING,0,(LPARAM) (LPSTR) "1-Channel raw integer 16bit unsigned");
+				SendDlgItemMessage(hDlg,IDC_FORMATCOMBO,CB_ADDSTRING,0,(LPARAM) (LPSTR) "Binary float32, interleaved (little endian)");
+				SendDlgItemMessage(hDlg,IDC_FORMATCOMBO,CB_ADDSTRING,0,(LPARAM) (LPSTR) "NumPy array (.npy), float32");
+				SendDlgItemMessage(hDlg,IDC_FORMATCOMBO,CB_ADDSTRING,0,(LPARAM) (LPSTR) "Columnar float32 chunks with min/max");
 				SendDlgItemMessage(hDlg, IDC_FORMATCOMBO, CB_SETCURSEL, st->format, 0L ) ;
 				updateDialog(hDlg, st);
 				return TRUE;
@@ -232,11 +289,16 @@ LRESULT CALLBACK FileWriterDlgHandler( HWND hDlg, UINT message, WPARAM wParam, L
 					}
 					if (open_file_dlg(ghWndMain,st->filename, FT_TXT, OPEN_SAVE))
 					{
+						 // work() must be finished before the queue is replaced
+						 int sav_pause;
+						 st->state=STATE_FILE_IDLE;
+						 sav_pause=pause_processing();
 						 if (!openFile(st)) 
 						 {
 							 SetDlgItemText(hDlg,IDC_FILESTATUS,"Could not create File");
 							 strcpy(st->filename,"none");
 						 }
+						 resume_processing(sav_pause);
 					}
 					updateDialog(hDlg, st);
 
@@ -277,11 +339,15 @@ LRESULT CALLBACK FileWriterDlgHandler( HWND hDlg, UINT message, WPARAM wParam, L
 				break; 
 
 			case IDC_CLOSE: 
-					if (st->file!=INVALID_HANDLE_VALUE) CloseHandle(st->file);
-					st->file=INVALID_HANDLE_VALUE;
+				{   // work() must be finished before the last block is queued
+					int sav_pause;
 					st->state=STATE_FILE_IDLE;
+					sav_pause=pause_processing();
+					st->close_file();
+					resume_processing(sav_pause);
 					updateDialog(hDlg, st);
-					break;
+				}
+				break;
 
 			case IDC_FORMATCOMBO:
 					if (HIWORD(wParam)==CBN_SELCHANGE)
@@ -318,7 +384,7 @@ FILE_WRITEROBJ::FILE_WRITEROBJ(int num) : BASE_CL()
 
 
 		state=STATE_FILE_IDLE; 
-		format=0;
+		format=0; fileformat=0;
 		append=FALSE;
 		autocreate=FALSE;
 		add_date=FALSE;
@@ -327,6 +393,13 @@ FILE_WRITEROBJ::FILE_WRITEROBJ(int num) : BASE_CL()
 		for (int i=0;i<MAX_PORTS;i++)
 			averaging_buffers[i]=0;
 
+		queue=NULL; encodebuf=NULL; columns=0;
+		qhead=qtail=qcount=0; packets=0;
+		dropped=0; written=0; fileend=0;
+		writeerror=0; lastflush=0;
+		writethread=NULL; writeevent=NULL; writeexit=0;
+		InitializeCriticalSection(&cs);
+
 		file=INVALID_HANDLE_VALUE;
 		strcpy(filename,"none");
 		strcpy(headerline,"");
@@ -397,8 +470,7 @@ FILE_WRITEROBJ::FILE_WRITEROBJ(int num) : BASE_CL()
 
 	  void FILE_WRITEROBJ::session_stop(void)
 	  {
-			if (file!=INVALID_HANDLE_VALUE) CloseHandle(file);
-			file=INVALID_HANDLE_VALUE;
+			close_file();
 			state=STATE_FILE_IDLE;
 	  }
 
@@ -413,69 +485,244 @@ FILE_WRITEROBJ::FILE_WRITEROBJ(int num) : BASE_CL()
 		averaging_buffers[port]+=value;
 	  }
 	  
-	  void FILE_WRITEROBJ::work(void) 
+DWORD WINAPI FileWriterProc(LPVOID lpv)
+{
+	((FILE_WRITEROBJ *)lpv)->write_blocks();
+	return(0);
+}
+
+	  int FILE_WRITEROBJ::start_writer(void)
 	  {
-		int x;
-		char sztemp[100];
-		
-		if ((inports==0)||(state!=STATE_FILE_WRITING)||(file==INVALID_HANDLE_VALUE)) return;
+		DWORD dwThreadId;
 
-		if (++avg_count>=averaging) 
+		stop_writer();
+		free(queue); free(encodebuf);
+		queue=(float *)malloc(FILEW_QUEUESIZE*FILEW_BLOCKROWS*columns*sizeof(float));
+		encodebuf=(char *)malloc(FILEW_BLOCKROWS*(columns*FILEW_MAXTEXT+2)+4+columns*2*sizeof(float));
+		if ((!queue) || (!encodebuf))
 		{
-			avg_count=0;
+			report_error("Could not allocate the buffers of the file writer");
+			return(FALSE);
+		}
+		qhead=0; qtail=0; qcount=0; packets=0;
+		blockrows[0]=0;
+		dropped=0; writeerror=0; writeexit=0;
+		lastflush=GetTickCount();
+		writeevent=CreateEvent(NULL,FALSE,FALSE,NULL);
+		writethread=CreateThread(NULL, 0, (LPTHREAD_START_ROUTINE) FileWriterProc, this, 0, &dwThreadId);
+		if (!writethread)
+		{
+			CloseHandle(writeevent);
+			report_error("Could not create file writer thread");
+			return(FALSE);
+		}
+		return(TRUE);
+	  }
 
-			for (x=0;x<inports-1;x++)
+	  //  writes the queued blocks and ends the writer thread
+	  void FILE_WRITEROBJ::stop_writer(void)
+	  {
+		if (!writethread) return;
+		writeexit=1;
+		SetEvent(writeevent);
+		WaitForSingleObject(writethread,INFINITE);
+		CloseHandle(writethread);
+		CloseHandle(writeevent);
+		writethread=NULL;
+		if (fileformat==FILEW_NPY) write_npyheader();
+		write_logfile("File writer: %ld rows written, %ld blocks dropped",(long)written,dropped);
+		if (writeerror) report_error("Could not write to the file");
+	  }
+
+	  //  queues the actual block, called by the processing thread
+	  void FILE_WRITEROBJ::queue_block(void)
+	  {
+		packets=0;
+		if (!blockrows[qhead]) return;
+		EnterCriticalSection(&cs);
+		if (qcount+1<FILEW_QUEUESIZE)
+		{
+			qhead=(qhead+1)%FILEW_QUEUESIZE;
+			qcount++;
+		}
+		else dropped++;      // the writer thread is behind: the block is overwritten
+		LeaveCriticalSection(&cs);
+		blockrows[qhead]=0;
+		SetEvent(writeevent);
+	  }
+
+	  //  writer thread
+	  void FILE_WRITEROBJ::write_blocks(void)
+	  {
+		DWORD now;
+		int exit;
+
+		do
+		{
+			WaitForSingleObject(writeevent,INFINITE);
+			exit=writeexit;
+			while (qcount)
 			{
-				in_ports[x].value=averaging_buffers[x]/averaging;
-				averaging_buffers[x]=0;
+				if ((!writeerror) && (!write_block(queue+qtail*FILEW_BLOCKROWS*columns,blockrows[qtail])))
+					writeerror=GetLastError();
+				EnterCriticalSection(&cs);
+				qtail=(qtail+1)%FILEW_QUEUESIZE;
+				qcount--;
+				LeaveCriticalSection(&cs);
+			}
+			now=GetTickCount();
+			if ((GLOBAL.record_flush==FLUSH_SECOND) && (now-lastflush>=1000))
+			{
+				FlushFileBuffers(file);
+				lastflush=now;
+			}
+		} while (!exit);
+	  }
 
-				if ((format==0) || (format==1))
-  				   wsprintf(sztemp,"%d",(int)in_ports[x].value);
-				else if ((format==2) || (format==3))
-  				   sprintf(sztemp,"%.2f",in_ports[x].value);
-				else if (format==4)
-				{
-					sprintf(sztemp,"%.11f",in_ports[x].value/1000000);
-				}
-			
-				if (format<5)
+	  int FILE_WRITEROBJ::write_at(LONGLONG pos, void * data, DWORD size)
+	  {
+		OVERLAPPED ov;
+		DWORD dwWritten;
+
+		memset(&ov,0,sizeof(ov));
+		ov.Offset=(DWORD)pos;
+		ov.OffsetHigh=(DWORD)(pos>>32);
+		return((WriteFile(file,data,size,&dwWritten,&ov)) && (dwWritten==size));
+	  }
+
+	  //  encodes the rows of a block and writes them at the end of the file
+	  int FILE_WRITEROBJ::write_block(float * rows, int count)
+	  {
+		char * p=encodebuf;
+		float * v, * minmax;
+		int i,x;
+
+		switch (fileformat)
+		{
+			case FILEW_RAWFLOAT:
+			case FILEW_NPY:
+				p=(char *)rows;
+				i=count*columns*sizeof(float);
+				break;
+
+			case FILEW_COLUMNAR:
+				*(int *)p=count;
+				minmax=(float *)(p+4);
+				v=minmax+columns*2;
+				for (x=0;x<columns;x++)
 				{
-					if (x<inports-2)
+					minmax[x*2]=minmax[x*2+1]=rows[x];
+					for (i=0;i<count;i++)
 					{
-					  if ((format==0) || (format==2)) strcat(sztemp,"\t");
-					  else if ((format==1) || (format==3)) strcat(sztemp,", ");
-					  else if (format==4) strcat(sztemp,",");
+						*v=rows[i*columns+x];
+						if (*v<minmax[x*2]) minmax[x*2]=*v;
+						if (*v>minmax[x*2+1]) minmax[x*2+1]=*v;
+						v++;
 					}
-					WriteFile(file,sztemp,strlen(sztemp),&dwWritten,NULL);
 				}
+				i=(char *)v-p;
+				break;
 
-				if ((format==5)&&(x==0))
+			case 5:
+			case 6:
+				for (i=0;i<count;i++)
 				{
-					sztemp[0]= (((int)in_ports[x].value) >> 8);
-					sztemp[1]= (((int)in_ports[x].value) & 0xff);
-					WriteFile(file,sztemp,2,&dwWritten,NULL);
+					if (fileformat==5) x=(int)rows[i*columns]; else x=(int)(unsigned int)rows[i*columns];
+					*p++=(char)(x >> 8);
+					*p++=(char)(x & 0xff);
 				}
-				if ((format==6)&&(x==0))
+				i=p-encodebuf; p=encodebuf;
+				break;
+
+			default:
+				for (i=0,v=rows;i<count;i++)
 				{
-					sztemp[0]= (((unsigned int)in_ports[x].value) >> 8);
-					sztemp[1]= (((unsigned int)in_ports[x].value) & 0xff);
-					WriteFile(file,sztemp,2,&dwWritten,NULL);
+					for (x=0;x<columns;x++,v++)
+					{
+						if ((fileformat==0) || (fileformat==1))
+							p+=wsprintf(p,"%d",(int)*v);
+						else if ((fileformat==2) || (fileformat==3))
+							p+=sprintf(p,"%.2f",*v);
+						else
+							p+=sprintf(p,"%.11f",*v/1000000);
+
+						if (x<columns-1)
+						{
+							if ((fileformat==0) || (fileformat==2)) *p++='\t';
+							else if ((fileformat==1) || (fileformat==3)) { *p++=','; *p++=' '; }
+							else *p++=',';
+						}
+					}
+					*p++=13; *p++=10;
 				}
-			
-			}
-			if (format<5)
+				i=p-encodebuf; p=encodebuf;
+				break;
+		}
+
+		if (!write_at(fileend,p,i)) return(FALSE);
+		fileend+=i;
+		written+=count;
+		if ((fileformat==FILEW_NPY) && ((written-count)/(FILEW_BLOCKROWS*FILEW_HEADERUPDATE)!=written/(FILEW_BLOCKROWS*FILEW_HEADERUPDATE)))
+			write_npyheader();
+		if (GLOBAL.record_flush==FLUSH_BUFFER) FlushFileBuffers(file);
+		return(TRUE);
+	  }
+
+	  //  writes the .npy header with the actual number of rows
+	  void FILE_WRITEROBJ::write_npyheader(void)
+	  {
+		char header[FILEW_NPYHEADER];
+		int len;
+
+		if (file==INVALID_HANDLE_VALUE) return;
+		memset(header,' ',sizeof(header));
+		memcpy(header,"\x93NUMPY\x01\x00",8);
+		header[8]=(char)((FILEW_NPYHEADER-10)&0xff);
+		header[9]=(char)((FILEW_NPYHEADER-10)>>8);
+		len=sprintf(header+10,"{'descr': '<f4', 'fortran_order': False, 'shape': (%I64d, %d), }",written,columns);
+		header[10+len]=' ';
+		header[FILEW_NPYHEADER-1]=10;
+		write_at(0,header,FILEW_NPYHEADER);
+	  }
+
+	  void FILE_WRITEROBJ::close_file(void)
+	  {
+		if (file==INVALID_HANDLE_VALUE) return;
+		if (writethread) queue_block();
+		stop_writer();
+		CloseHandle(file);
+		file=INVALID_HANDLE_VALUE;
+	  }
+
+	  void FILE_WRITEROBJ::work(void) 
+	  {
+		float * row;
+		int x;
+		
+		if ((inports==0)||(state!=STATE_FILE_WRITING)||(file==INVALID_HANDLE_VALUE)||(!queue)) return;
+
+		if (++avg_count>=averaging) 
+		{
+			avg_count=0;
+
+			row=queue+(qhead*FILEW_BLOCKROWS+blockrows[qhead])*columns;
+			for (x=0;x<inports-1;x++)
 			{
-			  wsprintf(sztemp,"\r\n");
-			  WriteFile(file,sztemp,strlen(sztemp),&dwWritten,NULL);
+				in_ports[x].value=averaging_buffers[x]/averaging;
+				averaging_buffers[x]=0;
+				if (x<columns) row[x]=in_ports[x].value;
 			}
-		  }
+			for (;x<columns;x++) row[x]=0;
+			if (++blockrows[qhead]==FILEW_BLOCKROWS) queue_block();
+		}
+		if (++packets>=PACKETSPERSECOND) queue_block();
 	  }
 
 
 FILE_WRITEROBJ::~FILE_WRITEROBJ()
 	  {	
-		if (file)
-		{
-			CloseHandle(file);
-		}
-	  }  
+		close_file();
+		free(queue);
+		free(encodebuf);
+		DeleteCriticalSection(&cs);
+	  }
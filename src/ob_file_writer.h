@@ -9,6 +9,7 @@
   Using this Object, a File containing raw or ASCII-integer values 
   of the connected signale can be written. Delimiters for the Columns can be selected
   the Signals are connected to the input-ports.
+  The rows are collected in blocks, encoded and written by a writer thread.
 
 
   This program is free software; you can redistribute it and/or
@@ -21,6 +22,16 @@
 
 #include "brainBay.h"
 
+#define FILEW_BLOCKROWS     256     // rows of one block (= one chunk of the columnar format)
+#define FILEW_QUEUESIZE     16      // blocks waiting for the writer thread
+#define FILEW_HEADERUPDATE  16      // full blocks of rows between two updates of the .npy shape
+#define FILEW_NPYHEADER     128     // bytes of the .npy header
+#define FILEW_MAXTEXT       64      // characters of one value in the text formats
+
+#define FILEW_RAWFLOAT      7       // float32 little endian, interleaved
+#define FILEW_NPY           8       // NumPy array (rows, columns), float32
+#define FILEW_COLUMNAR      9       // chunks of columns with min/max
+
 class FILE_WRITEROBJ : public BASE_CL
 {
 protected:
@@ -32,6 +43,7 @@ public:
 	char headerline[500];
 	int  state;
 	int  format;
+	int  fileformat;              // format of the open file, copied by openFile
 	int  append;
 	int  autocreate;
 	int  add_date;
@@ -39,10 +51,33 @@ public:
 	float averaging_buffers[MAX_PORTS];
 	int  avg_count;
 
+	float  * queue;               // FILEW_QUEUESIZE blocks of FILEW_BLOCKROWS rows
+	int    blockrows[FILEW_QUEUESIZE];
+	int    columns;               // values of a row
+	int    qhead,qtail;
+	volatile int qcount;          // blocks waiting for the writer thread
+	int    packets;               // packets since the last block was queued
+	char   * encodebuf;           // one encoded block
+	long   dropped;               // blocks
+	LONGLONG written;             // rows in the file
+	LONGLONG fileend;
+	DWORD  writeerror,lastflush;
+	HANDLE writethread,writeevent;
+	volatile int writeexit;
+	CRITICAL_SECTION cs;
+
     FILE_WRITEROBJ(int num);
 	void update_inports(void);
 	void work(void);
 	void incoming_data(int port, float value);
+	int  start_writer(void);
+	void stop_writer(void);
+	void queue_block(void);
+	void write_blocks(void);
+	int  write_block(float * rows, int count);
+	int  write_at(LONGLONG pos, void * data, DWORD size);
+	void write_npyheader(void);
+	void close_file(void);
 	void make_dialog(void);
 	void load(HANDLE hFile);
 	void save(HANDLE hFile);
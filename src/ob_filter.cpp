@@ -384,6 +384,17 @@ FILTEROBJ::FILTEROBJ(int num) : BASE_CL()
 	     pass_values(0,x); 
 	  }
 
+	  void FILTEROBJ::work_block(int count) 
+	  {  
+		 float * in, out[MAX_BLOCKSIZE];
+		 int i;
+
+		 in=get_block_input(0,count,&input);
+		 for (i=0;i<count;i++)
+			 out[i]=(float)(funcp(fbuf,(double)in[i]));
+	     pass_block(0,out,count); 
+	  }
+
 
 FILTEROBJ::~FILTEROBJ()
 	  {
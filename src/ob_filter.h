@@ -65,6 +65,7 @@ class FILTEROBJ : public BASE_CL
 	void save(HANDLE hFile);
 	void incoming_data(int port, float value);
 	void work(void);
+	void work_block(int count);
 	~FILTEROBJ();
 
    
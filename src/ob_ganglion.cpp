@@ -729,12 +729,12 @@ void GANGLIONOBJ::update_channelinfo(void)
 		if ((filehandle!=INVALID_HANDLE_VALUE) && (filemode == FILE_READING))
 		{
 			ReadFile(filehandle,intbuffer,sizeof(int)*5, &dwRead, NULL);
-			if (dwRead != sizeof(int)*5) SendMessage (ghWndStatusbox,WM_COMMAND,IDC_STOPSESSION,0);
+			if (dwRead != sizeof(int)*5) publish_command(ghWndStatusbox,IDC_STOPSESSION);
 			else 
 			{
 				DWORD x= SetFilePointer(filehandle,0,NULL,FILE_CURRENT);
 				x=x*1000/filelength/sizeof(int)*5  ; //TTY.bytes_per_packet;
-				SetScrollPos(GetDlgItem(ghWndStatusbox, IDC_SESSIONPOS), SB_CTL, x, 1);
+				publish_scroll_pos(ghWndStatusbox, IDC_SESSIONPOS, x);
 			}
 		}
 
@@ -749,7 +749,7 @@ void GANGLIONOBJ::update_channelinfo(void)
 		/*
 		if ((!TIMING.dialog_update) && (hDlg==ghWndToolbox)) 
 		{
-			InvalidateRect(hDlg,NULL,FALSE);
+			publish_invalidate(hDlg);
 		}
 		*/
 	}
@@ -89,7 +89,7 @@ void KEYCAPTUREOBJ::work(void)
 
 	if ((!TIMING.dialog_update) && (hDlg==ghWndToolbox)) 
 	{
-		SetDlgItemInt(hDlg, IDC_ACTKEY, GLOBAL.pressed_key, 0); 
+		publish_dlg_int(hDlg, IDC_ACTKEY, GLOBAL.pressed_key, 0); 
 	}
 
 }
@@ -322,6 +322,7 @@ void KEYSTRIKEOBJ::work(void)
 			keybd_event(get_vk(keylist[i]),MapVirtualKey(get_vk(keylist[i]),0) , get_fl(keylist[i]),0); 
 			//keybd_event(get_vk(keylist[i]),0, KEYEVENTF_EXTENDEDKEY,0); 
 		}
+		record_latency(this);
 		
 	}
 
@@ -66,6 +66,25 @@ void LIMITEROBJ::work(void)
 	pass_values(0, actval);
 }
 
+void LIMITEROBJ::work_block(int count)
+{
+	float * in, out[MAX_BLOCKSIZE];
+	int i;
+
+	in=get_block_input(0,count,&actval);
+	for (i=0;i<count;i++)
+	{
+		out[i]=in[i];
+		if (out[i]!=INVALID_VALUE)
+		{
+			if (out[i]>upper) out[i]=upper;
+			if (out[i]<lower) out[i]=lower;
+		}
+	}
+	actval=out[count-1];
+	pass_block(0, out, count);
+}
+
 
 LIMITEROBJ::~LIMITEROBJ() {}
 
@@ -30,6 +30,7 @@ class LIMITEROBJ : public BASE_CL
 	void incoming_data(int port, float value);
 	void save(HANDLE hFile);
 	void work(void);
+	void work_block(int count);
 	~LIMITEROBJ();
 
 	friend LRESULT CALLBACK LimiterDlgHandler(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam);
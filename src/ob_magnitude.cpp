@@ -295,6 +295,25 @@ MAGNITUDEOBJ::MAGNITUDEOBJ(int num) : BASE_CL()
 		pass_values(0,(float)(2*sqrt(sig1*sig1+sig2*sig2)*gain/100.0f));
       }
 
+      void MAGNITUDEOBJ::work_block(int count)
+      {
+        float sig1,sig2,* in,out[MAX_BLOCKSIZE];
+		int i;
+
+		in=get_block_input(0,count,&input);
+		for (i=0;i<count;i++)
+		{
+			sig1=(float)sin(BLOCK.packetcounter[i]*2*DDC_PI/PACKETSPERSECOND*center)*(in[i]);
+			sig2=(float)cos(BLOCK.packetcounter[i]*2*DDC_PI/PACKETSPERSECOND*center)*(in[i]);
+
+			sig1= (float)(lp1funcp(lp1fbuf,sig1));
+			sig2= (float)(lp2funcp(lp2fbuf,sig2));
+
+			out[i]=(float)(2*sqrt(sig1*sig1+sig2*sig2)*gain/100.0f);
+		}
+		pass_block(0,out,count);
+      }
+
 
 
 
@@ -59,6 +59,7 @@ class MAGNITUDEOBJ : public BASE_CL
 	void save(HANDLE hFile);
 	void incoming_data(int port, float value);
 	void work(void);
+	void work_block(int count);
 	~MAGNITUDEOBJ();
 
  };
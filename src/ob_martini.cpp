@@ -510,7 +510,7 @@ MARTINIOBJ::MARTINIOBJ(int num) : BASE_CL()
 
 		if (GLOBAL.fly) return;
 
-		if( redrawcnt++ > 50) {redrawcnt=0; redraw=0; InvalidateRect(displayWnd,NULL,FALSE); }
+		if( redrawcnt++ > 50) {redrawcnt=0; redraw=0; publish_invalidate(displayWnd); }
 
 		if (pump1cnt)  
 		{ 
@@ -552,7 +552,7 @@ MARTINIOBJ::MARTINIOBJ(int num) : BASE_CL()
 					pass_values(0,16+32);
 					state=2; 
 
-					redraw=1; InvalidateRect(displayWnd,NULL,FALSE);
+					redraw=1; publish_invalidate(displayWnd);
 				}
 			}
 
@@ -582,7 +582,7 @@ MARTINIOBJ::MARTINIOBJ(int num) : BASE_CL()
 			if (cnt1>2200) 
 			{	
 				state=0;
-				redraw=1; InvalidateRect(displayWnd,NULL,FALSE);
+				redraw=1; publish_invalidate(displayWnd);
 
 				cnt1=0;
 
@@ -350,7 +350,7 @@ if (periodic)
 			if (engPutVariable(ep, "A", A))
 			{
 				cn++;
-				SetDlgItemInt(ghWndStatusbox,IDC_STATUS,cn,0);
+				publish_dlg_int(ghWndStatusbox,IDC_STATUS,cn,0);
 			}
 
 		default:
@@ -451,6 +451,7 @@ MIDIOBJ::MIDIOBJ(int num) : BASE_CL()
 				  		temp=acttone-n_tones;
 						if (temp<0) temp=temp+MAX_MIDITONES;
 						if (instrument<128) midi_NoteOff(&(MIDIPORTS[port].midiout),midichn,tonebuffer[temp]);
+						record_latency(this);
 					}
 					sum_note=0.0f;
 					sum_volume=0.0f;
@@ -463,8 +464,8 @@ MIDIOBJ::MIDIOBJ(int num) : BASE_CL()
 
 		if ((hDlg==ghWndToolbox)&&(!TIMING.dialog_update))
 		{
-  			SetScrollPos(GetDlgItem(hDlg,IDC_MIDITIMERBAR), SB_CTL,timer,TRUE);
-			SetDlgItemInt(hDlg,IDC_MIDITIMER,timer,0);
+  			publish_scroll_pos(hDlg,IDC_MIDITIMERBAR,timer);
+			publish_dlg_int(hDlg,IDC_MIDITIMER,timer,0);
 		}
 
 	  }
@@ -25,7 +25,7 @@ MINOBJ::MINOBJ(int num) : BASE_CL()
 	outports = 1;
 	inports = 1;
 	width=65;
-	for (t=0;t<MAX_PORTS;t++) sprintf(in_ports[t].in_name,"in%d",t+1);
+	for (t=0;t<port_count;t++) sprintf(in_ports[t].in_name,"in%d",t+1);
 
 	strcpy(in_ports[0].in_name,"in1");
 	strcpy(out_ports[0].out_name,"min");
@@ -237,5 +237,41 @@ void MIXER4OBJ::work(void)
 
 	pass_values(0, result);
 }
+
+void MIXER4OBJ::work_block(int count)
+{
+	float * in1, * in2, * in3, * in4, out[MAX_BLOCKSIZE];
+	int i;
+
+	in1=get_block_input(0,count,&input1);
+	in2=get_block_input(1,count,&input2);
+	in3=get_block_input(2,count,&input3);
+	in4=get_block_input(3,count,&input4);
+
+	for (i=0;i<count;i++)
+	{
+		float result=0;
+
+		if (in1[i] != INVALID_VALUE) result+=in1[i]*chn1vol/100.0f;
+		if (in2[i] != INVALID_VALUE) result+=in2[i]*chn2vol/100.0f;
+		if (in3[i] != INVALID_VALUE) result+=in3[i]*chn3vol/100.0f;
+		if (in4[i] != INVALID_VALUE) result+=in4[i]*chn4vol/100.0f;
+
+		if (invmode==1)
+			if ( ((chn1vol!=0) && (in1[i]==INVALID_VALUE)) &&
+				((chn2vol!=0) && (in2[i]==INVALID_VALUE)) &&
+				((chn3vol!=0) && (in3[i]==INVALID_VALUE)) &&
+				((chn4vol!=0) && (in4[i]==INVALID_VALUE)) )  result=INVALID_VALUE;
+
+		if (invmode==2)
+			if ( ((chn1vol!=0) && (in1[i]==INVALID_VALUE)) ||
+				((chn2vol!=0) && (in2[i]==INVALID_VALUE)) ||
+				((chn3vol!=0) && (in3[i]==INVALID_VALUE)) ||
+				((chn4vol!=0) && (in4[i]==INVALID_VALUE)) )  result=INVALID_VALUE;
+
+		out[i]=result;
+	}
+	pass_block(0, out, count);
+}
 	
 MIXER4OBJ::~MIXER4OBJ() {}
@@ -41,6 +41,7 @@ class MIXER4OBJ : public BASE_CL
 	void incoming_data(int port, float value);
 	
 	void work(void);
+	void work_block(int count);
 	
 	~MIXER4OBJ();
 };
@@ -507,7 +507,10 @@ void MOUSEOBJ::work(void)
 		if (ypos!= INVALID_VALUE) p.y = (int)ypos;
 
 		if (!bypass_pos)
+		{
 		  mouse_input(MOUSEEVENTF_MOVE|MOUSEEVENTF_ABSOLUTE|0x4000,(LONG)xpos * 70,(LONG)ypos * 85);
+		  record_latency(this);
+		}
 						
 		if (enable_dwelling) 
 		{
@@ -599,19 +602,19 @@ void MOUSEOBJ::work(void)
 	{
 		if (hDlg=ghWndToolbox)
 		{
-			SetDlgItemInt(hDlg,IDC_ACT_X,(int)(xpos),FALSE); //*3.76f
-			SetDlgItemInt(hDlg,IDC_ACT_Y,(int)(ypos),FALSE); // *1.56f
+			publish_dlg_int(hDlg,IDC_ACT_X,(int)(xpos),FALSE); //*3.76f
+			publish_dlg_int(hDlg,IDC_ACT_Y,(int)(ypos),FALSE); // *1.56f
 		}
 
 		if (hWndClick)
 		{
 			if(setdouble)
-				SetDlgItemText(hWndClick, IDC_NEXTCLICK,"   ------------------");
+				publish_dlg_text(hWndClick, IDC_NEXTCLICK,"   ------------------");
 			else if (setright)
-					SetDlgItemText(hWndClick, IDC_NEXTCLICK,"                          ------------------");
+					publish_dlg_text(hWndClick, IDC_NEXTCLICK,"                          ------------------");
 			else if (setdrag)
-					SetDlgItemText(hWndClick, IDC_NEXTCLICK,"                                                 -----------------");
-			else SetDlgItemText(hWndClick, IDC_NEXTCLICK," ");
+					publish_dlg_text(hWndClick, IDC_NEXTCLICK,"                                                 -----------------");
+			else publish_dlg_text(hWndClick, IDC_NEXTCLICK," ");
 		}
 	}
 
@@ -823,12 +823,12 @@ NEUROBITOBJ::NEUROBITOBJ(int num) : BASE_CL()
 			if ((filehandle!=INVALID_HANDLE_VALUE) && (filemode == FILE_READING))
 			{
 				ReadFile(filehandle,current_chn,sizeof(float)*4, &dwRead, NULL);
-				if (dwRead != sizeof(float)*4) SendMessage (ghWndStatusbox,WM_COMMAND,IDC_STOPSESSION,0);
+				if (dwRead != sizeof(float)*4) publish_command(ghWndStatusbox,IDC_STOPSESSION);
 				else 
 				{
 					DWORD x= SetFilePointer(filehandle,0,NULL,FILE_CURRENT);
 					x=x*1000/filelength/TTY.bytes_per_packet;
-					SetScrollPos(GetDlgItem(ghWndStatusbox, IDC_SESSIONPOS), SB_CTL, x, 1);
+					publish_scroll_pos(ghWndStatusbox, IDC_SESSIONPOS, x);
 				}
 			}
 			
@@ -842,7 +842,7 @@ NEUROBITOBJ::NEUROBITOBJ(int num) : BASE_CL()
 
 			if ((!TIMING.dialog_update) && (hDlg==ghWndToolbox)) 
 			{
-				InvalidateRect(hDlg,NULL,FALSE);
+				publish_invalidate(hDlg);
 			}
 
 	  }
@@ -6,7 +6,9 @@
   Author: Chris Veigl
 
   The OSCI-Object has its own window, it uses GDI-drawings. 
-  draw_osci: draws all used channels of the oscilloscope
+  draw_osci: draws all used channels of the oscilloscope. work() writes the new
+			 pixels into the back buffer (pixelbuffer), draw_osci swaps it with the
+			 front buffer (pixelcopy) under the critical section of the element
   OsciboxDlgHandler: processes the events for the OSCI-toolbox window
   OsciWndHandler: processes the events for the OSCI-drawing window
 
@@ -94,7 +96,7 @@ void draw_osci(OSCIOBJ * st)
 	HDC hdc;
 	RECT rect,txtpos,clr;
 	TCHAR szdata[50];
-	float  pbuf[MAX_EEG_CHANNELS][LEN_PIXELBUFFER];
+	float  (* pbuf)[LEN_PIXELBUFFER];
 	float oscitime,sec_total;
 	int t,i,d,x,y,top,np,count,space;
 	int  half_chn_height,channel_mid,upper,lower;
@@ -107,7 +109,6 @@ void draw_osci(OSCIOBJ * st)
     hdc = BeginPaint (st->displayWnd, &ps);
 	GetClientRect(st->displayWnd, &rect);
     top=(WORD) rect.top+2;
-
 	SetBkColor(hdc,st->bkcol);
 	count=st->inports-1;
 	if (count<1) count=1;
@@ -163,7 +164,7 @@ void draw_osci(OSCIOBJ * st)
 				actbrush=CreateSolidBrush(st->sigcol[i]);
 				txtpos.left-=15; txtpos.right=txtpos.left+10;
 				FillRect(hdc,&txtpos,actbrush);
-				if (!(st->showgroupsignal&(1<<i)))	{
+				if (!st->show_signal(i))	{
 					txtpos.left+=2;	txtpos.top+=2;
 					txtpos.right-=2; txtpos.bottom-=2;
 					FillRect(hdc,&txtpos,st->bkbrush);
@@ -307,7 +308,7 @@ void draw_osci(OSCIOBJ * st)
 					else y=channel_mid;
 
 					if (y<top) y=top;
-					if ((st->pixelmem[i][d]!=INVALID_VALUE)&&(st->showgroupsignal&(1<<i))) 
+					if ((st->pixelmem[i][d]!=INVALID_VALUE)&&(st->show_signal(i))) 
 					{ 
 						if (setnew) { MoveToEx(hdc,st->signal_pos-t, y,NULL); setnew=FALSE;}
 						LineTo(hdc,st->signal_pos-t, y); 
@@ -350,18 +351,25 @@ void draw_osci(OSCIOBJ * st)
 	//	wsprintf(tmp,"%d,%d",st->drawend,st->signal_pos);
 	//   ExtTextOut(hdc, 0,0, 0, &rect,tmp, strlen(tmp), NULL ) ;
 
+	// the new pixels become the front buffer, work() continues in the other one
+	EnterCriticalSection(&st->cs);
     np=st->newpixels;
+	if (np>0)
+	{
+		pbuf=st->pixelbuffer;
+		st->pixelbuffer=st->pixelcopy;
+		st->pixelcopy=pbuf;
+		st->newpixels=0;
+	}
+	LeaveCriticalSection(&st->cs);
+	pbuf=st->pixelcopy;
+
 	if (np>0)
 	{
 		int line_x=st->drawstart+st->mysec*PACKETSPERSECOND/st->timer;
 		if (st->mysec>=st->showseconds*st->periods) st->mysec=0;
 		st->inc_mysec=0;
 
-	  st->newpixels=0;
-	    for (i=0;i<count;i++)
-	      for (t=0;t<np;t++)
-		     pbuf[i][t]=st->pixelbuffer[i][t];
-
 	  x=st->signal_pos;
 	  for (i=0;i<count;i++)
 	  {
@@ -432,7 +440,7 @@ void draw_osci(OSCIOBJ * st)
 			{ 
 				SelectObject (hdc, st->drawpen[i]);
 				if (setnew) { MoveToEx(hdc,x+t, y,NULL); setnew=FALSE;}
-				if ((!st->group) || (st->showgroupsignal&(1<<i)))
+				if ((!st->group) || (st->show_signal(i)))
 					LineTo(hdc,x+t, y);
 			} else setnew=TRUE;
 		}
@@ -510,6 +518,7 @@ LRESULT CALLBACK OsciboxDlgHandler( HWND hDlg, UINT message, WPARAM wParam, LPAR
 					SendDlgItemMessage(hDlg, IDC_SIGCOMBO, CB_ADDSTRING, 0,(LPARAM) (LPSTR) temp ) ;
 				}
 				SetDlgItemText(hDlg,IDC_SIGCOMBO,"Chn 1");
+				actsig=0;
 
 			}
 			return TRUE;
@@ -743,7 +752,7 @@ LRESULT CALLBACK OsciWndHandler(HWND hWnd, UINT message, WPARAM wParam, LPARAM l
 				  if (mindist<300) 
 				  {
 					  st->groupselect=minpoint;
-					  st->showgroupsignal^=(1<<minpoint);
+					  if (minpoint<32) st->showgroupsignal^=(1<<minpoint);
 					  st->redraw=1;
 				  }
 			   }
@@ -826,14 +835,16 @@ OSCIOBJ::OSCIOBJ(int num) : BASE_CL()
 		inports = 1;
 		
 		newpixels=0;signal_pos=0;drawstart=25;drawend=20000;
+		InitializeCriticalSection(&cs);
 		groupselect=0;savebitmap=0;add_date=0;saveatend=0;
 		mysec=0; mysec_total=0;
 		inc_mysec=0;
 		strcpy (wndcaption,"Oscilloscope");
 		strcpy (filename,"oscigraph");
 
-		for (t=0;t<MAX_EEG_CHANNELS;t++) input[t]=0.0f; //512.0;
-		for (t=0;t<MAX_PORTS;t++) sprintf(in_ports[t].in_name,"Chn%d",t+1);
+		channels=0; channelmem=NULL;
+		alloc_channels(inports);
+		for (t=0;t<port_count;t++) sprintf(in_ports[t].in_name,"Chn%d",t+1);
 		timer=1;gain=100; group=0; mempos=0; gradual=0;
 		timercount=0;
 		laststamp=(float)TIMING.packetcounter/(float)PACKETSPERSECOND;
@@ -848,12 +859,6 @@ OSCIOBJ::OSCIOBJ(int num) : BASE_CL()
 		captpen=CreatePen(PS_SOLID,1,captcol);
 		redraw=TRUE;		
 		showgroupsignal=0xffffffff;
-
-		for (t=0;t<MAX_EEG_CHANNELS;t++) 
-		{
-			sigcol[t]=RGB(150,0,0); sigsize[t]=1;
-			drawpen[t]=CreatePen(PS_SOLID,1,sigcol[t]);
-		}
 		left=30;right=800;top=210;bottom=450;
 		if(!(displayWnd=CreateWindow("Osci_Class", wndcaption, WS_CLIPSIBLINGS | WS_CAPTION  | WS_THICKFRAME | WS_CHILD ,left, top, right-left, bottom-top, ghWndMain, NULL, hInst, NULL))) 
 		    report_error("can't create Oscillocope Window");
@@ -861,20 +866,72 @@ OSCIOBJ::OSCIOBJ(int num) : BASE_CL()
 		InvalidateRect(displayWnd, NULL, TRUE);
 	  }
 
+	  //  grows the per-channel storage to count channels. the fields of all
+	  //  channels are packed into one block, new channels get the default pen
+	  int OSCIOBJ::alloc_channels(int count)
+	  {
+		  char * mem, * p;
+		  int x,size,sav_pause;
+
+		  if (count<=channels) return(TRUE);
+		  size=channels ? channels : 8;
+		  while (size<count) size*=2;
+
+		  mem=(char *)malloc(size*(sizeof(HPEN)+sizeof(float)*(2*LEN_PIXELBUFFER+PIXELMEMSIZE+1)
+				+sizeof(int)*3+sizeof(COLORREF)));
+		  if (!mem) { report_error("Could not allocate memory for the Oscilloscope channels"); return(FALSE); }
+
+		  // the processing threads write the pixelbuffer
+		  sav_pause=pause_processing();
+		  p=mem;
+		  drawpen=(HPEN *)move_channels(&p,drawpen,sizeof(HPEN),size);
+		  pixelmem=(float (*)[PIXELMEMSIZE])move_channels(&p,pixelmem,sizeof(float)*PIXELMEMSIZE,size);
+		  pixelbuffer=(float (*)[LEN_PIXELBUFFER])move_channels(&p,pixelbuffer,sizeof(float)*LEN_PIXELBUFFER,size);
+		  pixelcopy=(float (*)[LEN_PIXELBUFFER])move_channels(&p,pixelcopy,sizeof(float)*LEN_PIXELBUFFER,size);
+		  input=(float *)move_channels(&p,input,sizeof(float),size);
+		  inputcount=(int *)move_channels(&p,inputcount,sizeof(int),size);
+		  prev_pixel=(int *)move_channels(&p,prev_pixel,sizeof(int),size);
+		  sigsize=(int *)move_channels(&p,sigsize,sizeof(int),size);
+		  sigcol=(COLORREF *)move_channels(&p,sigcol,sizeof(COLORREF),size);
+		  free(channelmem);
+		  channelmem=mem;
+
+		  for (x=channels;x<size;x++)
+		  {
+			  for (int t=0;t<PIXELMEMSIZE;t++) pixelmem[x][t]=INVALID_VALUE;
+			  input[x]=0.0f; inputcount[x]=0; prev_pixel[x]=-1;
+			  sigcol[x]=RGB(150,0,0); sigsize[x]=1;
+			  drawpen[x]=CreatePen(PS_SOLID,1,sigcol[x]);
+		  }
+		  channels=size;
+		  resume_processing(sav_pause);
+		  return(TRUE);
+	  }
+
+	  //  copies the entries of one field to the new block
+	  char * OSCIOBJ::move_channels(char ** p, void * field, size_t elemsize, int size)
+	  {
+		  char * f=*p;
+		  if (channels) memcpy(f,field,channels*elemsize);
+		  *p+=size*elemsize;
+		  return(f);
+	  }
+
 	  void OSCIOBJ::update_inports(void)
 	  {
 		  int x,i;
 		  i=count_inports(this);
 	
-		  if (i>MAX_EEG_CHANNELS) i=MAX_EEG_CHANNELS;
+		  if (!alloc_channels(i)) i=channels;
 		  if (i>inports) inports=i;
 
-		  for(x=inports;x<MAX_EEG_CHANNELS;x++)
+		  for(x=inports;x<port_count;x++)
 			  in_ports[x].get_range=1;
 
 		  for(x=0;x<inports;x++)
 		  {
 			input[x]=0;inputcount[x]=0;
+			sprintf(in_ports[x].in_name,"Chn%d",x+1);
 
 			// This section is a bit of an adaptation for EEG devices with an absolutely
 			// HUGE output range.  E.g. OpenBCI is +-187485 uV.  If we use that default
@@ -911,11 +968,13 @@ OSCIOBJ::OSCIOBJ(int num) : BASE_CL()
 		char pname[20];
 
 		newpixels=0;inports=6;signal_pos=0;drawend=20000;
-		for (t=0;t<MAX_EEG_CHANNELS;t++)
-		{input[t]=0.0f; inputcount[t]=0;}
 		timercount=0; laststamp=0;
 
 		load_object_basics(this);
+		if (!alloc_channels(inports)) inports=channels;
+		for (t=0;t<channels;t++)
+		{input[t]=0.0f; inputcount[t]=0;}
+		for (t=0;t<inports;t++) sprintf(in_ports[t].in_name,"Chn%d",t+1);
 		load_property("grid",P_INT,&showgrid);
 		load_property("line",P_INT,&showline);
 		load_property("gain",P_INT,&gain);
@@ -1038,7 +1097,7 @@ OSCIOBJ::OSCIOBJ(int num) : BASE_CL()
 			mysec=0; mysec_total=0;
 			inc_mysec=0;
 			redraw=1;
-			for (t=0;t<MAX_EEG_CHANNELS;t++)
+			for (t=0;t<channels;t++)
 			{input[t]=0.0f; inputcount[t]=0;}
 			InvalidateRect(displayWnd,NULL,TRUE);
 	  }
@@ -1080,6 +1139,7 @@ OSCIOBJ::OSCIOBJ(int num) : BASE_CL()
 		{
 			timercount=0;
 			z=inports-1; if(z<0) z=0;
+			EnterCriticalSection(&cs);
 			for (t=0;t<z;t++)
 			{
 				if (input[t]!=INVALID_VALUE)
@@ -1105,7 +1165,8 @@ OSCIOBJ::OSCIOBJ(int num) : BASE_CL()
 			    else pixelbuffer[t][newpixels]=INVALID_VALUE;
 			}
 			if (newpixels<499) newpixels++;
-			InvalidateRect(displayWnd,NULL,FALSE);
+			LeaveCriticalSection(&cs);
+			publish_invalidate(displayWnd);
 		}
 
 
@@ -1121,6 +1182,8 @@ OSCIOBJ::~OSCIOBJ()
 		DeleteObject(bkbrush);
 		DeleteObject(gridpen);
 		DeleteObject(captpen);
-		for (t=0;t<MAX_EEG_CHANNELS;t++) DeleteObject(drawpen[t]);
+		for (t=0;t<channels;t++) DeleteObject(drawpen[t]);
+		free(channelmem);
 		if  (displayWnd!=NULL){ DestroyWindow(displayWnd); displayWnd=NULL; }
+		DeleteCriticalSection(&cs);
 	  }  
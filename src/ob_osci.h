@@ -22,14 +22,19 @@ class OSCIOBJ : public BASE_CL
 	  
   public:
 
-	float    input[MAX_EEG_CHANNELS];
-	int      inputcount[MAX_EEG_CHANNELS];
-	unsigned int showgroupsignal;
+	// per-channel storage, channels entries in one block (see alloc_channels)
+	int      channels;
+	char   * channelmem;
+	float  * input;
+	int    * inputcount;
+	unsigned int showgroupsignal;       // signals 1-32 can be hidden in group mode
 	char	 filename[256];
 
-	float    pixelbuffer[MAX_EEG_CHANNELS][LEN_PIXELBUFFER];
-	int	     prev_pixel[MAX_EEG_CHANNELS];
-	float    pixelmem[MAX_EEG_CHANNELS][PIXELMEMSIZE];
+	float    (* pixelbuffer)[LEN_PIXELBUFFER];  // back buffer, written by work()
+	float    (* pixelcopy)[LEN_PIXELBUFFER];    // front buffer, drawn by draw_osci()
+	CRITICAL_SECTION cs;                        // swap of the pixel buffers
+	int	   * prev_pixel;
+	float    (* pixelmem)[PIXELMEMSIZE];
 	WORD	 newpixels;
 	WORD	 signal_pos;
 
@@ -62,12 +67,15 @@ class OSCIOBJ : public BASE_CL
 	HPEN	 gridpen;
 	COLORREF captcol;
 	HPEN     captpen;
-	COLORREF sigcol[MAX_EEG_CHANNELS];
-	int		 sigsize[MAX_EEG_CHANNELS];
-	HPEN     drawpen[MAX_EEG_CHANNELS];
+	COLORREF * sigcol;
+	int		 * sigsize;
+	HPEN     * drawpen;
 
 	
 	OSCIOBJ(int num);
+	int  alloc_channels(int count);
+	char * move_channels(char ** p, void * field, size_t elemsize, int size);
+	int  show_signal(int i) { return((i>=32) || (showgroupsignal&(1<<i))); }
 	void update_inports(void);
 	void session_reset(void);
 	void session_stop(void);
@@ -605,10 +605,10 @@ PARTICLEOBJ::PARTICLEOBJ(int num) : BASE_CL()
 						if (value[i]!=INVALID_VALUE) 
 						{ 
 							sprintf(sztemp,"%.2f",get_paramvalue(i));
-							SetDlgItemText(hDlg, IDC_VALUE,sztemp);
-							EnableWindow(GetDlgItem(hDlg, IDC_VALUEBAR),TRUE); SetScrollPos(GetDlgItem(hDlg, IDC_VALUEBAR), SB_CTL, (int)value[i], 1); 
+							publish_dlg_text(hDlg, IDC_VALUE,sztemp);
+							publish_enable(hDlg, IDC_VALUEBAR, TRUE); publish_scroll_pos(hDlg, IDC_VALUEBAR, (int)value[i]); 
 						}
-						else { SetDlgItemText(hDlg, IDC_VALUE, "none"); EnableWindow(GetDlgItem(hDlg, IDC_VALUEBAR),FALSE); }
+						else { publish_dlg_text(hDlg, IDC_VALUE, "none"); publish_enable(hDlg, IDC_VALUEBAR, FALSE); }
 					}
 				}
 
@@ -713,7 +713,7 @@ void SESSIONMANAGEROBJ::incoming_data(int port, float value)
 void SESSIONMANAGEROBJ::work(void) 
 {
 	if ((displayWnd)&&(!TIMING.draw_update)&&(!GLOBAL.fly)) 
-		InvalidateRect(displayWnd,NULL,FALSE);	  
+		publish_invalidate(displayWnd);	  
 }
 	  
 SESSIONMANAGEROBJ::~SESSIONMANAGEROBJ()
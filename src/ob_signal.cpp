@@ -275,11 +275,11 @@ SIGNALOBJ::SIGNALOBJ(int num) : BASE_CL()
 		{
 			char sztemp[25];
 			sprintf(sztemp,"%.2f",frequency);
-			SetDlgItemText(hDlg, IDC_FREQUENCY,sztemp);
-			SetScrollPos(GetDlgItem(hDlg, IDC_FREQUENCYBAR), SB_CTL, (int)(frequency*100.0f), 1); 
+			publish_dlg_text(hDlg, IDC_FREQUENCY,sztemp);
+			publish_scroll_pos(hDlg, IDC_FREQUENCYBAR, (int)(frequency*100.0f)); 
 			sprintf(sztemp,"%.2f",phase);
-			SetDlgItemText(hDlg, IDC_PHASE,sztemp);
-			SetScrollPos(GetDlgItem(hDlg, IDC_PHASEBAR), SB_CTL, (int)(phase), 1); 
+			publish_dlg_text(hDlg, IDC_PHASE,sztemp);
+			publish_scroll_pos(hDlg, IDC_PHASEBAR, (int)(phase)); 
 		}
 
 	    pass_values(0,x+center);
@@ -591,7 +591,7 @@ void SKINDIALOGOBJ::work(void)
 			if (!(resetbutton[i])) 
 			{ 
 				win.m_Buttons.operator [](buttons[i])->_mouse_over=false;
-			    ::InvalidateRect(win.m_Buttons.operator [](buttons[i])->m_hWnd, NULL, false );
+			    publish_invalidate(win.m_Buttons.operator [](buttons[i])->m_hWnd);
 				pass_values(num_sliders+i,INVALID_VALUE);
 			}
 		}
@@ -599,7 +599,7 @@ void SKINDIALOGOBJ::work(void)
 		if (setbutton[i]==1)
 		{
 			win.m_Buttons.operator [](buttons[i])->_mouse_over=true;
-			::InvalidateRect(win.m_Buttons.operator [](buttons[i])->m_hWnd, NULL, false );
+			publish_invalidate(win.m_Buttons.operator [](buttons[i])->m_hWnd);
 			pass_values(num_sliders+i, 1.0f);
 			setbutton[i]=0;
 		}	
@@ -608,13 +608,13 @@ void SKINDIALOGOBJ::work(void)
 			if (win.m_Buttons.operator [](buttons[i])->_mouse_over==false)
 			{
 				win.m_Buttons.operator [](buttons[i])->_mouse_over=true;
-				::InvalidateRect(win.m_Buttons.operator [](buttons[i])->m_hWnd, NULL, false );
+				publish_invalidate(win.m_Buttons.operator [](buttons[i])->m_hWnd);
 				pass_values(num_sliders+i, 1.0f);
 			}
 			else
 			{
 				win.m_Buttons.operator [](buttons[i])->_mouse_over=false;
-			    ::InvalidateRect(win.m_Buttons.operator [](buttons[i])->m_hWnd, NULL, false );
+			    publish_invalidate(win.m_Buttons.operator [](buttons[i])->m_hWnd);
 				pass_values(num_sliders+i,INVALID_VALUE);
 			}
 			setbutton[i]=0;
@@ -632,7 +632,7 @@ void SKINDIALOGOBJ::work(void)
 			wsprintf(tmp,"%d",setslider[i]);
 
 			win.m_Labels.operator [](sliders[i])->value=setslider[i];
-			win.m_Labels.operator [](sliders[i])->SetWindowText(tmp);
+			publish_window_text(win.m_Labels.operator [](sliders[i])->m_hWnd,tmp);
 
 			pass_values(i, (float)setslider[i]);
 			setslider[i]=INVALID_VALUE;
@@ -774,7 +774,7 @@ SPELLEROBJ::SPELLEROBJ(int num) : BASE_CL()
 			   //selstart+=selections; 
 			   //if (selstart>selend) selstart=0;
 			}
-			if (displayWnd) InvalidateRect(displayWnd,NULL,FALSE);
+			if (displayWnd) publish_invalidate(displayWnd);
 
 		  }
 		}
@@ -815,14 +815,14 @@ SPELLEROBJ::SPELLEROBJ(int num) : BASE_CL()
 					else                      
 					{ selstart=0; selbegin=0; selections=entries; selend=selections; 
 					  delchars=0; }
-					InvalidateRect(displayWnd,NULL,FALSE);
+					publish_invalidate(displayWnd);
 				}
 
 				if (input!=15)  { get_suggestions(); waitres=1; oldinput=input; idletime=0; presstime=0; select=-1; }
 
 				if (presstime>press) {presstime=0; enter=1; idletime=0; }
 
-				if (displayWnd && (select!=os)) InvalidateRect(displayWnd,NULL,FALSE);
+				if (displayWnd && (select!=os)) publish_invalidate(displayWnd);
 				os=select;
 			
 			}
@@ -848,7 +848,7 @@ SPELLEROBJ::SPELLEROBJ(int num) : BASE_CL()
 					else                      
 					{ selstart=0; selbegin=0; selections=entries; selend=selections; 
 					  delchars=0; }
-					InvalidateRect(displayWnd,NULL,FALSE);
+					publish_invalidate(displayWnd);
 				}
 
 				if ((input!=oldinput) || (input==15)) presstime=0;
@@ -870,7 +870,7 @@ SPELLEROBJ::SPELLEROBJ(int num) : BASE_CL()
 
 				if ((enter==2) && (idletime>180) && (select>=0)) {enter=1; waitres=1;}
 
-				if (displayWnd && (select!=os)) InvalidateRect(displayWnd,NULL,FALSE);
+				if (displayWnd && (select!=os)) publish_invalidate(displayWnd);
 				os=select;
 			}
 		    oldinput=input;
@@ -916,7 +916,7 @@ SPELLEROBJ::SPELLEROBJ(int num) : BASE_CL()
 							  upchar=1; break;
 
 					case 3:  get_suggestions(); 
-							 InvalidateRect(displayWnd,NULL,FALSE);
+							 publish_invalidate(displayWnd);
 							 keep=1;
 							 //waitres=1; oldinput=input; 
 							 idletime=0; presstime=0; switchtime=0;
@@ -924,7 +924,7 @@ SPELLEROBJ::SPELLEROBJ(int num) : BASE_CL()
 							 break;
 					
 					case 4:  get_dictionary(); 
-							 InvalidateRect(displayWnd,NULL,FALSE);
+							 publish_invalidate(displayWnd);
 							 keep=1;
 							 idletime=0; presstime=0; switchtime=0;
 							 break;
@@ -1012,7 +1012,7 @@ SPELLEROBJ::SPELLEROBJ(int num) : BASE_CL()
 
 			}
 
-			if (displayWnd) InvalidateRect(displayWnd,NULL,FALSE);
+			if (displayWnd) publish_invalidate(displayWnd);
 		}
 		
 		
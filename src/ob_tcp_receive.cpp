@@ -78,6 +78,7 @@ LRESULT CALLBACK TcpReceiveDlgHandler( HWND hDlg, UINT message, WPARAM wParam, L
 	TCP_RECEIVEOBJ * st;
 	char writebuf[100],szdata[100];
 	char readbuf[readbuflength];
+	char * hdrbuf;
 	int result;
 	static int actchn;
 
@@ -194,22 +195,22 @@ LRESULT CALLBACK TcpReceiveDlgHandler( HWND hDlg, UINT message, WPARAM wParam, L
 				 result = SDLNet_TCP_Send(st->sock, writebuf, strlen(writebuf));
 				 add_to_listbox(hDlg,IDC_LIST, "sending:GETHEADER");
 
-				 st->read_tcp(readbuf, sizeof(readbuf)-1);
-				 strncpy(szdata,readbuf,6); szdata[6]=0;
-				 if (strcmp(szdata,"200 OK")) {   add_to_listbox(hDlg,IDC_LIST,"Could not get EDF-header.");break;}
+				 // the header holds 256 bytes per channel
+				 if (!(hdrbuf=(char *)malloc(EDF_HEADERSIZE(MAX_CHANNELS)+16))) break;
+				 st->read_tcp(hdrbuf, EDF_HEADERSIZE(MAX_CHANNELS)+15);
+				 strncpy(szdata,hdrbuf,6); szdata[6]=0;
+				 if (strcmp(szdata,"200 OK")) {   free(hdrbuf); add_to_listbox(hDlg,IDC_LIST,"Could not get EDF-header.");break;}
 
 				 add_to_listbox(hDlg,IDC_LIST, "OK");
-				 strcpy(st->edfheader,readbuf+8);
-//				 report(st->edfheader);
-
 				 EnableWindow(GetDlgItem(hDlg, IDC_SELECTCOMBO), FALSE);
 				 st->syncloss=0;
 				 add_to_listbox(hDlg,IDC_LIST, "Parsing Header");
-				 parse_edf_header(&st->header,st->channel, st->edfheader);
+				 st->set_header(hdrbuf+8);
+				 free(hdrbuf);
+//				 report(st->edfheader);
 
 
  				 add_to_listbox(hDlg,IDC_LIST, "clear OK");
-				 st->outports=st->header.channels;
 				 st->height=CON_START+st->outports*CON_HEIGHT+5;
 				 st->get_captions();
 				update_header(hDlg,&st->header);
@@ -295,12 +296,14 @@ TCP_RECEIVEOBJ::TCP_RECEIVEOBJ(int num) : BASE_CL()
 		width=80;
 		height=50;
 
-		for (i=0;i<MAX_PORTS;i++)
+		for (i=0;i<port_count;i++)
 		  out_ports[i].get_range=-1;
 
 		sock=0;
 		reset_header(&header);
-		reset_channel(channel);
+		edfheader=NULL;
+		channel=NULL; channels_allocated=0; samplebuf=NULL;
+		reserve_channels(&channel,&channels_allocated,0);
 		state=0;
 		watching=FALSE;
 		packetcount=0;
@@ -369,6 +372,21 @@ TCP_RECEIVEOBJ::TCP_RECEIVEOBJ(int num) : BASE_CL()
 //		update_dimensions();
 	  }
 	
+	  //  parses the edf-header of the stream and allocates the channel buffers
+	  void TCP_RECEIVEOBJ::set_header(char * str)
+	  {
+		  if (str!=edfheader)
+		  {
+			  free(edfheader);
+			  if (!(edfheader=(char *)malloc(strlen(str)+1))) return;
+			  strcpy(edfheader,str);
+		  }
+		  parse_edf_header(&header, &channel, &channels_allocated, edfheader);
+		  samplebuf=alloc_channel_buffers(samplebuf, channel, header.channels, samplebuflen);
+		  bufstart=0; bufend=0;
+		  outports= samplebuf ? reserve_ports(header.channels) : 0;
+	  }
+
 	  void TCP_RECEIVEOBJ::clear_buffer(void)
 	  {
 		  int x;
@@ -379,13 +397,13 @@ TCP_RECEIVEOBJ::TCP_RECEIVEOBJ(int num) : BASE_CL()
 	  {
       /*
 		int x;
-	  		  for (x=0;x<MAX_CONNECTS;x++)
+	  		  for (x=0;x<out_size;x++)
 		  {
 			  out[x].from_port=-1;
 			  out[x].to_port=-1;
 			  out[x].to_object=-1;
 		  }
-		  for (x=0;x<MAX_PORTS;x++)
+		  for (x=0;x<port_count;x++)
 		  {
 			  out_ports[x].out_name[0]=0;
 			  strcpy(out_ports[x].out_dim,"none");
@@ -413,23 +431,24 @@ TCP_RECEIVEOBJ::TCP_RECEIVEOBJ(int num) : BASE_CL()
 
 	  int TCP_RECEIVEOBJ::read_tcp(char * readbuf, int size)
 	  {
-		int len;
+		int len,pos;
 		bool reading=true;	
 		char tempbuf[readbuflength];
 
 		reading=true;
-		readbuf[0]=0;
+		readbuf[0]=0; pos=0;
 		while (reading)
 		{
 			if (SDLNet_CheckSockets(set, sockettimeout) == -1)  return(TCP_BAD_REQUEST);
 				
 			if (SDLNet_SocketReady(sock))
 			{
-				if ((len = SDLNet_TCP_Recv(sock, tempbuf, size)) <= 0) return(TCP_ERROR);
+				len=size-pos; if (len>readbuflength-1) len=readbuflength-1;
+				if ((len = SDLNet_TCP_Recv(sock, tempbuf, len)) <= 0) return(TCP_ERROR);
 				
 				tempbuf[len] = '\0';
-				if (strlen(readbuf) + strlen(tempbuf) <= (unsigned int)size) strcat (readbuf, tempbuf);
-				if (strlen(readbuf)>=(unsigned int)size) reading=false;
+				if (pos + strlen(tempbuf) <= (unsigned int)size) { strcpy (readbuf+pos, tempbuf); pos+=strlen(tempbuf); }
+				if (pos>=size) reading=false;
 			}
 			else reading=false;
 		
@@ -463,7 +482,7 @@ TCP_RECEIVEOBJ::TCP_RECEIVEOBJ(int num) : BASE_CL()
 					case 0: if (readbuf[len++]=='!') {state=1; ppos=0;} 
 							break;
 					case 1: if ((readbuf[len]==10)||(readbuf[len]==13)) state=2;
-							else packet[ppos++]=readbuf[len];
+							else if (ppos<packetbuflength-1) packet[ppos++]=readbuf[len];
 							len++;
 							break;
 					case 2: packetcount++;
@@ -485,7 +504,7 @@ TCP_RECEIVEOBJ::TCP_RECEIVEOBJ(int num) : BASE_CL()
 							for (x=0;x<channels;x++)
 							{
 								ppos=get_int(packet,ppos,&b);
-								fact=(channel[x].physmax-channel[x].physmin)/(float)(channel[x].digmax-channel[x].digmin);
+								fact=(float)((channel[x].physmax-channel[x].physmin)/(double)(channel[x].digmax-channel[x].digmin));
 								b-=channel[x].digmin;
 								
 								channel[x].buffer[bufend]=(short)((float)b*fact+(float)channel[x].physmin);
@@ -585,9 +604,9 @@ TCP_RECEIVEOBJ::TCP_RECEIVEOBJ(int num) : BASE_CL()
 
 		  load_object_basics(this);
 		  load_property("host",P_STRING,&host);
-		  load_property("header",P_STRING,&edfheader);
-		  parse_edf_header(&header, channel, edfheader);
-		  outports=header.channels;
+		  free(edfheader);
+		  if ((edfheader=load_property_string("header"))) set_header(edfheader);
+		  else outports=0;
 		  height=CON_START+outports*CON_HEIGHT+5;
 		  get_captions();
 	  }
@@ -596,7 +615,7 @@ TCP_RECEIVEOBJ::TCP_RECEIVEOBJ(int num) : BASE_CL()
 	  {
 	  	  save_object_basics(hFile, this);
 		  save_property(hFile,"host",P_STRING,&host);
-		  save_property(hFile,"header",P_STRING,&edfheader);	  
+		  if (edfheader) save_property(hFile,"header",P_STRING,edfheader);
 	  }
 
 	  
@@ -605,7 +624,7 @@ TCP_RECEIVEOBJ::TCP_RECEIVEOBJ(int num) : BASE_CL()
 		int x;
 		if ((outports==0)||(watching==FALSE)) return;
 	    if (watch_tcp(watchbuf,sizeof(watchbuf))==TCP_ERROR)  
-		{	if (hDlg==ghWndToolbox) add_to_listbox(hDlg,IDC_LIST, "--WATCH-ERROR---");
+		{	if (hDlg==ghWndToolbox) publish_list_item(hDlg,IDC_LIST, "--WATCH-ERROR---");
 		}
 		
 		if (bufend!=bufstart)
@@ -619,7 +638,7 @@ TCP_RECEIVEOBJ::TCP_RECEIVEOBJ(int num) : BASE_CL()
 
 		if ((!TIMING.dialog_update) && (hDlg==ghWndToolbox)) 
 		{
-			SetDlgItemInt(hDlg, IDC_STATUS, syncloss, 0); 
+			publish_dlg_int(hDlg, IDC_STATUS, syncloss, 0); 
 		}
 	  }
 
@@ -632,4 +651,7 @@ TCP_RECEIVEOBJ::~TCP_RECEIVEOBJ()
 			SDLNet_TCP_DelSocket(set, sock);
 			SDLNet_TCP_Close(sock);
 		}
+		free(edfheader);
+		free(samplebuf);
+		free(channel);
 	  }  
@@ -32,6 +32,7 @@ using namespace std;
 #define writebuflength 128
 #define readbuflength 8192
 #define watchbuflength 14000
+#define packetbuflength (32+MAX_CHANNELS*12)
 
 #define sockettimeout 50
 
@@ -42,19 +43,21 @@ protected:
 	DWORD dwRead,dwWritten;
 	char szdata[300];
 	int  state,ppos;
-	char packet[500];
+	char packet[packetbuflength];
   
 public: 
 	IPaddress ip; 
 	TCPsocket sock;
 	SDLNet_SocketSet set;
 
-	char edfheader[readbuflength];
+	char * edfheader;
 	char watchbuf[watchbuflength];
 	char writebuf[100];
 
 	struct EDFHEADERStruct header;
-	struct CHANNELStruct channel[MAX_EEG_CHANNELS];
+	struct CHANNELStruct * channel;
+	int    channels_allocated;
+	short  * samplebuf;         // ring buffers of the channels, samplebuflen samples each
 	char   host[101];
 	int    streamnum;
 	int    packetcount;
@@ -68,6 +71,7 @@ public:
     TCP_RECEIVEOBJ(int num);
 	int  connect();
 	void get_captions(void);
+	void set_header(char * str);
 	void work(void);
 	int  read_tcp(char * readbuf, int size);
 	int  watch_tcp(char * readbuf, int size);
@@ -245,19 +245,18 @@ LRESULT CALLBACK TcpSenderDlgHandler( HWND hDlg, UINT message, WPARAM wParam, LP
 
 TCP_SENDEROBJ::TCP_SENDEROBJ(int num) : BASE_CL()	
 	  {
-  	    int i,x;
+  	    int i;
 	    outports = 0;
 		inports = 1;
 		width=80;
 		height=50;
 
-		for (i=0;i<MAX_PORTS;i++)
+		for (i=0;i<port_count;i++)
 		  out_ports[i].get_range=-1;
 
 		sock=0;
 		reset_header(&header);
-		reset_channel(channel);
-		for (x=0;x<8192;x++) edfinfos[x]=' ';
+		channel=NULL; channels_allocated=0;
 
 		header.samplespersegment=PACKETSPERSECOND;
 		header.segments=-1;
@@ -266,19 +265,7 @@ TCP_SENDEROBJ::TCP_SENDEROBJ(int num) : BASE_CL()
 		strcpy (header.patient,"standard EEG");
 		strcpy (header.device,"Modular EEG  Unit");
 		header.channels=0;
-
-		for (x=0;x<MAX_EEG_CHANNELS;x++) 
-		{
-			sprintf(szdata,"%d : ",x+1);
-			strcpy (channel[x].transducer, "Ag/AgCl Electrode");
-			strcpy (channel[x].physdim, "uV");
-			strcpy (channel[x].label, "none");
-			strcpy (channel[x].prefiltering, "HP:0.16Hz, LP:59Hz");
-			channel[x].physmin=500;
-			channel[x].physmax=500;
-			channel[x].digmin=0;
-			channel[x].digmax=1024;
-		}
+		reserve_inputs();
 
 
 		state=STATE_IDLE;
@@ -315,19 +302,41 @@ TCP_SENDEROBJ::TCP_SENDEROBJ(int num) : BASE_CL()
 				//in_ports[x].in_name[i]=0;
 				strcpy(channel[x].physdim,in_ports[x].in_dim);
 
-				channel[x].physmin=(int)in_ports[x].in_min;
-				channel[x].physmax=(int)in_ports[x].in_max;
+				channel[x].physmin=in_ports[x].in_min;
+				channel[x].physmax=in_ports[x].in_max;
 		}
 		header.channels=inports-1;
 
 	  }
 
+	  //  the channel table grows with the connected inputs
+	  void TCP_SENDEROBJ::reserve_inputs(void)
+	  {
+		int x,n;
+
+		n=channels_allocated;
+		if (inports>reserve_channels(&channel,&channels_allocated,inports)) inports=channels_allocated;
+		for (x=n;x<channels_allocated;x++) 
+		{
+			strcpy (channel[x].transducer, "Ag/AgCl Electrode");
+			strcpy (channel[x].physdim, "uV");
+			strcpy (channel[x].label, "none");
+			strcpy (channel[x].prefiltering, "HP:0.16Hz, LP:59Hz");
+			channel[x].physmin=500;
+			channel[x].physmax=500;
+			channel[x].digmin=0;
+			channel[x].digmax=1024;
+			channel[x].samples=0;     // every packet is sent
+		}
+	  }
+
 
   	  void TCP_SENDEROBJ::update_inports(void)
 	  {
 		if (state!=STATE_WRITING)
 		{
 			inports=count_inports(this);
+			reserve_inputs();
 			//get_captions();
 			header.channels=inports-1;
 			height=CON_START+inports*CON_HEIGHT+5;
@@ -418,12 +427,17 @@ TCP_SENDEROBJ::TCP_SENDEROBJ(int num) : BASE_CL()
 	
 	  int TCP_SENDEROBJ::start_sending(void)
 	  {
+		char * hdrbuf;
+		int sent;
 
 	  	if (sock)
 		{
-  		    strcpy(writebuf,"setheader ");
+			if (!(hdrbuf=(char *)malloc(10+EDF_HEADERSIZE(header.channels)+3))) return(0);
+  		    strcpy(hdrbuf,"setheader ");
+			header.samplespersegment=PACKETSPERSECOND;
+			header.samplingrate=PACKETSPERSECOND;
 			
-			generate_edf_header(writebuf+10,&header,channel);
+			generate_edf_header(hdrbuf+10,&header,channel);
 /*			
 			{HANDLE testfile;
 			testfile= CreateFile("c:\\_t.tst", GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
@@ -431,7 +445,9 @@ TCP_SENDEROBJ::TCP_SENDEROBJ(int num) : BASE_CL()
 			CloseHandle(testfile);
 			}
 */
-			if (SDLNet_TCP_Send(sock, writebuf, strlen(writebuf))==strlen(writebuf))
+			sent=SDLNet_TCP_Send(sock, hdrbuf, strlen(hdrbuf))==strlen(hdrbuf);
+			free(hdrbuf);
+			if (sent)
 			{
 				read_tcp(readbuf, 6);
 				if (!strcmp(readbuf,"200 OK"))   return(200);
@@ -451,8 +467,8 @@ TCP_SENDEROBJ::TCP_SENDEROBJ(int num) : BASE_CL()
 
 		  load_object_basics(this);
 		  load_property("host",P_STRING,&host);
-		  if (load_property("edfinfos",P_STRING,&edfinfos))
-			  parse_edf_header(&header, channel, edfinfos);
+		  load_edf_header("edfinfos", &header, &channel, &channels_allocated);
+		  reserve_inputs();
 	//	  else get_captions();
 		  height=CON_START+inports*CON_HEIGHT+5;
 	  }
@@ -462,9 +478,7 @@ TCP_SENDEROBJ::TCP_SENDEROBJ(int num) : BASE_CL()
 		  save_object_basics(hFile, this);
 		  save_property(hFile,"host",P_STRING,&host);
 //		  save_property(hFile,"header",P_STRING,&edfheader);
-		  edfheader_to_physical(&header, (EDFHEADER_PHYSICALStruct *) edfinfos);
-		  edfchannels_to_physical(channel,edfinfos+256,header.channels);
-		  save_property(hFile,"edfinfos",P_STRING,&edfinfos);	  
+		  save_edf_header(hFile,"edfinfos",&header,channel);
 	  }
 
 	  
@@ -487,6 +501,7 @@ TCP_SENDEROBJ::TCP_SENDEROBJ(int num) : BASE_CL()
 		}
 		strcat(writebuf,"\n");
 		SDLNet_TCP_Send(sock, writebuf, strlen(writebuf));
+		record_latency(this);
 	
 		SDLNet_CheckSockets(set, 0);
 				
@@ -497,7 +512,7 @@ TCP_SENDEROBJ::TCP_SENDEROBJ(int num) : BASE_CL()
 		{		
 			sprintf(szdata,"%d Packets sent",packetcount);
 			if (hDlg==ghWndToolbox) 
-				add_to_listbox(hDlg,IDC_LIST, szdata); 
+				publish_list_item(hDlg,IDC_LIST, szdata); 
 		}
 		
 	  }
@@ -511,4 +526,5 @@ TCP_SENDEROBJ::~TCP_SENDEROBJ()
 			SDLNet_TCP_DelSocket(set, sock);
 			SDLNet_TCP_Close(sock);
 		}
+		free(channel);
 	  }  
@@ -53,8 +53,8 @@ public:
 	char writebuf[s_writebuflength];
 
 	struct EDFHEADERStruct header;
-	struct CHANNELStruct channel[MAX_EEG_CHANNELS];
-	char   edfinfos[8192];
+	struct CHANNELStruct * channel;
+	int    channels_allocated;
 	char   host[101];
 	int    streamnum;
 	int    state;
@@ -69,6 +69,7 @@ public:
 	void incoming_data(int, float);
 	int  connect();
 	void get_captions(void);
+	void reserve_inputs(void);
 	void work(void);
 	int  read_tcp(char * readbuf, int size);
 	int  start_sending(void);
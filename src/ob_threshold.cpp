@@ -730,16 +730,16 @@ THRESHOLDOBJ::THRESHOLDOBJ(int num) : BASE_CL()
 			  char temp[100];
 
 			  sprintf(temp,"%.2f",from_input);
-			  SetDlgItemText(hDlg, IDC_AVGFROM, temp);
+			  publish_dlg_text(hDlg, IDC_AVGFROM, temp);
 			  sprintf(temp,"%.2f",to_input);
-			  SetDlgItemText(hDlg, IDC_AVGTO, temp);
+			  publish_dlg_text(hDlg, IDC_AVGTO, temp);
 
-			  if (smalladapt) SetScrollPos(GetDlgItem(hDlg,IDC_AVGTOBAR), SB_CTL,(int) size_value(in_ports[0].in_min,in_ports[0].in_max, to_input,0.0f,1000.0f,0),TRUE);
-			  if (bigadapt) SetScrollPos(GetDlgItem(hDlg,IDC_AVGFROMBAR), SB_CTL,(int) size_value(in_ports[0].in_min,in_ports[0].in_max, from_input ,0.0f,1000.0f,0),TRUE);
+			  if (smalladapt) publish_scroll_pos(hDlg, IDC_AVGTOBAR, (int) size_value(in_ports[0].in_min,in_ports[0].in_max, to_input,0.0f,1000.0f,0));
+			  if (bigadapt) publish_scroll_pos(hDlg, IDC_AVGFROMBAR, (int) size_value(in_ports[0].in_min,in_ports[0].in_max, from_input ,0.0f,1000.0f,0));
 			  
 		}
 
-		if ((displayWnd)&&(!TIMING.draw_update)&&(!GLOBAL.fly))  InvalidateRect(displayWnd,NULL,FALSE);
+		if ((displayWnd)&&(!TIMING.draw_update)&&(!GLOBAL.fly))  publish_invalidate(displayWnd);
 	  
 	  }
 	  
@@ -227,10 +227,16 @@ void WAVOBJ::work(void)
 			if (on_change_only)
 			{
 				if (lastInputOn == INVALID_VALUE)
+				{
 					play();
+					record_latency(this);
+				}
 			}
 			else
+			{
 				play();
+				record_latency(this);
+			}
 		}
 	}
 	lastInputOn = inputOn;
@@ -0,0 +1,146 @@
+/* -----------------------------------------------------------------------------
+
+  BrainBay  -  Version 2.0, GPL 2003-2017
+
+  MODULE:  PACKETRING.CPP
+  Author:  Chris Veigl
+
+
+  This Module decouples the COM-port reader thread from the signal processing:
+
+  While a COM-port is open, a processing thread is running. When a parser
+  (ParseLocalInput) completes a packet on the reader thread, process_packets()
+  does not call the elements, but pushes the packet values, the switches
+  and the arrival time into the PACKETRING - structure, a lock-free ring buffer with
+  one producer (the reader thread) and one consumer (the processing thread).
+  The processing thread drains all queued packets on each wakeup and runs
+  work_packet() for them, so a slow element does not stall the serial reads.
+  When more than one packet is queued and the design allows block processing,
+  the packets of a wakeup are processed as one catch-up block (see block.cpp).
+
+  Packets arriving while the ring is full are dropped and counted as overruns,
+  the maximum fill level is kept as high_water. Both are shown in the status
+  bar and written to the logfile when the port is closed.
+
+  Other packet sources (archive playback, Neurobit, Emotiv, Ganglion) still
+  call work_packet() directly via process_packets().
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; See the
+  GNU General Public License for more details.
+
+
+--------------------------------------------------------------------------------*/
+
+
+#include "brainBay.h"
+
+PACKETRINGStruct PACKETRING;
+
+
+//  called on the reader thread by process_packets()
+void push_packet(void)
+{
+	RINGPACKETStruct * p;
+	LONG head,next,fill;
+
+	head=PACKETRING.head;
+	next=(head+1)&(PACKETRING_SIZE-1);
+	if (next==PACKETRING.tail) { PACKETRING.overruns++; return; }
+
+	p=&PACKETRING.packet[head];
+	memcpy(p->buffer,PACKET.buffer,sizeof(p->buffer));
+	p->switches=PACKET.switches;
+	if (PACKET.arrival) p->timestamp=PACKET.arrival;
+	else QueryPerformanceCounter((_LARGE_INTEGER *)&p->timestamp);
+	p->clocktime=PACKET.clocktime ? PACKET.clocktime : p->timestamp;
+	InterlockedExchange(&PACKETRING.head,next);
+
+	fill=(next-PACKETRING.tail)&(PACKETRING_SIZE-1);
+	if (fill>PACKETRING.high_water) PACKETRING.high_water=fill;
+	SetEvent(PACKETRING.event);
+}
+
+
+DWORD WINAPI PacketProcessProc(LPVOID lpv)
+{
+	RINGPACKETStruct * p;
+	LONG tail,avail;
+
+	while (!PACKETRING.exit)
+	{
+		WaitForSingleObject(PACKETRING.event,50);
+
+		avail=(PACKETRING.head-PACKETRING.tail)&(PACKETRING_SIZE-1);
+		if ((avail>1) && (BLOCK.possible) && (!GLOBAL.fly))
+			BLOCK.catchup=(avail<MAX_BLOCKSIZE) ? avail : MAX_BLOCKSIZE;
+
+		for (;(avail>0) && (!PACKETRING.exit);avail--)
+		{
+			tail=PACKETRING.tail;
+			if ((GLOBAL.loading) || (TTY.read_pause))
+			{   // the design is changed: discard the queued packets
+				InterlockedExchange(&PACKETRING.tail,PACKETRING.head);
+				BLOCK.catchup=0;
+				break;
+			}
+			p=&PACKETRING.packet[tail];
+			memcpy(PACKET.work_buffer,p->buffer,sizeof(PACKET.work_buffer));
+			PACKET.work_switches=p->switches;
+			PACKET.timestamp=p->timestamp;
+			PACKET.work_clocktime=p->clocktime;
+			InterlockedExchange(&PACKETRING.tail,(tail+1)&(PACKETRING_SIZE-1));
+			work_packet();
+		}
+
+		if (BLOCK.catchup)
+		{   // the catch-up block ends with the drained packets
+			BLOCK.catchup=0;
+			if (!BLOCK.active) process_block();
+		}
+	}
+	return(0);
+}
+
+
+void start_packetring(DWORD reader_id)
+{
+	DWORD dwThreadId;
+
+	stop_packetring();
+	PACKETRING.head=0; PACKETRING.tail=0;
+	PACKETRING.high_water=0; PACKETRING.overruns=0;
+	PACKETRING.exit=0;
+	PACKETRING.event=CreateEvent(NULL,FALSE,FALSE,NULL);
+	PACKETRING.thread=CreateThread(NULL,0,(LPTHREAD_START_ROUTINE)PacketProcessProc,0,0,&dwThreadId);
+	if (!PACKETRING.thread)
+	{
+		CloseHandle(PACKETRING.event);
+		report_error("Could not create processing thread");
+		return;
+	}
+	SetThreadPriority(PACKETRING.thread,THREAD_PRIORITY_ABOVE_NORMAL);
+	PACKETRING.reader_id=reader_id;
+	PACKETRING.active=TRUE;
+}
+
+
+void stop_packetring(void)
+{
+	MSG msg;
+
+	if (!PACKETRING.active) return;
+	PACKETRING.active=FALSE;
+	PACKETRING.exit=1;
+	SetEvent(PACKETRING.event);
+
+	// elements may send messages to our windows while we wait
+	while (MsgWaitForMultipleObjects(1,&PACKETRING.thread,FALSE,INFINITE,QS_SENDMESSAGE)==WAIT_OBJECT_0+1)
+		PeekMessage(&msg,NULL,0,0,PM_NOREMOVE);
+
+	CloseHandle(PACKETRING.thread);
+	CloseHandle(PACKETRING.event);
+	write_logfile("packet ring: high water mark %d of %d packets, %d overruns",
+		PACKETRING.high_water, PACKETRING_SIZE-1, PACKETRING.overruns);
+}
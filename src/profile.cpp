@@ -0,0 +1,419 @@
+/* -----------------------------------------------------------------------------
+
+  BrainBay  -  Version 2.0, GPL 2003-2017
+
+  MODULE:  PROFILE.CPP
+  Author:  Chris Veigl
+
+
+  This Module provides the execution profiler:
+
+  When profiling is active, each work() / work_block() - call of the execution
+  plan (see run_object in schedule.cpp), each pass_values() - call and each
+  incoming_data() - call delivered by pass_values() is timed with the
+  QueryPerformanceCounter. The calls, total, min and max time and a histogram
+  of the durations (for the 99th percentile) are kept per element in its
+  PROFILEStruct. The time of pass_values() includes the incoming_data() - calls
+  of the consumers. In block mode, the incoming_data() - calls of the block
+  replay (BASE_CL::work_block) are timed as incoming and not as work.
+
+  The PROFILEStruct is allocated by the first thread which profiles the element
+  (compare-exchange, so parallel workers can't allocate it twice). reset_profile()
+  only advances profile_generation: the counters of an older generation are
+  cleared by the thread which adds to them next, and are not shown meanwhile.
+
+  End-to-end latency: the parser stamps each packet with the arrival time of its
+  bytes (PACKET.arrival, see ParseLocalInput), which is carried through the
+  packet ring and the block queue as PACKET.timestamp. The output elements
+  (WAV, MIDI, MOUSE, KEYSTRIKE, COM-WRITER, TCP-SENDER) call record_latency()
+  when they act, this is done also when the profiler is not active. The
+  latency histograms are written to the logfile when the session stops.
+
+  The profiler window (Tools - Execution Profiler) shows the elements sorted by
+  their cost (work + incoming_data) and the latencies. The table is exported to
+  a CSV-file on demand and when a session stops (profile.csv in the BrainBay
+  directory).
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; See the
+  GNU General Public License for more details.
+
+
+--------------------------------------------------------------------------------*/
+
+
+#include "brainBay.h"
+
+#define PROFILE_TIMER 1
+
+volatile int profiling=0;
+volatile LONG profile_generation=0;
+HWND hWndProfiler=NULL;
+
+
+//  4 bins per octave: bin 0..3 are exact, then the 2 bits below the highest bit
+int profile_bin(LONGLONG ticks)
+{
+	int e,bin;
+
+	if (ticks<4) return(ticks<0 ? 0 : (int)ticks);
+	for (e=2;(e<62)&&(ticks>>(e+1));e++);
+	bin=4*(e-1)+(int)((ticks>>(e-2))&3);
+	if (bin>=PROFILE_BINS) bin=PROFILE_BINS-1;
+	return(bin);
+}
+
+//  upper bound of the durations in a bin
+LONGLONG profile_bin_value(int bin)
+{
+	int e,m;
+
+	if (bin<4) return(bin);
+	e=bin/4+1; m=bin%4;
+	return(((LONGLONG)(5+m)<<(e-2))-1);
+}
+
+void profile_add(PROFILECOUNTERStruct * c, LONGLONG ticks)
+{
+	if ((!c->calls)||(ticks<c->min)) c->min=ticks;
+	if (ticks>c->max) c->max=ticks;
+	c->total+=ticks;
+	c->calls++;
+	c->bins[profile_bin(ticks)]++;
+}
+
+PROFILEStruct * get_profile(BASE_CL * ob)
+{
+	PROFILEStruct * p=ob->prof;
+	LONG gen=profile_generation;
+
+	if (!p)
+	{
+		p = new PROFILEStruct;
+		memset(p,0,sizeof(PROFILEStruct));
+		p->generation=gen;
+		if (InterlockedCompareExchangePointer((PVOID volatile *)&ob->prof,p,NULL)!=NULL)
+		{   // another thread was first
+			delete p;
+			p=ob->prof;
+		}
+	}
+	if (p->generation!=gen)
+	{   // reset_profile() was called
+		memset(p,0,sizeof(PROFILEStruct));
+		p->generation=gen;
+	}
+	return(p);
+}
+
+//  the profile for display and export, NULL when it was not used since the last reset
+PROFILEStruct * valid_profile(BASE_CL * ob)
+{
+	PROFILEStruct * p=ob->prof;
+
+	if ((!p) || (p->generation!=profile_generation)) return(NULL);
+	return(p);
+}
+
+void profile_work(BASE_CL * ob, int count)
+{
+	PROFILEStruct * p;
+	LONGLONG t0,t1;
+
+	get_profile(ob)->replay=0;
+	QueryPerformanceCounter((_LARGE_INTEGER *)&t0);
+	call_object(ob,count);
+	QueryPerformanceCounter((_LARGE_INTEGER *)&t1);
+	p=get_profile(ob);
+	profile_add(&p->work,t1-t0-p->replay);
+}
+
+//  incoming_data() - call of the block replay, see BASE_CL::work_block
+void profile_incoming(BASE_CL * ob, int port, float value)
+{
+	PROFILEStruct * p;
+	LONGLONG t0,t1;
+
+	QueryPerformanceCounter((_LARGE_INTEGER *)&t0);
+	ob->incoming_data(port,value);
+	QueryPerformanceCounter((_LARGE_INTEGER *)&t1);
+	p=get_profile(ob);
+	profile_add(&p->incoming,t1-t0);
+	p->replay+=t1-t0;
+}
+
+//  called by the output elements when they act on the actual packet
+void record_latency(BASE_CL * ob)
+{
+	LONGLONG now;
+
+	if (!PACKET.timestamp) return;
+	QueryPerformanceCounter((_LARGE_INTEGER *)&now);
+	profile_add(&get_profile(ob)->latency,now-PACKET.timestamp);
+}
+
+void BASE_CL::profile_pass_values(int port, float value)
+{
+	FANOUTStruct * f, * end;
+	LONGLONG t0,t1,t2;
+
+	QueryPerformanceCounter((_LARGE_INTEGER *)&t0);
+	t1=t0;
+	for (f=&fanout[fanout_start[port]],end=&fanout[fanout_start[port+1]];f<end;f++)
+	{
+		f->obj->incoming_data(f->port, value);
+		QueryPerformanceCounter((_LARGE_INTEGER *)&t2);
+		profile_add(&get_profile(f->obj)->incoming,t2-t1);
+		t1=t2;
+	}
+	profile_add(&get_profile(this)->pass,t1-t0);
+}
+
+void BASE_CL::profile_pass_values(int port, float * value, int count)
+{
+	FANOUTStruct * f, * end;
+	LONGLONG t0,t1,t2;
+
+	QueryPerformanceCounter((_LARGE_INTEGER *)&t0);
+	t1=t0;
+	for (f=&fanout[fanout_start[port]],end=&fanout[fanout_start[port+1]];f<end;f++)
+	{
+		f->obj->incoming_data(f->port, value, count);
+		QueryPerformanceCounter((_LARGE_INTEGER *)&t2);
+		profile_add(&get_profile(f->obj)->incoming,t2-t1);
+		t1=t2;
+	}
+	profile_add(&get_profile(this)->pass,t1-t0);
+}
+
+
+void reset_profile(void)
+{
+	InterlockedIncrement(&profile_generation);
+}
+
+double ticks_to_us(LONGLONG ticks)
+{
+	return((double)ticks*1000000.0/(double)TIMING.pcfreq);
+}
+
+//  99th percentile in microseconds (upper bound of the bin)
+double profile_p99(PROFILECOUNTERStruct * c)
+{
+	long limit,sum=0;
+	int b;
+
+	if (!c->calls) return(0);
+	limit=c->calls-c->calls/100;
+	for (b=0;b<PROFILE_BINS;b++)
+	{
+		sum+=c->bins[b];
+		if (sum>=limit) break;
+	}
+	if (b>=PROFILE_BINS) b=PROFILE_BINS-1;
+	if (profile_bin_value(b)>c->max) return(ticks_to_us(c->max));
+	return(ticks_to_us(profile_bin_value(b)));
+}
+
+double profile_avg(PROFILECOUNTERStruct * c)
+{
+	if (!c->calls) return(0);
+	return(ticks_to_us(c->total)/c->calls);
+}
+
+LONGLONG profile_cost(BASE_CL * ob)
+{
+	PROFILEStruct * p=valid_profile(ob);
+
+	if (!p) return(0);
+	return(p->work.total+p->incoming.total);
+}
+
+//  fills order with the object indices, most expensive first
+int sort_profile(int * order)
+{
+	int t,i,n;
+
+	n=0;
+	for (t=0;t<GLOBAL.objects;t++)
+	{
+		for (i=n;(i>0)&&(profile_cost(objects[order[i-1]])<profile_cost(objects[t]));i--)
+			order[i]=order[i-1];
+		order[i]=t;
+		n++;
+	}
+	return(n);
+}
+
+
+int export_profile(char * filename)
+{
+	char str[512];
+	HANDLE hFile;
+	DWORD dwWritten;
+	PROFILECOUNTERStruct * c[4];
+	int * order;
+	int t,n,i;
+
+	hFile=CreateFile(filename, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile==INVALID_HANDLE_VALUE) return(FALSE);
+
+	strcpy(str,"element,index,type");
+	strcat(str,",work_calls,work_total_ms,work_avg_us,work_min_us,work_max_us,work_p99_us");
+	strcat(str,",incoming_calls,incoming_total_ms,incoming_avg_us,incoming_min_us,incoming_max_us,incoming_p99_us");
+	strcat(str,",pass_calls,pass_total_ms,pass_avg_us,pass_min_us,pass_max_us,pass_p99_us");
+	strcat(str,",latency_calls,latency_total_ms,latency_avg_us,latency_min_us,latency_max_us,latency_p99_us\r\n");
+	WriteFile(hFile,str,strlen(str),&dwWritten,NULL);
+
+	order=(int *)malloc((GLOBAL.objects+1)*sizeof(int));
+	n = order ? sort_profile(order) : 0;
+	for (i=0;i<n;i++)
+	{
+		BASE_CL * ob=objects[order[i]];
+		PROFILEStruct * p=valid_profile(ob);
+		if (!p) continue;
+		sprintf(str,"\"%s\",%d,%s",ob->tag,order[i],objnames[ob->type]);
+		WriteFile(hFile,str,strlen(str),&dwWritten,NULL);
+		c[0]=&p->work; c[1]=&p->incoming; c[2]=&p->pass; c[3]=&p->latency;
+		for (t=0;t<4;t++)
+		{
+			sprintf(str,",%ld,%.3f,%.2f,%.2f,%.2f,%.2f",c[t]->calls,ticks_to_us(c[t]->total)/1000.0,
+				profile_avg(c[t]),ticks_to_us(c[t]->min),ticks_to_us(c[t]->max),profile_p99(c[t]));
+			WriteFile(hFile,str,strlen(str),&dwWritten,NULL);
+		}
+		WriteFile(hFile,"\r\n",2,&dwWritten,NULL);
+	}
+	free(order);
+	CloseHandle(hFile);
+	write_logfile("execution profile saved: %s",filename);
+	return(TRUE);
+}
+
+//  writes the latency histograms of the output elements to the logfile
+void log_latency(void)
+{
+	char str[512],tmp[40];
+	PROFILECOUNTERStruct * c;
+	int t,b,last;
+
+	for (t=0;t<GLOBAL.objects;t++)
+	{
+		PROFILEStruct * p=valid_profile(objects[t]);
+		if ((!p) || (!(c=&p->latency)->calls)) continue;
+		write_logfile("latency %s (%s): %ld actions, avg %.2f ms, p99 %.2f ms, min %.2f ms, max %.2f ms",
+			objects[t]->tag, objnames[objects[t]->type], c->calls, profile_avg(c)/1000.0,
+			profile_p99(c)/1000.0, ticks_to_us(c->min)/1000.0, ticks_to_us(c->max)/1000.0);
+
+		for (last=PROFILE_BINS-1;(last>0)&&(!c->bins[last]);last--);
+		strcpy(str,"  histogram (<= ms:count)");
+		for (b=0;(b<=last)&&(strlen(str)<sizeof(str)-sizeof(tmp));b++)
+		{
+			if (!c->bins[b]) continue;
+			sprintf(tmp," %.2f:%u",ticks_to_us(profile_bin_value(b))/1000.0,c->bins[b]);
+			strcat(str,tmp);
+		}
+		write_logfile("%s",str);
+	}
+}
+
+//  called when a session stops
+void save_profile(void)
+{
+	char filename[MAX_PATH];
+
+	log_latency();
+	if (!profiling) return;
+	strcpy(filename,GLOBAL.resourcepath);
+	strcat(filename,"profile.csv");
+	export_profile(filename);
+}
+
+
+void update_profiler_list(HWND hDlg)
+{
+	char str[256];
+	int * order;
+	int i,n,top;
+	PROFILEStruct * p;
+
+	order=(int *)malloc((GLOBAL.objects+1)*sizeof(int));
+	if (!order) return;
+	n=sort_profile(order);
+
+	top=(int)SendDlgItemMessage(hDlg,IDC_PROFILELIST,LB_GETTOPINDEX,0,0);
+	SendDlgItemMessage(hDlg,IDC_PROFILELIST,WM_SETREDRAW,FALSE,0);
+	SendDlgItemMessage(hDlg,IDC_PROFILELIST,LB_RESETCONTENT,0,0);
+	SendDlgItemMessage(hDlg,IDC_PROFILELIST,LB_ADDSTRING,0,(LPARAM)
+		"Element\twork calls\tavg us\tp99 us\tmax us\ttotal ms\tincoming\tavg us\tpass\tavg us\tlatency\tavg ms\tp99 ms");
+	for (i=0;i<n;i++)
+	{
+		if (!(p=valid_profile(objects[order[i]]))) continue;
+		sprintf(str,"%s\t%ld\t%.1f\t%.1f\t%.1f\t%.1f\t%ld\t%.1f\t%ld\t%.1f\t%ld\t%.2f\t%.2f",
+			objects[order[i]]->tag, p->work.calls, profile_avg(&p->work), profile_p99(&p->work),
+			ticks_to_us(p->work.max), ticks_to_us(p->work.total)/1000.0,
+			p->incoming.calls, profile_avg(&p->incoming), p->pass.calls, profile_avg(&p->pass),
+			p->latency.calls, profile_avg(&p->latency)/1000.0, profile_p99(&p->latency)/1000.0);
+		SendDlgItemMessage(hDlg,IDC_PROFILELIST,LB_ADDSTRING,0,(LPARAM)str);
+	}
+	SendDlgItemMessage(hDlg,IDC_PROFILELIST,LB_SETTOPINDEX,top,0);
+	SendDlgItemMessage(hDlg,IDC_PROFILELIST,WM_SETREDRAW,TRUE,0);
+	InvalidateRect(GetDlgItem(hDlg,IDC_PROFILELIST),NULL,TRUE);
+	free(order);
+}
+
+
+LRESULT CALLBACK ProfilerDlgHandler(HWND hDlg, UINT message, WPARAM wParam, LPARAM lParam)
+{
+	static int tabs[12] = { 90, 130, 160, 190, 220, 255, 290, 320, 350, 380, 420, 455 };
+	char szFileName[MAX_PATH];
+
+	switch( message )
+	{
+		case WM_INITDIALOG:
+			SendDlgItemMessage(hDlg,IDC_PROFILELIST,LB_SETTABSTOPS,12,(LPARAM)tabs);
+			CheckDlgButton(hDlg,IDC_PROFILEENABLE,profiling);
+			update_profiler_list(hDlg);
+			SetTimer(hDlg,PROFILE_TIMER,500,NULL);
+			return TRUE;
+
+		case WM_TIMER:
+			if ((profiling) || (GLOBAL.running)) update_profiler_list(hDlg);
+			break;
+
+		case WM_CLOSE:
+			KillTimer(hDlg,PROFILE_TIMER);
+			DestroyWindow(hDlg);
+			hWndProfiler=NULL;
+			break;
+
+		case WM_COMMAND:
+			switch (LOWORD(wParam))
+			{
+				case IDC_PROFILEENABLE:
+					profiling=IsDlgButtonChecked(hDlg,IDC_PROFILEENABLE);
+					write_logfile("execution profiler %s",profiling ? "enabled" : "disabled");
+					break;
+				case IDC_PROFILERESET:
+					reset_profile();
+					update_profiler_list(hDlg);
+					break;
+				case IDC_PROFILEEXPORT:
+					strcpy(szFileName,GLOBAL.resourcepath);
+					strcat(szFileName,"profile.csv");
+					if (open_file_dlg(hDlg,szFileName,FT_CSV,OPEN_SAVE))
+					{
+						if (!export_profile(szFileName)) report_error("Could not write the profile");
+					}
+					break;
+			}
+			break;
+	}
+	return FALSE;
+}
+
+void open_profiler(void)
+{
+	if (hWndProfiler) SetForegroundWindow(hWndProfiler);
+	else hWndProfiler=CreateDialog(hInst, (LPCTSTR)IDD_PROFILERBOX, ghWndStatusbox, (DLGPROC)ProfilerDlgHandler);
+}
@@ -0,0 +1,249 @@
+/* -----------------------------------------------------------------------------
+
+  BrainBay  -  Version 2.0, GPL 2003-2017
+
+  MODULE:  RECORDER.CPP
+  Author:  Chris Veigl
+
+
+  This Module writes the archive file (the recording of the raw device data):
+
+  The bytes received from the device are appended to a ring of large buffers
+  by record_bytes(), which is called from ParseLocalInput on the reader thread
+  and only copies the data. For the compressed archives, record_packet() copies
+  the decoded packets instead, they are coded by the writer thread (see
+  archive.cpp). A writer thread writes the full buffers to the
+  archive file (for the text-mode archives the values are formatted by the writer
+  thread). A partly filled buffer is written after RECORDER_LATENCY milliseconds.
+
+  When the disk stalls and all buffers are full, the received bytes are dropped
+  and counted, the count is shown in the status bar and written to the logfile
+  when the archive is closed.
+
+  The flush policy (application settings) selects when the data is forced to
+  the disk via FlushFileBuffers: never (left to the cache of the operating
+  system), once per second or after every written buffer.
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; See the
+  GNU General Public License for more details.
+
+
+--------------------------------------------------------------------------------*/
+
+
+#include "brainBay.h"
+
+#define RECORDER_LATENCY 250
+
+RECORDERStruct RECORDER;
+
+char recordflushnames[][20] = { "never (OS cache)", "every second", "every buffer", "\0" };
+
+
+void record_data(unsigned char * buf, int len)
+{
+	int n;
+
+	if (!RECORDER.cs_init) return;
+	EnterCriticalSection(&RECORDER.cs);
+	while ((len>0) && (RECORDER.active))
+	{
+		if (RECORDER.fill[RECORDER.head]==RECORDER_BUFSIZE)
+		{
+			if (RECORDER.count+1>=RECORDER_BUFFERS)
+			{   // all buffers wait for the disk
+				RECORDER.dropped+=len;
+				break;
+			}
+			RECORDER.count++;
+			RECORDER.head=(RECORDER.head+1)%RECORDER_BUFFERS;
+			RECORDER.fill[RECORDER.head]=0;
+			SetEvent(RECORDER.event);
+		}
+		n=RECORDER_BUFSIZE-RECORDER.fill[RECORDER.head];
+		if (n>len) n=len;
+		memcpy(RECORDER.buffer[RECORDER.head]+RECORDER.fill[RECORDER.head],buf,n);
+		RECORDER.fill[RECORDER.head]+=n;
+		buf+=n; len-=n;
+	}
+	LeaveCriticalSection(&RECORDER.cs);
+}
+
+//  called on the reader thread
+void record_bytes(unsigned char * buf, int len)
+{
+	if (RECORDER.filetype!=FILE_COMPRESSED) record_data(buf,len);
+}
+
+//  called by process_packets, when a packet was decoded
+void record_packet(void)
+{
+	ARCHIVEPACKETStruct packet;
+
+	if ((!RECORDER.active) || (RECORDER.filetype!=FILE_COMPRESSED)) return;
+	memcpy(packet.buffer,PACKET.buffer,sizeof(packet.buffer));
+	packet.switches=PACKET.switches;
+	if (PACKET.arrival) packet.arrival=PACKET.arrival;
+	else QueryPerformanceCounter((_LARGE_INTEGER *)&packet.arrival);
+	record_data((unsigned char *)&packet,sizeof(packet));
+}
+
+
+int write_recorder_text(unsigned char * buf, int len)
+{
+	char text[4096],str[10];
+	DWORD dwWritten;
+	int i,pos=0;
+
+	for (i=0;i<len;i++)
+	{
+		wsprintf(str, "%d, ", (int) buf[i]);
+		while (strlen(str)<5) strcat(str," ");
+		if (++RECORDER.column==TTY.bytes_per_packet)
+		{
+			strcat (str,"\r\n ");
+			RECORDER.column=0;
+		}
+		strcpy(text+pos,str);
+		pos+=strlen(str);
+		if ((pos>(int)(sizeof(text)-sizeof(str))) || (i==len-1))
+		{
+			if (!WriteFile(RECORDER.file,text,pos,&dwWritten,NULL)) return(FALSE);
+			pos=0;
+		}
+	}
+	return(TRUE);
+}
+
+int write_recorder_buffer(unsigned char * buf, int len)
+{
+	DWORD dwWritten;
+	int res;
+
+	if (RECORDER.filetype==FILE_COMPRESSED) return(write_archive_packets(buf,len));
+	if (RECORDER.filetype==FILE_TEXTMODE) res=write_recorder_text(buf,len);
+	else res=WriteFile(RECORDER.file,buf,len,&dwWritten,NULL) && (dwWritten==(DWORD)len);
+	if (res) RECORDER.written+=len;
+	return(res);
+}
+
+
+DWORD WINAPI RecorderProc(LPVOID lpv)
+{
+	DWORD lastflush,now;
+	int tail,exit;
+
+	lastflush=GetTickCount();
+	do
+	{
+		WaitForSingleObject(RECORDER.event,RECORDER_LATENCY);
+		exit=RECORDER.exit;
+
+		EnterCriticalSection(&RECORDER.cs);
+		if ((!RECORDER.count) && (RECORDER.fill[RECORDER.head]) &&
+			(RECORDER.count+1<RECORDER_BUFFERS))
+		{   // write the partly filled buffer
+			RECORDER.count++;
+			RECORDER.head=(RECORDER.head+1)%RECORDER_BUFFERS;
+			RECORDER.fill[RECORDER.head]=0;
+		}
+		LeaveCriticalSection(&RECORDER.cs);
+
+		while (RECORDER.count)
+		{
+			tail=RECORDER.tail;
+			if (!RECORDER.error)
+			{
+				if (!write_recorder_buffer(RECORDER.buffer[tail],RECORDER.fill[tail]))
+					RECORDER.error=GetLastError();
+				else if (RECORDER.flush==FLUSH_BUFFER) FlushFileBuffers(RECORDER.file);
+			}
+
+			EnterCriticalSection(&RECORDER.cs);
+			if (RECORDER.error) RECORDER.dropped+=RECORDER.fill[tail];
+			RECORDER.tail=(tail+1)%RECORDER_BUFFERS;
+			RECORDER.count--;
+			LeaveCriticalSection(&RECORDER.cs);
+		}
+
+		now=GetTickCount();
+		if ((RECORDER.flush==FLUSH_SECOND) && (now-lastflush>=1000))
+		{
+			FlushFileBuffers(RECORDER.file);
+			lastflush=now;
+		}
+	} while (!exit);
+
+	return(0);
+}
+
+
+int start_recorder(HANDLE hFile, int filetype)
+{
+	DWORD dwThreadId;
+	int i;
+
+	stop_recorder();
+	for (i=0;i<RECORDER_BUFFERS;i++)
+	{
+		if (!RECORDER.buffer[i]) RECORDER.buffer[i]=(unsigned char *)malloc(RECORDER_BUFSIZE);
+		if (!RECORDER.buffer[i]) { report_error("Could not allocate archive buffers"); return(FALSE); }
+		RECORDER.fill[i]=0;
+	}
+	RECORDER.file=hFile;
+	RECORDER.filetype=filetype;
+	RECORDER.flush=GLOBAL.record_flush;
+	RECORDER.head=0; RECORDER.tail=0; RECORDER.count=0;
+	RECORDER.column=0;
+	RECORDER.written=0; RECORDER.dropped=0; RECORDER.error=0;
+	RECORDER.exit=0;
+	if ((filetype==FILE_COMPRESSED) && (!start_archive_writer(hFile))) return(FALSE);
+
+	if (!RECORDER.cs_init) { InitializeCriticalSection(&RECORDER.cs); RECORDER.cs_init=TRUE; }
+	RECORDER.event=CreateEvent(NULL,FALSE,FALSE,NULL);
+	RECORDER.thread=CreateThread(NULL,0,(LPTHREAD_START_ROUTINE)RecorderProc,0,0,&dwThreadId);
+	if (!RECORDER.thread)
+	{
+		CloseHandle(RECORDER.event);
+		report_error("Could not create archive writer thread");
+		return(FALSE);
+	}
+	RECORDER.active=TRUE;
+	return(TRUE);
+}
+
+
+//  writes the remaining data, called before the archive file is closed
+void stop_recorder(void)
+{
+	if (!RECORDER.thread) return;
+
+	EnterCriticalSection(&RECORDER.cs);
+	RECORDER.active=FALSE;
+	LeaveCriticalSection(&RECORDER.cs);
+
+	RECORDER.exit=1;
+	SetEvent(RECORDER.event);
+	WaitForSingleObject(RECORDER.thread,INFINITE);
+
+	// the partly filled buffer, when the ring was full at the exit
+	if ((RECORDER.fill[RECORDER.head]) && (!RECORDER.error))
+	{
+		if (!write_recorder_buffer(RECORDER.buffer[RECORDER.head],RECORDER.fill[RECORDER.head]))
+			RECORDER.error=GetLastError();
+	}
+	if ((RECORDER.filetype==FILE_COMPRESSED) && (!RECORDER.error))
+	{
+		if (!finish_archive_writer()) RECORDER.error=GetLastError();
+	}
+	if (RECORDER.flush!=FLUSH_NONE) FlushFileBuffers(RECORDER.file);
+
+	CloseHandle(RECORDER.thread);
+	CloseHandle(RECORDER.event);
+	RECORDER.thread=NULL;
+
+	write_logfile("archive recorder: %ld bytes written, %ld bytes dropped",RECORDER.written,RECORDER.dropped);
+	if (RECORDER.error) report_error("Could not write to Archive");
+}
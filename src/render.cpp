@@ -0,0 +1,363 @@
+/* -----------------------------------------------------------------------------
+
+  BrainBay  -  Version 2.0, GPL 2003-2017
+
+  MODULE:  RENDER.CPP
+  Author:  Chris Veigl
+
+
+  This Module decouples the display updates from the signal processing:
+
+  The work() - functions of the elements don't call USER32 for their windows
+  and dialogs directly, but publish the new display state:
+
+        publish_invalidate   - InvalidateRect
+        publish_dlg_text     - SetDlgItemText   (publish_dlg_int: SetDlgItemInt)
+        publish_window_text  - SetWindowText and a redraw of the window
+        publish_scroll_pos   - SetScrollPos of a scrollbar control
+        publish_enable       - EnableWindow of a dialog control
+        publish_list_item    - add_to_listbox, the lines are queued, not merged
+        publish_command      - PostMessage(WM_COMMAND), e.g. IDC_STOPSESSION
+
+  The published state is kept in the RENDER - structure, one item per window
+  or dialog control and kind. Publishing only copies the value under a critical
+  section, so a display update never makes the processing thread wait for
+  USER32 / GDI. The SESSIONTIME element still sends IDC_STOPSESSION
+  synchronously, because the session has to end before the next packet
+  (pause_processing() allows for this, see schedule.cpp).
+  When all MAX_RENDERITEMS items are in use, or RENDER_LISTSIZE bytes of
+  listbox lines are waiting, the update is lost: it is counted and logged.
+
+  The render thread wakes up RENDER_FPS times per second, takes a snapshot of
+  the changed items (into its own frame buffers) and applies them to the
+  windows. Repeated updates of the same item between two frames are merged.
+
+  Only the window updates are deferred here. The data which a window draws
+  in WM_PAINT stays in the element: the Oscilloscope hands its new pixels
+  over in a front and back buffer (see ob_osci.cpp), the other display
+  elements read their values directly.
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; See the
+  GNU General Public License for more details.
+
+
+--------------------------------------------------------------------------------*/
+
+
+#include "brainBay.h"
+
+#define RI_INVALIDATE 0
+#define RI_TEXT       1
+#define RI_WINDOWTEXT 2
+#define RI_SCROLL     3
+#define RI_ENABLE     4
+#define RI_LIST       5
+#define RI_COMMAND    6
+
+RENDERStruct RENDER;
+
+
+//  returns the item for the window / control, creates a new one if necessary.
+//  call with RENDER.cs entered
+RENDERITEMStruct * get_render_item(HWND hWnd, int id, int kind)
+{
+	RENDERITEMStruct * item;
+	int i;
+
+	for (i=0;i<RENDER.count;i++)
+	{
+		item=&RENDER.item[i];
+		if ((item->hWnd==hWnd) && (item->id==id) && (item->kind==kind)) return(item);
+	}
+	if (RENDER.count>=MAX_RENDERITEMS) { RENDER.overflows++; return(NULL); }
+
+	item=&RENDER.item[RENDER.count++];
+	item->hWnd=hWnd;
+	item->id=id;
+	item->kind=kind;
+	item->erase=FALSE;
+	item->value=0;
+	item->textlen=0;
+	item->dirty=FALSE;
+	return(item);
+}
+
+
+void publish_invalidate(HWND hWnd, BOOL erase)
+{
+	RENDERITEMStruct * item;
+
+	if (!hWnd) return;
+	if (!RENDER.active) { InvalidateRect(hWnd,NULL,erase); return; }
+
+	EnterCriticalSection(&RENDER.cs);
+	if ((item=get_render_item(hWnd,0,RI_INVALIDATE)))
+	{
+		item->erase|=erase;
+		item->dirty=TRUE;
+	}
+	LeaveCriticalSection(&RENDER.cs);
+}
+
+
+//  copies a text item, call with RENDER.cs entered
+void store_render_text(HWND hWnd, int id, int kind, const char * text)
+{
+	RENDERITEMStruct * item;
+	int len;
+
+	len=(int)strlen(text)+1;
+	if ((item=get_render_item(hWnd,id,kind)))
+	{
+		if (len>item->textsize)
+		{
+			char * t=(char *)realloc(item->text,len);
+			if (!t) { RENDER.overflows++; return; }
+			item->text=t;
+			item->textsize=len;
+		}
+		memcpy(item->text,text,len);
+		item->dirty=TRUE;
+	}
+}
+
+
+void publish_dlg_text(HWND hDlg, int id, const char * text)
+{
+	if (!hDlg) return;
+	if (!RENDER.active) { SetDlgItemText(hDlg,id,text); return; }
+
+	EnterCriticalSection(&RENDER.cs);
+	store_render_text(hDlg,id,RI_TEXT,text);
+	LeaveCriticalSection(&RENDER.cs);
+}
+
+
+void publish_window_text(HWND hWnd, const char * text)
+{
+	if (!hWnd) return;
+	if (!RENDER.active) { SetWindowText(hWnd,text); InvalidateRect(hWnd,NULL,TRUE); return; }
+
+	EnterCriticalSection(&RENDER.cs);
+	store_render_text(hWnd,0,RI_WINDOWTEXT,text);
+	LeaveCriticalSection(&RENDER.cs);
+}
+
+
+void publish_dlg_int(HWND hDlg, int id, int value, BOOL bSigned)
+{
+	char szdata[20];
+
+	if (bSigned) wsprintf(szdata,"%d",value);
+	else wsprintf(szdata,"%u",(unsigned int)value);
+	publish_dlg_text(hDlg,id,szdata);
+}
+
+
+//  the last value of a scroll position, enable state or command is kept
+void publish_value(HWND hWnd, int id, int kind, int value)
+{
+	RENDERITEMStruct * item;
+
+	EnterCriticalSection(&RENDER.cs);
+	if ((item=get_render_item(hWnd,id,kind)))
+	{
+		item->value=value;
+		item->dirty=TRUE;
+	}
+	LeaveCriticalSection(&RENDER.cs);
+}
+
+
+void publish_scroll_pos(HWND hDlg, int id, int pos)
+{
+	if (!hDlg) return;
+	if (!RENDER.active) { SetScrollPos(GetDlgItem(hDlg,id),SB_CTL,pos,TRUE); return; }
+	publish_value(hDlg,id,RI_SCROLL,pos);
+}
+
+
+void publish_enable(HWND hDlg, int id, BOOL enable)
+{
+	if (!hDlg) return;
+	if (!RENDER.active) { EnableWindow(GetDlgItem(hDlg,id),enable); return; }
+	publish_value(hDlg,id,RI_ENABLE,enable);
+}
+
+
+//  a command which is published several times before the frame is posted once
+void publish_command(HWND hWnd, int command)
+{
+	if (!hWnd) return;
+	if (!RENDER.active) { SendMessage(hWnd,WM_COMMAND,command,0); return; }
+	publish_value(hWnd,command,RI_COMMAND,command);
+}
+
+
+//  the lines of a listbox are appended, every line is added in the next frame
+void publish_list_item(HWND hDlg, int id, const char * text)
+{
+	RENDERITEMStruct * item;
+	int len;
+
+	if (!hDlg) return;
+	if (!RENDER.active) { add_to_listbox(hDlg,id,(char *)text); return; }
+
+	len=(int)strlen(text)+1;
+	EnterCriticalSection(&RENDER.cs);
+	if ((item=get_render_item(hDlg,id,RI_LIST)))
+	{
+		if (item->textlen+len>RENDER_LISTSIZE) RENDER.overflows++;
+		else
+		{
+			if (item->textlen+len>item->textsize)
+			{
+				char * t=(char *)realloc(item->text,RENDER_LISTSIZE);
+				if (t) { item->text=t; item->textsize=RENDER_LISTSIZE; }
+			}
+			if (item->textlen+len<=item->textsize)
+			{
+				memcpy(item->text+item->textlen,text,len);
+				item->textlen+=len;
+				item->dirty=TRUE;
+			}
+			else RENDER.overflows++;
+		}
+	}
+	LeaveCriticalSection(&RENDER.cs);
+}
+
+
+//  forgets all items, called when objects (and their windows) are deleted
+void clear_render_items(void)
+{
+	if (!RENDER.active) return;
+	EnterCriticalSection(&RENDER.cs);
+	for (int i=0;i<RENDER.count;i++) { RENDER.item[i].dirty=FALSE; RENDER.item[i].textlen=0; }
+	RENDER.count=0;
+	LeaveCriticalSection(&RENDER.cs);
+}
+
+
+void render_frame(void)
+{
+	HWND hWnd[MAX_RENDERITEMS];
+	int id[MAX_RENDERITEMS], kind[MAX_RENDERITEMS], erase[MAX_RENDERITEMS], slot[MAX_RENDERITEMS];
+	int value[MAX_RENDERITEMS];
+	RENDERITEMStruct * item;
+	char * line;
+	int i,n,len;
+	long overflows;
+
+	// snapshot of the changed items
+	n=0;
+	EnterCriticalSection(&RENDER.cs);
+	for (i=0;i<RENDER.count;i++)
+	{
+		item=&RENDER.item[i];
+		if (!item->dirty) continue;
+		if ((item->kind==RI_TEXT) || (item->kind==RI_WINDOWTEXT) || (item->kind==RI_LIST))
+		{
+			len=(item->kind==RI_LIST) ? item->textlen : (int)strlen(item->text)+1;
+			if (len>item->framesize)
+			{
+				char * f=(char *)realloc(item->frame,len);
+				if (!f) continue;
+				item->frame=f;
+				item->framesize=len;
+			}
+			memcpy(item->frame,item->text,len);
+			item->framelen=len;
+			item->textlen=0;
+		}
+		hWnd[n]=item->hWnd; id[n]=item->id; kind[n]=item->kind; erase[n]=item->erase; slot[n]=i;
+		value[n]=item->value;
+		item->dirty=FALSE;
+		item->erase=FALSE;
+		n++;
+	}
+	overflows=RENDER.overflows;
+	LeaveCriticalSection(&RENDER.cs);
+
+	// only the render thread touches the frame buffers
+	for (i=0;i<n;i++)
+	{
+		item=&RENDER.item[slot[i]];
+		switch (kind[i])
+		{
+			case RI_INVALIDATE: InvalidateRect(hWnd[i],NULL,erase[i]); break;
+			case RI_TEXT:       SetDlgItemText(hWnd[i],id[i],item->frame); break;
+			case RI_WINDOWTEXT: SetWindowText(hWnd[i],item->frame); InvalidateRect(hWnd[i],NULL,TRUE); break;
+			case RI_SCROLL:     SetScrollPos(GetDlgItem(hWnd[i],id[i]),SB_CTL,value[i],TRUE); break;
+			case RI_ENABLE:     EnableWindow(GetDlgItem(hWnd[i],id[i]),value[i]); break;
+			case RI_COMMAND:    PostMessage(hWnd[i],WM_COMMAND,value[i],0); break;
+			case RI_LIST:
+				for (line=item->frame;line<item->frame+item->framelen;line+=strlen(line)+1)
+					add_to_listbox(hWnd[i],id[i],line);
+				break;
+		}
+	}
+	if (overflows!=RENDER.logged)
+	{
+		write_logfile("render: %ld display updates lost, %d items in use",overflows-RENDER.logged,RENDER.count);
+		RENDER.logged=overflows;
+	}
+	RENDER.frames++;
+}
+
+
+DWORD WINAPI RenderProc(LPVOID lpv)
+{
+	while (WaitForSingleObject(RENDER.exit_event,1000/RENDER_FPS)==WAIT_TIMEOUT)
+		render_frame();
+	return(0);
+}
+
+
+void start_render(void)
+{
+	DWORD dwThreadId;
+
+	InitializeCriticalSection(&RENDER.cs);
+	RENDER.count=0;
+	RENDER.frames=0;
+	RENDER.overflows=0;
+	RENDER.logged=0;
+	RENDER.exit_event=CreateEvent(NULL,TRUE,FALSE,NULL);
+	RENDER.thread=CreateThread(NULL,0,(LPTHREAD_START_ROUTINE)RenderProc,0,0,&dwThreadId);
+	if (!RENDER.thread)
+	{
+		report_error("Could not create render thread");
+		return;
+	}
+	RENDER.active=TRUE;
+}
+
+
+void stop_render(void)
+{
+	MSG msg;
+	int i;
+
+	if (!RENDER.active) return;
+	SetEvent(RENDER.exit_event);
+
+	// SetDlgItemText of the render thread sends messages to our windows
+	while (MsgWaitForMultipleObjects(1,&RENDER.thread,FALSE,INFINITE,QS_SENDMESSAGE)==WAIT_OBJECT_0+1)
+		PeekMessage(&msg,NULL,0,0,PM_NOREMOVE);
+
+	RENDER.active=FALSE;
+	CloseHandle(RENDER.thread);
+	CloseHandle(RENDER.exit_event);
+	for (i=0;i<MAX_RENDERITEMS;i++)
+	{
+		if (RENDER.item[i].text) free(RENDER.item[i].text);
+		if (RENDER.item[i].frame) free(RENDER.item[i].frame);
+		RENDER.item[i].text=NULL;  RENDER.item[i].textsize=0; RENDER.item[i].textlen=0;
+		RENDER.item[i].frame=NULL; RENDER.item[i].framesize=0; RENDER.item[i].framelen=0;
+	}
+	RENDER.count=0;
+	DeleteCriticalSection(&RENDER.cs);
+}
@@ -93,6 +93,8 @@
 #define IDD_SESSIONMANAGERBOX           256
 #define IDD_KEYCAPTUREBOX               257
 #define IDD_BUTTONBOX                   258
+#define IDD_PROFILERBOX                 259
+#define IDD_AUXDEVICEBOX                260
 #define IDC_PORTCOMBO                   1000
 #define IDC_BAUDCOMBO                   1001
 #define IDC_DEVICECOMBO                 1002
@@ -656,6 +658,8 @@
 #define IDC_RESLABEL                    1485
 #define IDC_RESLABEL2                   1486
 #define IDC_CHNFROMPORT                 1487
+#define IDC_BDFFORMAT                   1539
+#define IDC_CHNSAMPLES                  1540
 #define IDC_DELAYTIME                   1490
 #define IDC_LOWERLIMIT                  1491
 #define IDC_UPPERLIMIT                  1492
@@ -738,6 +742,19 @@
 #define IDC_VALUE2                      1523
 #define IDC_FUNCTIONCOMBO               1524
 #define IDC_BUTTONCAPTION               1525
+#define IDC_BLOCKSIZE                   1526
+#define IDC_WORKERTHREADS               1527
+#define IDC_PROFILELIST                 1528
+#define IDC_PROFILERESET                1529
+#define IDC_PROFILEENABLE               1530
+#define IDC_PROFILEEXPORT               1531
+#define IDC_RECORDFLUSH                 1532
+#define IDC_CLOCKRESAMPLE               1533
+#define IDC_AUXRATE                     1534
+#define IDC_AUXLATENCY                  1535
+#define IDC_AUXHOLD                     1536
+#define IDC_AUXQUEUED                   1537
+#define IDC_AUXOVERRUNS                 1538
 #define IDM_SETTINGS                    32771
 #define IDM_LOADCONFIG                  32779
 #define IDM_SAVECONFIG                  32780
@@ -892,15 +909,17 @@
 #define IDM_INSERTKEYCAPTURE            32947
 #define ID_OTHERS_BUTTON                32948
 #define IDM_INSERTBUTTON                32949
+#define IDM_PROFILER                    32950
+#define IDM_INSERTAUXDEVICE             32951
 #define IDC_STATIC                      -1
 
 // Next default values for new objects
 // 
 #ifdef APSTUDIO_INVOKED
 #ifndef APSTUDIO_READONLY_SYMBOLS
-#define _APS_NEXT_RESOURCE_VALUE        255
-#define _APS_NEXT_COMMAND_VALUE         32950
-#define _APS_NEXT_CONTROL_VALUE         1525
+#define _APS_NEXT_RESOURCE_VALUE        261
+#define _APS_NEXT_COMMAND_VALUE         32952
+#define _APS_NEXT_CONTROL_VALUE         1541
 #define _APS_NEXT_SYMED_VALUE           110
 #endif
 #endif
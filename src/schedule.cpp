@@ -0,0 +1,631 @@
+/* -----------------------------------------------------------------------------
+
+  BrainBay  -  Version 2.0, GPL 2003-2017
+
+  MODULE:  SCHEDULE.CPP
+  Author:  Chris Veigl
+
+
+  This Module compiles the execution plan of the signal-flow:
+
+  build_plan() creates a directed graph from the link-tables (LINKStruct) of
+  all objects and sorts it topologically (Kahn's algorithm), so that every
+  element is processed after the elements which deliver its input values.
+  The objects[] - array is not reordered any more, the plan holds the execution
+  order, the successors of each element and its level (longest path from a source).
+
+  Connections which form a loop can't be ordered. The loops are found first
+  (strongly connected components, Tarjan's algorithm, see find_loops). When
+  no element is ready any more, the loop is broken at the element with the
+  lowest index inside a loop which gets no more input from outside, so an
+  element below a loop is never moved before its producer. The connections
+  leading back into it are feedback connections: their values are processed
+  with the next packet. Feedback connections are reported to the logfile.
+
+  The links of each object are compiled into its fanout-table: the consumers
+  (object pointer and in-port) of all output ports, grouped by port, so that
+  pass_values() only visits the actual consumers of a port.
+
+  Two plans are kept: a new plan is compiled into the unused one and then
+  activated, so process_packets() always iterates a complete plan. The arrays
+  of a plan grow with the number of objects and links (see reserve_plan).
+  The plan has to be rebuilt whenever objects or connections are changed.
+
+  When more than one worker thread is selected in the application settings,
+  the plan is partitioned for parallel execution (see partition_plan): the
+  branches below the source elements which only contain pure computation
+  elements (filters, averagers, FFT ...) and don't depend on each other are
+  distributed to task lists. execute_plan() runs the sources, then the task
+  lists on the worker threads (the processing thread takes the first list),
+  waits until all of them are finished and then runs the remaining elements
+  in plan order. Every element sees its inputs exactly as in serial execution.
+
+  The tables which the processing threads read (objects[], fanouts, ports,
+  channel buffers) may only be resized while the processing is paused:
+  work_packet() and process_block() are bracketed by enter_processing() and
+  leave_processing(). pause_processing() stops the timer, lets new packets
+  be skipped and waits until every thread (timer, reader, packet ring) has
+  left the processing; resume_processing() continues. Calls may be nested,
+  a pause from inside the processing (a dialog message sent by an element)
+  does not wait for its own thread.
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; See the
+  GNU General Public License for more details.
+
+
+--------------------------------------------------------------------------------*/
+
+
+#include "brainBay.h"
+
+EXECPLANStruct   PLANS[2];
+EXECPLANStruct * EXECPLAN = &PLANS[0];
+
+typedef struct WORKERStruct
+{
+	HANDLE thread;
+	HANDLE start_event;
+	HANDLE done_event;
+	int    task;
+} WORKERStruct;
+
+WORKERStruct   WORKER[MAX_WORKERS];
+int            workers=0;
+volatile int   worker_exit=0;
+volatile int   worker_count=0;
+EXECPLANStruct * volatile worker_plan=NULL;
+
+volatile LONG  processing_active=0;   // threads inside the processing, not nesting levels
+volatile LONG  processing_pause=0;
+volatile DWORD processing_owner=0;
+DWORD          processing_tls=TLS_OUT_OF_INDEXES;
+
+void partition_plan(EXECPLANStruct * plan);
+
+
+//  makes sure that the (inactive) plan can hold count objects and links connections
+int reserve_plan(EXECPLANStruct * plan, int count, int links)
+{
+	int size;
+
+	if ((count>plan->size) || (!plan->order))
+	{
+		size = (count>16) ? count : 16;
+		plan->order=(BASE_CL **)realloc(plan->order,size*sizeof(BASE_CL *));
+		plan->index=(int *)realloc(plan->index,size*sizeof(int));
+		plan->level=(int *)realloc(plan->level,size*sizeof(int));
+		plan->stage=(int *)realloc(plan->stage,size*sizeof(int));
+		plan->task=(int *)realloc(plan->task,size*sizeof(int));
+		plan->succ_start=(int *)realloc(plan->succ_start,(size+1)*sizeof(int));
+		if ((!plan->order)||(!plan->index)||(!plan->level)||(!plan->stage)||(!plan->task)||(!plan->succ_start))
+		{ plan->size=0; return(FALSE); }
+		plan->size=size;
+	}
+	if ((links>plan->succ_size) || (!plan->succ))
+	{
+		size = (links>64) ? links : 64;
+		plan->succ=(int *)realloc(plan->succ,size*sizeof(int));
+		if (!plan->succ) { plan->succ_size=0; return(FALSE); }
+		plan->succ_size=size;
+	}
+	return(TRUE);
+}
+
+
+//  marks the strongly connected components of the signal graph: comp[] gets the
+//  component of every object, the objects of a loop share one component.
+//  Tarjan's algorithm without recursion, work holds 3*n ints, edge n pointers.
+//  returns the number of components
+int find_loops(int n, int * comp, int * work, LINKStruct ** edge)
+{
+	int * num, * low, * stack, * call;
+	int t,v,w,sp,cp,counter,c;
+
+	num=work; low=work+n; stack=work+2*n; call=comp+n;
+	for (t=0;t<n;t++) { num[t]=-1; comp[t]=-1; }
+	sp=0; counter=0; c=0;
+
+	for (t=0;t<n;t++)
+	{
+		if (num[t]!=-1) continue;
+		num[t]=low[t]=counter++; stack[sp++]=t; edge[t]=&(objects[t]->out[0]);
+		cp=0; call[cp++]=t;
+		while (cp)
+		{
+			v=call[cp-1];
+			if (edge[v]->to_port!=-1)
+			{
+				w=edge[v]->to_object; edge[v]++;
+				if ((w<0) || (w>=n)) continue;
+				if (num[w]==-1)
+				{   // descend
+					num[w]=low[w]=counter++; stack[sp++]=w; edge[w]=&(objects[w]->out[0]);
+					call[cp++]=w;
+				}
+				else if ((comp[w]==-1) && (num[w]<low[v])) low[v]=num[w];   // w is on the stack
+			}
+			else
+			{
+				cp--;
+				if ((cp) && (low[v]<low[call[cp-1]])) low[call[cp-1]]=low[v];
+				if (low[v]==num[v])
+				{
+					do { w=stack[--sp]; comp[w]=c; } while (w!=v);
+					c++;
+				}
+			}
+		}
+	}
+	return(c);
+}
+
+
+void build_plan(void)
+{
+	EXECPLANStruct * plan;
+	int * indegree, * pos, * queue, * mark, * comp, * ext;
+	int n,t,i,to,next,count,qhead,qtail,s,links,sav_pause;
+	LINKStruct * act_link;
+	LINKStruct ** edge;
+
+	sav_pause=pause_processing();
+
+	plan = (EXECPLAN==&PLANS[0]) ? &PLANS[1] : &PLANS[0];
+	n=GLOBAL.objects;
+
+	links=0;
+	for (t=0;t<n;t++)
+		for (act_link=&(objects[t]->out[0]);act_link->to_port!=-1;act_link++) links++;
+
+	indegree=(int *)malloc((8*n+1)*sizeof(int));
+	edge=(LINKStruct **)malloc((n+1)*sizeof(LINKStruct *));
+	if ((!indegree) || (!edge) || (!reserve_plan(plan,n,links)))
+	{
+		report_error("Could not allocate memory for the execution plan");
+		free(indegree); free(edge);
+		resume_processing(sav_pause);
+		return;
+	}
+	pos=indegree+n; queue=pos+n; mark=queue+n; ext=mark+n; comp=ext+n;  // comp: 2*n, see find_loops
+
+	// the loops, and the inputs which each loop still expects from outside
+	find_loops(n,comp,queue,edge);
+	for (t=0;t<n;t++) { indegree[t]=0; pos[t]=-1; mark[t]=-1; ext[t]=0; }
+
+	for (t=0;t<n;t++)
+		for (act_link=&(objects[t]->out[0]);act_link->to_port!=-1;act_link++)
+		{
+			to=act_link->to_object;
+			if ((to>=0) && (to<n) && (to!=t))
+			{
+				indegree[to]++;
+				if (comp[to]!=comp[t]) ext[comp[to]]++;
+			}
+		}
+
+	// Kahn's algorithm: process all objects without pending inputs
+	qhead=0; qtail=0; count=0;
+	for (t=0;t<n;t++) if (!indegree[t]) queue[qtail++]=t;
+
+	while (count<n)
+	{
+		if (qhead<qtail) next=queue[qhead++];
+		else
+		{   // all remaining objects are part of a loop or depend on one:
+			// break a loop which has all its inputs from outside
+			for (next=0;(next<n) && ((pos[next]!=-1) || (ext[comp[next]]));next++);
+			if (next==n) for (next=0;pos[next]!=-1;next++);
+			write_logfile("execution plan: loop found at object %d (%s)",next,objnames[objects[next]->type]);
+		}
+		if (pos[next]!=-1) continue;
+
+		pos[next]=count;
+		plan->order[count]=objects[next];
+		plan->index[count]=next;
+		count++;
+
+		for (act_link=&(objects[next]->out[0]);act_link->to_port!=-1;act_link++)
+		{
+			to=act_link->to_object;
+			if ((to<0) || (to>=n) || (to==next)) continue;
+			if (comp[to]!=comp[next]) ext[comp[to]]--;
+			if (pos[to]==-1)
+				if (--indegree[to]==0) queue[qtail++]=to;
+		}
+	}
+	plan->count=count;
+
+	// successor tables, levels and feedback connections
+	plan->feedback=0;
+	s=0;
+	for (t=0;t<count;t++) plan->level[t]=0;
+	for (t=0;t<count;t++)
+	{
+		plan->succ_start[t]=s;
+		for (act_link=&(plan->order[t]->out[0]);act_link->to_port!=-1;act_link++)
+		{
+			to=act_link->to_object;
+			if ((to<0) || (to>=n)) continue;
+			if (pos[to]<=t)
+			{
+				plan->feedback++;
+				write_logfile("execution plan: feedback connection %s -> %s",
+					objnames[plan->order[t]->type],objnames[objects[to]->type]);
+				continue;
+			}
+			if (mark[to]==t) continue;   // already listed
+			mark[to]=t;
+			plan->succ[s++]=pos[to];
+			if (plan->level[pos[to]]<plan->level[t]+1) plan->level[pos[to]]=plan->level[t]+1;
+		}
+	}
+	plan->succ_start[count]=s;
+
+	if ((GLOBAL.worker_threads>1) && (!plan->feedback)) partition_plan(plan);
+	else { plan->tasks=0; for (t=0;t<count;t++) plan->stage[t]=0; }
+
+	for (t=0;t<n;t++) objects[t]->build_fanout();
+	free(indegree); free(edge);
+
+	EXECPLAN=plan;
+	resume_processing(sav_pause);
+}
+
+//  compiles the links of the object into the per-port fanout-table,
+//  the order of the links of a port is kept
+void BASE_CL::build_fanout(void)
+{
+	int count[MAX_PORTS+1];
+	int p,i,to,links;
+	LINKStruct * act_link;
+	FANOUTStruct * f;
+
+	for (p=0;p<=port_count;p++) count[p]=0;
+	links=0;
+	for (act_link=&(out[0]);act_link->to_port!=-1;act_link++)
+	{
+		p=act_link->from_port; to=act_link->to_object;
+		if ((p>=0) && (p<port_count) && (to>=0) && (to<GLOBAL.objects)) { count[p]++; links++; }
+	}
+
+	if (links>fanout_size)
+	{
+		if (!(f=(FANOUTStruct *)realloc(fanout,links*sizeof(FANOUTStruct))))
+		{
+			clear_fanout();
+			return;
+		}
+		fanout=f; fanout_size=links;
+	}
+
+	fanout_start[0]=0;
+	for (p=0;p<port_count;p++)
+	{
+		fanout_start[p+1]=fanout_start[p]+count[p];
+		count[p]=fanout_start[p];
+	}
+
+	for (act_link=&(out[0]);act_link->to_port!=-1;act_link++)
+	{
+		p=act_link->from_port; to=act_link->to_object;
+		if ((p>=0) && (p<port_count) && (to>=0) && (to<GLOBAL.objects))
+		{
+			i=count[p]++;
+			fanout[i].obj=objects[to];
+			fanout[i].port=act_link->to_port;
+			// allocate the block buffers here: parallel tasks may pass into the same object
+			objects[to]->get_block_port(act_link->to_port);
+		}
+	}
+}
+
+void BASE_CL::clear_fanout(void)
+{
+	for (int p=0;p<=port_count;p++) fanout_start[p]=0;
+}
+
+//  activates an empty plan, used while objects are deleted
+void clear_plan(void)
+{
+	EXECPLANStruct * plan;
+
+	plan = (EXECPLAN==&PLANS[0]) ? &PLANS[1] : &PLANS[0];
+	if (!reserve_plan(plan,0,0)) return;
+	plan->count=0;
+	plan->feedback=0;
+	plan->tasks=0;
+	plan->succ_start[0]=0;
+	EXECPLAN=plan;
+}
+
+
+//
+//  parallel execution
+//
+
+//  elements which only compute on their own members and in-ports
+//  and have a native work_block() (see block.cpp)
+int parallel_safe(BASE_CL * ob)
+{
+	switch (ob->type)
+	{
+		case OB_FILTER:
+		case OB_MAGNITUDE:
+		case OB_AVERAGE:
+		case OB_DEVIATION:
+		case OB_LIMITER:
+		case OB_MIXER4:
+		case OB_EVAL:
+		case OB_FFT:
+			return(TRUE);
+	}
+	return(FALSE);
+}
+
+int find_root(int * parent, int t)
+{
+	while (parent[t]!=t) t=parent[t]=parent[parent[t]];
+	return(t);
+}
+
+//  stage 0: sources, stage 1: parallel safe elements which only depend on
+//  stage 0/1 - elements, stage 2: all others. the stage 1 - elements are grouped
+//  into connected components, which are distributed to the task lists.
+//  elements which deliver values to the same consumer are in the same component,
+//  so a consumer never gets incoming_data() from two threads at a time
+void partition_plan(EXECPLANStruct * plan)
+{
+	int * taint, * parent, * size, * list, * comps;
+	int load[MAX_WORKERS];
+	int t,i,s,a,b,w,k,ncomps,lists;
+
+	plan->tasks=0;
+	for (t=0;t<plan->count;t++) plan->stage[t]=0;
+	if (!(taint=(int *)malloc((5*plan->count+1)*sizeof(int)))) return;
+	parent=taint+plan->count; size=parent+plan->count;
+	list=size+plan->count; comps=list+plan->count;
+
+	for (t=0;t<plan->count;t++) { taint[t]=0; parent[t]=t; size[t]=0; list[t]=-1; }
+
+	for (t=0;t<plan->count;t++)
+	{
+		if (plan->level[t]==0) plan->stage[t]=0;
+		else if ((!taint[t]) && parallel_safe(plan->order[t])) plan->stage[t]=1;
+		else plan->stage[t]=2;
+
+		if (plan->stage[t]==2)
+			for (i=plan->succ_start[t];i<plan->succ_start[t+1];i++)
+				taint[plan->succ[i]]=1;
+	}
+
+	// list[s] holds the first stage 1 - element which delivers to s
+	for (t=0;t<plan->count;t++)
+		if (plan->stage[t]==1)
+			for (i=plan->succ_start[t];i<plan->succ_start[t+1];i++)
+			{
+				s=plan->succ[i];
+				if (plan->stage[s]==1) b=s;
+				else if (list[s]==-1) { list[s]=t; continue; }
+				else b=list[s];
+				a=find_root(parent,t); b=find_root(parent,b);
+				if (a!=b) parent[b]=a;
+			}
+
+	ncomps=0;
+	for (t=0;t<plan->count;t++)
+		if (plan->stage[t]==1)
+		{
+			a=find_root(parent,t);
+			if (!size[a]) comps[ncomps++]=a;
+			size[a]++;
+		}
+
+	if (ncomps<2)
+	{   // nothing to run in parallel
+		for (t=0;t<plan->count;t++) plan->stage[t]=0;
+		free(taint);
+		return;
+	}
+
+	// largest components first, each one to the task list with the least elements
+	lists=GLOBAL.worker_threads;
+	if (lists>MAX_WORKERS) lists=MAX_WORKERS;
+	if (lists>ncomps) lists=ncomps;
+	for (w=0;w<lists;w++) load[w]=0;
+	for (i=1;i<ncomps;i++)
+		for (k=i;(k>0)&&(size[comps[k]]>size[comps[k-1]]);k--)
+		{ a=comps[k]; comps[k]=comps[k-1]; comps[k-1]=a; }
+	for (i=0;i<ncomps;i++)
+	{
+		for (w=0,k=1;k<lists;k++) if (load[k]<load[w]) w=k;
+		load[w]+=size[comps[i]];
+		list[comps[i]]=w;
+	}
+
+	k=0;
+	for (w=0;w<lists;w++)
+	{
+		plan->task_start[w]=k;
+		for (t=0;t<plan->count;t++)
+			if ((plan->stage[t]==1) && (list[find_root(parent,t)]==w))
+				plan->task[k++]=t;
+	}
+	plan->task_start[lists]=k;
+	plan->tasks=lists;
+	free(taint);
+	write_logfile("execution plan: %d independent branches on %d threads",ncomps,lists);
+}
+
+//  count=0: process one packet, count>0: process a block of count packets
+void call_object(BASE_CL * ob, int count)
+{
+	if (!count) { ob->work(); return; }
+	ob->block_pos=0;
+	ob->work_block(count);
+	ob->block_pos=-1;
+	ob->clear_block_inputs();
+}
+
+void run_object(BASE_CL * ob, int count)
+{
+	if (profiling) profile_work(ob,count);   // timed call, see profile.cpp
+	else call_object(ob,count);
+}
+
+void run_tasks(EXECPLANStruct * plan, int w, int count)
+{
+	for (int i=plan->task_start[w];i<plan->task_start[w+1];i++)
+		run_object(plan->order[plan->task[i]],count);
+}
+
+DWORD WINAPI WorkerProc(LPVOID lpv)
+{
+	WORKERStruct * worker = (WORKERStruct *) lpv;
+
+	while (1)
+	{
+		WaitForSingleObject(worker->start_event,INFINITE);
+		if (worker_exit) break;
+		run_tasks(worker_plan,worker->task,worker_count);
+		SetEvent(worker->done_event);
+	}
+	return(0);
+}
+
+//  processes one packet (count=0) or a block of count packets
+void execute_plan(int count)
+{
+	EXECPLANStruct * plan=EXECPLAN;
+	HANDLE done[MAX_WORKERS];
+	int t,w;
+
+	for (t=0;t<plan->count;t++)
+		if (plan->stage[t]==0) run_object(plan->order[t],count);
+
+	if (!plan->tasks) return;
+
+	if (plan->tasks-1<=workers)
+	{
+		worker_plan=plan;
+		worker_count=count;
+		for (w=1;w<plan->tasks;w++)
+		{
+			done[w-1]=WORKER[w-1].done_event;
+			SetEvent(WORKER[w-1].start_event);
+		}
+		run_tasks(plan,0,count);
+		WaitForMultipleObjects(plan->tasks-1,done,TRUE,INFINITE);
+	}
+	else for (t=0;t<plan->count;t++)
+		if (plan->stage[t]==1) run_object(plan->order[t],count);
+
+	for (t=0;t<plan->count;t++)
+		if (plan->stage[t]==2) run_object(plan->order[t],count);
+}
+
+//  (re)creates the worker threads. the processing thread works on the first
+//  task list, so threads-1 workers are started. init_workers(0) stops all workers
+void init_workers(int threads)
+{
+	DWORD dwThreadId;
+	int w,sav_pause;
+
+	if (processing_tls==TLS_OUT_OF_INDEXES) processing_tls=TlsAlloc();
+
+	sav_pause=pause_processing();
+	if (workers)
+	{
+		worker_exit=1;
+		for (w=0;w<workers;w++) SetEvent(WORKER[w].start_event);
+		for (w=0;w<workers;w++)
+		{
+			WaitForSingleObject(WORKER[w].thread,INFINITE);
+			CloseHandle(WORKER[w].thread);
+			CloseHandle(WORKER[w].start_event);
+			CloseHandle(WORKER[w].done_event);
+		}
+		workers=0;
+		worker_exit=0;
+	}
+
+	if (threads>MAX_WORKERS) threads=MAX_WORKERS;
+	for (w=0;w<threads-1;w++)
+	{
+		WORKER[w].task=w+1;
+		WORKER[w].start_event=CreateEvent(NULL,FALSE,FALSE,NULL);
+		WORKER[w].done_event=CreateEvent(NULL,FALSE,FALSE,NULL);
+		WORKER[w].thread=CreateThread(NULL,0,(LPTHREAD_START_ROUTINE)WorkerProc,(LPVOID)&WORKER[w],0,&dwThreadId);
+		if (!WORKER[w].thread)
+		{
+			CloseHandle(WORKER[w].start_event);
+			CloseHandle(WORKER[w].done_event);
+			report_error("Could not create worker thread");
+			break;
+		}
+		workers++;
+	}
+	if (workers) write_logfile("%d worker threads started",workers);
+	resume_processing(sav_pause);
+}
+
+
+//  counts the threads inside the processing. returns FALSE (the packet is
+//  skipped) while the processing is paused by another thread
+int enter_processing(void)
+{
+	int depth;
+
+	depth=(int)(INT_PTR)TlsGetValue(processing_tls);
+	if (!depth)
+	{   // a nested entry (work_packet -> process_block) counts the thread only once
+		InterlockedIncrement(&processing_active);
+		if (processing_pause && (processing_owner!=GetCurrentThreadId()))
+		{
+			InterlockedDecrement(&processing_active);
+			return(FALSE);
+		}
+	}
+	TlsSetValue(processing_tls,(LPVOID)(INT_PTR)(depth+1));
+	return(TRUE);
+}
+
+void leave_processing(void)
+{
+	int depth;
+
+	depth=(int)(INT_PTR)TlsGetValue(processing_tls);
+	TlsSetValue(processing_tls,(LPVOID)(INT_PTR)(depth-1));
+	if (depth==1) InterlockedDecrement(&processing_active);
+}
+
+//  stops the timer and waits until no other thread is inside the processing.
+//  returns the timer state for resume_processing()
+int pause_processing(void)
+{
+	int sav_timerpause;
+	LONG others;
+	MSG msg;
+
+	sav_timerpause=TIMING.pause_timer;
+	TIMING.pause_timer=1;
+	if (InterlockedIncrement(&processing_pause)==1) processing_owner=GetCurrentThreadId();
+
+	// our own processing can't leave, a thread which sent us a message waits for the reply
+	others=(LONG)(INT_PTR)TlsGetValue(processing_tls) ? 1 : 0;
+	if (InSendMessage()) others++;
+
+	// elements may send messages to our windows while we wait
+	while (processing_active>others)
+		if (MsgWaitForMultipleObjects(0,NULL,FALSE,1,QS_SENDMESSAGE)==WAIT_OBJECT_0)
+			PeekMessage(&msg,NULL,0,0,PM_NOREMOVE);
+
+	return(sav_timerpause);
+}
+
+void resume_processing(int sav_timerpause)
+{
+	if (InterlockedDecrement(&processing_pause)==0) processing_owner=0;
+	TIMING.pause_timer=sav_timerpause;
+}
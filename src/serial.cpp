@@ -0,0 +1,227 @@
+/* -----------------------------------------------------------------------------
+
+  BrainBay  Version 2.0, GPL 2003-2017, contact: chris@shifz.org
+
+  MODULE: SERIAL.CPP:  event driven access to the serial ports
+
+        serial_open   - opens and configures a port for overlapped I/O
+        serial_read   - waits for received bytes and reads them
+        serial_write  - writes a buffer to the port
+        serial_cancel - wakes up a thread which waits in serial_read
+        serial_stop   - ends the reader thread of a port and waits for it
+        serial_close  - closes the port
+
+  The device reader thread (tty.cpp) and the ComPort Reader element use these
+  functions instead of polling the receive queue: serial_read waits for the
+  EV_RXCHAR event of the port (WaitCommEvent), so the thread sleeps until data
+  arrives and wakes up without the delay of a polling interval. All bytes which
+  are in the receive queue are read at once (up to the given size), the
+  arrival time is taken when the wait returns.
+  A cancel ends the pending I/O of the reader thread (CancelIo in the thread
+  which started it), so serial_stop can wait for the thread without a
+  timeout and the handle is closed only when no thread uses it.
+
+  This program is free software; you can redistribute it and/or
+  modify it under the terms of the GNU General Public License
+  as published by the Free Software Foundation; See the
+  GNU General Public License for more details.
+
+-----------------------------------------------------------------------------*/
+
+#include "brainBay.h"
+
+
+BOOL serial_open(SERIALPORTStruct * sp, int port, DWORD baudrate, int flowcontrol)
+{
+	COMMTIMEOUTS timeouts;
+    DCB dcb = {0};
+	char PORTNAME[20];
+
+	memset(sp,0,sizeof(SERIALPORTStruct));
+	sp->handle=INVALID_HANDLE_VALUE;
+	if (!port) return(FALSE);
+
+	sprintf(PORTNAME,"\\\\.\\COM%d",port);
+    sp->handle = CreateFile( PORTNAME,GENERIC_READ | GENERIC_WRITE, 
+                  0,0,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED,0);
+    if (sp->handle == INVALID_HANDLE_VALUE) return(FALSE);
+
+    if (!GetCommState(sp->handle, &dcb))      // get current DCB settings
+	{ report_error("GetCommState"); goto failed; }
+
+    // update DCB rate, byte size, parity, and stop bits size
+	dcb.DCBlength = sizeof(dcb);
+    dcb.BaudRate = baudrate;
+    dcb.ByteSize = 8;
+	dcb.Parity   = NOPARITY;
+    dcb.StopBits = ONESTOPBIT;
+	dcb.EvtChar = '\0';
+
+    // update flow control settings
+    dcb.fDtrControl     =  DTR_CONTROL_ENABLE;
+    dcb.fRtsControl     =  RTS_CONTROL_ENABLE;
+    dcb.fOutxCtsFlow    = flowcontrol ? TRUE : FALSE;
+    dcb.fOutxDsrFlow    = flowcontrol ? TRUE : FALSE;
+    dcb.fDsrSensitivity = FALSE;
+    dcb.fOutX           = FALSE;
+    dcb.fInX            = FALSE;
+    dcb.fTXContinueOnXoff = FALSE;
+    dcb.XonChar         = 0;
+    dcb.XoffChar        = 0;
+    dcb.XonLim          = 0;
+    dcb.XoffLim         = 0;
+    dcb.fParity = FALSE;
+
+    if (!SetCommState(sp->handle, &dcb))     // set new state
+	{ report_error("SetCommState failed"); goto failed; }
+
+	// set comm buffer sizes
+    if (!SetupComm(sp->handle, SERIAL_QUEUESIZE, SERIAL_QUEUESIZE))
+	{ report_error("SetupComm failed"); goto failed; }
+
+	// a read returns at once with the bytes which are in the receive queue
+	timeouts.ReadIntervalTimeout=MAXDWORD;
+	timeouts.ReadTotalTimeoutMultiplier=0;
+	timeouts.ReadTotalTimeoutConstant=0;
+	timeouts.WriteTotalTimeoutMultiplier=0;
+	timeouts.WriteTotalTimeoutConstant=0;
+    if (!SetCommTimeouts(sp->handle, &timeouts))
+	{ report_error("SetCommTimeouts failed"); goto failed; }
+
+    if (!EscapeCommFunction(sp->handle, SETDTR))        // raise DTR
+	{ report_error("EscapeCommFunction failed"); goto failed; }
+
+	SetCommMask (sp->handle, EV_RXCHAR);
+
+	sp->ovread.hEvent=CreateEvent(NULL,TRUE,FALSE,NULL);
+	sp->ovwait.hEvent=CreateEvent(NULL,TRUE,FALSE,NULL);
+	sp->ovwrite.hEvent=CreateEvent(NULL,TRUE,FALSE,NULL);
+	sp->cancel=CreateEvent(NULL,TRUE,FALSE,NULL);
+	if ((!sp->ovread.hEvent) || (!sp->ovwait.hEvent) || (!sp->ovwrite.hEvent) || (!sp->cancel))
+	{ report_error("CreateEvent failed"); goto failed; }
+
+	return(TRUE);
+
+failed:
+	serial_close(sp);
+	return(FALSE);
+}
+
+
+//  waits up to timeout milliseconds for received bytes and reads up to size bytes,
+//  returns the number of bytes, 0 at a timeout or cancel, -1 at an error
+int serial_read(SERIALPORTStruct * sp, unsigned char * buf, int size, DWORD timeout, LONGLONG * arrival)
+{
+	DWORD dwRead,dwEvent;
+	HANDLE events[2];
+	LONGLONG woken=0;
+
+	if (sp->handle==INVALID_HANDLE_VALUE) return(-1);
+	while (1)
+	{
+		dwRead=0;
+		if (!ReadFile(sp->handle,buf,size,&dwRead,&sp->ovread))
+		{
+			if (GetLastError()!=ERROR_IO_PENDING) return(-1);
+			events[0]=sp->ovread.hEvent;
+			events[1]=sp->cancel;
+			if (WaitForMultipleObjects(2,events,FALSE,INFINITE)!=WAIT_OBJECT_0)
+			{
+				CancelIo(sp->handle);
+				GetOverlappedResult(sp->handle,&sp->ovread,&dwRead,TRUE);
+				return(0);
+			}
+			if (!GetOverlappedResult(sp->handle,&sp->ovread,&dwRead,FALSE)) return(-1);
+		}
+		if (dwRead)
+		{
+			if (arrival)
+			{
+				if (woken) *arrival=woken;
+				else QueryPerformanceCounter((_LARGE_INTEGER *)arrival);
+			}
+			return((int)dwRead);
+		}
+
+		if (!sp->waiting)
+		{   // start the wait and read once more, bytes could have arrived in between
+			if (!WaitCommEvent(sp->handle,&sp->eventmask,&sp->ovwait))
+			{
+				if (GetLastError()!=ERROR_IO_PENDING) return(-1);
+				sp->waiting=TRUE;
+			}
+			continue;
+		}
+
+		events[0]=sp->ovwait.hEvent;
+		events[1]=sp->cancel;
+		switch (WaitForMultipleObjects(2,events,FALSE,timeout))
+		{
+			case WAIT_OBJECT_0: break;
+			case WAIT_TIMEOUT: return(0);      // the wait stays pending
+			default:                           // cancel: end the wait of this thread
+				CancelIo(sp->handle);
+				GetOverlappedResult(sp->handle,&sp->ovwait,&dwEvent,TRUE);
+				sp->waiting=FALSE;
+				return(0);
+		}
+		QueryPerformanceCounter((_LARGE_INTEGER *)&woken);
+		sp->waiting=FALSE;
+		if (!GetOverlappedResult(sp->handle,&sp->ovwait,&dwEvent,FALSE)) return(-1);
+	}
+}
+
+
+BOOL serial_write(SERIALPORTStruct * sp, unsigned char * buf, int len)
+{
+	DWORD dwWritten=0;
+
+	if (sp->handle==INVALID_HANDLE_VALUE) return(FALSE);
+	if (!WriteFile(sp->handle,buf,len,&dwWritten,&sp->ovwrite))
+	{
+		if (GetLastError()!=ERROR_IO_PENDING) return(FALSE);
+		if (!GetOverlappedResult(sp->handle,&sp->ovwrite,&dwWritten,TRUE)) return(FALSE);
+	}
+	return(dwWritten==(DWORD)len);
+}
+
+
+void serial_cancel(SERIALPORTStruct * sp)
+{
+	if (sp->cancel) SetEvent(sp->cancel);
+}
+
+
+//  cancels the reader thread of the port and waits until it has ended, the
+//  thread must leave its loop when it is woken up (done flag). Messages sent
+//  to our windows by the thread are handled while we wait.
+void serial_stop(SERIALPORTStruct * sp, HANDLE * thread)
+{
+	MSG msg;
+
+	if (!*thread) return;
+	serial_cancel(sp);
+	while (MsgWaitForMultipleObjects(1,thread,FALSE,INFINITE,QS_SENDMESSAGE)==WAIT_OBJECT_0+1)
+		PeekMessage(&msg,NULL,0,0,PM_NOREMOVE);
+	CloseHandle(*thread);
+	*thread=NULL;
+}
+
+
+void serial_close(SERIALPORTStruct * sp)
+{
+	if (sp->handle!=INVALID_HANDLE_VALUE)
+	{
+		SetCommMask(sp->handle,0);          // completes a pending WaitCommEvent
+		CancelIo(sp->handle);
+		if (!PurgeComm(sp->handle, PURGE_FLAGS))  report_error("PurgeComm failed..");
+		if (!EscapeCommFunction(sp->handle, CLRDTR)) report_error("EscapeCommFunction failed");
+		CloseHandle(sp->handle);
+	}
+	if (sp->ovread.hEvent) CloseHandle(sp->ovread.hEvent);
+	if (sp->ovwait.hEvent) CloseHandle(sp->ovwait.hEvent);
+	if (sp->ovwrite.hEvent) CloseHandle(sp->ovwrite.hEvent);
+	if (sp->cancel) CloseHandle(sp->cancel);
+	memset(sp,0,sizeof(SERIALPORTStruct));
+	sp->handle=INVALID_HANDLE_VALUE;
+}
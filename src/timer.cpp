@@ -11,6 +11,16 @@
   triggers the worker-functions of all objects in case of an archive read.
   The Windows PerformanceCounter-functions are used to retrieve excat system time
 
+  Pacing: pace_packets() processes all packets which are due at a timer tick.
+  At sampling rates above 1000 Hz (or when a tick comes late) several packets
+  are due, they are processed as one catch-up block (see block.cpp). The lag
+  of the processing is measured every tick: from PACING_DEGRADE ms on, the
+  dialog- and draw- updates are reduced, from PACING_DROP ms on the backlog
+  is given up so that the session continues in real time. No packet of an
+  archive or EDF-file is lost by this, the pacing is only resynced (counted in
+  TIMING.resynced); the packets of the synthetic device (headless.cpp) stand
+  for a device which keeps sending, they are counted as dropped.
+
   This program is free software; you can redistribute it and/or
   modify it under the terms of the GNU General Public License
   as published by the Free Software Foundation; See the
@@ -38,27 +48,78 @@ void init_system_time(void)
 	TIMING.packetcounter=0;
 	TIMING.dialog_update=0;
 	TIMING.draw_update=0;
+	TIMING.lag=0;
+	TIMING.maxlag=0;
+	TIMING.behind=0;
+	TIMING.dropped=0;
+	TIMING.resynced=0;
 
 }
 
 
 
+//  called by the parsers when a packet is complete
 void process_packets(void)
 {
-	static double calc;
-	int t;
+	if (CAPTFILE.do_write) record_packet();
+
+	// packets from a device: clock model and resampling, see clock.cpp
+	PACKET.clocktime=0;
+	if ((PACKET.arrival) && (!CAPTFILE.do_read) && (clock_packet())) return;
+	emit_packet();
+}
+
+//  passes the packet in PACKET.buffer to the processing
+void emit_packet(void)
+{
+	if ((PACKETRING.active) && (GetCurrentThreadId()==PACKETRING.reader_id))
+	{   // COM-port reader: the packet is processed by the processing thread
+		push_packet();
+		return;
+	}
+	memcpy(PACKET.work_buffer,PACKET.buffer,sizeof(PACKET.work_buffer));
+	PACKET.work_switches=PACKET.switches;
+	if (PACKET.arrival) PACKET.timestamp=PACKET.arrival;
+	else QueryPerformanceCounter((_LARGE_INTEGER *)&PACKET.timestamp);
+	PACKET.work_clocktime=PACKET.clocktime ? PACKET.clocktime : PACKET.timestamp;
+	work_packet();
+}
+
+//  processes the packet in PACKET.work_buffer
+void work_packet(void)
+{
+	int t,slow;
+
+	if (!enter_processing()) return;
+
+	if (GLOBAL.headless && (TIMING.packetcounter>=GLOBAL.session_end))
+	{   // batch mode: all packets of the run are processed
+		process_block();
+		GLOBAL.running=FALSE;
+		leave_processing();
+		return;
+	}
 
     TIMING.ppscounter++;
     TIMING.packetcounter++;
 	
 
-	if (TIMING.dialog_update++ >= GLOBAL.dialog_interval) TIMING.dialog_update=0; 
-	if (TIMING.draw_update++ >= GLOBAL.draw_interval) TIMING.draw_update=0; 
+	if (GLOBAL.headless)
+	{   // no dialog- or display updates in batch mode
+		TIMING.dialog_update=1; TIMING.draw_update=1;
+	}
+	else
+	{   // less display work while the processing is behind
+		slow = TIMING.behind ? PACING_SLOWUPDATE : 1;
+		if (TIMING.dialog_update++ >= GLOBAL.dialog_interval*slow) TIMING.dialog_update=0; 
+		if (TIMING.draw_update++ >= GLOBAL.draw_interval*slow) TIMING.draw_update=0; 
+	}
 
 
-	if (GLOBAL.session_length && (TIMING.packetcounter>=GLOBAL.session_end))
+	if ((!GLOBAL.headless) && GLOBAL.session_length && (TIMING.packetcounter>=GLOBAL.session_end))
 	{
 		int sav_fly=GLOBAL.fly;
+		process_block();
 		SendMessage(ghWndStatusbox,WM_COMMAND,IDC_STOPSESSION,0);
 		
 		TIMING.packetcounter= GLOBAL.session_start;
@@ -73,22 +134,92 @@ void process_packets(void)
 		}
 		 		
 	}
-	else
+	else if ((BLOCK.active) || (BLOCK.catchup)) queue_block_packet();
+	else execute_plan(0);
+	if (!TIMING.dialog_update) update_statusinfo();
+	leave_processing();
+}
+	
+
+//  processes the packets which are due at time pc (archive or no device)
+void pace_packets(LONGLONG pc)
+{
+	LONGLONG lag;
+	long due,drop;
+	MSG msg;
+
+	lag=pc-TIMING.readtimestamp;
+	due=(lag>=TTY.packettime) ? (long)(lag/TTY.packettime) : 0;
+	TIMING.lag=(int)(lag*1000/TIMING.pcfreq);
+	if (TIMING.lag<0) TIMING.lag=0;
+	if (TIMING.lag>TIMING.maxlag) TIMING.maxlag=TIMING.lag;
+	TIMING.behind=(TIMING.lag>=PACING_DEGRADE);
+
+	if ((!GLOBAL.fly) && (TIMING.lag>=PACING_DROP) && (due>MAX_BLOCKSIZE))
+	{   // too far behind: give up the backlog, process one block
+		drop=due-MAX_BLOCKSIZE;
+		TIMING.readtimestamp+=TTY.packettime*drop;
+		due-=drop;
+		if (GLOBAL.synthetic)
+		{
+			TIMING.dropped+=drop;
+			write_logfile("processing %d ms behind, %ld packets dropped",TIMING.lag,drop);
+		}
+		else
+		{   // the next packet is still read, only the pacing restarts
+			TIMING.resynced+=drop;
+			write_logfile("processing %d ms behind, pacing resynced by %ld packets",TIMING.lag,drop);
+		}
+	}
+
+	// the packets of this tick are produced here: process them as one block
+	if ((due>1) && (BLOCK.possible) && (!GLOBAL.fly) && ((CAPTFILE.do_read) || (TTY.read_pause)))
+		BLOCK.catchup=(due<MAX_BLOCKSIZE) ? due : MAX_BLOCKSIZE;
+
+	// Reading from Archive & next packet demanded? -> read from File and Process Packets
+	while ((pc-TIMING.readtimestamp >= TTY.packettime) || (GLOBAL.fly))
 	{
+		TIMING.readtimestamp+=TTY.packettime;
+		TIMING.acttime=TIMING.readtimestamp;
 
-		for (t=0;t<GLOBAL.objects;t++)
-		 if (objects[t]) objects[t]->work();
-		
+		if(CAPTFILE.do_read&&(CAPTFILE.offset<=TIMING.packetcounter)&&(CAPTFILE.offset+CAPTFILE.length>TIMING.packetcounter))
+		{
+			long tmp;
+			tmp=TIMING.packetcounter;
+			play_captfile();
+			if ((TIMING.packetcounter-tmp-1)>0)
+			 TIMING.readtimestamp+=TTY.packettime*(TIMING.packetcounter-tmp-1);
+			//return;
+		}
+
+		// process packets in case of no File-Read and no Com-Read
+		else if ((TTY.read_pause) && (!GLOBAL.neurobit_available) && (!GLOBAL.emotiv_available) && (!GLOBAL.ganglion_available))  
+		{
+			if (GLOBAL.synthetic) synthetic_packet();
+			process_packets();
+		}
+
+		if (GLOBAL.fly)
+		{
+			if(PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+			{	
+				TranslateMessage(&msg);
+				DispatchMessage(&msg);
+			}
+		}
+	}
+
+	if (BLOCK.catchup)
+	{   // the catch-up block ends with the tick
+		BLOCK.catchup=0;
+		if (!BLOCK.active) process_block();
 	}
-	if (!TIMING.dialog_update) update_statusinfo();
-	
 }
-	
+
 
 void CALLBACK TimerProc(UINT uID,UINT uMsg,DWORD dwUser,DWORD dw1,DWORD dw2)
 {
 	LONGLONG pc;
-	MSG msg;
 
     QueryPerformanceCounter((_LARGE_INTEGER *)&pc);
 	//TIMING.acttime=pc;
@@ -107,36 +238,7 @@ void CALLBACK TimerProc(UINT uID,UINT uMsg,DWORD dwUser,DWORD dw1,DWORD dw2)
 		    TIMING.ppscounter=0;
 		}
 
-		// Reading from Archive & next packet demanded? -> read from File and Process Packets
-		while ((pc-TIMING.readtimestamp >= TTY.packettime) || (GLOBAL.fly))
-		{
-			TIMING.readtimestamp+=TTY.packettime;
-			TIMING.acttime=TIMING.readtimestamp;
-
-			if(CAPTFILE.do_read&&(CAPTFILE.offset<=TIMING.packetcounter)&&(CAPTFILE.offset+CAPTFILE.length>TIMING.packetcounter))
-			{
-				long tmp;
-				tmp=TIMING.packetcounter;
-				read_captfile(TTY.amount_to_read); 	
-				ParseLocalInput(TTY.amount_to_read);
-				if ((TIMING.packetcounter-tmp-1)>0)
-				 TIMING.readtimestamp+=TTY.packettime*(TIMING.packetcounter-tmp-1);
-				//return;
-			}
-
-			// process packets in case of no File-Read and no Com-Read
-			else if ((TTY.read_pause) && (!GLOBAL.neurobit_available) && (!GLOBAL.emotiv_available) && (!GLOBAL.ganglion_available))  
-				process_packets();
-
-			if (GLOBAL.fly)
-			{
-				if(PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
-				{	
-					TranslateMessage(&msg);
-					DispatchMessage(&msg);
-				}
-			}
-		}	
+		pace_packets(pc);
 	}
 }
 
@@ -148,6 +250,9 @@ void start_timer(void)
 	QueryPerformanceCounter((_LARGE_INTEGER *)&TIMING.timestamp);
 	TIMING.readtimestamp=TIMING.timestamp;
 	TIMING.ppscounter=0;
+	TIMING.maxlag=0;
+	TIMING.dropped=0;
+	TIMING.resynced=0;
 
 	if(!(TIMING.timerid= timeSetEvent(1,0,TimerProc,1,TIME_PERIODIC | TIME_CALLBACK_FUNCTION)))
 							report_error("Could not set Timer!");
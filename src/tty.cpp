@@ -3,6 +3,7 @@
   BrainBay  Version 2.0, GPL 2003-2017, contact: chris@shifz.org
   
   MODULE: TTY.cpp:  contains functions for Com-opening, reading, and the reader thread
+                    (the port is accessed via the functions in serial.cpp)
 
         SetupCommPort     - Opens the port for the first time
         WaitForThreads    - Sets the thread exit event and wait for worker
@@ -42,7 +43,6 @@ BOOL SetupCommPort(int port)
     DWORD dwReadStatId;
     DWORD dwWriteStatId;
 	int sav_port,sav_pause;
-    DCB dcb = {0};
 	char PORTNAME[10];
 
 	if (!port) return(false);
@@ -62,85 +62,30 @@ BOOL SetupCommPort(int port)
 	PACKET.number=0;
 	PACKET.old_number=0;
 	PACKET.info=0;
+	reset_clock();
 
-    // open communication port handle
-//    TTY.COMDEV = CreateFile( PORTNAME,GENERIC_READ | GENERIC_WRITE, 
-//                  0,0,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL | FILE_FLAG_OVERLAPPED,0);
+    // open communication port handle (overlapped, see serial.cpp)
+	if (!serial_open(&TTY.SERIAL, port, TTY.BAUDRATE, TTY.FLOW_CONTROL)) goto failed;
+	TTY.COMDEV=TTY.SERIAL.handle;
 
-    TTY.COMDEV = CreateFile( PORTNAME,GENERIC_READ | GENERIC_WRITE, 
-                  0,0,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,0);
-
-    if (TTY.COMDEV == INVALID_HANDLE_VALUE) goto failed;
-    
-    if (!GetCommState(TTY.COMDEV, &dcb))      // get current DCB settings
-	{ report_error("GetCommState");goto failed; }
-
-   
-    // update DCB rate, byte size, parity, and stop bits size
-   
-	dcb.DCBlength = sizeof(dcb);
-    dcb.BaudRate = TTY.BAUDRATE;
-    dcb.ByteSize = 8;
-    
-	dcb.Parity   = NOPARITY;
-    dcb.StopBits = ONESTOPBIT;
-	dcb.EvtChar = '\0';
-
-   
-    // update flow control settings
-   
-    dcb.fDtrControl     =  DTR_CONTROL_ENABLE;
-    dcb.fRtsControl     =  RTS_CONTROL_ENABLE;
-
-	if (TTY.FLOW_CONTROL)
-	{
-      dcb.fOutxCtsFlow    = TRUE;
-      dcb.fOutxDsrFlow    = TRUE;
-	}
-	else
-	{
-      dcb.fOutxCtsFlow    = FALSE;
-      dcb.fOutxDsrFlow    = FALSE;
-	}
-
-    dcb.fDsrSensitivity = FALSE;;
-    dcb.fOutX           = FALSE;
-    dcb.fInX            = FALSE;
-    dcb.fTXContinueOnXoff = FALSE;
-    dcb.XonChar         = 0;
-    dcb.XoffChar        = 0;
-    dcb.XonLim          = 0;
-    dcb.XoffLim         = 0;
-    dcb.fParity = FALSE; //TRUE;
-
-    if (!SetCommState(TTY.COMDEV, &dcb))     // set new state
-	{ report_error("SetCommState failed"); goto failed;}
-	
-	// set comm buffer sizes
-    if (!SetupComm(TTY.COMDEV, 1024, 1024))
-	{  report_error("SetupComm failed");goto failed;}
-
-    if (!EscapeCommFunction(TTY.COMDEV, SETDTR))        // raise DTR
-	{  report_error("EscapeCommFunction failed");goto failed;}
-
-	  SetCommMask (TTY.COMDEV, EV_RXCHAR | EV_CTS | EV_DSR | EV_RLSD | EV_RING);
-
-      
     // start the reader and writer threads
 
 	fThreadDone = FALSE;
 
+	// the ring has to run before the reader delivers the first packet
     TTY.READERTHREAD =  
-		CreateThread( NULL, 1000, (LPTHREAD_START_ROUTINE) ReaderProc, 0, 0, &dwReadStatId);
+		CreateThread( NULL, 1000, (LPTHREAD_START_ROUTINE) ReaderProc, 0, CREATE_SUSPENDED, &dwReadStatId);
     if (TTY.READERTHREAD == NULL)
 	{ report_error("CreateThread failed"); goto failed;}
+	start_packetring(dwReadStatId);
+	ResumeThread(TTY.READERTHREAD);
 
 	TTY.WRITERTHREAD =
 		CreateThread( NULL, 1000, (LPTHREAD_START_ROUTINE) WriterProc, 0, 0, &dwWriteStatId);
     if (TTY.WRITERTHREAD == NULL)
 	{ report_error("CreateWriterThread failed"); goto failed;}
 
-	write_logfile("COMPORT opened: %s", PORTNAME);
+	write_logfile("COMPORT opened: %s, read size %d", PORTNAME, TTY.readsize);
 	TTY.amount_to_write=0;	
 	TTY.read_pause=sav_pause;
 
@@ -159,6 +104,7 @@ failed:
 		
 			TTY.read_pause=sav_pause;
 			TTY.PORT=sav_port;
+			serial_close(&TTY.SERIAL);
 			TTY.COMDEV=INVALID_HANDLE_VALUE;
 			TTY.CONNECTED=FALSE;
 			TTY.amount_to_write=0;
@@ -176,35 +122,21 @@ PURPOSE: Thread function controls comm port reading
 
 DWORD WINAPI ReaderProc(LPVOID lpv)
 {
-    DWORD 	   dwRead;          // bytes actually read
-    DWORD      dwBytesTransferred;           // result from WaitForSingleObject
-    struct _COMSTAT status;
-    unsigned long   etat;
-	//
+	LONGLONG arrival;
+	int      size,n;
 
     while (!fThreadDone) 
 	{
-
-		// Wait for an event to occur for the port.
-  	    //	WaitCommEvent (TTY.COMDEV, &dwCommModemStatus, 0);
-
-		// Re-specify the set of events to be monitored for the port.
-	    //	SetCommMask (TTY.COMDEV, EV_RXCHAR | EV_CTS | EV_DSR | EV_RING);
         if ((TTY.CONNECTED) && (!GLOBAL.loading))
 		{
-          dwBytesTransferred = 0;
-          if (ClearCommError(TTY.COMDEV, &etat, &status))
-            dwBytesTransferred = status.cbInQue;
-   
-		  if (dwBytesTransferred) 
-	  	  {
- 				dwRead=0;
-				// Read the data from the serial port.
-				ReadFile (TTY.COMDEV, TTY.readBuf, dwBytesTransferred, &dwRead, 0);
-				// Display the data read.
-				if ((dwRead)&&(!TTY.read_pause)) ParseLocalInput((int)dwRead);
-		  }  else Sleep (1);
+			// wait for the received bytes and pass the whole buffer to the decoder
+			size=TTY.readsize;
+			if ((size<1) || (size>(int)sizeof(TTY.readBuf))) size=sizeof(TTY.readBuf);
+			n=serial_read(&TTY.SERIAL, TTY.readBuf, size, 100, &arrival);
+			if ((n>0) && (!TTY.read_pause)) ParseLocalInput(n,arrival);
+			else if (n<0) Sleep(10);
 		}
+		else Sleep(10);
 	}
 	write_logfile("COMPORT closed");    
     return 1;
@@ -220,15 +152,13 @@ PURPOSE: Thread function controls comm port reading
 
 DWORD WINAPI WriterProc(LPVOID lpv)
 {
-    DWORD dwWritten;
-
     while (!fThreadDone) 
 	{
         if ((TTY.CONNECTED)&&(TTY.amount_to_write>0))
 		{
 			if ( WaitForSingleObject( TTY.writeMutex, INFINITE ) == WAIT_OBJECT_0 )
 			{
-			    WriteFile(TTY.COMDEV, TTY.writeBuf, TTY.amount_to_write, &dwWritten, 0); 
+			    serial_write(&TTY.SERIAL, TTY.writeBuf, TTY.amount_to_write); 
 				TTY.amount_to_write=0;
 				ReleaseMutex( TTY.writeMutex );
 			}
@@ -400,15 +330,11 @@ BOOL BreakDownCommPort()
 	if (TTY.COMDEV==INVALID_HANDLE_VALUE) return TRUE;
 	TTY.read_pause=TRUE;
 	fThreadDone = TRUE;
+	serial_stop(&TTY.SERIAL,&TTY.READERTHREAD);   // the reader has ended before the port is closed
+	stop_packetring();
 		
-    if (!PurgeComm(TTY.COMDEV, PURGE_FLAGS))  report_error("PurgeComm failed..");
-    if (!EscapeCommFunction(TTY.COMDEV, CLRDTR)) report_error("EscapeCommFunction failed");
-    // if (!SetCommTimeouts(TTY.COMDEV,  &(TTY.TIMEOUTSORIG)))   report_error("SetCommTimeouts failed");
-
-	CloseHandle(TTY.COMDEV);
+	serial_close(&TTY.SERIAL);
 	TTY.COMDEV=INVALID_HANDLE_VALUE;
-    
-	CloseHandle(TTY.READERTHREAD);
     //CloseHandle(TTY.WRITERTHREAD);
     
 	TTY.read_pause=sav_pause;